@@ -17,4 +17,47 @@
 
 #include <dmsdk/dlib/atomic.h>
 
+// Pointer sized variants, used by the internal lock free lists
+
+/**
+ * Atomic compare and store pointer. Compares the value at ptr with comparand and stores value if equal.
+ * @param ptr Pointer to the pointer to compare and store to
+ * @param value Value to store
+ * @param comparand Value to compare with
+ * @return The previous value
+ */
+inline void* dmAtomicCompareStorePtr(void* volatile* ptr, void* value, void* comparand)
+{
+#if defined(_MSC_VER)
+    return InterlockedCompareExchangePointer(ptr, value, comparand);
+#else
+    return __sync_val_compare_and_swap(ptr, comparand, value);
+#endif
+}
+
+/**
+ * Atomic exchange pointer. Stores value and returns the previous value
+ * @param ptr Pointer to the pointer to store to
+ * @param value Value to store
+ * @return The previous value
+ */
+inline void* dmAtomicExchangePtr(void* volatile* ptr, void* value)
+{
+#if defined(_MSC_VER)
+    return InterlockedExchangePointer(ptr, value);
+#else
+    return __sync_lock_test_and_set(ptr, value);
+#endif
+}
+
+/**
+ * Atomic get pointer
+ * @param ptr Pointer to the pointer to get
+ * @return The current value
+ */
+inline void* dmAtomicGetPtr(void* volatile* ptr)
+{
+    return dmAtomicCompareStorePtr(ptr, 0, 0);
+}
+
 #endif //DM_ATOMIC_H
@@ -21,6 +21,19 @@ namespace dmEasing
 {
     #include "easing_lookup.h"
 
+    static inline float Sample(const float* lookup, int sample_count, float t)
+    {
+        t = dmMath::Clamp(t, 0.0f, 1.0f);
+        int index1 = (int) (t * (sample_count-1));
+        int index2 = dmMath::Min(index1 + 1, sample_count-1);
+
+        float val1 = lookup[index1];
+        float val2 = lookup[index2];
+
+        float diff = (t - index1 * (1.0f / (sample_count-1))) * (sample_count-1);
+        return val1 * (1.0f - diff) + val2 * diff;
+    }
+
     float GetValue(Type type, float t)
     {
         return GetValue(Curve(type), t);
@@ -28,10 +41,7 @@ namespace dmEasing
 
     float GetValue(Curve curve, float t)
     {
-        t = dmMath::Clamp(t, 0.0f, 1.0f);
         int sample_count;
-        int index1, index2;
-        float val1, val2;
         float* lookup;
 
         if (curve.type == dmEasing::TYPE_FLOAT_VECTOR)
@@ -52,14 +62,17 @@ namespace dmEasing
             lookup      += curve.type * (EASING_SAMPLES + 1); // NOTE: + 1 as the last sample is duplicated
         }
 
-        index1 = (int) (t * (sample_count-1));
-        index2 = dmMath::Min(index1 + 1, sample_count-1);
-
-        val1 = lookup[index1];
-        val2 = lookup[index2];
+        return Sample(lookup, sample_count, t);
+    }
 
-        float diff = (t - index1 * (1.0f / (sample_count-1))) * (sample_count-1);
-        return val1 * (1.0f - diff) + val2 * diff;
+    void GetValues(Type type, uint32_t count, const float* t, float* out)
+    {
+        assert(type < TYPE_FLOAT_VECTOR);
+        const float* lookup = EASING_LOOKUP + type * (EASING_SAMPLES + 1);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            out[i] = Sample(lookup, EASING_SAMPLES, t[i]);
+        }
     }
 }
 
@@ -105,6 +105,15 @@ namespace dmEasing
      */
     float GetValue(Type type, float t);
     float GetValue(Curve curve, float t);
+
+    /**
+     * Easing-curve evaluation of several values with the same built-in curve
+     * @param type curve type, TYPE_FLOAT_VECTOR is not supported
+     * @param count number of values
+     * @param t times in the range [0,1]
+     * @param out curve values
+     */
+    void GetValues(Type type, uint32_t count, const float* t, float* out);
 }
 
 #endif // DM_EASING
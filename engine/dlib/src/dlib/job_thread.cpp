@@ -14,16 +14,17 @@
 
 
 #include <stdio.h> // printf
-
-#include <dmsdk/dlib/array.h>
+#include <assert.h>
 
 #include <dmsdk/dlib/array.h>
 #include <dmsdk/dlib/atomic.h>
 #include <dmsdk/dlib/profile.h>
 #include <dmsdk/dlib/log.h>
+#include <dmsdk/dlib/spinlock.h>
 #include <dlib/thread.h>
 #include <dlib/math.h>
 #include <dlib/dstrings.h>
+#include <dlib/time.h>
 
 #if defined(DM_HAS_THREADS)
     #include <dmsdk/dlib/condition_variable.h>
@@ -36,114 +37,459 @@
 namespace dmJobThread
 {
 
-struct JobItem
+// Jobs are allocated in pages, that are never freed or moved while the context is alive.
+// A job handle is (generation << 16) | index, where the generation is never zero
+static const uint32_t JOB_PAGE_SHIFT    = 8;
+static const uint32_t JOB_PAGE_SIZE     = 1 << JOB_PAGE_SHIFT;
+static const uint32_t MAX_JOB_PAGES     = 65536 / JOB_PAGE_SIZE;
+static const uint32_t INVALID_INDEX     = 0xFFFFFFFF;
+
+// Size of the per worker queues. When full, jobs go to the shared queue instead
+static const uint32_t DEQUE_SIZE        = 4096;
+static const uint32_t DEQUE_MASK        = DEQUE_SIZE - 1;
+
+#if !defined(DM_HAS_THREADS)
+// Without threads, Update() processes jobs for at most this long (in microseconds), but always at least one job
+static const uint64_t SINGLE_THREAD_TIME_SLICE = 4000;
+#endif
+
+struct Job
 {
-    void*       m_Context;
-    void*       m_Data;
-    FProcess    m_Process;
-    FCallback   m_Callback;
-    int         m_Result;
+    FProcess                m_Process;
+    FCallback               m_Callback;
+    void*                   m_Context;
+    void*                   m_Data;
+    HJob                    m_Parent;
+    int                     m_Result;
+    // Number of unfinished parts of the job: the job itself and its children
+    int32_atomic_t          m_Unfinished;
+    // Number of dependencies that aren't done, plus one until RunJob is called
+    int32_atomic_t          m_Blocked;
+    int32_atomic_t          m_Generation;
+    int32_atomic_t          m_Done;
+    // Protects m_Dependents and the transition to m_Done
+    dmSpinlock::Spinlock    m_Lock;
+    uint32_t                m_Dependents[MAX_JOB_DEPENDENTS];
+    uint32_t                m_DependentCount;
+    // Next free job, when in the free list
+    uint32_t                m_NextFree;
 };
 
-struct JobThreadContext
+/*
+ * Work stealing deque (Chase & Lev). Only the owning worker pushes and pops at the bottom,
+ * while other threads steal from the top. Indices are allowed to wrap around.
+ */
+struct WorkDeque
 {
-    jc::RingBuffer<JobItem>                 m_Work;
-    jc::RingBuffer<JobItem>                 m_Done;
+    int32_atomic_t          m_Top;
+    int32_atomic_t          m_Bottom;
+    volatile uint32_t       m_Jobs[DEQUE_SIZE];
+};
+
+// A PushJob() that is waiting for a free job, when all job handles are in use
+struct PendingJob
+{
+    FProcess                m_Process;
+    FCallback               m_Callback;
+    void*                   m_Context;
+    void*                   m_Data;
+};
 
+struct JobContext;
+
+struct Worker
+{
+    JobContext*             m_Context;
+    WorkDeque               m_Deque;
+    uint32_t                m_Index;
 #if defined(DM_HAS_THREADS)
-    dmMutex::HMutex                         m_Mutex;
-    dmConditionVariable::HConditionVariable m_WakeupCond;
-    bool                                    m_Run;
+    dmThread::Thread        m_Thread;
 #endif
 };
 
 struct JobContext
 {
+    Job*                    m_Pages[MAX_JOB_PAGES];
+    uint32_t                m_PageCount;
+    uint32_t                m_FirstFree;
+    // Scheduled as soon as a job is freed, protected by m_PoolLock
+    jc::RingBuffer<PendingJob> m_Pending;
+    // Protects the allocation of jobs
+    dmSpinlock::Spinlock    m_PoolLock;
+
+    dmArray<Worker*>        m_Workers;
+
+    // Jobs scheduled from outside of the workers
+    jc::RingBuffer<uint32_t> m_Work;
+    // Jobs with a callback, waiting for Update
+    jc::RingBuffer<uint32_t> m_Done;
+    // Number of jobs waiting in any queue
+    int32_atomic_t          m_Queued;
+
 #if defined(DM_HAS_THREADS)
-    dmArray<dmThread::Thread> m_Threads;
+    dmMutex::HMutex                         m_Mutex;
+    dmConditionVariable::HConditionVariable m_WakeupCond;
+    dmThread::TlsKey                        m_WorkerKey;
+    int32_atomic_t                          m_Sleeping;
+    bool                                    m_Run;
 #endif
-    JobThreadContext    m_ThreadContext;
 };
 
-static void PutWork(JobThreadContext* ctx, const JobItem* item)
+static inline Job* GetJob(JobContext* ctx, uint32_t index)
+{
+    return &ctx->m_Pages[index >> JOB_PAGE_SHIFT][index & (JOB_PAGE_SIZE - 1)];
+}
+
+static inline uint32_t GetIndex(HJob job)
+{
+    return job & 0xFFFF;
+}
+
+// Returns the job if the handle still refers to it, or 0 if the job has been recycled
+static Job* GetLiveJob(JobContext* ctx, HJob hjob)
+{
+    if (hjob == INVALID_JOB)
+        return 0;
+    uint32_t index = GetIndex(hjob);
+    if ((index >> JOB_PAGE_SHIFT) >= ctx->m_PageCount)
+        return 0;
+    Job* job = GetJob(ctx, index);
+    if ((uint32_t) dmAtomicGet32(&job->m_Generation) != (hjob >> 16))
+        return 0;
+    return job;
+}
+
+static bool AllocatePage(JobContext* ctx)
+{
+    if (ctx->m_PageCount == MAX_JOB_PAGES)
+        return false;
+    uint32_t first = ctx->m_PageCount * JOB_PAGE_SIZE;
+    Job* page = new Job[JOB_PAGE_SIZE];
+    for (uint32_t i = 0; i < JOB_PAGE_SIZE; ++i)
+    {
+        Job* job = &page[i];
+        memset(job, 0, sizeof(*job));
+        dmSpinlock::Create(&job->m_Lock);
+        job->m_Generation = 1;
+        job->m_NextFree = i + 1 < JOB_PAGE_SIZE ? first + i + 1 : ctx->m_FirstFree;
+    }
+    // The last handle (0xFFFF) is never used, so that indices always fit in 16 bits
+    if (ctx->m_PageCount == MAX_JOB_PAGES - 1)
+        page[JOB_PAGE_SIZE - 1].m_NextFree = INVALID_INDEX;
+    ctx->m_Pages[ctx->m_PageCount] = page;
+    ctx->m_FirstFree = first;
+    dmAtomicIncrement32((int32_atomic_t*) &ctx->m_PageCount);
+    return true;
+}
+
+static uint32_t AllocateJobNoLock(JobContext* ctx)
+{
+    if (ctx->m_FirstFree == INVALID_INDEX && !AllocatePage(ctx))
+        return INVALID_INDEX;
+    uint32_t index = ctx->m_FirstFree;
+    ctx->m_FirstFree = GetJob(ctx, index)->m_NextFree;
+    return index;
+}
+
+static uint32_t AllocateJob(JobContext* ctx)
+{
+    DM_SPINLOCK_SCOPED_LOCK(ctx->m_PoolLock);
+    return AllocateJobNoLock(ctx);
+}
+
+static void InitJob(Job* job, FProcess process, FCallback callback, void* user_context, void* data)
+{
+    job->m_Process = process;
+    job->m_Callback = callback;
+    job->m_Context = user_context;
+    job->m_Data = data;
+    job->m_Result = 0;
+    job->m_Parent = INVALID_JOB;
+    job->m_DependentCount = 0;
+    job->m_Unfinished = 1;
+    job->m_Blocked = 1;
+    dmAtomicStore32(&job->m_Done, 0);
+}
+
+static void Schedule(JobContext* ctx, uint32_t index);
+
+static void FreeJob(JobContext* ctx, uint32_t index)
+{
+    Job* job = GetJob(ctx, index);
+    // Invalidates all handles to the job. Only the thread that finishes the job writes the generation
+    int32_t generation = job->m_Generation;
+    int32_t next_generation = generation < 0xFFFF ? generation + 1 : 1;
+    dmAtomicCompareStore32(&job->m_Generation, next_generation, generation);
+
+    PendingJob pending;
+    {
+        DM_SPINLOCK_SCOPED_LOCK(ctx->m_PoolLock);
+        if (ctx->m_Pending.Empty())
+        {
+            job->m_NextFree = ctx->m_FirstFree;
+            ctx->m_FirstFree = index;
+            return;
+        }
+        pending = ctx->m_Pending.Pop();
+    }
+
+    // The job is handed over to the oldest waiting PushJob()
+    InitJob(job, pending.m_Process, pending.m_Callback, pending.m_Context, pending.m_Data);
+    job->m_Blocked = 0;
+    Schedule(ctx, index);
+}
+
+static bool DequePush(WorkDeque* deque, uint32_t job)
+{
+    int32_t b = deque->m_Bottom;
+    int32_t t = dmAtomicGet32(&deque->m_Top);
+    if ((uint32_t) (b - t) >= DEQUE_SIZE)
+        return false;
+    deque->m_Jobs[b & DEQUE_MASK] = job;
+    // Publishes the job (full barrier)
+    dmAtomicIncrement32(&deque->m_Bottom);
+    return true;
+}
+
+static bool DequePop(WorkDeque* deque, uint32_t* job)
+{
+    // The bottom must be written before the top is read, or a thief could take the same job (full barrier)
+    int32_t b = dmAtomicDecrement32(&deque->m_Bottom) - 1;
+    int32_t t = dmAtomicGet32(&deque->m_Top);
+    if (b - t < 0)
+    {
+        // Empty, restore the bottom (b + 1 == t)
+        dmAtomicIncrement32(&deque->m_Bottom);
+        return false;
+    }
+
+    *job = deque->m_Jobs[b & DEQUE_MASK];
+    if (b != t)
+        return true;
+
+    // Last job, which a thief may be trying to take as well
+    bool taken = dmAtomicCompareStore32(&deque->m_Top, t + 1, t) == t;
+    dmAtomicIncrement32(&deque->m_Bottom);
+    return taken;
+}
+
+static bool DequeSteal(WorkDeque* deque, uint32_t* job)
+{
+    int32_t t = dmAtomicGet32(&deque->m_Top);
+    int32_t b = dmAtomicGet32(&deque->m_Bottom);
+    if (b - t <= 0)
+        return false;
+    *job = deque->m_Jobs[t & DEQUE_MASK];
+    return dmAtomicCompareStore32(&deque->m_Top, t + 1, t) == t;
+}
+
+static Worker* GetCurrentWorker(JobContext* ctx)
 {
 #if defined(DM_HAS_THREADS)
-    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+    return (Worker*) dmThread::GetTlsValue(ctx->m_WorkerKey);
+#else
+    return 0;
 #endif
-    if (ctx->m_Work.Full())
-        ctx->m_Work.SetCapacity(ctx->m_Work.Capacity() + 8);
-    ctx->m_Work.Push(*item);
 }
 
-static void PutDone(JobThreadContext* ctx, JobItem* item)
+static void Schedule(JobContext* ctx, uint32_t index)
 {
+    dmAtomicIncrement32(&ctx->m_Queued);
+
+    Worker* worker = GetCurrentWorker(ctx);
+    if (!worker || !DequePush(&worker->m_Deque, index))
+    {
 #if defined(DM_HAS_THREADS)
-    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+#endif
+        if (ctx->m_Work.Full())
+            ctx->m_Work.SetCapacity(ctx->m_Work.Capacity() + 64);
+        ctx->m_Work.Push(index);
+    }
+
+#if defined(DM_HAS_THREADS)
+    if (dmAtomicGet32(&ctx->m_Sleeping) > 0)
+    {
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        dmConditionVariable::Signal(ctx->m_WakeupCond);
+    }
 #endif
-    if (ctx->m_Done.Full())
-        ctx->m_Done.SetCapacity(ctx->m_Done.Capacity() + 8);
-    ctx->m_Done.Push(*item);
 }
 
+// Takes a job from the worker's own queue, the shared queue, or steals one from another worker
+static bool FindJob(JobContext* ctx, Worker* worker, uint32_t* index)
+{
+    if (worker && DequePop(&worker->m_Deque, index))
+    {
+        dmAtomicDecrement32(&ctx->m_Queued);
+        return true;
+    }
+
+    {
 #if defined(DM_HAS_THREADS)
-static void JobThread(void* _ctx)
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+#endif
+        if (!ctx->m_Work.Empty())
+        {
+            *index = ctx->m_Work.Pop();
+            dmAtomicDecrement32(&ctx->m_Queued);
+            return true;
+        }
+    }
+
+    uint32_t worker_count = ctx->m_Workers.Size();
+    uint32_t start = worker ? worker->m_Index + 1 : 0;
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        Worker* victim = ctx->m_Workers[(start + i) % worker_count];
+        if (victim != worker && DequeSteal(&victim->m_Deque, index))
+        {
+            dmAtomicDecrement32(&ctx->m_Queued);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called when a part of the job (itself or a child) is done
+static void FinishJob(JobContext* ctx, uint32_t index)
 {
-    JobThreadContext* ctx = (JobThreadContext*)_ctx;
-    while (true)
+    while (index != INVALID_INDEX)
     {
-        JobItem item = {};
+        Job* job = GetJob(ctx, index);
+        if (dmAtomicDecrement32(&job->m_Unfinished) != 1)
+            return;
+
+        uint32_t dependents[MAX_JOB_DEPENDENTS];
+        uint32_t dependent_count;
+        {
+            DM_SPINLOCK_SCOPED_LOCK(job->m_Lock);
+            // Makes the results of the job visible before it is seen as done (full barrier)
+            dmAtomicIncrement32(&job->m_Done);
+            dependent_count = job->m_DependentCount;
+            memcpy(dependents, job->m_Dependents, sizeof(uint32_t) * dependent_count);
+            job->m_DependentCount = 0;
+        }
+
+        for (uint32_t i = 0; i < dependent_count; ++i)
         {
+            if (dmAtomicDecrement32(&GetJob(ctx, dependents[i])->m_Blocked) == 1)
+                Schedule(ctx, dependents[i]);
+        }
+
+        HJob parent = job->m_Parent;
+        if (job->m_Callback)
+        {
+#if defined(DM_HAS_THREADS)
             DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+#endif
+            if (ctx->m_Done.Full())
+                ctx->m_Done.SetCapacity(ctx->m_Done.Capacity() + 64);
+            ctx->m_Done.Push(index);
+        }
+        else
+        {
+            FreeJob(ctx, index);
+        }
 
-            if (!ctx->m_Run)
-                break;
+        // A parent can't be recycled before all its children are done
+        index = parent != INVALID_JOB ? GetIndex(parent) : INVALID_INDEX;
+    }
+}
 
-            while(ctx->m_Work.Empty())
-            {
-                dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
-                if (!ctx->m_Run)
-                    return;
-            }
-            item = ctx->m_Work.Pop();
+static void ExecuteJob(JobContext* ctx, uint32_t index)
+{
+    Job* job = GetJob(ctx, index);
+    if (job->m_Process)
+    {
+        DM_PROFILE("JobThread");
+        job->m_Result = job->m_Process(job->m_Context, job->m_Data);
+    }
+    FinishJob(ctx, index);
+}
+
+#if defined(DM_HAS_THREADS)
+static void JobThread(void* _worker)
+{
+    Worker* worker = (Worker*)_worker;
+    JobContext* ctx = worker->m_Context;
+    dmThread::SetTlsValue(ctx->m_WorkerKey, worker);
+
+    while (true)
+    {
+        uint32_t index;
+        if (FindJob(ctx, worker, &index))
+        {
+            ExecuteJob(ctx, index);
+            continue;
         }
 
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        if (!ctx->m_Run)
+            break;
+
+        // Schedule() checks m_Sleeping after queueing the job, so either the job is seen here or the sleeper is woken up
+        dmAtomicIncrement32(&ctx->m_Sleeping);
+        if (dmAtomicGet32(&ctx->m_Queued) == 0)
         {
-            DM_PROFILE("JobThread");
-            item.m_Result = item.m_Process(item.m_Context, item.m_Data);
-            PutDone(ctx, &item);
+            dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
         }
+        dmAtomicDecrement32(&ctx->m_Sleeping);
     }
 }
 #else
-static void UpdateSingleThread(JobThreadContext* ctx)
+static void UpdateSingleThread(JobContext* ctx)
 {
-    if (ctx->m_Work.Empty())
-        return;
-    // TODO: Perhaps time scope a number of items!
-    JobItem item = ctx->m_Work.Pop();
-
-    item.m_Result = item.m_Process(item.m_Context, item.m_Data);
-    PutDone(ctx, &item);
+    uint64_t start = dmTime::GetTime();
+    uint32_t index;
+    while (FindJob(ctx, 0, &index))
+    {
+        ExecuteJob(ctx, index);
+        if (dmTime::GetTime() - start >= SINGLE_THREAD_TIME_SLICE)
+            break;
+    }
 }
 #endif
 
 HContext Create(const JobThreadCreationParams& create_params)
 {
     JobContext* context = new JobContext;
+    memset(context->m_Pages, 0, sizeof(context->m_Pages));
+    context->m_PageCount = 0;
+    context->m_FirstFree = INVALID_INDEX;
+    context->m_Queued = 0;
+    dmSpinlock::Create(&context->m_PoolLock);
+    {
+        DM_SPINLOCK_SCOPED_LOCK(context->m_PoolLock);
+        AllocatePage(context);
+    }
+
 #if defined(DM_HAS_THREADS)
-    context->m_ThreadContext.m_Mutex = dmMutex::New();
-    context->m_ThreadContext.m_WakeupCond = dmConditionVariable::New();
-    context->m_ThreadContext.m_Run = true;
+    context->m_Mutex = dmMutex::New();
+    context->m_WakeupCond = dmConditionVariable::New();
+    context->m_WorkerKey = dmThread::AllocTls();
+    context->m_Sleeping = 0;
+    context->m_Run = true;
 
     uint32_t thread_count = dmMath::Min(create_params.m_ThreadCount, DM_MAX_JOB_THREAD_COUNT);
-    context->m_Threads.SetCapacity(thread_count);
-    context->m_Threads.SetSize(thread_count);
+    context->m_Workers.SetCapacity(thread_count);
+    context->m_Workers.SetSize(thread_count);
+
+    // All workers must exist before any of them tries to steal
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        Worker* worker = new Worker;
+        memset(&worker->m_Deque, 0, sizeof(worker->m_Deque));
+        worker->m_Context = context;
+        worker->m_Index = i;
+        context->m_Workers[i] = worker;
+    }
 
-    for (int i = 0; i < thread_count; ++i)
+    for (uint32_t i = 0; i < thread_count; ++i)
     {
         char name_buf[128];
         dmSnPrintf(name_buf, sizeof(name_buf), "%s_%d", create_params.m_ThreadNames[i], i);
-        context->m_Threads[i] = dmThread::New(JobThread, 0x80000, (void*)&context->m_ThreadContext, name_buf);
+        context->m_Workers[i]->m_Thread = dmThread::New(JobThread, 0x80000, (void*)context->m_Workers[i], name_buf);
     }
 #endif
     return context;
@@ -156,43 +502,144 @@ void Destroy(HContext context)
 
 #if defined(DM_HAS_THREADS)
     {
-        DM_MUTEX_SCOPED_LOCK(context->m_ThreadContext.m_Mutex);
+        DM_MUTEX_SCOPED_LOCK(context->m_Mutex);
 
-        context->m_ThreadContext.m_Run = false;;
+        context->m_Run = false;
 
-        dmConditionVariable::Broadcast(context->m_ThreadContext.m_WakeupCond);
+        dmConditionVariable::Broadcast(context->m_WakeupCond);
     }
 
-    for (int i = 0; i < context->m_Threads.Size(); ++i)
+    for (uint32_t i = 0; i < context->m_Workers.Size(); ++i)
     {
-        dmThread::Join(context->m_Threads[i]);
+        dmThread::Join(context->m_Workers[i]->m_Thread);
     }
-    dmConditionVariable::Delete(context->m_ThreadContext.m_WakeupCond);
-    dmMutex::Delete(context->m_ThreadContext.m_Mutex);
+    for (uint32_t i = 0; i < context->m_Workers.Size(); ++i)
+    {
+        delete context->m_Workers[i];
+    }
+    dmThread::FreeTls(context->m_WorkerKey);
+    dmConditionVariable::Delete(context->m_WakeupCond);
+    dmMutex::Delete(context->m_Mutex);
 #endif // DM_HAS_THREADS
 
+    for (uint32_t p = 0; p < context->m_PageCount; ++p)
+    {
+        Job* page = context->m_Pages[p];
+        for (uint32_t i = 0; i < JOB_PAGE_SIZE; ++i)
+            dmSpinlock::Destroy(&page[i].m_Lock);
+        delete[] page;
+    }
+    dmSpinlock::Destroy(&context->m_PoolLock);
+
     delete context;
 }
 
+HJob CreateJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data, HJob parent)
+{
+    uint32_t index = AllocateJob(context);
+    if (index == INVALID_INDEX)
+        return INVALID_JOB;
+
+    Job* job = GetJob(context, index);
+    InitJob(job, process, callback, user_context, data);
+
+    if (parent != INVALID_JOB)
+    {
+        Job* parent_job = GetLiveJob(context, parent);
+        assert(parent_job && !parent_job->m_Done);
+        dmAtomicIncrement32(&parent_job->m_Unfinished);
+        job->m_Parent = parent;
+    }
+    return (HJob) ((uint32_t) job->m_Generation << 16) | index;
+}
+
+HJob CreateJob(HContext context, FProcess process, void* user_context, void* data, HJob parent)
+{
+    return CreateJob(context, process, 0, user_context, data, parent);
+}
+
+void AddDependency(HContext context, HJob hjob, HJob hdependency)
+{
+    Job* job = GetLiveJob(context, hjob);
+    assert(job);
+    Job* dependency = GetLiveJob(context, hdependency);
+    if (!dependency)
+        return;
+
+    DM_SPINLOCK_SCOPED_LOCK(dependency->m_Lock);
+    // The generation is checked again, since the dependency may have been recycled after the check above
+    if (dependency->m_Done || (uint32_t) dependency->m_Generation != (hdependency >> 16))
+        return;
+    assert(dependency->m_DependentCount < MAX_JOB_DEPENDENTS);
+    dependency->m_Dependents[dependency->m_DependentCount++] = GetIndex(hjob);
+    dmAtomicIncrement32(&job->m_Blocked);
+}
+
+void RunJob(HContext context, HJob hjob)
+{
+    Job* job = GetLiveJob(context, hjob);
+    assert(job);
+    if (dmAtomicDecrement32(&job->m_Blocked) == 1)
+        Schedule(context, GetIndex(hjob));
+}
+
+bool IsJobDone(HContext context, HJob hjob)
+{
+    Job* job = GetLiveJob(context, hjob);
+    if (job == 0 || dmAtomicGet32(&job->m_Done) != 0)
+        return true;
+    // The job may have been recycled after the first check
+    return GetLiveJob(context, hjob) == 0;
+}
+
+void WaitJob(HContext context, HJob hjob)
+{
+    DM_PROFILE("WaitJob");
+    Worker* worker = GetCurrentWorker(context);
+    uint32_t idle_count = 0;
+    while (!IsJobDone(context, hjob))
+    {
+        uint32_t index;
+        if (FindJob(context, worker, &index))
+        {
+            ExecuteJob(context, index);
+            idle_count = 0;
+        }
+        else if (++idle_count > 64)
+        {
+            // The remaining work is running on other threads
+            dmTime::Sleep(0);
+        }
+    }
+}
+
 void PushJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data)
 {
-    JobItem item;
-    item.m_Context = user_context;
-    item.m_Data = data;
-    item.m_Process = process;
-    item.m_Callback = callback;
-    item.m_Result = 0;
+    uint32_t index;
+    {
+        DM_SPINLOCK_SCOPED_LOCK(context->m_PoolLock);
+        index = AllocateJobNoLock(context);
+        if (index == INVALID_INDEX)
+        {
+            // All job handles are in use. The job waits for the next job to be freed
+            PendingJob pending = {process, callback, user_context, data};
+            if (context->m_Pending.Full())
+                context->m_Pending.SetCapacity(context->m_Pending.Capacity() + 64);
+            context->m_Pending.Push(pending);
+            return;
+        }
+    }
 
-    PutWork(&context->m_ThreadContext, &item);
-#if defined(DM_HAS_THREADS)
-    dmConditionVariable::Signal(context->m_ThreadContext.m_WakeupCond);
-#endif
+    Job* job = GetJob(context, index);
+    InitJob(job, process, callback, user_context, data);
+    job->m_Blocked = 0;
+    Schedule(context, index);
 }
 
 uint32_t GetWorkerCount(HContext context)
 {
 #if defined(DM_HAS_THREADS)
-    return context->m_Threads.Size();
+    return context->m_Workers.Size();
 #else
     return 0;
 #endif
@@ -203,31 +650,31 @@ void Update(HContext context)
     DM_PROFILE("Update");
 
 #if !defined(DM_HAS_THREADS)
-    UpdateSingleThread(&context->m_ThreadContext);
+    UpdateSingleThread(context);
 #endif
 
     // Lock for as little as possible, by copying the items to an array owned by this thread
     uint32_t size;
-    dmArray<JobItem> items;
+    dmArray<uint32_t> items;
 
     {
 #if defined(DM_HAS_THREADS)
-        DM_MUTEX_SCOPED_LOCK(context->m_ThreadContext.m_Mutex);
+        DM_MUTEX_SCOPED_LOCK(context->m_Mutex);
 #endif
-        size = context->m_ThreadContext.m_Done.Size();
+        size = context->m_Done.Size();
         items.SetCapacity(size);
 
         for(uint32_t i = 0; i < size; ++i)
-            items.Push(context->m_ThreadContext.m_Done[i]);
-        context->m_ThreadContext.m_Done.Clear();
+            items.Push(context->m_Done[i]);
+        context->m_Done.Clear();
     }
 
     // Now do the callbacks
     for(uint32_t i = 0; i < size; ++i)
     {
-        JobItem& item = items[i];
-        if (item.m_Callback)
-            item.m_Callback(item.m_Context, item.m_Data, item.m_Result);
+        Job* job = GetJob(context, items[i]);
+        job->m_Callback(job->m_Context, job->m_Data, job->m_Result);
+        FreeJob(context, items[i]);
     }
 }
 
@@ -23,7 +23,15 @@ namespace dmJobThread
     typedef int (*FProcess)(void* context, void* data);
     typedef void (*FCallback)(void* context, void* data, int result);
 
-    static const uint8_t DM_MAX_JOB_THREAD_COUNT = 8;
+    /*
+     * Handle to a job created with CreateJob. Handles stay valid (as "done") after the job is recycled
+     */
+    typedef uint32_t HJob;
+    static const HJob INVALID_JOB = 0;
+
+    static const uint8_t DM_MAX_JOB_THREAD_COUNT = 32;
+    // Max number of jobs that can depend on one job (see AddDependency)
+    static const uint32_t MAX_JOB_DEPENDENTS = 8;
 
     struct JobThreadCreationParams
     {
@@ -37,6 +45,53 @@ namespace dmJobThread
     void     PushJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data);
     uint32_t GetWorkerCount(HContext context);
     bool     PlatformHasThreadSupport();
+
+    /*
+     * Fork/join API
+     *
+     * Each worker thread has its own queue. Jobs scheduled from a worker (e.g. child jobs) go to the queue of that worker,
+     * and idle workers steal jobs from the other queues. Jobs scheduled from any other thread go to a shared queue.
+     *
+     *   HJob root = CreateJob(ctx, Root, 0, 0, INVALID_JOB);
+     *   for (...)
+     *       RunJob(ctx, CreateJob(ctx, Work, 0, &items[i], root));
+     *   RunJob(ctx, root);
+     *   WaitJob(ctx, root); // Returns when Root and all Work jobs are done
+     */
+
+    /*
+     * Creates a job. It won't run until RunJob is called, and all its dependencies are done.
+     * @param parent [type: HJob] If valid, the parent isn't done until this job is done. The parent must not be done yet
+     * @return job [type: HJob] The job, or INVALID_JOB if too many jobs are alive
+     */
+    HJob CreateJob(HContext context, FProcess process, void* user_context, void* data, HJob parent);
+
+    /*
+     * Creates a job with a callback, which is called from Update() on the thread calling Update, once the job (and its children) are done.
+     */
+    HJob CreateJob(HContext context, FProcess process, FCallback callback, void* user_context, void* data, HJob parent);
+
+    /*
+     * Makes the job wait for the dependency to be done. Must be called before RunJob(job).
+     * Nothing happens if the dependency is already done.
+     */
+    void AddDependency(HContext context, HJob job, HJob dependency);
+
+    /*
+     * Schedules the job, once all its dependencies are done
+     */
+    void RunJob(HContext context, HJob job);
+
+    /*
+     * Returns true when the job, and all its children, are done
+     */
+    bool IsJobDone(HContext context, HJob job);
+
+    /*
+     * Waits for the job, and all its children, to be done. The calling thread runs other jobs while waiting.
+     * Jobs with a callback are considered done before the callback is called.
+     */
+    void WaitJob(HContext context, HJob job);
 }
 
 #endif // DM_JOB_THREAD_H
@@ -14,6 +14,8 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
 #include "atomic.h"
@@ -93,6 +95,13 @@ static const int g_MaxListeners = 32;
 static FLogListener g_Listeners[g_MaxListeners];
 static int32_atomic_t g_ListenersCount;
 
+// Deferred logging, see LogParams::m_Deferred
+static bool g_Deferred = false;
+static int32_atomic_t g_DeferredWriters = 0;    // Threads currently writing to (or retiring) their ring
+static dmThread::TlsKey g_DeferredRingKey;
+static int32_atomic_t g_DeferredRingCount = 0;
+static void* volatile g_DeferredRings = 0;      // List of all rings. Rings are pushed by the logging threads, and only removed by the log thread (or LogFinalize)
+
 static inline bool IsServerInitialized()
 {
     return dmAtomicGet32(&g_LogServerInitialized) > 0;
@@ -335,21 +344,10 @@ static void DoLogSynchronized(LogSeverity severity, const char* domain, const ch
     dmProfile::LogText("%s", output);
 }
 
-static void dmLogDispatch(dmMessage::Message *message, void* user_ptr)
+static void dmLogSendToConnections(const char* message, int msg_len)
 {
     dmLogServer* server = g_dmLogServer;
 
-    bool* run = (bool*) user_ptr;
-    LogMessage* log_message = (LogMessage*) &message->m_Data[0];
-    if (log_message->m_Type == LogMessage::SHUTDOWN)
-    {
-        *run = false;
-        return;
-    }
-
-    int msg_len = (int) strlen(log_message->m_Message);
-    DoLogSynchronized((LogSeverity)log_message->m_Severity, log_message->m_Domain, log_message->m_Message, msg_len);
-
     // NOTE: Keep i as signed! See --i below after EraseSwap
     int n = 0;
     {
@@ -376,7 +374,7 @@ static void dmLogDispatch(dmMessage::Message *message, void* user_ptr)
         int total_sent = 0;
         do
         {
-            r = dmSocket::Send(socket, log_message->m_Message + total_sent, msg_len - total_sent, &sent_bytes);
+            r = dmSocket::Send(socket, message + total_sent, msg_len - total_sent, &sent_bytes);
             if (r == dmSocket::RESULT_OK)
             {
                 total_sent += sent_bytes;
@@ -406,19 +404,625 @@ static void dmLogDispatch(dmMessage::Message *message, void* user_ptr)
     }
 }
 
+static void dmLogDispatch(dmMessage::Message *message, void* user_ptr)
+{
+    bool* run = (bool*) user_ptr;
+    LogMessage* log_message = (LogMessage*) &message->m_Data[0];
+    if (log_message->m_Type == LogMessage::SHUTDOWN)
+    {
+        *run = false;
+        return;
+    }
+
+    int msg_len = (int) strlen(log_message->m_Message);
+    DoLogSynchronized((LogSeverity)log_message->m_Severity, log_message->m_Domain, log_message->m_Message, msg_len);
+    dmLogSendToConnections(log_message->m_Message, msg_len);
+}
+
+static const char* GetSeverityString(LogSeverity severity)
+{
+    switch (severity)
+    {
+        case LOG_SEVERITY_DEBUG:        return "DEBUG";
+        case LOG_SEVERITY_USER_DEBUG:   return "DEBUG";
+        case LOG_SEVERITY_INFO:         return "INFO";
+        case LOG_SEVERITY_WARNING:      return "WARNING";
+        case LOG_SEVERITY_ERROR:        return "ERROR";
+        case LOG_SEVERITY_FATAL:        return "FATAL";
+        default:
+            assert(0);
+            return 0;
+    }
+}
+
+// Appends the newline to a message of (untruncated) length n in a buffer of MAX_STRING_SIZE, and marks it
+// if it was truncated. Returns the actual length of the message
+static int TerminateMessage(char* str_buf, int n)
+{
+    if (n < (int) MAX_STRING_SIZE)
+    {
+        n += dmSnPrintf(str_buf + n, MAX_STRING_SIZE - n, "\n");
+    }
+
+    if (n >= (int) MAX_STRING_SIZE)
+    {
+        strcpy(&str_buf[MAX_STRING_SIZE - (strlen(LOG_OUTPUT_TRUNCATED_MESSAGE) + 1)], LOG_OUTPUT_TRUNCATED_MESSAGE);
+    }
+
+    str_buf[MAX_STRING_SIZE-1] = '\0';
+    return dmMath::Min(n, (int)(MAX_STRING_SIZE-1));
+}
+
+/*
+ * Deferred logging
+ *
+ * Each logging thread has its own ring buffer, with a single producer (the logging thread) and a single
+ * consumer (the log thread). A record holds a copy of the format string and the arguments packed in 8 byte
+ * slots, strings are copied too. The log thread formats the record, by calling snprintf for one conversion
+ * at a time, and does all the output. Messages that can't be packed (e.g. %n or long double) and fatal
+ * messages are formatted by the logging thread, and stored as text.
+ */
+
+static const uint32_t DEFERRED_RING_SIZE = 64 * 1024;
+static const uint32_t DEFERRED_MAX_SPEC_LENGTH = 31;
+
+enum DeferredRecordType
+{
+    DEFERRED_RECORD_PACKED  = 0,
+    DEFERRED_RECORD_TEXT    = 1,
+    DEFERRED_RECORD_PADDING = 2,    // Skips to the end of the ring
+};
+
+struct DeferredRecord
+{
+    uint32_t    m_Size;             // Including the header, a multiple of 8
+    uint32_t    m_FormatSize;       // Size of the copied format string, a multiple of 8
+    uint8_t     m_Type;
+    uint8_t     m_Severity;
+    uint8_t     m_Platform;         // Also output to the platform log (debug mode when logged)
+    uint8_t     m_Pad[5];
+    char        m_Domain[16];
+    // Followed by the format string and the packed arguments, or the text
+};
+
+// A record is never larger than the staging buffer, which always fits in the ring
+static const uint32_t DEFERRED_MAX_RECORD_SIZE = (sizeof(DeferredRecord) + MAX_STRING_SIZE + 7) & ~7U;
+
+struct DeferredRing
+{
+    DeferredRing*   m_Next;
+    int32_atomic_t  m_Head;         // Only written by the thread owning the ring
+    int32_atomic_t  m_Tail;         // Only written by the log thread
+    int32_atomic_t  m_Retired;      // Set when the owning thread has exited. The ring is deleted by the log thread once it's empty
+    uint8_t         m_Data[DEFERRED_RING_SIZE];
+};
+
+enum DeferredArgType
+{
+    DEFERRED_ARG_NONE,              // %%
+    DEFERRED_ARG_INT,
+    DEFERRED_ARG_LONG,
+    DEFERRED_ARG_LONG_LONG,
+    DEFERRED_ARG_SIZE,
+    DEFERRED_ARG_INTMAX,
+    DEFERRED_ARG_PTRDIFF,
+    DEFERRED_ARG_DOUBLE,
+    DEFERRED_ARG_POINTER,
+    DEFERRED_ARG_STRING,
+    DEFERRED_ARG_UNSUPPORTED,
+};
+
+struct DeferredConversion
+{
+    DeferredArgType m_Type;
+    uint8_t         m_NumStars;         // Width and precision given as int arguments
+    bool            m_PrecisionStar;    // The last star is the precision
+    int32_t         m_Precision;        // -1 if not given
+};
+
+// Parses the conversion specification at format, which points to a '%'. Returns the end of the specification.
+static const char* ParseConversion(const char* format, DeferredConversion* conversion)
+{
+    const char* start = format++;
+    conversion->m_NumStars = 0;
+    conversion->m_PrecisionStar = false;
+    conversion->m_Precision = -1;
+
+    if (*format == '%')
+    {
+        conversion->m_Type = DEFERRED_ARG_NONE;
+        return format + 1;
+    }
+
+    while (*format && strchr("-+ #0'", *format))
+        ++format;
+
+    if (*format == '*')
+    {
+        conversion->m_NumStars++;
+        ++format;
+    }
+    else
+    {
+        while (*format >= '0' && *format <= '9')
+            ++format;
+    }
+
+    if (*format == '.')
+    {
+        ++format;
+        if (*format == '*')
+        {
+            conversion->m_NumStars++;
+            conversion->m_PrecisionStar = true;
+            ++format;
+        }
+        else
+        {
+            conversion->m_Precision = 0;
+            while (*format >= '0' && *format <= '9')
+                conversion->m_Precision = conversion->m_Precision * 10 + (*format++ - '0');
+        }
+    }
+
+    enum Length { LENGTH_NONE, LENGTH_LONG, LENGTH_LONG_LONG, LENGTH_SIZE, LENGTH_INTMAX, LENGTH_PTRDIFF, LENGTH_UNSUPPORTED };
+    Length length = LENGTH_NONE;
+    switch (*format)
+    {
+        case 'h':   ++format; if (*format == 'h') ++format; break; // Promoted to int
+        case 'l':   ++format; length = LENGTH_LONG; if (*format == 'l') { ++format; length = LENGTH_LONG_LONG; } break;
+        case 'q':   ++format; length = LENGTH_LONG_LONG; break;
+        case 'z':   ++format; length = LENGTH_SIZE; break;
+        case 'j':   ++format; length = LENGTH_INTMAX; break;
+        case 't':   ++format; length = LENGTH_PTRDIFF; break;
+        case 'L':   ++format; length = LENGTH_UNSUPPORTED; break;
+        default:    break;
+    }
+
+    DeferredArgType type = DEFERRED_ARG_UNSUPPORTED;
+    switch (*format)
+    {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            switch (length)
+            {
+                case LENGTH_NONE:       type = DEFERRED_ARG_INT; break;
+                case LENGTH_LONG:       type = DEFERRED_ARG_LONG; break;
+                case LENGTH_LONG_LONG:  type = DEFERRED_ARG_LONG_LONG; break;
+                case LENGTH_SIZE:       type = DEFERRED_ARG_SIZE; break;
+                case LENGTH_INTMAX:     type = DEFERRED_ARG_INTMAX; break;
+                case LENGTH_PTRDIFF:    type = DEFERRED_ARG_PTRDIFF; break;
+                default:                break;
+            }
+            break;
+        case 'c':
+            type = length == LENGTH_NONE ? DEFERRED_ARG_INT : DEFERRED_ARG_UNSUPPORTED;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            type = (length == LENGTH_NONE || length == LENGTH_LONG) ? DEFERRED_ARG_DOUBLE : DEFERRED_ARG_UNSUPPORTED;
+            break;
+        case 's':
+            type = length == LENGTH_NONE ? DEFERRED_ARG_STRING : DEFERRED_ARG_UNSUPPORTED;
+            break;
+        case 'p':
+            type = DEFERRED_ARG_POINTER;
+            break;
+        default: // %n, wide characters, or the end of the string
+            break;
+    }
+
+    if (*format)
+        ++format;
+    if (format - start > (ptrdiff_t) DEFERRED_MAX_SPEC_LENGTH)
+        type = DEFERRED_ARG_UNSUPPORTED;
+
+    conversion->m_Type = type;
+    return format;
+}
+
+template <typename T>
+static inline bool PackArgument(uint8_t*& cursor, const uint8_t* end, T value)
+{
+    if (cursor + 8 > end)
+        return false;
+    memcpy(cursor, &value, sizeof(T));
+    cursor += 8;
+    return true;
+}
+
+template <typename T>
+static inline T UnpackArgument(const uint8_t*& cursor)
+{
+    T value;
+    memcpy(&value, cursor, sizeof(T));
+    cursor += 8;
+    return value;
+}
+
+// Packs the arguments of the format string. Returns false if the format string isn't supported or the arguments don't fit
+static bool PackArguments(uint8_t* args, uint32_t capacity, const char* format, va_list lst, uint32_t* args_size)
+{
+    uint8_t* cursor = args;
+    const uint8_t* end = args + capacity;
+    bool ok = true;
+
+    while (ok && (format = strchr(format, '%')) != 0)
+    {
+        DeferredConversion conversion;
+        format = ParseConversion(format, &conversion);
+
+        int32_t precision = conversion.m_Precision;
+        for (uint32_t i = 0; i < conversion.m_NumStars; ++i)
+        {
+            int star = va_arg(lst, int);
+            ok = ok && PackArgument(cursor, end, star);
+            if (conversion.m_PrecisionStar && i == conversion.m_NumStars - 1U)
+                precision = star;
+        }
+
+        switch (conversion.m_Type)
+        {
+            case DEFERRED_ARG_NONE:         break;
+            case DEFERRED_ARG_INT:          ok = ok && PackArgument(cursor, end, va_arg(lst, int)); break;
+            case DEFERRED_ARG_LONG:         ok = ok && PackArgument(cursor, end, va_arg(lst, long)); break;
+            case DEFERRED_ARG_LONG_LONG:    ok = ok && PackArgument(cursor, end, va_arg(lst, long long)); break;
+            case DEFERRED_ARG_SIZE:         ok = ok && PackArgument(cursor, end, va_arg(lst, size_t)); break;
+            case DEFERRED_ARG_INTMAX:       ok = ok && PackArgument(cursor, end, va_arg(lst, intmax_t)); break;
+            case DEFERRED_ARG_PTRDIFF:      ok = ok && PackArgument(cursor, end, va_arg(lst, ptrdiff_t)); break;
+            case DEFERRED_ARG_DOUBLE:       ok = ok && PackArgument(cursor, end, va_arg(lst, double)); break;
+            case DEFERRED_ARG_POINTER:      ok = ok && PackArgument(cursor, end, va_arg(lst, void*)); break;
+            case DEFERRED_ARG_STRING:
+            {
+                const char* str = va_arg(lst, const char*);
+                if (str == 0)
+                    str = "(null)";
+                // With a precision, the string doesn't have to be null terminated
+                uint32_t length = 0;
+                while (str[length] && (precision < 0 || length < (uint32_t) precision))
+                    ++length;
+                uint32_t size = (length + 1 + 7) & ~7U;
+                ok = ok && cursor + size <= end;
+                if (ok)
+                {
+                    memcpy(cursor, str, length);
+                    cursor[length] = '\0';
+                    cursor += size;
+                }
+                break;
+            }
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    *args_size = (uint32_t) (cursor - args);
+    return ok;
+}
+
+template <typename T>
+static int FormatArgument(char* out, int size, const char* spec, uint32_t num_stars, const int* stars, T value)
+{
+    switch (num_stars)
+    {
+        case 0:     return snprintf(out, size, spec, value);
+        case 1:     return snprintf(out, size, spec, stars[0], value);
+        default:    return snprintf(out, size, spec, stars[0], stars[1], value);
+    }
+}
+
+// Formats a packed record like vsnprintf: the output is always null terminated, and the untruncated length is returned
+static int FormatPackedArguments(char* out, int size, const char* format, const uint8_t* args)
+{
+    int n = 0;
+    while (*format)
+    {
+        const char* percent = strchr(format, '%');
+        int literal_length = percent ? (int) (percent - format) : (int) strlen(format);
+        if (n < size)
+        {
+            int count = dmMath::Min(literal_length, size - n - 1);
+            memcpy(out + n, format, count);
+            out[n + count] = '\0';
+        }
+        n += literal_length;
+        if (!percent)
+            break;
+
+        DeferredConversion conversion;
+        format = ParseConversion(percent, &conversion);
+
+        char spec[DEFERRED_MAX_SPEC_LENGTH + 1];
+        memcpy(spec, percent, format - percent);
+        spec[format - percent] = '\0';
+
+        int stars[2] = {0, 0};
+        for (uint32_t i = 0; i < conversion.m_NumStars; ++i)
+            stars[i] = UnpackArgument<int>(args);
+
+        char* dst = n < size ? out + n : 0;
+        int dst_size = n < size ? size - n : 0;
+        int r = 0;
+        switch (conversion.m_Type)
+        {
+            case DEFERRED_ARG_NONE:         r = snprintf(dst, dst_size, "%%"); break;
+            case DEFERRED_ARG_INT:          r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<int>(args)); break;
+            case DEFERRED_ARG_LONG:         r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<long>(args)); break;
+            case DEFERRED_ARG_LONG_LONG:    r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<long long>(args)); break;
+            case DEFERRED_ARG_SIZE:         r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<size_t>(args)); break;
+            case DEFERRED_ARG_INTMAX:       r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<intmax_t>(args)); break;
+            case DEFERRED_ARG_PTRDIFF:      r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<ptrdiff_t>(args)); break;
+            case DEFERRED_ARG_DOUBLE:       r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<double>(args)); break;
+            case DEFERRED_ARG_POINTER:      r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, UnpackArgument<void*>(args)); break;
+            case DEFERRED_ARG_STRING:
+            {
+                const char* str = (const char*) args;
+                args += (strlen(str) + 1 + 7) & ~7U;
+                r = FormatArgument(dst, dst_size, spec, conversion.m_NumStars, stars, str);
+                break;
+            }
+            default:
+                assert(0 && "The record was packed with an unsupported conversion");
+                break;
+        }
+        n += r > 0 ? r : 0;
+    }
+    return n;
+}
+
+static void OutputDeferredRecord(const DeferredRecord* record, char* str_buf)
+{
+    LogSeverity severity = (LogSeverity) record->m_Severity;
+    int n;
+    if (record->m_Type == DEFERRED_RECORD_TEXT)
+    {
+        const char* text = (const char*) (record + 1);
+        n = (int) strlen(text);
+        memcpy(str_buf, text, n + 1);
+    }
+    else
+    {
+        n = dmSnPrintf(str_buf, MAX_STRING_SIZE, "%s:%s: ", GetSeverityString(severity), record->m_Domain);
+        if (n < (int) MAX_STRING_SIZE)
+        {
+            const char* format = (const char*) (record + 1);
+            const uint8_t* args = (const uint8_t*) format + record->m_FormatSize;
+            n += FormatPackedArguments(str_buf + n, MAX_STRING_SIZE - n, format, args);
+        }
+        n = TerminateMessage(str_buf, n);
+    }
+
+    if (record->m_Platform)
+    {
+        DoLogPlatform(severity, str_buf, n);
+    }
+    DoLogSynchronized(severity, record->m_Domain, str_buf, n);
+    dmLogSendToConnections(str_buf, n);
+}
+
+// Removes the ring from the list. Only called by the log thread, the logging threads only push new rings to the front.
+// Returns false if a ring was pushed in front of it meanwhile, in which case it's removed in a later call
+static bool UnlinkDeferredRing(DeferredRing* ring, DeferredRing* prev)
+{
+    if (prev)
+    {
+        prev->m_Next = ring->m_Next;
+        return true;
+    }
+    return dmAtomicCompareStorePtr(&g_DeferredRings, ring->m_Next, ring) == ring;
+}
+
+// Outputs all records in the rings, and deletes the empty rings of exited threads. Returns the number of records
+static uint32_t ProcessDeferredRings()
+{
+    char str_buf[MAX_STRING_SIZE];
+    uint32_t count = 0;
+
+    DeferredRing* prev = 0;
+    DeferredRing* ring = (DeferredRing*) dmAtomicGetPtr(&g_DeferredRings);
+    while (ring)
+    {
+        // Read before the head, since the owner doesn't write to the ring after it's retired
+        bool retired = dmAtomicGet32(&ring->m_Retired) != 0;
+        uint32_t head = (uint32_t) dmAtomicGet32(&ring->m_Head);
+        uint32_t tail = (uint32_t) ring->m_Tail;
+        while (tail != head)
+        {
+            const DeferredRecord* record = (const DeferredRecord*) &ring->m_Data[tail % DEFERRED_RING_SIZE];
+            uint32_t size = record->m_Size;
+            if (record->m_Type != DEFERRED_RECORD_PADDING)
+            {
+                OutputDeferredRecord(record, str_buf);
+                ++count;
+            }
+            tail += size;
+            // Releases the space to the logging thread, after the record has been read
+            dmAtomicAdd32(&ring->m_Tail, (int32_t) size);
+        }
+
+        DeferredRing* next = ring->m_Next;
+        if (retired && UnlinkDeferredRing(ring, prev))
+        {
+            delete ring;
+            dmAtomicDecrement32(&g_DeferredRingCount);
+        }
+        else
+        {
+            prev = ring;
+        }
+        ring = next;
+    }
+    return count;
+}
+
+// Called when a thread with a ring exits
+static void RetireDeferredRing(void* value)
+{
+    DeferredRing* ring = (DeferredRing*) value;
+    // Counted as a writer, so that LogFinalize doesn't delete the ring before it's marked
+    dmAtomicIncrement32(&g_DeferredWriters);
+    if (IsServerInitialized())
+    {
+        // Publishes the last records of the thread along with the flag (the store is only an acquire barrier)
+        dmAtomicIncrement32(&ring->m_Retired);
+    }
+    dmAtomicDecrement32(&g_DeferredWriters);
+}
+
+static DeferredRing* GetDeferredRing()
+{
+    DeferredRing* ring = (DeferredRing*) dmThread::GetTlsValue(g_DeferredRingKey);
+    if (ring == 0)
+    {
+        ring = new DeferredRing;
+        ring->m_Head = 0;
+        ring->m_Tail = 0;
+        ring->m_Retired = 0;
+        dmAtomicIncrement32(&g_DeferredRingCount);
+        void* next;
+        do
+        {
+            next = dmAtomicGetPtr(&g_DeferredRings);
+            ring->m_Next = (DeferredRing*) next;
+        } while (dmAtomicCompareStorePtr(&g_DeferredRings, ring, next) != next);
+        dmThread::SetTlsValue(g_DeferredRingKey, ring);
+    }
+    return ring;
+}
+
+static void WriteDeferredRecord(DeferredRing* ring, const DeferredRecord* record)
+{
+    uint32_t size = record->m_Size;
+    uint32_t head = (uint32_t) ring->m_Head;
+    uint32_t offset = head % DEFERRED_RING_SIZE;
+    uint32_t contiguous = DEFERRED_RING_SIZE - offset;
+    // A record is never split, we skip to the start of the ring instead
+    uint32_t needed = size <= contiguous ? size : contiguous + size;
+
+    // Waits for the log thread if the ring is full. The messages are never dropped.
+    while (DEFERRED_RING_SIZE - (head - (uint32_t) dmAtomicGet32(&ring->m_Tail)) < needed)
+    {
+        dmTime::Sleep(100);
+    }
+
+    if (size > contiguous)
+    {
+        DeferredRecord* padding = (DeferredRecord*) &ring->m_Data[offset];
+        padding->m_Size = contiguous;
+        padding->m_Type = DEFERRED_RECORD_PADDING;
+        offset = 0;
+    }
+
+    memcpy(&ring->m_Data[offset], record, size);
+    // Publishes the record to the log thread, after it has been written
+    dmAtomicAdd32(&ring->m_Head, (int32_t) needed);
+}
+
+// Returns false if the message wasn't deferred, in which case lst wasn't used
+static bool LogDeferred(LogSeverity severity, const char* domain, bool is_debug_mode, const char* format, va_list lst)
+{
+    // Counted before checking that the log system is running, see LogFinalize
+    dmAtomicIncrement32(&g_DeferredWriters);
+    if (!IsServerInitialized() || dmThread::GetCurrentThread() == g_dmLogServer->m_Thread)
+    {
+        dmAtomicDecrement32(&g_DeferredWriters);
+        return false;
+    }
+
+    uint64_t staging[DEFERRED_MAX_RECORD_SIZE / sizeof(uint64_t)];
+    DeferredRecord* record = (DeferredRecord*) staging;
+    record->m_Type = DEFERRED_RECORD_PACKED;
+    record->m_Severity = (uint8_t) severity;
+    record->m_Platform = is_debug_mode;
+    memset(record->m_Pad, 0, sizeof(record->m_Pad));
+    dmStrlCpy(record->m_Domain, domain, sizeof(record->m_Domain));
+    record->m_FormatSize = 0;
+
+    uint8_t* payload = (uint8_t*) (record + 1);
+    uint32_t capacity = DEFERRED_MAX_RECORD_SIZE - sizeof(DeferredRecord);
+
+    // Fatal messages are formatted and printed directly, since the application may not survive until the
+    // log thread outputs them. They still go through the ring, to keep the order for the listeners.
+    bool packed = false;
+    uint32_t args_size = 0;
+    if (severity != LOG_SEVERITY_FATAL)
+    {
+        // The format string is copied, since the caller may have built it at runtime
+        uint32_t format_length = (uint32_t) strlen(format);
+        uint32_t format_size = (format_length + 1 + 7) & ~7U;
+        if (format_size < capacity)
+        {
+            memcpy(payload, format, format_length + 1);
+            va_list args_lst;
+            va_copy(args_lst, lst);
+            packed = PackArguments(payload + format_size, capacity - format_size, format, args_lst, &args_size);
+            va_end(args_lst);
+            record->m_FormatSize = format_size;
+            args_size += format_size;
+        }
+    }
+
+    // An unsupported conversion, or arguments that don't fit, we format it here instead
+    if (!packed)
+    {
+        char* str_buf = (char*) payload;
+        int n = dmSnPrintf(str_buf, MAX_STRING_SIZE, "%s:%s: ", GetSeverityString(severity), domain);
+        if (n < (int) MAX_STRING_SIZE)
+        {
+            n += vsnprintf(str_buf + n, MAX_STRING_SIZE - n, format, lst);
+        }
+        n = TerminateMessage(str_buf, n);
+        args_size = n + 1;
+        record->m_FormatSize = 0;
+        record->m_Type = DEFERRED_RECORD_TEXT;
+
+        if (severity == LOG_SEVERITY_FATAL && is_debug_mode)
+        {
+            DoLogPlatform(severity, str_buf, n);
+            record->m_Platform = 0;
+        }
+    }
+    record->m_Size = (sizeof(DeferredRecord) + args_size + 7) & ~7U;
+
+    WriteDeferredRecord(GetDeferredRing(), record);
+
+    dmAtomicDecrement32(&g_DeferredWriters);
+    return true;
+}
+
+static void DeleteDeferredRings()
+{
+    DeferredRing* ring = (DeferredRing*) dmAtomicExchangePtr(&g_DeferredRings, 0);
+    while (ring)
+    {
+        DeferredRing* next = ring->m_Next;
+        delete ring;
+        dmAtomicDecrement32(&g_DeferredRingCount);
+        ring = next;
+    }
+}
+
 static void dmLogThread(void* args)
 {
     dmLogServer* server = g_dmLogServer;
 
     volatile bool run = true;
+    uint32_t deferred_count = 0;
     while (run)
     {
         // NOTE: We have support for blocking dispatch in dmMessage
         // but we have to wait for both new messages and on sockets.
-        // Currently no support for that and hence the sleep here
-        dmTime::Sleep(1000 * 30);
+        // Currently no support for that and hence the sleep here.
+        // While there are deferred records, we don't sleep, so that the rings don't fill up.
+        if (deferred_count == 0)
+        {
+            dmTime::Sleep(1000 * (g_Deferred ? 10 : 30));
+        }
         dmLogUpdateNetwork();
         dmMessage::Dispatch(server->m_MessageSocket, dmLogDispatch, (void*) &run);
+        if (g_Deferred)
+        {
+            deferred_count = ProcessDeferredRings();
+        }
     }
 }
 
@@ -467,6 +1071,13 @@ void LogInitialize(const LogParams* params)
     server->m_Thread = 0;
     if(dLib::FeaturesSupported(DM_FEATURE_BIT_SOCKET_SERVER_TCP)) // e.g. Emscripten doesn't support it
     {
+        // Deferred logging needs the log thread
+        g_Deferred = params->m_Deferred || getenv("DM_LOG_DEFERRED") != 0x0;
+        if (g_Deferred)
+        {
+            g_DeferredRingKey = dmThread::AllocTls(RetireDeferredRing);
+        }
+
         server->m_Thread = dmThread::New(dmLogThread, 0x80000, 0, "log");
     }
 
@@ -514,6 +1125,21 @@ void LogFinalize()
     if (self->m_Thread)
         dmThread::Join(self->m_Thread);
 
+    if (g_Deferred)
+    {
+        // Outputs what's left in the rings. A thread that passed the initialized check may still
+        // be writing, or waiting for space in its ring.
+        do
+        {
+            ProcessDeferredRings();
+        } while (dmAtomicGet32(&g_DeferredWriters) != 0);
+        ProcessDeferredRings();
+
+        DeleteDeferredRings();
+        dmThread::FreeTls(g_DeferredRingKey);
+        g_Deferred = false;
+    }
+
     {
         DM_SPINLOCK_SCOPED_LOCK(g_LogServerLock);
 
@@ -554,6 +1180,11 @@ uint16_t GetPort()
     return g_dmLogServer->m_Port;
 }
 
+uint32_t GetDeferredRingCount()
+{
+    return (uint32_t) dmAtomicGet32(&g_DeferredRingCount);
+}
+
 bool SetLogFile(const char* path)
 {
     if (g_LogFile) {
@@ -632,20 +1263,17 @@ void LogInternal(LogSeverity severity, const char* domain, const char* format, .
     va_list lst;
     va_start(lst, format);
 
-    const char* severity_str = 0;
-    switch (severity)
+    if (dmLog::g_Deferred)
     {
-        case LOG_SEVERITY_DEBUG:        severity_str = "DEBUG"; break;
-        case LOG_SEVERITY_USER_DEBUG:   severity_str = "DEBUG"; break;
-        case LOG_SEVERITY_INFO:         severity_str = "INFO"; break;
-        case LOG_SEVERITY_WARNING:      severity_str = "WARNING"; break;
-        case LOG_SEVERITY_ERROR:        severity_str = "ERROR"; break;
-        case LOG_SEVERITY_FATAL:        severity_str = "FATAL"; break;
-        default:
-            assert(0);
-            break;
+        if (dmLog::LogDeferred(severity, domain, is_debug_mode, format, lst))
+        {
+            va_end(lst);
+            return;
+        }
     }
 
+    const char* severity_str = dmLog::GetSeverityString(severity);
+
     char tmp_buf[sizeof(dmLog::LogMessage) + dmLog::MAX_STRING_SIZE];
     dmLog::LogMessage* msg = (dmLog::LogMessage*) &tmp_buf[0];
     char* str_buf = &tmp_buf[sizeof(dmLog::LogMessage)];
@@ -657,18 +1285,7 @@ void LogInternal(LogSeverity severity, const char* domain, const char* format, .
         n += vsnprintf(str_buf + n, dmLog::MAX_STRING_SIZE - n, format, lst);
     }
 
-    if (n < dmLog::MAX_STRING_SIZE)
-    {
-        n += dmSnPrintf(str_buf + n, dmLog::MAX_STRING_SIZE - n, "\n");
-    }
-
-    if (n >= dmLog::MAX_STRING_SIZE)
-    {
-        strcpy(&str_buf[dmLog::MAX_STRING_SIZE - (strlen(dmLog::LOG_OUTPUT_TRUNCATED_MESSAGE) + 1)], dmLog::LOG_OUTPUT_TRUNCATED_MESSAGE);
-    }
-
-    str_buf[dmLog::MAX_STRING_SIZE-1] = '\0';
-    int actual_n = dmMath::Min(n, (int)(dmLog::MAX_STRING_SIZE-1));
+    int actual_n = dmLog::TerminateMessage(str_buf, n);
 
     va_end(lst);
 
@@ -56,7 +56,14 @@ struct LogParams
 {
     LogParams()
     {
+        m_Deferred = false;
     }
+
+    /// Format and output the messages on the log thread. Each logging thread stores a copy of the format
+    /// string and the arguments in its own ring buffer. The listeners are called from the log thread,
+    /// and fatal messages are still printed directly.
+    /// Also enabled with the DM_LOG_DEFERRED environment variable.
+    bool m_Deferred;
 };
 
 /**
@@ -78,6 +85,13 @@ void LogFinalize();
  */
 uint16_t GetPort();
 
+/**
+ * Get the number of ring buffers used for deferred logging (see LogParams::m_Deferred).
+ * The ring of a thread is deleted by the log thread, once the thread has exited and the messages have been output.
+ * @return number of rings
+ */
+uint32_t GetDeferredRingCount();
+
 /**
  * Set log file. The file will be created and truncated.
  * Subsequent invocations to this function will close previous opened file.
@@ -13,7 +13,9 @@
 // specific language governing permissions and limitations under the License.
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include "message.h"
 #include "atomic.h"
 #include "hash.h"
@@ -24,6 +26,7 @@
 #include <dlib/mutex.h>
 #include <dlib/static_assert.h>
 #include <dlib/spinlock.h>
+#include <dlib/thread.h>
 #include <dlib/profile/profile.h>
 
 DM_PROPERTY_GROUP(rmtp_Message, "dmMessage");
@@ -34,24 +37,60 @@ namespace dmMessage
     // Alignment of allocations
     const uint32_t DM_MESSAGE_ALIGNMENT = 16U;
 
+    // Initial reference count of a page, while a thread still allocates from it. See ReleasePageRef()
+    const int32_t DM_MESSAGE_PAGE_BIAS = 0x40000000;
+
+    struct MemoryPage;
+
+    // Stored in front of each message, to find the page to release the message to after dispatch
+    struct DM_ALIGNED(16) MessagePrefix
+    {
+        MemoryPage* m_Page;
+        union
+        {
+            // Set for the messages of a batch, the message that holds their payload (see PostBatch())
+            Message*    m_Shared;
+            // Set for a message that holds the payload of a batch, the number of messages that refer to it.
+            // Only accessed by the thread dispatching the socket, once the messages are posted
+            uint32_t    m_SharedCount;
+        };
+    };
+
     struct MemoryPage
     {
-        uint8_t     m_Memory[DM_MESSAGE_PAGE_SIZE];
-        uint32_t    m_Current;
-        MemoryPage* m_NextPage;
+        // Room for the prefix, so that messages of DM_MESSAGE_MAX_DATA_SIZE still fit
+        uint8_t DM_ALIGNED(16) m_Memory[DM_MESSAGE_PAGE_SIZE + sizeof(MessagePrefix)];
+        uint32_t        m_Current;
+        // Number of messages allocated from the page. Only accessed by the allocating thread
+        uint32_t        m_Allocations;
+        // Outstanding messages, plus DM_MESSAGE_PAGE_BIAS while the page is the current page of a thread
+        int32_atomic_t  m_RefCount;
+        MemoryPage*     m_NextPage;
     };
 
-    struct MemoryAllocator
+    struct MessageSocket;
+
+    // Number of sockets a thread remembers the lookup of, see AcquireSocket()
+    const uint32_t DM_MESSAGE_SOCKET_CACHE_SIZE = 8;
+
+    struct SocketCacheEntry
     {
-        MemoryAllocator()
-        {
-            m_CurrentPage = 0;
-            m_FreePages = 0;
-            m_FullPages = 0;
-        }
-        MemoryPage* m_CurrentPage;
-        MemoryPage* m_FreePages;
-        MemoryPage* m_FullPages;
+        HSocket        m_Socket;
+        MessageSocket* m_Data;
+        // The generation of the socket when it was looked up
+        int32_t        m_Generation;
+    };
+
+    // Each posting thread allocates messages from its own page, which means that no lock is needed
+    // when posting. The pages are released when all messages have been dispatched.
+    // The context is deleted when the thread exits, see DeleteThreadContext()
+    struct ThreadContext
+    {
+        MemoryPage*      m_CurrentPage;
+        SocketCacheEntry m_SocketCache[DM_MESSAGE_SOCKET_CACHE_SIZE];
+        // All contexts, protected by g_MessagePageSpinlock
+        ThreadContext*   m_Prev;
+        ThreadContext*   m_Next;
     };
 
     struct GlobalInit
@@ -63,73 +102,211 @@ namespace dmMessage
 
     } g_MessageInit;
 
+    // Free pages and thread contexts
+    dmSpinlock::Spinlock g_MessagePageSpinlock;
+    MemoryPage*          g_FreePages = 0;
+    ThreadContext*       g_ThreadContexts = 0;
+    dmThread::TlsKey     g_ThreadContextKey;
+
     static Result GetSocketNoLock(dmhash_t name_hash, HSocket* out_socket);
 
-    static void AllocateNewPage(MemoryAllocator* allocator)
+    static MemoryPage* NewPage()
     {
-        if (allocator->m_CurrentPage)
+        MemoryPage* page = 0;
         {
-            // Link current page to full pages
-            allocator->m_CurrentPage->m_NextPage = allocator->m_FullPages;
-            allocator->m_FullPages = allocator->m_CurrentPage;
+            DM_SPINLOCK_SCOPED_LOCK(g_MessagePageSpinlock);
+            page = g_FreePages;
+            if (page)
+            {
+                g_FreePages = page->m_NextPage;
+            }
+        }
+        if (!page)
+        {
+            page = new MemoryPage;
         }
 
-        MemoryPage* new_page = 0;
+        page->m_Current = 0;
+        page->m_Allocations = 0;
+        page->m_NextPage = 0;
+        dmAtomicStore32(&page->m_RefCount, DM_MESSAGE_PAGE_BIAS);
+        return page;
+    }
 
-        if (allocator->m_FreePages)
+    // Releases count references to the page, and returns it to the free pages when the last reference is released
+    static void ReleasePageRef(MemoryPage* page, int32_t count)
+    {
+        if (dmAtomicSub32(&page->m_RefCount, count) == count)
         {
-            // Free page to use
-            new_page = allocator->m_FreePages;
-            allocator->m_FreePages = new_page->m_NextPage;
+            DM_SPINLOCK_SCOPED_LOCK(g_MessagePageSpinlock);
+            page->m_NextPage = g_FreePages;
+            g_FreePages = page;
         }
-        else
+    }
+
+    static ThreadContext* GetThreadContext()
+    {
+        ThreadContext* context = (ThreadContext*) dmThread::GetTlsValue(g_ThreadContextKey);
+        if (!context)
         {
-            // Allocate new page
-            new_page = new MemoryPage;
+            context = new ThreadContext;
+            memset(context, 0, sizeof(ThreadContext));
+            {
+                DM_SPINLOCK_SCOPED_LOCK(g_MessagePageSpinlock);
+                context->m_Next = g_ThreadContexts;
+                if (g_ThreadContexts)
+                {
+                    g_ThreadContexts->m_Prev = context;
+                }
+                g_ThreadContexts = context;
+            }
+            dmThread::SetTlsValue(g_ThreadContextKey, context);
         }
+        return context;
+    }
 
-        new_page->m_Current = 0;
-        new_page->m_NextPage = 0;
+    // Called when a thread that has posted or dispatched messages exits
+    static void DeleteThreadContext(void* value)
+    {
+        ThreadContext* context = (ThreadContext*) value;
+        MemoryPage* page = context->m_CurrentPage;
+        if (page)
+        {
+            // Drop the bias, the page is released when its remaining messages have been dispatched
+            ReleasePageRef(page, DM_MESSAGE_PAGE_BIAS - (int32_t) page->m_Allocations);
+        }
 
-        allocator->m_CurrentPage = new_page;
+        {
+            DM_SPINLOCK_SCOPED_LOCK(g_MessagePageSpinlock);
+            if (context->m_Prev)
+            {
+                context->m_Prev->m_Next = context->m_Next;
+            }
+            else
+            {
+                g_ThreadContexts = context->m_Next;
+            }
+            if (context->m_Next)
+            {
+                context->m_Next->m_Prev = context->m_Prev;
+            }
+        }
+        delete context;
     }
 
-    static void* AllocateMessage(MemoryAllocator* allocator, uint32_t size)
+    static Message* AllocateMessage(uint32_t size)
     {
         // At least ALIGNMENT bytes alignment of size in order to ensure that the next allocation is aligned
+        size += sizeof(MessagePrefix);
         size += DM_MESSAGE_ALIGNMENT-1;
         size &= ~(DM_MESSAGE_ALIGNMENT-1);
-        assert(size <= DM_MESSAGE_PAGE_SIZE);
+        assert(size <= sizeof(((MemoryPage*)0)->m_Memory));
 
-        if (allocator->m_CurrentPage == 0 || (DM_MESSAGE_PAGE_SIZE-allocator->m_CurrentPage->m_Current) < size)
+        ThreadContext* context = GetThreadContext();
+        MemoryPage* page = context->m_CurrentPage;
+        if (page == 0 || (sizeof(page->m_Memory) - page->m_Current) < size)
         {
             // No current page or allocation didn't fit.
-            AllocateNewPage(allocator);
+            if (page)
+            {
+                // Drop the bias, the page is released when its remaining messages have been dispatched
+                ReleasePageRef(page, DM_MESSAGE_PAGE_BIAS - (int32_t) page->m_Allocations);
+            }
+            page = NewPage();
+            context->m_CurrentPage = page;
         }
 
-        MemoryPage* page = allocator->m_CurrentPage;
-        void* ret = (void*) ((uintptr_t) &page->m_Memory[0] + page->m_Current);
+        MessagePrefix* prefix = (MessagePrefix*) &page->m_Memory[page->m_Current];
+        prefix->m_Page = page;
+        prefix->m_Shared = 0;
         page->m_Current += size;
-        return ret;
+        page->m_Allocations++;
+        return (Message*) (prefix + 1);
+    }
+
+    // Returns the message to pass to the callbacks. The header of a batch message is copied to the message holding the payload.
+    static Message* GetDispatchMessage(Message* message_object)
+    {
+        Message* shared = ((MessagePrefix*) message_object - 1)->m_Shared;
+        if (shared == 0)
+        {
+            return message_object;
+        }
+        memcpy(shared, message_object, sizeof(Message));
+        return shared;
+    }
+
+    // Releases the memory of the messages in the list, returning the pages once per run of messages from the same page
+    static void FreeMessages(Message* message_object)
+    {
+        MemoryPage* page = 0;
+        int32_t count = 0;
+        while (message_object)
+        {
+            Message* next = message_object->m_Next;
+            MessagePrefix* prefix = (MessagePrefix*) message_object - 1;
+            if (prefix->m_Shared != 0)
+            {
+                // The payload is released with the last message of the batch
+                MessagePrefix* shared_prefix = (MessagePrefix*) prefix->m_Shared - 1;
+                if (--shared_prefix->m_SharedCount == 0)
+                {
+                    ReleasePageRef(shared_prefix->m_Page, 1);
+                }
+            }
+            MemoryPage* message_page = prefix->m_Page;
+            if (message_page != page)
+            {
+                if (page)
+                {
+                    ReleasePageRef(page, count);
+                }
+                page = message_page;
+                count = 0;
+            }
+            ++count;
+            message_object = next;
+        }
+        if (page)
+        {
+            ReleasePageRef(page, count);
+        }
+    }
+
+    static void DeletePages(MemoryPage* p)
+    {
+        while (p)
+        {
+            MemoryPage* next = p->m_NextPage;
+            delete p;
+            p = next;
+        }
     }
 
     struct MessageSocket
     {
-        uint32_t        m_RefCount; // Is protected by "g_MessageSpinlock"
+        // One reference is held by the socket table, and one by each AcquireSocket(). Disposed when it reaches zero
+        int32_atomic_t  m_RefCount;
+        // Incremented under "g_MessageSpinlock" when the socket is created or deleted. Kept when the socket is disposed
+        int32_atomic_t  m_Generation;
         dmhash_t        m_NameHash;
-        Message*        m_Header;
-        Message*        m_Tail;
+        // Posted messages in reverse order. Pushed to by any thread, and taken as a whole by the dispatching thread
+        Message* volatile m_Incoming;
         const char*     m_Name;
+        // Only used by DispatchBlocking() to wait for messages
         dmMutex::HMutex m_Mutex;
         dmConditionVariable::HConditionVariable m_Condition;
-        MemoryAllocator m_Allocator;
+        int32_atomic_t  m_Waiting;
     };
 
     const uint32_t MAX_SOCKETS = 256;
 
     struct MessageContext
     {
-        dmHashTable64<MessageSocket> m_Sockets;
+        // The sockets are never moved or freed, so that a thread can keep a pointer to one (see AcquireSocket())
+        MessageSocket                  m_SocketPool[MAX_SOCKETS];
+        dmArray<MessageSocket*>        m_FreeSockets;
+        dmHashTable64<MessageSocket*>  m_Sockets;
     };
 
     MessageContext* g_MessageContext = 0;
@@ -138,6 +315,12 @@ namespace dmMessage
     static MessageContext* Create(uint32_t max_sockets)
     {
         MessageContext* ctx = new MessageContext;
+        memset(ctx->m_SocketPool, 0, sizeof(ctx->m_SocketPool));
+        ctx->m_FreeSockets.SetCapacity(max_sockets);
+        for (uint32_t i = max_sockets; i > 0; --i)
+        {
+            ctx->m_FreeSockets.Push(&ctx->m_SocketPool[i - 1]);
+        }
         ctx->m_Sockets.SetCapacity(max_sockets, max_sockets);
 
         return ctx;
@@ -151,6 +334,8 @@ namespace dmMessage
         {
             dmAtomicStore32(&m_Deleted, 0);
             dmSpinlock::Create(&g_MessageSpinlock);
+            dmSpinlock::Create(&g_MessagePageSpinlock);
+            g_ThreadContextKey = dmThread::AllocTls(DeleteThreadContext);
         }
 
         ~ContextDestroyer()
@@ -165,6 +350,23 @@ namespace dmMessage
                 }
             }
             dmSpinlock::Destroy(&g_MessageSpinlock);
+
+            {
+                DM_SPINLOCK_SCOPED_LOCK(g_MessagePageSpinlock);
+                ThreadContext* context = g_ThreadContexts;
+                while (context)
+                {
+                    ThreadContext* next = context->m_Next;
+                    delete context->m_CurrentPage;
+                    delete context;
+                    context = next;
+                }
+                g_ThreadContexts = 0;
+                DeletePages(g_FreePages);
+                g_FreePages = 0;
+            }
+            dmThread::FreeTls(g_ThreadContextKey);
+            dmSpinlock::Destroy(&g_MessagePageSpinlock);
         }
         int32_atomic_t m_Deleted;
     } g_ContextDestroyer;
@@ -201,14 +403,17 @@ namespace dmMessage
             return RESULT_SOCKET_EXISTS;
         }
 
-        MessageSocket s;
-        s.m_RefCount = 1;
-        s.m_Header = 0;
-        s.m_Tail = 0;
-        s.m_NameHash = name_hash;
-        s.m_Name = strdup(name);
-        s.m_Mutex = dmMutex::New();
-        s.m_Condition = dmConditionVariable::New();
+        MessageSocket* s = g_MessageContext->m_FreeSockets.Back();
+        g_MessageContext->m_FreeSockets.Pop();
+        s->m_Incoming = 0;
+        s->m_NameHash = name_hash;
+        s->m_Name = strdup(name);
+        s->m_Mutex = dmMutex::New();
+        s->m_Condition = dmConditionVariable::New();
+        s->m_Waiting = 0;
+        // The cached lookups of the previous socket in the slot are no longer valid
+        dmAtomicIncrement32(&s->m_Generation);
+        dmAtomicStore32(&s->m_RefCount, 1);
 
         g_MessageContext->m_Sockets.Put(name_hash, s);
         *socket = name_hash;
@@ -216,58 +421,98 @@ namespace dmMessage
         return RESULT_OK;
     }
 
+    // Takes all posted messages from the socket, in the order they were posted
+    static Message* TakeMessages(MessageSocket* s)
+    {
+        Message* message_object = (Message*) dmAtomicExchangePtr((void* volatile*) &s->m_Incoming, 0);
+
+        // The messages are pushed to the front of the list, so reverse it
+        Message* ordered = 0;
+        while (message_object)
+        {
+            Message* next = message_object->m_Next;
+            message_object->m_Next = ordered;
+            ordered = message_object;
+            message_object = next;
+        }
+        return ordered;
+    }
+
     static void DisposeSocket(MessageSocket* s)
     {
-        Message *message_object = s->m_Header;
+        Message* messages = TakeMessages(s);
+        Message *message_object = messages;
         while (message_object)
         {
             if (message_object->m_DestroyCallback)
             {
-                message_object->m_DestroyCallback(message_object);
+                message_object->m_DestroyCallback(GetDispatchMessage(message_object));
             }
             message_object = message_object->m_Next;
         }
+        FreeMessages(messages);
 
         free((void*) s->m_Name);
 
-        MemoryPage* p = s->m_Allocator.m_FreePages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        p = s->m_Allocator.m_FullPages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        if (s->m_Allocator.m_CurrentPage)
-        {
-            delete s->m_Allocator.m_CurrentPage;
-        }
-
         dmConditionVariable::Delete(s->m_Condition);
 
         dmMutex::Delete(s->m_Mutex);
 
-        memset(s, 0, sizeof(*s));
+        // The reference count and generation are kept, see AcquireCachedSocket()
+        s->m_NameHash = 0;
+        s->m_Name = 0;
+        s->m_Mutex = 0;
+        s->m_Condition = 0;
+        s->m_Waiting = 0;
+
+        DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
+        if (g_MessageContext)
+        {
+            g_MessageContext->m_FreeSockets.Push(s);
+        }
     }
 
     static void ReleaseSocket(MessageSocket* s)
     {
+        if (dmAtomicDecrement32(&s->m_RefCount) == 1)
         {
-            DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            --s->m_RefCount;
+            DisposeSocket(s);
+        }
+    }
+
+    // Takes a reference to the socket found by an earlier lookup on this thread, without locking
+    static MessageSocket* AcquireCachedSocket(const SocketCacheEntry* entry, HSocket socket)
+    {
+        if (entry->m_Socket != socket)
+        {
+            return 0;
+        }
 
-            if (s->m_RefCount > 0)
+        // A disposed socket can't be resurrected, since its count is zero.
+        // Most of the time, only the socket table holds a reference
+        MessageSocket* s = entry->m_Data;
+        int32_t ref_count = 1;
+        while (ref_count > 0)
+        {
+            int32_t prev = dmAtomicCompareStore32(&s->m_RefCount, ref_count + 1, ref_count);
+            if (prev == ref_count)
             {
-                return;
+                break;
             }
+            ref_count = prev;
+        }
+        if (ref_count <= 0)
+        {
+            return 0;
         }
-        DisposeSocket(s);
+
+        // The socket was deleted, or the slot reused, since the lookup
+        if (dmAtomicGet32(&s->m_Generation) != entry->m_Generation)
+        {
+            ReleaseSocket(s);
+            return 0;
+        }
+        return s;
     }
 
     static MessageSocket* AcquireSocket(HSocket socket)
@@ -277,18 +522,30 @@ namespace dmMessage
             return 0; // The system has already been shut down
         }
 
+        SocketCacheEntry* entry = &GetThreadContext()->m_SocketCache[socket & (DM_MESSAGE_SOCKET_CACHE_SIZE - 1)];
+        MessageSocket* s = AcquireCachedSocket(entry, socket);
+        if (s)
+        {
+            return s;
+        }
+
         DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
 
-        MessageSocket* s = g_MessageContext->m_Sockets.Get(socket);
+        MessageSocket** socket_data = g_MessageContext->m_Sockets.Get(socket);
 
-        if (s == 0x0)
+        if (socket_data == 0x0)
         {
             return 0x0;
         }
 
-        assert(s->m_RefCount >= 1);
+        s = *socket_data;
+        assert(dmAtomicGet32(&s->m_RefCount) >= 1);
 
-        ++s->m_RefCount;
+        dmAtomicIncrement32(&s->m_RefCount);
+
+        entry->m_Socket = socket;
+        entry->m_Data = s;
+        entry->m_Generation = dmAtomicGet32(&s->m_Generation);
 
         return s;
     }
@@ -298,22 +555,19 @@ namespace dmMessage
         MessageSocket* s = 0x0;
         {
             DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            s = g_MessageContext->m_Sockets.Get(socket);
-            if (s == 0x0)
+            MessageSocket** socket_data = g_MessageContext->m_Sockets.Get(socket);
+            if (socket_data == 0x0)
             {
                 return RESULT_SOCKET_NOT_FOUND;
             }
 
+            s = *socket_data;
             g_MessageContext->m_Sockets.Erase(s->m_NameHash);
-            --s->m_RefCount;
-
-            if(s->m_RefCount > 0)
-            {
-                // Defer deletion
-                return RESULT_OK;
-            }
+            dmAtomicIncrement32(&s->m_Generation);
         }
-        DisposeSocket(s);
+
+        // Deletion is deferred while the socket is acquired
+        ReleaseSocket(s);
         return RESULT_OK;
     }
 
@@ -321,7 +575,7 @@ namespace dmMessage
     {
         *out_socket = name_hash; // to silence an existing test
 
-        MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(name_hash);
+        MessageSocket** message_socket = g_MessageContext->m_Sockets.Get(name_hash);
         if (!message_socket)
         {
             return RESULT_NAME_OK_SOCKET_NOT_FOUND;
@@ -349,10 +603,10 @@ namespace dmMessage
     {
         DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
 
-        MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(socket);
+        MessageSocket** message_socket = g_MessageContext->m_Sockets.Get(socket);
         if (message_socket != 0x0)
         {
-            return message_socket->m_Name;
+            return (*message_socket)->m_Name;
         }
         else
         {
@@ -365,7 +619,7 @@ namespace dmMessage
         if (socket != 0)
         {
             DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(socket);
+            MessageSocket** message_socket = g_MessageContext->m_Sockets.Get(socket);
             return message_socket != 0;
         }
         return false;
@@ -379,11 +633,7 @@ namespace dmMessage
         MessageSocket* s = AcquireSocket(socket);
         if (s != 0)
         {
-            bool has_messages;
-            {
-                DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
-                has_messages = s->m_Header != 0;
-            }
+            bool has_messages = dmAtomicGetPtr((void* volatile*) &s->m_Incoming) != 0;
             ReleaseSocket(s);
             return has_messages;
         }
@@ -430,28 +680,12 @@ namespace dmMessage
         url->m_Fragment = fragment;
     }
 
-    Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
-                    uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    // If shared is set, the message refers to the payload of that message instead of holding a copy
+    static Message* NewMessage(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                                uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback, Message* shared)
     {
-        DM_PROFILE("Post");
-        //Currently called out by the Thread Sanitizer: DM_PROPERTY_ADD_U32(rmtp_Messages, 1);
-
-        if (receiver == 0x0)
-        {
-            return RESULT_SOCKET_NOT_FOUND;
-        }
-
-        MessageSocket* s = AcquireSocket(receiver->m_Socket);
-        if (s == 0x0)
-        {
-            return RESULT_SOCKET_NOT_FOUND;
-        }
-
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
-        uint32_t data_size = sizeof(Message) + message_data_size;
-        Message *new_message = (Message *) AllocateMessage(allocator, data_size);
+        uint32_t data_size = sizeof(Message) + (shared ? 0 : message_data_size);
+        Message *new_message = AllocateMessage(data_size);
         if (sender != 0x0)
         {
             new_message->m_Sender = *sender;
@@ -468,32 +702,149 @@ namespace dmMessage
         new_message->m_DataSize = message_data_size;
         new_message->m_Next = 0;
         new_message->m_DestroyCallback = destroy_callback;
-        memcpy(&new_message->m_Data[0], message_data, message_data_size);
-
-        bool is_first_message = !s->m_Header;
-
-        if (!s->m_Header)
+        if (shared)
         {
-            s->m_Header = new_message;
-            s->m_Tail = new_message;
+            ((MessagePrefix*) new_message - 1)->m_Shared = shared;
         }
         else
         {
-            s->m_Tail->m_Next = new_message;
-            s->m_Tail = new_message;
+            memcpy(&new_message->m_Data[0], message_data, message_data_size);
+        }
+        return new_message;
+    }
+
+    // Pushes a list of messages (newest first, linked from 'newest' to 'oldest') to the front of the incoming list
+    static void PushMessages(MessageSocket* s, Message* newest, Message* oldest)
+    {
+        // A failed compare returns the current head, so start by guessing that the list is empty
+        Message* head = 0;
+        while (true)
+        {
+            oldest->m_Next = head;
+            Message* prev = (Message*) dmAtomicCompareStorePtr((void* volatile*) &s->m_Incoming, newest, head);
+            if (prev == head)
+            {
+                break;
+            }
+            head = prev;
         }
 
-        if (is_first_message)
+        // Only a blocking dispatch needs to be woken up, see InternalDispatch()
+        if (head == 0 && dmAtomicGet32(&s->m_Waiting) != 0)
         {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
             dmConditionVariable::Signal(s->m_Condition);
         }
-        dmMutex::Unlock(s->m_Mutex);
+    }
+
+    Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                    uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    {
+        DM_PROFILE("Post");
+        //Currently called out by the Thread Sanitizer: DM_PROPERTY_ADD_U32(rmtp_Messages, 1);
+
+        if (receiver == 0x0)
+        {
+            return RESULT_SOCKET_NOT_FOUND;
+        }
+
+        MessageSocket* s = AcquireSocket(receiver->m_Socket);
+        if (s == 0x0)
+        {
+            return RESULT_SOCKET_NOT_FOUND;
+        }
+
+        Message* new_message = NewMessage(sender, receiver, message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, 0);
+        PushMessages(s, new_message, new_message);
 
         ReleaseSocket(s);
 
         return RESULT_OK;
     }
 
+    // Orders receiver indices by socket, and by index within the same socket
+    struct ReceiverSortPred
+    {
+        const URL* m_Receivers;
+        ReceiverSortPred(const URL* receivers) : m_Receivers(receivers) {}
+
+        bool operator ()(uint32_t a, uint32_t b) const
+        {
+            HSocket socket_a = m_Receivers[a].m_Socket;
+            HSocket socket_b = m_Receivers[b].m_Socket;
+            return socket_a < socket_b || (socket_a == socket_b && a < b);
+        }
+    };
+
+    Result PostBatch(const URL* sender, const URL* receivers, uint32_t receiver_count, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                    uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
+    {
+        DM_PROFILE("PostBatch");
+
+        if (receivers == 0x0 && receiver_count > 0)
+        {
+            return RESULT_SOCKET_NOT_FOUND;
+        }
+
+        // The receivers are grouped by socket, keeping their order within each socket
+        const uint32_t max_stack_receivers = 64;
+        uint32_t stack_order[max_stack_receivers];
+        uint32_t* order = receiver_count <= max_stack_receivers ? stack_order : (uint32_t*) malloc(receiver_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < receiver_count; ++i)
+        {
+            order[i] = i;
+        }
+        std::sort(order, order + receiver_count, ReceiverSortPred(receivers));
+
+        Result result = RESULT_OK;
+        uint32_t end = 0;
+        for (uint32_t begin = 0; begin < receiver_count; begin = end)
+        {
+            HSocket socket = receivers[order[begin]].m_Socket;
+            end = begin + 1;
+            while (end < receiver_count && receivers[order[end]].m_Socket == socket)
+            {
+                ++end;
+            }
+
+            MessageSocket* s = AcquireSocket(socket);
+            if (s == 0x0)
+            {
+                result = RESULT_SOCKET_NOT_FOUND;
+                continue;
+            }
+
+            // The receivers of the socket share one copy of the payload. It's not shared between sockets, since the header
+            // in front of it is written for each receiver when the socket is dispatched, and sockets may be dispatched
+            // from different threads.
+            const URL* first = &receivers[order[begin]];
+            Message* shared = 0;
+            if (end - begin > 1)
+            {
+                shared = NewMessage(sender, first, message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, 0);
+                ((MessagePrefix*) shared - 1)->m_SharedCount = end - begin;
+            }
+
+            Message* oldest = NewMessage(sender, first, message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, shared);
+            Message* newest = oldest;
+            for (uint32_t i = begin + 1; i < end; ++i)
+            {
+                Message* new_message = NewMessage(sender, &receivers[order[i]], message_id, user_data1, user_data2, descriptor, message_data, message_data_size, destroy_callback, shared);
+                new_message->m_Next = newest;
+                newest = new_message;
+            }
+            PushMessages(s, newest, oldest);
+
+            ReleaseSocket(s);
+        }
+
+        if (order != stack_order)
+        {
+            free(order);
+        }
+        return result;
+    }
+
     Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t descriptor,
                     const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback)
     {
@@ -535,21 +886,25 @@ namespace dmMessage
             return 0;
         }
 
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
-
-        if (!s->m_Header)
+        Message* messages = TakeMessages(s);
+        if (!messages)
         {
-            if (blocking) {
-                dmConditionVariable::Wait(s->m_Condition, s->m_Mutex);
-            } else {
-                dmMutex::Unlock(s->m_Mutex);
+            if (!blocking)
+            {
                 ReleaseSocket(s);
                 return 0;
             }
-        }
 
+            // The waiting flag is set before checking the list again, and a post checks it after
+            // pushing its message. Either the post signals, or we see the message here.
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            dmAtomicIncrement32(&s->m_Waiting);
+            while ((messages = TakeMessages(s)) == 0)
+            {
+                dmConditionVariable::Wait(s->m_Condition, s->m_Mutex);
+            }
+            dmAtomicDecrement32(&s->m_Waiting);
+        }
 
         char buffer[128];
         const char* profiler_string = GetProfilerString(s->m_Name, buffer, sizeof(buffer));
@@ -557,37 +912,19 @@ namespace dmMessage
 
         uint32_t dispatch_count = 0;
 
-        Message *message_object = s->m_Header;
-        s->m_Header = 0;
-        s->m_Tail = 0;
-
-        // Unlink full pages
-        MemoryPage* full_pages = allocator->m_FullPages;
-        allocator->m_FullPages = 0;
-
-        dmMutex::Unlock(s->m_Mutex);
-
+        Message *message_object = messages;
         while (message_object)
         {
-            dispatch_callback(message_object, user_ptr);
-            if (message_object->m_DestroyCallback) {
-                message_object->m_DestroyCallback(message_object);
+            Message* dispatch_message = GetDispatchMessage(message_object);
+            dispatch_callback(dispatch_message, user_ptr);
+            if (dispatch_message->m_DestroyCallback) {
+                dispatch_message->m_DestroyCallback(dispatch_message);
             }
             message_object = message_object->m_Next;
             dispatch_count++;
         }
 
-        // Reclaim all full pages active when dispatch started
-        dmMutex::Lock(s->m_Mutex);
-        MemoryPage* p = full_pages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            p->m_NextPage = allocator->m_FreePages;
-            allocator->m_FreePages = p;
-            p = next;
-        }
-        dmMutex::Unlock(s->m_Mutex);
+        FreeMessages(messages);
 
         ReleaseSocket(s);
 
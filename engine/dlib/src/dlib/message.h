@@ -65,6 +65,27 @@ namespace dmMessage
      */
     bool HasMessages(HSocket socket);
 
+    /**
+     * Post the same message to several receivers
+     * @note The receivers are grouped by socket, and the messages to each socket are added at once. The message data is copied
+     *       once per socket and shared by its receivers, and the destroy callback (if any) is called for each of the messages.
+     *       The messages to each socket are dispatched in the order of the receivers.
+     * @param sender The sender URL if the receiver wants to respond. 0x0 is accepted
+     * @param receivers Array of receiver URLs
+     * @param receiver_count Number of receivers
+     * @param message_id Message id
+     * @param user_data1 User data that can be used when both the sender and receiver are known
+     * @param user_data2 User data that can be used when both the sender and receiver are known
+     * @param descriptor User specified descriptor of the message data
+     * @param message_data Message data reference
+     * @param message_data_size Message data size in bytes
+     * @param destroy_callback If set, will be called after each message dispatch
+     * @return RESULT_OK if the message was posted to all receivers, RESULT_SOCKET_NOT_FOUND if the socket of any receiver
+     *         wasn't found (the message is still posted to the other receivers)
+     */
+    Result PostBatch(const URL* sender, const URL* receivers, uint32_t receiver_count, dmhash_t message_id, uintptr_t user_data1, uintptr_t user_data2,
+                     uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback);
+
     // Internal legacy function
     Result Post(const URL* sender, const URL* receiver, dmhash_t message_id, uintptr_t user_data1, uintptr_t descriptor, const void* message_data, uint32_t message_data_size, MessageDestroyCallback destroy_callback);
 
@@ -72,6 +93,7 @@ namespace dmMessage
      * Dispatch messages
      * @note When dispatched, the messages are considered destroyed. Messages posted during dispatch
      *       are handled in the next invocation to #Dispatch
+     * @note Messages may be posted from any thread, but a socket must only be dispatched from one thread at a time
      * @param socket Socket handle of the socket of which messages to dispatch.
      * @param dispatch_callback Callback function that will be called for each message
      *        dispatched. The callbacks parameters contains a pointer to a unique Message
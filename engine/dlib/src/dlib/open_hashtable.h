@@ -0,0 +1,482 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_OPEN_HASHTABLE_H
+#define DM_OPEN_HASHTABLE_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+
+/*# Open addressing hash table
+ *
+ * Hash table with open addressing, in the style of a "Swiss table".
+ * Each slot has a one byte control value, and lookups compare a whole group of 16 control bytes at once
+ * (SSE2 on x86/x86_64, NEON on arm64, a scalar loop elsewhere), before looking at any keys.
+ * The number of slots is a power of two, so no integer division is needed, and the table grows
+ * automatically when it is more than 7/8 full.
+ *
+ * The API follows dmHashTable, so that call sites can be migrated by changing the type. The differences are:
+ *
+ * - Put() never asserts on a full table, it grows instead. Pointers returned by Get() are invalidated when the table grows.
+ * - The key type needs to support == and conversion to uint64_t (the integer key types used with dmHashTable).
+ * - The table size argument of SetCapacity(table_size, capacity) is ignored.
+ *
+ * Values are copied with memcpy semantics (POD types), like dmHashTable.
+ *
+ * @class
+ * @name dmOpenHashTable
+ */
+template <typename KEY, typename T>
+class dmOpenHashTable
+{
+    static const uint32_t GROUP_SIZE    = 16;
+    // Control byte values. A full slot stores the lower 7 bits of the key hash
+    static const uint8_t  CTRL_EMPTY    = 0x80;
+    static const uint8_t  CTRL_DELETED  = 0xFE;
+
+public:
+    struct Entry
+    {
+        KEY m_Key;
+        T   m_Value;
+    };
+
+    dmOpenHashTable()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    ~dmOpenHashTable()
+    {
+        free(m_Ctrl);
+    }
+
+    /*# number of entries stored in the table
+     * @name Size
+     * @return size [type:uint32_t] number of entries
+     */
+    uint32_t Size() const
+    {
+        return m_Count;
+    }
+
+    /*# number of entries that can be stored before the table grows
+     * @name Capacity
+     * @return capacity [type:uint32_t] the capacity of the table
+     */
+    uint32_t Capacity() const
+    {
+        return MaxLoad(m_SlotCount);
+    }
+
+    /*# check if the table is full
+     * The table grows automatically, so this is only true if the next Put() of a new key will grow the table.
+     * @name Full
+     * @return full [type:bool] true if the table is full
+     */
+    bool Full() const
+    {
+        return m_Count >= Capacity();
+    }
+
+    /*# check if the table is empty
+     * @name Empty
+     * @return empty [type:bool] true if the table is empty
+     */
+    bool Empty() const
+    {
+        return m_Count == 0;
+    }
+
+    /*# reserve space for a number of entries
+     * Grows the table so that at least `capacity` entries can be stored without growing again.
+     * Never shrinks the table.
+     * @name SetCapacity
+     * @param capacity [type:uint32_t] the number of entries
+     */
+    void SetCapacity(uint32_t capacity)
+    {
+        uint32_t slot_count = GROUP_SIZE;
+        while (MaxLoad(slot_count) < capacity)
+        {
+            slot_count *= 2;
+        }
+        if (slot_count > m_SlotCount)
+        {
+            Rehash(slot_count);
+        }
+    }
+
+    /*# reserve space for a number of entries
+     * Same as SetCapacity(capacity), for compatibility with dmHashTable
+     * @name SetCapacity
+     * @param table_size [type:uint32_t] ignored
+     * @param capacity [type:uint32_t] the number of entries
+     */
+    void SetCapacity(uint32_t table_size, uint32_t capacity)
+    {
+        (void) table_size;
+        SetCapacity(capacity);
+    }
+
+    /*# removes all the entries from the table
+     * The memory is kept.
+     * @name Clear
+     */
+    void Clear()
+    {
+        if (m_SlotCount)
+        {
+            memset(m_Ctrl, CTRL_EMPTY, m_SlotCount);
+        }
+        m_Count = 0;
+        m_GrowthLeft = MaxLoad(m_SlotCount);
+    }
+
+    /*# swaps the contents of two tables
+     * @name Swap
+     * @param other [type:dmOpenHashTable<KEY, T>&] the other table
+     */
+    void Swap(dmOpenHashTable<KEY, T>& other)
+    {
+        char buf[sizeof(*this)];
+        memcpy(buf, &other, sizeof(buf));
+        memcpy(&other, this, sizeof(buf));
+        memcpy(this, buf, sizeof(buf));
+    }
+
+    /*# put a key/value pair in the table
+     * Replaces the value if the key already exists. Grows the table if needed.
+     * @name Put
+     * @param key [type:KEY] key
+     * @param value [type:const T&] value
+     */
+    void Put(KEY key, const T& value)
+    {
+        Entry* entry = FindEntry(key);
+        if (entry != 0)
+        {
+            entry->m_Value = value;
+            return;
+        }
+
+        uint64_t hash = HashKey(key);
+        if (m_GrowthLeft == 0)
+        {
+            // Mostly tombstones? Then a rehash at the same size is enough to reclaim them
+            uint32_t slot_count = m_SlotCount == 0 ? GROUP_SIZE : m_SlotCount;
+            if (m_Count + 1 > MaxLoad(slot_count) / 2)
+            {
+                slot_count *= 2;
+            }
+            Rehash(slot_count);
+        }
+
+        uint32_t index = FindInsertSlot(hash);
+        if (m_Ctrl[index] == CTRL_EMPTY)
+        {
+            --m_GrowthLeft;
+        }
+        m_Ctrl[index] = (uint8_t) (hash & 0x7F);
+        m_Entries[index].m_Key = key;
+        m_Entries[index].m_Value = value;
+        ++m_Count;
+    }
+
+    /*# get a pointer to the value of a key
+     * @name Get
+     * @param key [type:KEY] key
+     * @return value [type:T*] pointer to the value. 0 if the key doesn't exist.
+     */
+    T* Get(KEY key)
+    {
+        Entry* entry = FindEntry(key);
+        return entry != 0 ? &entry->m_Value : 0;
+    }
+
+    /*# get a pointer to the value of a key
+     * @name Get
+     * @param key [type:KEY] key
+     * @return value [type:const T*] pointer to the value. 0 if the key doesn't exist.
+     */
+    const T* Get(KEY key) const
+    {
+        Entry* entry = FindEntry(key);
+        return entry != 0 ? &entry->m_Value : 0;
+    }
+
+    /*# remove a key/value pair
+     * @name Erase
+     * @param key [type:KEY] key to remove
+     * @note Only valid if the key exists in the table
+     */
+    void Erase(KEY key)
+    {
+        Entry* entry = FindEntry(key);
+        assert(entry != 0 && "Key not found (erase)");
+
+        uint32_t index = (uint32_t) (entry - m_Entries);
+        // A probe only continues past a group that has no empty slot. If the group has one,
+        // no other key can depend on this slot being occupied, and it can be freed completely.
+        if (MatchByte(m_Ctrl + (index & ~(GROUP_SIZE - 1)), CTRL_EMPTY))
+        {
+            m_Ctrl[index] = CTRL_EMPTY;
+            ++m_GrowthLeft;
+        }
+        else
+        {
+            m_Ctrl[index] = CTRL_DELETED;
+        }
+        --m_Count;
+    }
+
+    /*# iterate over all entries in the table
+     * @name Iterate
+     * @param call_back [type:void(*)(CONTEXT*, const KEY*, T*)] called for every entry
+     * @param context [type:CONTEXT*] context
+     */
+    template <typename CONTEXT>
+    void Iterate(void (*call_back)(CONTEXT *context, const KEY* key, T* value), CONTEXT* context) const
+    {
+        for (uint32_t i = 0; i < m_SlotCount; ++i)
+        {
+            if (IsFull(m_Ctrl[i]))
+            {
+                call_back(context, &m_Entries[i].m_Key, &m_Entries[i].m_Value);
+            }
+        }
+    }
+
+    /*# iterator to the key/value pairs of a table
+     * @struct
+     * @name Iterator
+     * @member GetKey()
+     * @member GetValue()
+     */
+    struct Iterator
+    {
+        const KEY&  GetKey()    { return m_Table.m_Entries[m_Index].m_Key; }
+        const T&    GetValue()  { return m_Table.m_Entries[m_Index].m_Value; }
+
+        Iterator(dmOpenHashTable<KEY, T>& table)
+            : m_Table(table)
+            , m_Index(0xFFFFFFFF)
+        {
+        }
+
+        bool Next()
+        {
+            for (++m_Index; m_Index < m_Table.m_SlotCount; ++m_Index)
+            {
+                if (IsFull(m_Table.m_Ctrl[m_Index]))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        dmOpenHashTable<KEY, T>&    m_Table;
+        uint32_t                    m_Index;
+    };
+
+    /*# get an iterator for the key/value pairs
+     * @name GetIterator
+     * @return iterator [type:dmOpenHashTable<KEY, T>::Iterator] the iterator
+     */
+    Iterator GetIterator()
+    {
+        return Iterator(*this);
+    }
+
+private:
+    // Forbid assignment operator and copy-constructor
+    dmOpenHashTable(const dmOpenHashTable<KEY, T>&);
+    const dmOpenHashTable<KEY, T>& operator=(const dmOpenHashTable<KEY, T>&);
+
+    static uint32_t MaxLoad(uint32_t slot_count)
+    {
+        return slot_count - slot_count / 8;
+    }
+
+    static bool IsFull(uint8_t ctrl)
+    {
+        return (ctrl & 0x80) == 0;
+    }
+
+    // The keys are often sequential indices, so the bits are mixed before they are used.
+    // The lower 7 bits go into the control byte, the rest select the group.
+    static uint64_t HashKey(KEY key)
+    {
+        uint64_t h = (uint64_t) key * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    static uint32_t CountTrailingZeros(uint32_t mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return (uint32_t) __builtin_ctz(mask);
+#else
+        uint32_t n = 0;
+        while ((mask & 1) == 0)
+        {
+            mask >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    // Returns a bit mask with bit i set if ctrl[i] == value, for the 16 bytes in the group
+    static uint32_t MatchByte(const uint8_t* ctrl, uint8_t value)
+    {
+#if defined(DM_SIMD_SSE2)
+        __m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) value)));
+#elif defined(DM_SIMD_NEON)
+        static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        uint8x16_t match = vandq_u8(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value)), vld1q_u8(bits));
+        return (uint32_t) vaddv_u8(vget_low_u8(match)) | ((uint32_t) vaddv_u8(vget_high_u8(match)) << 8);
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < GROUP_SIZE; ++i)
+        {
+            mask |= (uint32_t) (ctrl[i] == value) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Returns a bit mask with bit i set if ctrl[i] is empty or deleted
+    static uint32_t MatchFree(const uint8_t* ctrl)
+    {
+#if defined(DM_SIMD_SSE2)
+        return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+#else
+        return MatchByte(ctrl, CTRL_EMPTY) | MatchByte(ctrl, CTRL_DELETED);
+#endif
+    }
+
+    Entry* FindEntry(KEY key) const
+    {
+        if (m_Count == 0)
+        {
+            return 0;
+        }
+
+        uint64_t hash = HashKey(key);
+        uint8_t h2 = (uint8_t) (hash & 0x7F);
+        uint32_t group_mask = m_SlotCount / GROUP_SIZE - 1;
+        uint32_t group = (uint32_t) (hash >> 7) & group_mask;
+        // Triangular probing visits every group once, since the group count is a power of two
+        for (uint32_t step = 1; ; ++step)
+        {
+            const uint8_t* ctrl = m_Ctrl + group * GROUP_SIZE;
+            uint32_t match = MatchByte(ctrl, h2);
+            while (match)
+            {
+                uint32_t index = group * GROUP_SIZE + CountTrailingZeros(match);
+                if (m_Entries[index].m_Key == key)
+                {
+                    return &m_Entries[index];
+                }
+                match &= match - 1;
+            }
+            if (MatchByte(ctrl, CTRL_EMPTY))
+            {
+                return 0;
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // The first empty or deleted slot in the probe sequence. The table is never completely full.
+    uint32_t FindInsertSlot(uint64_t hash) const
+    {
+        uint32_t group_mask = m_SlotCount / GROUP_SIZE - 1;
+        uint32_t group = (uint32_t) (hash >> 7) & group_mask;
+        for (uint32_t step = 1; ; ++step)
+        {
+            uint32_t free = MatchFree(m_Ctrl + group * GROUP_SIZE);
+            if (free)
+            {
+                return group * GROUP_SIZE + CountTrailingZeros(free);
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+
+    void Rehash(uint32_t slot_count)
+    {
+        // Control bytes first, with the entries after them. slot_count is a multiple of 16, which keeps the entries aligned
+        uint8_t* ctrl = (uint8_t*) malloc(slot_count + sizeof(Entry) * slot_count);
+        assert(ctrl != 0);
+        memset(ctrl, CTRL_EMPTY, slot_count);
+
+        uint8_t* old_ctrl = m_Ctrl;
+        Entry* old_entries = m_Entries;
+        uint32_t old_slot_count = m_SlotCount;
+
+        m_Ctrl = ctrl;
+        m_Entries = (Entry*) (ctrl + slot_count);
+        m_SlotCount = slot_count;
+        m_GrowthLeft = MaxLoad(slot_count) - m_Count;
+
+        for (uint32_t i = 0; i < old_slot_count; ++i)
+        {
+            if (IsFull(old_ctrl[i]))
+            {
+                uint64_t hash = HashKey(old_entries[i].m_Key);
+                uint32_t index = FindInsertSlot(hash);
+                m_Ctrl[index] = (uint8_t) (hash & 0x7F);
+                m_Entries[index] = old_entries[i];
+            }
+        }
+        free(old_ctrl);
+    }
+
+    uint8_t*    m_Ctrl;
+    Entry*      m_Entries;
+    uint32_t    m_SlotCount;
+    // Number of entries that can be put in empty slots before the load limit is reached
+    uint32_t    m_GrowthLeft;
+    uint32_t    m_Count;
+};
+
+/*# open addressing hash table with [type:uint16_t] as keys
+ * @type class
+ * @name dmOpenHashTable16
+ */
+template <typename T>
+class dmOpenHashTable16 : public dmOpenHashTable<uint16_t, T> {};
+
+/*# open addressing hash table with [type:uint32_t] as keys
+ * @type class
+ * @name dmOpenHashTable32
+ */
+template <typename T>
+class dmOpenHashTable32 : public dmOpenHashTable<uint32_t, T> {};
+
+/*# open addressing hash table with [type:uint64_t] as keys
+ * @type class
+ * @name dmOpenHashTable64
+ */
+template <typename T>
+class dmOpenHashTable64 : public dmOpenHashTable<uint64_t, T> {};
+
+#endif // DM_OPEN_HASHTABLE_H
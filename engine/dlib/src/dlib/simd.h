@@ -0,0 +1,189 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_SIMD_H
+#define DM_SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Thin wrapper around 4-wide float SIMD registers, used for structure-of-arrays kernels.
+ *
+ * Maps to SSE2 on x86/x86_64 and NEON on arm64. Other targets use a plain scalar fallback.
+ * Multiply-add is intentionally never fused, so that kernels produce the same results as
+ * the equivalent scalar code (e.g. the vectormath library) when written in the same order.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_SIMD_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #define DM_SIMD_NEON
+    #include <arm_neon.h>
+#else
+    #define DM_SIMD_SCALAR
+#endif
+
+namespace dmSimd
+{
+#if defined(DM_SIMD_SSE2)
+    typedef __m128 Vec4f;
+
+    static inline Vec4f Load(const float* p)                { return _mm_loadu_ps(p); }
+    static inline void  Store(float* p, Vec4f v)            { _mm_storeu_ps(p, v); }
+    static inline Vec4f Splat(float v)                      { return _mm_set1_ps(v); }
+    static inline Vec4f Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    static inline Vec4f Zero()                              { return _mm_setzero_ps(); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return _mm_add_ps(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return _mm_sub_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return _mm_mul_ps(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return _mm_div_ps(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return _mm_sqrt_ps(a); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return _mm_min_ps(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)               { return _mm_max_ps(a, b); }
+    static inline Vec4f CmpGt(Vec4f a, Vec4f b)             { return _mm_cmpgt_ps(a, b); }
+    static inline Vec4f CmpLt(Vec4f a, Vec4f b)             { return _mm_cmplt_ps(a, b); }
+    // Per lane: mask ? a : b
+    static inline Vec4f Select(Vec4f mask, Vec4f a, Vec4f b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+    static inline Vec4f SplatX(Vec4f a)                     { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)); }
+    static inline Vec4f SplatY(Vec4f a)                     { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)); }
+    static inline Vec4f SplatZ(Vec4f a)                     { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)); }
+    static inline Vec4f SplatW(Vec4f a)                     { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    static inline void Transpose(Vec4f& a, Vec4f& b, Vec4f& c, Vec4f& d)
+    {
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+    }
+
+#elif defined(DM_SIMD_NEON)
+    typedef float32x4_t Vec4f;
+
+    static inline Vec4f Load(const float* p)                { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)            { vst1q_f32(p, v); }
+    static inline Vec4f Splat(float v)                      { return vdupq_n_f32(v); }
+    static inline Vec4f Set(float x, float y, float z, float w) { float v[4] = {x, y, z, w}; return vld1q_f32(v); }
+    static inline Vec4f Zero()                              { return vdupq_n_f32(0.0f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)               { return vaddq_f32(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)               { return vsubq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)               { return vmulq_f32(a, b); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)               { return vdivq_f32(a, b); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return vsqrtq_f32(a); }
+    static inline Vec4f Min(Vec4f a, Vec4f b)               { return vminq_f32(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)               { return vmaxq_f32(a, b); }
+    static inline Vec4f CmpGt(Vec4f a, Vec4f b)             { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+    static inline Vec4f CmpLt(Vec4f a, Vec4f b)             { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+    static inline Vec4f Select(Vec4f mask, Vec4f a, Vec4f b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+    static inline Vec4f SplatX(Vec4f a)                     { return vdupq_laneq_f32(a, 0); }
+    static inline Vec4f SplatY(Vec4f a)                     { return vdupq_laneq_f32(a, 1); }
+    static inline Vec4f SplatZ(Vec4f a)                     { return vdupq_laneq_f32(a, 2); }
+    static inline Vec4f SplatW(Vec4f a)                     { return vdupq_laneq_f32(a, 3); }
+
+    static inline void Transpose(Vec4f& a, Vec4f& b, Vec4f& c, Vec4f& d)
+    {
+        float32x4x2_t ab = vtrnq_f32(a, b);
+        float32x4x2_t cd = vtrnq_f32(c, d);
+        a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+
+#else
+    struct Vec4f
+    {
+        float v[4];
+    };
+
+    static inline Vec4f Set(float x, float y, float z, float w) { Vec4f r; r.v[0] = x; r.v[1] = y; r.v[2] = z; r.v[3] = w; return r; }
+    static inline Vec4f Load(const float* p)                { return Set(p[0], p[1], p[2], p[3]); }
+    static inline void  Store(float* p, Vec4f a)            { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+    static inline Vec4f Splat(float v)                      { return Set(v, v, v, v); }
+    static inline Vec4f Zero()                              { return Splat(0.0f); }
+
+#define DM_SIMD_SCALAR_OP(NAME, EXPR) \
+    static inline Vec4f NAME(Vec4f a, Vec4f b) \
+    { \
+        Vec4f r; \
+        for (int i = 0; i < 4; ++i) { float x = a.v[i]; float y = b.v[i]; r.v[i] = (EXPR); } \
+        return r; \
+    }
+
+    DM_SIMD_SCALAR_OP(Add, x + y)
+    DM_SIMD_SCALAR_OP(Sub, x - y)
+    DM_SIMD_SCALAR_OP(Mul, x * y)
+    DM_SIMD_SCALAR_OP(Div, x / y)
+    DM_SIMD_SCALAR_OP(Min, x < y ? x : y)
+    DM_SIMD_SCALAR_OP(Max, x > y ? x : y)
+#undef DM_SIMD_SCALAR_OP
+
+    static inline Vec4f SplatX(Vec4f a)                     { return Splat(a.v[0]); }
+    static inline Vec4f SplatY(Vec4f a)                     { return Splat(a.v[1]); }
+    static inline Vec4f SplatZ(Vec4f a)                     { return Splat(a.v[2]); }
+    static inline Vec4f SplatW(Vec4f a)                     { return Splat(a.v[3]); }
+    static inline Vec4f Sqrt(Vec4f a)                       { return Set(sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3])); }
+
+    static inline float MaskFromBool(bool b)
+    {
+        uint32_t bits = b ? 0xFFFFFFFF : 0;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    static inline Vec4f CmpGt(Vec4f a, Vec4f b)
+    {
+        return Set(MaskFromBool(a.v[0] > b.v[0]), MaskFromBool(a.v[1] > b.v[1]), MaskFromBool(a.v[2] > b.v[2]), MaskFromBool(a.v[3] > b.v[3]));
+    }
+
+    static inline Vec4f CmpLt(Vec4f a, Vec4f b)
+    {
+        return CmpGt(b, a);
+    }
+
+    static inline Vec4f Select(Vec4f mask, Vec4f a, Vec4f b)
+    {
+        Vec4f r;
+        for (int i = 0; i < 4; ++i)
+        {
+            uint32_t m, x, y;
+            memcpy(&m, &mask.v[i], sizeof(m));
+            memcpy(&x, &a.v[i], sizeof(x));
+            memcpy(&y, &b.v[i], sizeof(y));
+            uint32_t bits = (m & x) | (~m & y);
+            memcpy(&r.v[i], &bits, sizeof(bits));
+        }
+        return r;
+    }
+
+    static inline void Transpose(Vec4f& a, Vec4f& b, Vec4f& c, Vec4f& d)
+    {
+        Vec4f ta = a, tb = b, tc = c, td = d;
+        a = Set(ta.v[0], tb.v[0], tc.v[0], td.v[0]);
+        b = Set(ta.v[1], tb.v[1], tc.v[1], td.v[1]);
+        c = Set(ta.v[2], tb.v[2], tc.v[2], td.v[2]);
+        d = Set(ta.v[3], tb.v[3], tc.v[3], td.v[3]);
+    }
+#endif
+
+    // a * b + c, never fused
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)
+    {
+        return Add(Mul(a, b), c);
+    }
+}
+
+#endif // DM_SIMD_H
@@ -29,6 +29,24 @@
 
 namespace dmThread
 {
+    /*# thread local storage destructor
+     * Called with the value of a thread local storage key when a thread exits
+     * @typedef
+     * @name dmThread::TlsDestructor
+     * @param value [type:void*] The value of the key. Never null
+     */
+    typedef void (*TlsDestructor)(void* value);
+
+    /*# allocate thread local storage key with a destructor
+     * Allocate thread local storage key. When a thread that has set a non null value exits,
+     * the destructor is called with the value on that thread.
+     * The destructor isn't called for the values that remain when the key is freed.
+     * @name dmThread::AllocTls
+     * @param destructor [type:dmThread::TlsDestructor] Called on thread exit. May be null
+     * @return Key
+     */
+    TlsKey AllocTls(TlsDestructor destructor);
+
     /*# check for threading support
      *
      * @name dmThread::PlatformHasThreadSupport
@@ -16,7 +16,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <dlib/profile/profile.h>
-#include <dmsdk/dlib/thread.h>
+#include <dlib/thread.h>
 
 #if defined(_WIN32)
 #include <wchar.h>
@@ -95,9 +95,14 @@ namespace dmThread
     }
 
     TlsKey AllocTls()
+    {
+        return AllocTls(0);
+    }
+
+    TlsKey AllocTls(TlsDestructor destructor)
     {
         pthread_key_t key;
-        int ret = pthread_key_create(&key, 0);
+        int ret = pthread_key_create(&key, destructor);
         assert(ret == 0);
         return key;
     }
@@ -14,9 +14,10 @@
 
 #include <assert.h>
 #include <dlib/profile/profile.h>
-#include <dmsdk/dlib/thread.h>
+#include <dlib/thread.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 
 namespace dmThread
@@ -71,13 +72,79 @@ namespace dmThread
         CloseHandle(thread);
     }
 
+    // TlsAlloc() has no destructors. A thread that sets a value for a key with a destructor also sets a
+    // fiber local value, and the callback of that runs the destructors when the thread exits.
+    static const uint32_t MAX_TLS_DESTRUCTORS = 16;
+
+    static SRWLOCK       g_TlsDestructorLock = SRWLOCK_INIT;
+    static TlsKey        g_TlsDestructorKeys[MAX_TLS_DESTRUCTORS];
+    static TlsDestructor g_TlsDestructors[MAX_TLS_DESTRUCTORS];
+    static DWORD         g_TlsExitKey = FLS_OUT_OF_INDEXES;
+
+    static void WINAPI TlsExitCallback(void*)
+    {
+        TlsKey keys[MAX_TLS_DESTRUCTORS];
+        TlsDestructor destructors[MAX_TLS_DESTRUCTORS];
+        AcquireSRWLockShared(&g_TlsDestructorLock);
+        memcpy(keys, g_TlsDestructorKeys, sizeof(keys));
+        memcpy(destructors, g_TlsDestructors, sizeof(destructors));
+        ReleaseSRWLockShared(&g_TlsDestructorLock);
+
+        for (uint32_t i = 0; i < MAX_TLS_DESTRUCTORS; ++i)
+        {
+            if (destructors[i] == 0)
+                continue;
+            void* value = TlsGetValue(keys[i]);
+            if (value)
+            {
+                TlsSetValue(keys[i], 0);
+                destructors[i](value);
+            }
+        }
+    }
+
     TlsKey AllocTls()
     {
         return TlsAlloc();
     }
 
+    TlsKey AllocTls(TlsDestructor destructor)
+    {
+        TlsKey key = TlsAlloc();
+        if (destructor == 0)
+        {
+            return key;
+        }
+
+        AcquireSRWLockExclusive(&g_TlsDestructorLock);
+        if (g_TlsExitKey == FLS_OUT_OF_INDEXES)
+        {
+            g_TlsExitKey = FlsAlloc(TlsExitCallback);
+        }
+        uint32_t i = 0;
+        while (i < MAX_TLS_DESTRUCTORS && g_TlsDestructors[i] != 0)
+        {
+            ++i;
+        }
+        assert(i < MAX_TLS_DESTRUCTORS);
+        g_TlsDestructorKeys[i] = key;
+        g_TlsDestructors[i] = destructor;
+        ReleaseSRWLockExclusive(&g_TlsDestructorLock);
+        return key;
+    }
+
     void FreeTls(TlsKey key)
     {
+        AcquireSRWLockExclusive(&g_TlsDestructorLock);
+        for (uint32_t i = 0; i < MAX_TLS_DESTRUCTORS; ++i)
+        {
+            if (g_TlsDestructors[i] != 0 && g_TlsDestructorKeys[i] == key)
+            {
+                g_TlsDestructors[i] = 0;
+            }
+        }
+        ReleaseSRWLockExclusive(&g_TlsDestructorLock);
+
         BOOL ret = TlsFree(key);
         assert(ret);
     }
@@ -86,6 +153,25 @@ namespace dmThread
     {
         BOOL ret = TlsSetValue(key, value);
         assert(ret);
+
+        if (value == 0 || g_TlsExitKey == FLS_OUT_OF_INDEXES || FlsGetValue(g_TlsExitKey) != 0)
+        {
+            return;
+        }
+
+        bool has_destructor = false;
+        AcquireSRWLockShared(&g_TlsDestructorLock);
+        for (uint32_t i = 0; i < MAX_TLS_DESTRUCTORS; ++i)
+        {
+            has_destructor |= g_TlsDestructors[i] != 0 && g_TlsDestructorKeys[i] == key;
+        }
+        ReleaseSRWLockShared(&g_TlsDestructorLock);
+
+        if (has_destructor)
+        {
+            // Any non null value makes the callback run on thread exit
+            FlsSetValue(g_TlsExitKey, (void*) 1);
+        }
     }
 
     void* GetTlsValue(TlsKey key)
@@ -108,6 +108,23 @@ TEST(dmEasing, CurstomCurve)
     }
 }
 
+TEST(dmEasing, GetValues)
+{
+    const uint32_t count = 201;
+    float t[count];
+    float values[count];
+    for (uint32_t i = 0; i < count; ++i) {
+        t[i] = -0.5f + 2.0f * i / (count - 1);
+    }
+
+    for (int type = 0; type < dmEasing::TYPE_FLOAT_VECTOR; ++type) {
+        dmEasing::GetValues((dmEasing::Type) type, count, t, values);
+        for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_EQ(dmEasing::GetValue((dmEasing::Type) type, t[i]), values[i]);
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -22,6 +22,7 @@
 #include <jc_test/jc_test.h>
 
 #include "dlib/hashtable.h"
+#include "dlib/open_hashtable.h"
 
 TEST(dmHashTable, EmtpyConstructor)
 {
@@ -524,6 +525,166 @@ TEST(dmHashTable, Swap)
     ASSERT_EQ(300, *h1.Get(30));
 }
 
+TEST(dmOpenHashTable, EmptyConstructor)
+{
+    dmOpenHashTable32<int> ht;
+
+    EXPECT_EQ(0U, ht.Size());
+    EXPECT_EQ(0U, ht.Capacity());
+    EXPECT_TRUE(ht.Full());
+    EXPECT_TRUE(ht.Empty());
+    EXPECT_EQ((uintptr_t) 0, (uintptr_t) ht.Get(1));
+}
+
+TEST(dmOpenHashTable, PutGrows)
+{
+    dmOpenHashTable<uint32_t, uint32_t> ht;
+    const uint32_t count = 1000;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ht.Put(i, i * 10);
+    }
+    ASSERT_EQ(count, ht.Size());
+    ASSERT_GE(ht.Capacity(), count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t* v = ht.Get(i);
+        ASSERT_TRUE(v != 0);
+        ASSERT_EQ(i * 10, *v);
+    }
+    ASSERT_EQ((uintptr_t) 0, (uintptr_t) ht.Get(count));
+
+    // Replace
+    ht.Put(7, 123);
+    ASSERT_EQ(count, ht.Size());
+    ASSERT_EQ(123U, *ht.Get(7));
+}
+
+// Keys that only differ in the upper bits
+static uint64_t LargeKey(int i)
+{
+    return (uint64_t) i << 40;
+}
+
+TEST(dmOpenHashTable, SetCapacity)
+{
+    dmOpenHashTable<uint64_t, int> ht;
+    ht.SetCapacity(100, 100);
+    uint32_t capacity = ht.Capacity();
+    ASSERT_GE(capacity, 100U);
+    for (int i = 0; i < 100; ++i)
+    {
+        ht.Put(LargeKey(i), i);
+    }
+    ASSERT_EQ(capacity, ht.Capacity());
+
+    // Never shrinks
+    ht.SetCapacity(1);
+    ASSERT_EQ(capacity, ht.Capacity());
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(i, *ht.Get(LargeKey(i)));
+    }
+
+    ht.Clear();
+    ASSERT_TRUE(ht.Empty());
+    ASSERT_EQ(capacity, ht.Capacity());
+    ASSERT_EQ((uintptr_t) 0, (uintptr_t) ht.Get(LargeKey(1)));
+}
+
+static void SumCallback(uint32_t* sum, const uint32_t* key, uint32_t* value)
+{
+    *sum += *value;
+}
+
+TEST(dmOpenHashTable, Iterate)
+{
+    dmOpenHashTable<uint32_t, uint32_t> ht;
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        ht.Put(i, i);
+        expected += i;
+    }
+    ht.Erase(10);
+    expected -= 10;
+
+    uint32_t sum = 0;
+    ht.Iterate(SumCallback, &sum);
+    ASSERT_EQ(expected, sum);
+
+    sum = 0;
+    uint32_t count = 0;
+    dmOpenHashTable<uint32_t, uint32_t>::Iterator iter = ht.GetIterator();
+    while (iter.Next())
+    {
+        ASSERT_EQ(iter.GetKey(), iter.GetValue());
+        sum += iter.GetValue();
+        ++count;
+    }
+    ASSERT_EQ(expected, sum);
+    ASSERT_EQ(99U, count);
+}
+
+// Random puts and erases, where the erased slots are reused. Compared against std::map
+TEST(dmOpenHashTable, Exhaustive)
+{
+    std::map<uint32_t, uint32_t> map;
+    dmOpenHashTable<uint32_t, uint32_t> ht;
+
+    srand(42);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uint32_t key = rand() % 2000;
+        if (rand() % 3 == 0 && map.find(key) != map.end())
+        {
+            map.erase(key);
+            ht.Erase(key);
+        }
+        else
+        {
+            map[key] = i;
+            ht.Put(key, i);
+        }
+        ASSERT_EQ((uint32_t) map.size(), ht.Size());
+    }
+    // The table should not have grown from the tombstones
+    ASSERT_LE(ht.Capacity(), 2 * 2000U);
+
+    for (uint32_t key = 0; key < 2000; ++key)
+    {
+        std::map<uint32_t, uint32_t>::iterator it = map.find(key);
+        uint32_t* v = ht.Get(key);
+        if (it == map.end())
+        {
+            ASSERT_EQ((uintptr_t) 0, (uintptr_t) v);
+        }
+        else
+        {
+            ASSERT_TRUE(v != 0);
+            ASSERT_EQ(it->second, *v);
+        }
+    }
+}
+
+TEST(dmOpenHashTable, Swap)
+{
+    dmOpenHashTable<int, int> h1;
+    dmOpenHashTable<int, int> h2;
+
+    h1.Put(1, 10);
+    h1.Put(2, 20);
+    h2.Put(10, 100);
+
+    h1.Swap(h2);
+
+    ASSERT_EQ(10, *h2.Get(1));
+    ASSERT_EQ(20, *h2.Get(2));
+    ASSERT_EQ(100, *h1.Get(10));
+    ASSERT_EQ(1U, h1.Size());
+    ASSERT_EQ(2U, h2.Size());
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
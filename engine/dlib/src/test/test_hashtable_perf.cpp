@@ -0,0 +1,168 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include "dlib/array.h"
+#include "dlib/hashtable.h"
+#include "dlib/open_hashtable.h"
+#include "dlib/time.h"
+
+// Compares dmOpenHashTable with dmHashTable, using 64 bit keys (like dmhash_t) with a 2/3 table size for dmHashTable,
+// which is what most call sites use
+
+static const uint32_t ENTRY_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+// Each test does at least this many operations, so that the small tables get measurable times
+static const uint32_t MIN_OPERATIONS = 2000000;
+
+static uint64_t NextKey(uint64_t* state)
+{
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void MakeKeys(dmArray<uint64_t>& keys, uint32_t count, uint64_t seed)
+{
+    keys.SetCapacity(count);
+    keys.SetSize(0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        keys.Push(NextKey(&seed));
+    }
+}
+
+struct Timings
+{
+    uint64_t m_Insert;
+    uint64_t m_Lookup;
+    uint64_t m_LookupMiss;
+    uint64_t m_Erase;
+    uint64_t m_Sum;
+};
+
+template <typename TABLE>
+static void Run(TABLE& table, const dmArray<uint64_t>& keys, const dmArray<uint64_t>& shuffled_keys, const dmArray<uint64_t>& missing_keys, uint32_t rounds, Timings* timings)
+{
+    uint32_t count = keys.Size();
+    memset(timings, 0, sizeof(*timings));
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        table.Clear();
+
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            table.Put(keys[i], i);
+        }
+        timings->m_Insert += dmTime::GetTime() - start;
+
+        start = dmTime::GetTime();
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            sum += *table.Get(shuffled_keys[i]);
+        }
+        timings->m_Lookup += dmTime::GetTime() - start;
+        timings->m_Sum += sum;
+
+        start = dmTime::GetTime();
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            found += table.Get(missing_keys[i]) != 0;
+        }
+        timings->m_LookupMiss += dmTime::GetTime() - start;
+        timings->m_Sum += found;
+
+        start = dmTime::GetTime();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            table.Erase(shuffled_keys[i]);
+        }
+        timings->m_Erase += dmTime::GetTime() - start;
+        timings->m_Sum += table.Size();
+    }
+}
+
+static void Print(const char* name, uint32_t count, uint64_t old_time, uint64_t new_time)
+{
+    printf("[%-11s] %7u entries | dmHashTable: %8.3f ms | dmOpenHashTable: %8.3f ms | x%.2f\n", name, count,
+            old_time / 1000.0, new_time / 1000.0, old_time / (double) (new_time ? new_time : 1));
+}
+
+TEST(dmOpenHashTable, Performance)
+{
+    for (uint32_t c = 0; c < sizeof(ENTRY_COUNTS) / sizeof(ENTRY_COUNTS[0]); ++c)
+    {
+        uint32_t count = ENTRY_COUNTS[c];
+        uint32_t rounds = count < MIN_OPERATIONS ? MIN_OPERATIONS / count : 1;
+
+        dmArray<uint64_t> keys;
+        dmArray<uint64_t> missing_keys;
+        MakeKeys(keys, count, 0x1234567 + c);
+        MakeKeys(missing_keys, count, 0x7654321 + c);
+
+        // Lookups and erases don't happen in insertion order
+        dmArray<uint64_t> shuffled_keys;
+        shuffled_keys.SetCapacity(count);
+        shuffled_keys.SetSize(count);
+        memcpy(shuffled_keys.Begin(), keys.Begin(), sizeof(uint64_t) * count);
+        uint64_t seed = 0xabcdef + c;
+        for (uint32_t i = count - 1; i > 0; --i)
+        {
+            uint32_t j = (uint32_t) (NextKey(&seed) % (i + 1));
+            uint64_t tmp = shuffled_keys[i];
+            shuffled_keys[i] = shuffled_keys[j];
+            shuffled_keys[j] = tmp;
+        }
+
+        Timings old_timings;
+        {
+            dmHashTable<uint64_t, uint32_t> table;
+            table.SetCapacity((count * 2) / 3, count);
+            Run(table, keys, shuffled_keys, missing_keys, rounds, &old_timings);
+        }
+
+        Timings new_timings;
+        {
+            dmOpenHashTable<uint64_t, uint32_t> table;
+            table.SetCapacity(count);
+            Run(table, keys, shuffled_keys, missing_keys, rounds, &new_timings);
+        }
+
+        // Both tables must have found the same values
+        ASSERT_EQ(old_timings.m_Sum, new_timings.m_Sum);
+
+        Print("insert", count, old_timings.m_Insert, new_timings.m_Insert);
+        Print("lookup", count, old_timings.m_Lookup, new_timings.m_Lookup);
+        Print("lookup miss", count, old_timings.m_LookupMiss, new_timings.m_LookupMiss);
+        Print("erase", count, old_timings.m_Erase, new_timings.m_Erase);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
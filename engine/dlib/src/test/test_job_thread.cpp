@@ -12,6 +12,8 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdio.h>
+#include "dlib/atomic.h"
 #include "dlib/job_thread.h"
 #include "dlib/array.h"
 #include "dlib/time.h"
@@ -82,6 +84,184 @@ TEST(dmJobThread, PushJobsMultipleThreads)
     ASSERT_TRUE(tests_done);
 }
 
+static dmJobThread::HContext CreateContext(uint8_t thread_count)
+{
+    dmJobThread::JobThreadCreationParams params;
+    for (uint32_t i = 0; i < thread_count; ++i)
+        params.m_ThreadNames[i] = "DefoldTestJobThread";
+    params.m_ThreadCount = thread_count;
+    return dmJobThread::Create(params);
+}
+
+static int IncrementCounter(void* context, void* data)
+{
+    dmAtomicIncrement32((int32_atomic_t*) context);
+    return 0;
+}
+
+TEST(dmJobThread, ForkJoin)
+{
+    const uint8_t thread_counts[] = {0, 1, 4};
+    for (uint32_t t = 0; t < DM_ARRAY_SIZE(thread_counts); ++t)
+    {
+        dmJobThread::HContext ctx = CreateContext(thread_counts[t]);
+
+        int32_atomic_t counter = 0;
+        dmJobThread::HJob root = dmJobThread::CreateJob(ctx, IncrementCounter, (void*) &counter, 0, dmJobThread::INVALID_JOB);
+        ASSERT_NE(dmJobThread::INVALID_JOB, root);
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            dmJobThread::HJob child = dmJobThread::CreateJob(ctx, IncrementCounter, (void*) &counter, 0, root);
+            ASSERT_NE(dmJobThread::INVALID_JOB, child);
+            dmJobThread::RunJob(ctx, child);
+        }
+        dmJobThread::RunJob(ctx, root);
+        dmJobThread::WaitJob(ctx, root);
+
+        ASSERT_TRUE(dmJobThread::IsJobDone(ctx, root));
+        ASSERT_EQ(1001, dmAtomicGet32(&counter));
+
+        dmJobThread::Destroy(ctx);
+    }
+}
+
+struct SpawnContext
+{
+    dmJobThread::HContext   m_Context;
+    int32_atomic_t          m_Counter;
+    dmJobThread::HJob       m_Root;
+};
+
+// Spawns children from within a job, which end up in the queue of the worker
+static int SpawnChildren(void* context, void* data)
+{
+    SpawnContext* ctx = (SpawnContext*) context;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        dmJobThread::HJob child = dmJobThread::CreateJob(ctx->m_Context, IncrementCounter, (void*) &ctx->m_Counter, 0, ctx->m_Root);
+        dmJobThread::RunJob(ctx->m_Context, child);
+    }
+    return 0;
+}
+
+TEST(dmJobThread, NestedJobs)
+{
+    dmJobThread::HContext ctx = CreateContext(4);
+
+    SpawnContext spawn_ctx;
+    spawn_ctx.m_Context = ctx;
+    spawn_ctx.m_Counter = 0;
+    spawn_ctx.m_Root = dmJobThread::CreateJob(ctx, 0, 0, 0, dmJobThread::INVALID_JOB);
+    for (uint32_t i = 0; i < 20; ++i)
+    {
+        dmJobThread::RunJob(ctx, dmJobThread::CreateJob(ctx, SpawnChildren, (void*) &spawn_ctx, 0, spawn_ctx.m_Root));
+    }
+    dmJobThread::RunJob(ctx, spawn_ctx.m_Root);
+    dmJobThread::WaitJob(ctx, spawn_ctx.m_Root);
+
+    ASSERT_EQ(20 * 100, dmAtomicGet32(&spawn_ctx.m_Counter));
+
+    dmJobThread::Destroy(ctx);
+}
+
+struct OrderContext
+{
+    int32_atomic_t  m_Next;
+    int32_t         m_Order[3];
+};
+
+static int RecordOrder(void* context, void* data)
+{
+    OrderContext* ctx = (OrderContext*) context;
+    ctx->m_Order[(uintptr_t) data] = dmAtomicIncrement32(&ctx->m_Next);
+    return 0;
+}
+
+TEST(dmJobThread, Dependencies)
+{
+    dmJobThread::HContext ctx = CreateContext(4);
+
+    for (uint32_t iteration = 0; iteration < 100; ++iteration)
+    {
+        OrderContext order_ctx;
+        order_ctx.m_Next = 0;
+
+        // c depends on b, which depends on a. They are scheduled in reverse order
+        dmJobThread::HJob a = dmJobThread::CreateJob(ctx, RecordOrder, (void*) &order_ctx, (void*) 0, dmJobThread::INVALID_JOB);
+        dmJobThread::HJob b = dmJobThread::CreateJob(ctx, RecordOrder, (void*) &order_ctx, (void*) 1, dmJobThread::INVALID_JOB);
+        dmJobThread::HJob c = dmJobThread::CreateJob(ctx, RecordOrder, (void*) &order_ctx, (void*) 2, dmJobThread::INVALID_JOB);
+        dmJobThread::AddDependency(ctx, c, b);
+        dmJobThread::AddDependency(ctx, b, a);
+        dmJobThread::RunJob(ctx, c);
+        dmJobThread::RunJob(ctx, b);
+        ASSERT_FALSE(dmJobThread::IsJobDone(ctx, c));
+        dmJobThread::RunJob(ctx, a);
+        dmJobThread::WaitJob(ctx, c);
+
+        ASSERT_EQ(0, order_ctx.m_Order[0]);
+        ASSERT_EQ(1, order_ctx.m_Order[1]);
+        ASSERT_EQ(2, order_ctx.m_Order[2]);
+        ASSERT_TRUE(dmJobThread::IsJobDone(ctx, a));
+        ASSERT_TRUE(dmJobThread::IsJobDone(ctx, b));
+    }
+
+    // Depending on a job that is already done is a no-op
+    int32_atomic_t counter = 0;
+    dmJobThread::HJob done = dmJobThread::CreateJob(ctx, IncrementCounter, (void*) &counter, 0, dmJobThread::INVALID_JOB);
+    dmJobThread::RunJob(ctx, done);
+    dmJobThread::WaitJob(ctx, done);
+    dmJobThread::HJob job = dmJobThread::CreateJob(ctx, IncrementCounter, (void*) &counter, 0, dmJobThread::INVALID_JOB);
+    dmJobThread::AddDependency(ctx, job, done);
+    dmJobThread::RunJob(ctx, job);
+    dmJobThread::WaitJob(ctx, job);
+    ASSERT_EQ(2, dmAtomicGet32(&counter));
+
+    dmJobThread::Destroy(ctx);
+}
+
+TEST(dmJobThread, JobCallback)
+{
+    dmJobThread::HContext ctx = CreateContext(2);
+
+    uint8_t data = 0;
+    dmJobThread::HJob job = dmJobThread::CreateJob(ctx, process, callback, 0, (void*) &data, dmJobThread::INVALID_JOB);
+    dmJobThread::RunJob(ctx, job);
+    dmJobThread::WaitJob(ctx, job);
+    // The callback is called from Update
+    ASSERT_EQ(0, data);
+    dmJobThread::Update(ctx);
+    ASSERT_EQ(1, data);
+
+    dmJobThread::Destroy(ctx);
+}
+
+static void CountCallback(void* context, void* data, int result)
+{
+    *(uint32_t*) context += result;
+}
+
+TEST(dmJobThread, PushJobsAllHandlesInUse)
+{
+    dmJobThread::HContext ctx = CreateContext(2);
+
+    // More jobs than there are job handles. The jobs with callbacks are only freed by Update
+    const uint32_t job_count = 70000;
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < job_count; ++i)
+    {
+        dmJobThread::PushJob(ctx, process, CountCallback, (void*) &done, 0);
+    }
+
+    uint64_t stop_time = dmTime::GetTime() + 10*1e6; // 10 seconds
+    while (done < job_count && dmTime::GetTime() < stop_time)
+    {
+        dmJobThread::Update(ctx);
+    }
+    ASSERT_EQ(job_count, done);
+
+    dmJobThread::Destroy(ctx);
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
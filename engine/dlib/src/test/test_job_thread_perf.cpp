@@ -0,0 +1,229 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include "dlib/array.h"
+#include "dlib/condition_variable.h"
+#include "dlib/job_thread.h"
+#include "dlib/mutex.h"
+#include "dlib/thread.h"
+#include "dlib/time.h"
+#include "jc/ringbuffer.h"
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+// Throughput of the job queue that dmJobThread had before the worker queues were added (one mutex protected queue),
+// versus PushJob on the current implementation, and child jobs pushed to the queue of a worker and stolen by the others
+
+// The previous implementation of PushJob and Update, for reference
+namespace BaselineJobThread
+{
+    struct JobItem
+    {
+        void*                   m_Context;
+        void*                   m_Data;
+        dmJobThread::FProcess   m_Process;
+        dmJobThread::FCallback  m_Callback;
+        int                     m_Result;
+    };
+
+    struct Context
+    {
+        jc::RingBuffer<JobItem>                 m_Work;
+        jc::RingBuffer<JobItem>                 m_Done;
+        dmArray<dmThread::Thread>               m_Threads;
+        dmMutex::HMutex                         m_Mutex;
+        dmConditionVariable::HConditionVariable m_WakeupCond;
+        bool                                    m_Run;
+    };
+
+    static void Put(Context* ctx, jc::RingBuffer<JobItem>& queue, const JobItem* item)
+    {
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+        if (queue.Full())
+            queue.SetCapacity(queue.Capacity() + 8);
+        queue.Push(*item);
+    }
+
+    static void JobThread(void* _ctx)
+    {
+        Context* ctx = (Context*)_ctx;
+        while (true)
+        {
+            JobItem item = {};
+            {
+                DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+                while (ctx->m_Work.Empty())
+                {
+                    if (!ctx->m_Run)
+                        return;
+                    dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
+                }
+                item = ctx->m_Work.Pop();
+            }
+            item.m_Result = item.m_Process(item.m_Context, item.m_Data);
+            Put(ctx, ctx->m_Done, &item);
+        }
+    }
+
+    static Context* Create(uint8_t thread_count)
+    {
+        Context* ctx = new Context;
+        ctx->m_Mutex = dmMutex::New();
+        ctx->m_WakeupCond = dmConditionVariable::New();
+        ctx->m_Run = true;
+        ctx->m_Threads.SetCapacity(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i)
+            ctx->m_Threads.Push(dmThread::New(JobThread, 0x80000, (void*)ctx, "DefoldTestJobThread"));
+        return ctx;
+    }
+
+    static void Destroy(Context* ctx)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+            ctx->m_Run = false;
+            dmConditionVariable::Broadcast(ctx->m_WakeupCond);
+        }
+        for (uint32_t i = 0; i < ctx->m_Threads.Size(); ++i)
+            dmThread::Join(ctx->m_Threads[i]);
+        dmConditionVariable::Delete(ctx->m_WakeupCond);
+        dmMutex::Delete(ctx->m_Mutex);
+        delete ctx;
+    }
+
+    static void PushJob(Context* ctx, dmJobThread::FProcess process, dmJobThread::FCallback callback, void* user_context, void* data)
+    {
+        JobItem item = {user_context, data, process, callback, 0};
+        Put(ctx, ctx->m_Work, &item);
+        dmConditionVariable::Signal(ctx->m_WakeupCond);
+    }
+
+    static void Update(Context* ctx)
+    {
+        dmArray<JobItem> items;
+        {
+            DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+            items.SetCapacity(ctx->m_Done.Size());
+            for (uint32_t i = 0; i < ctx->m_Done.Size(); ++i)
+                items.Push(ctx->m_Done[i]);
+            ctx->m_Done.Clear();
+        }
+        for (uint32_t i = 0; i < items.Size(); ++i)
+        {
+            JobItem& item = items[i];
+            if (item.m_Callback)
+                item.m_Callback(item.m_Context, item.m_Data, item.m_Result);
+        }
+    }
+}
+
+static const uint32_t JOB_COUNT = 20000;
+
+struct SpawnContext
+{
+    dmJobThread::HContext   m_Context;
+    dmJobThread::HJob       m_Root;
+};
+
+static dmJobThread::HContext CreateContext(uint8_t thread_count)
+{
+    dmJobThread::JobThreadCreationParams params;
+    for (uint32_t i = 0; i < thread_count; ++i)
+        params.m_ThreadNames[i] = "DefoldTestJobThread";
+    params.m_ThreadCount = thread_count;
+    return dmJobThread::Create(params);
+}
+
+static int EmptyJob(void* context, void* data)
+{
+    return 0;
+}
+
+static void CountCallback(void* context, void* data, int result)
+{
+    *(uint32_t*) context += 1;
+}
+
+static int SpawnEmptyChildren(void* context, void* data)
+{
+    SpawnContext* ctx = (SpawnContext*) context;
+    uint32_t count = (uint32_t) (uintptr_t) data;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmJobThread::RunJob(ctx->m_Context, dmJobThread::CreateJob(ctx->m_Context, EmptyJob, 0, 0, ctx->m_Root));
+    }
+    return 0;
+}
+
+TEST(dmJobThread, PerfPushSteal)
+{
+    const uint8_t thread_counts[] = {1, 2, 4, 8};
+    for (uint32_t t = 0; t < DM_ARRAY_SIZE(thread_counts); ++t)
+    {
+        BaselineJobThread::Context* baseline_ctx = BaselineJobThread::Create(thread_counts[t]);
+
+        uint64_t start = dmTime::GetTime();
+        uint32_t done = 0;
+        for (uint32_t i = 0; i < JOB_COUNT; ++i)
+        {
+            BaselineJobThread::PushJob(baseline_ctx, EmptyJob, CountCallback, (void*) &done, 0);
+        }
+        while (done < JOB_COUNT)
+        {
+            BaselineJobThread::Update(baseline_ctx);
+        }
+        uint64_t baseline_time = dmTime::GetTime() - start;
+
+        BaselineJobThread::Destroy(baseline_ctx);
+
+        dmJobThread::HContext ctx = CreateContext(thread_counts[t]);
+
+        start = dmTime::GetTime();
+        done = 0;
+        for (uint32_t i = 0; i < JOB_COUNT; ++i)
+        {
+            dmJobThread::PushJob(ctx, EmptyJob, CountCallback, (void*) &done, 0);
+        }
+        while (done < JOB_COUNT)
+        {
+            dmJobThread::Update(ctx);
+        }
+        uint64_t push_time = dmTime::GetTime() - start;
+
+        start = dmTime::GetTime();
+        SpawnContext spawn_ctx;
+        spawn_ctx.m_Context = ctx;
+        spawn_ctx.m_Root = dmJobThread::CreateJob(ctx, SpawnEmptyChildren, (void*) &spawn_ctx, (void*) (uintptr_t) JOB_COUNT, dmJobThread::INVALID_JOB);
+        dmJobThread::RunJob(ctx, spawn_ctx.m_Root);
+        dmJobThread::WaitJob(ctx, spawn_ctx.m_Root);
+        uint64_t steal_time = dmTime::GetTime() - start;
+
+        printf("%u threads, %u jobs | baseline: %7.3f ms (%5.0f jobs/ms) | PushJob: %7.3f ms (%5.0f jobs/ms) | worker queues: %7.3f ms (%5.0f jobs/ms)\n",
+                thread_counts[t], JOB_COUNT,
+                baseline_time / 1000.0f, JOB_COUNT / (baseline_time / 1000.0f),
+                push_time / 1000.0f, JOB_COUNT / (push_time / 1000.0f),
+                steal_time / 1000.0f, JOB_COUNT / (steal_time / 1000.0f));
+
+        dmJobThread::Destroy(ctx);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -12,8 +12,12 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <testmain/testmain.h>
 #include "../dlib/array.h"
 #include "../dlib/atomic.h"
@@ -310,6 +314,182 @@ TEST(dmLog, TestLogThreadWithLogCalls)
     dLib::SetDebugMode(true);
 }
 
+dmArray<char> g_ExpectedOutput;
+
+static void AppendExpected(const char* prefix, const char* format, ...)
+{
+    char buf[1024];
+    int n = dmSnPrintf(buf, sizeof(buf), "%s", prefix);
+    va_list lst;
+    va_start(lst, format);
+    n += vsnprintf(buf + n, sizeof(buf) - n, format, lst);
+    va_end(lst);
+    n += dmSnPrintf(buf + n, sizeof(buf) - n, "\n");
+
+    g_ExpectedOutput.SetCapacity(g_ExpectedOutput.Size() + n + 1);
+    g_ExpectedOutput.PushArray(buf, n);
+}
+
+#define LOG_AND_EXPECT(format, ...) \
+    dmLogInfo(format, __VA_ARGS__); \
+    AppendExpected("INFO:DLIB: ", format, __VA_ARGS__);
+
+TEST(dmLog, Deferred)
+{
+    dLib::SetDebugMode(false); // avoid spam in the unit tests
+
+    dmLog::LogParams params;
+    params.m_Deferred = true;
+    dmLog::LogInitialize(&params);
+
+    g_LogListenerOutput.SetSize(0);
+    g_ExpectedOutput.SetSize(0);
+    dmLogRegisterListener(TestLogCaptureCallback);
+
+    char not_terminated[3] = {'a', 'b', 'c'};
+    long long big = 0x123456789abcdefLL;
+    LOG_AND_EXPECT("int %d %5i %-3u| %x %08X %o %c %hd %hhu %+d", -12, 34, 5u, 0xbeefu, 0xcafeu, 8, 'z', (short) -7, (unsigned char) 200, 3);
+    LOG_AND_EXPECT("long %ld %lu %lld %llx %zu %jd %td", -1234567L, 1234567UL, -big, (unsigned long long) big, (size_t) 42, (intmax_t) -43, (ptrdiff_t) 44);
+    LOG_AND_EXPECT("float %f %.2f %10.3e %g %G %5.1f%%", 3.14159, -2.5f, 12345.678, 0.0001, 1e20, 99.95);
+    LOG_AND_EXPECT("string %s %10s %-6s| %.2s %.*s %*d %s", "hello", "right", "left", "truncated", 2, not_terminated, 4, 7, "");
+    LOG_AND_EXPECT("pointer %p", (void*) &big);
+    // Not packed, formatted by the logging thread
+    LOG_AND_EXPECT("long double %.3Lf", (long double) 1.5);
+    dmLogInfo("no arguments");
+    AppendExpected("INFO:DLIB: ", "no arguments");
+    // The format string is copied, it may be built at runtime
+    char runtime_format[32];
+    dmSnPrintf(runtime_format, sizeof(runtime_format), "runtime %%d %s", "format");
+    LogInternal(LOG_SEVERITY_INFO, DLIB_LOG_DOMAIN, runtime_format, 5);
+    AppendExpected("INFO:DLIB: ", runtime_format, 5);
+    memset(runtime_format, 'x', sizeof(runtime_format) - 1);
+    runtime_format[sizeof(runtime_format) - 1] = '\0';
+    dmLogFatal("fatal %d", 1);
+    AppendExpected("FATAL:DLIB: ", "fatal %d", 1);
+
+    // Outputs the remaining records
+    dmLog::LogFinalize();
+
+    g_LogListenerOutput.SetCapacity(g_LogListenerOutput.Size() + 1);
+    g_LogListenerOutput.Push(0);
+    g_ExpectedOutput.SetCapacity(g_ExpectedOutput.Size() + 1);
+    g_ExpectedOutput.Push(0);
+    ASSERT_STREQ(g_ExpectedOutput.Begin(), g_LogListenerOutput.Begin());
+
+    dLib::SetDebugMode(true);
+}
+
+static const int DEFERRED_THREAD_COUNT = 4;
+static const int DEFERRED_LOOP_COUNT = 5000;
+static int g_DeferredNextIndex[DEFERRED_THREAD_COUNT];
+static int g_DeferredOutOfOrder = 0;
+static int g_DeferredCount = 0;
+
+static void DeferredOrderListener(LogSeverity severity, const char* domain, const char* formatted_string)
+{
+    int thread_id, index;
+    if (sscanf(formatted_string, "INFO:DLIB: %d %d", &thread_id, &index) != 2)
+        return;
+    // Only called from the log thread, except from LogFinalize after the thread has been joined
+    if (g_DeferredNextIndex[thread_id] != index)
+        g_DeferredOutOfOrder++;
+    g_DeferredNextIndex[thread_id] = index + 1;
+    g_DeferredCount++;
+}
+
+static void DeferredLogThread(void* arg)
+{
+    int thread_id = (int) (uintptr_t) arg;
+    for (int i = 0; i < DEFERRED_LOOP_COUNT; ++i)
+    {
+        dmLogInfo("%d %d", thread_id, i);
+    }
+}
+
+TEST(dmLog, DeferredThreads)
+{
+    dLib::SetDebugMode(false); // avoid spam in the unit tests
+
+    dmLog::LogParams params;
+    params.m_Deferred = true;
+    dmLog::LogInitialize(&params);
+
+    memset(g_DeferredNextIndex, 0, sizeof(g_DeferredNextIndex));
+    g_DeferredOutOfOrder = 0;
+    g_DeferredCount = 0;
+    dmLogRegisterListener(DeferredOrderListener);
+
+    // More than fits in the rings, so that the threads have to wait for the log thread
+    dmThread::Thread threads[DEFERRED_THREAD_COUNT];
+    for (int i = 0; i < DEFERRED_THREAD_COUNT; ++i)
+    {
+        threads[i] = dmThread::New(DeferredLogThread, 0x80000, (void*) (uintptr_t) i, "test");
+    }
+    for (int i = 0; i < DEFERRED_THREAD_COUNT; ++i)
+    {
+        dmThread::Join(threads[i]);
+    }
+
+    dmLog::LogFinalize();
+
+    // The messages from each thread are output in order
+    ASSERT_EQ(DEFERRED_THREAD_COUNT * DEFERRED_LOOP_COUNT, g_DeferredCount);
+    ASSERT_EQ(0, g_DeferredOutOfOrder);
+
+    dLib::SetDebugMode(true);
+}
+
+static int32_atomic_t g_DeferredShortLivedCount = 0;
+
+static void DeferredShortLivedListener(LogSeverity severity, const char* domain, const char* formatted_string)
+{
+    if (strstr(formatted_string, "short lived") != 0)
+        dmAtomicIncrement32(&g_DeferredShortLivedCount);
+}
+
+static void DeferredShortLivedThread(void* arg)
+{
+    dmLogInfo("short lived %d", (int) (uintptr_t) arg);
+}
+
+TEST(dmLog, DeferredThreadExit)
+{
+    dLib::SetDebugMode(false); // avoid spam in the unit tests
+
+    dmLog::LogParams params;
+    params.m_Deferred = true;
+    dmLog::LogInitialize(&params);
+
+    dmAtomicStore32(&g_DeferredShortLivedCount, 0);
+    dmLogRegisterListener(DeferredShortLivedListener);
+
+    // The ring of this thread is kept
+    dmLogInfo("main thread");
+    uint32_t ring_count = dmLog::GetDeferredRingCount();
+    ASSERT_EQ(1u, ring_count);
+
+    // The rings of exited threads are deleted once their messages are output
+    const int thread_count = 64;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        dmThread::Thread thread = dmThread::New(DeferredShortLivedThread, 0x80000, (void*) (uintptr_t) i, "test");
+        dmThread::Join(thread);
+    }
+
+    uint64_t start = dmTime::GetTime();
+    while (dmLog::GetDeferredRingCount() != ring_count && dmTime::GetTime() - start < 5000000)
+    {
+        dmTime::Sleep(1000);
+    }
+    ASSERT_EQ(ring_count, dmLog::GetDeferredRingCount());
+    ASSERT_EQ(thread_count, dmAtomicGet32(&g_DeferredShortLivedCount));
+
+    dmLogUnregisterListener(DeferredShortLivedListener);
+    dmLog::LogFinalize();
+
+    dLib::SetDebugMode(true);
+}
+
 int main(int argc, char **argv)
 {
     TestMainPlatformInit();
@@ -0,0 +1,107 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include "dlib/atomic.h"
+#include "dlib/dlib.h"
+#include "dlib/log.h"
+#include "dlib/socket.h"
+#include "dlib/thread.h"
+#include "dlib/time.h"
+
+// Compares the immediate and the deferred logging, with 1M log calls from 4 threads.
+// The debug mode is turned off, so that the time isn't spent in the terminal.
+
+static const uint32_t THREAD_COUNT = 4;
+static const uint32_t CALL_COUNT = 1000000;
+
+static int32_atomic_t g_OutputCount = 0;
+static int32_atomic_t g_CallTime = 0; // In microseconds, summed over the threads
+
+static void CountingListener(LogSeverity severity, const char* domain, const char* formatted_string)
+{
+    dmAtomicIncrement32(&g_OutputCount);
+}
+
+static void LogThread(void* arg)
+{
+    uint32_t thread_id = (uint32_t) (uintptr_t) arg;
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < CALL_COUNT / THREAD_COUNT; ++i)
+    {
+        dmLogInfo("thread %u, message %u, position %.2f, %s", thread_id, i, i * 0.5f, "name");
+    }
+    dmAtomicAdd32(&g_CallTime, (int32_t) (dmTime::GetTime() - start));
+}
+
+static void Run(bool deferred, uint64_t* call_time, uint64_t* total_time)
+{
+    dmLog::LogParams params;
+    params.m_Deferred = deferred;
+    dmLog::LogInitialize(&params);
+    dmLogRegisterListener(CountingListener);
+
+    g_OutputCount = 0;
+    g_CallTime = 0;
+
+    uint64_t start = dmTime::GetTime();
+    dmThread::Thread threads[THREAD_COUNT];
+    for (uint32_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        threads[i] = dmThread::New(LogThread, 0x80000, (void*) (uintptr_t) i, "logperf");
+    }
+    for (uint32_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        dmThread::Join(threads[i]);
+    }
+
+    // Outputs the remaining deferred messages
+    dmLog::LogFinalize();
+    dmLogUnregisterListener(CountingListener);
+    *total_time = dmTime::GetTime() - start;
+    *call_time = (uint64_t) dmAtomicGet32(&g_CallTime) / THREAD_COUNT;
+
+    ASSERT_EQ(CALL_COUNT, (uint32_t) dmAtomicGet32(&g_OutputCount));
+}
+
+TEST(dmLog, Performance)
+{
+    dLib::SetDebugMode(false);
+
+    uint64_t immediate_call_time, immediate_total_time;
+    Run(false, &immediate_call_time, &immediate_total_time);
+    uint64_t deferred_call_time, deferred_total_time;
+    Run(true, &deferred_call_time, &deferred_total_time);
+
+    printf("%u log calls from %u threads\n", CALL_COUNT, THREAD_COUNT);
+    printf("[immediate] calls: %8.3f ms per thread | total: %8.3f ms\n", immediate_call_time / 1000.0, immediate_total_time / 1000.0);
+    printf("[deferred ] calls: %8.3f ms per thread | total: %8.3f ms\n", deferred_call_time / 1000.0, deferred_total_time / 1000.0);
+    printf("Time spent in the logging threads: x%.2f\n", immediate_call_time / (double) (deferred_call_time ? deferred_call_time : 1));
+
+    dLib::SetDebugMode(true);
+}
+
+int main(int argc, char **argv)
+{
+    dmSocket::Initialize();
+    jc_test_init(&argc, argv);
+    int ret = jc_test_run_all();
+    dmSocket::Finalize();
+    return ret;
+}
@@ -17,6 +17,7 @@
 #include <vector>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
+#include "../../src/dlib/array.h"
 #include "../../src/dlib/hash.h"
 #include "../../src/dlib/message.h"
 #include "../../src/dlib/dstrings.h"
@@ -365,6 +366,277 @@ TEST(dmMessage, ThreadTest2)
     ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
 }
 
+TEST(dmMessage, ThreadExitBeforeDispatch)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    // The pages of the threads are released by the dispatch, after the threads have exited
+    for (int i = 0; i < 8; ++i)
+    {
+        dmThread::Thread t = dmThread::New(&PostThread, 0xf0000, (void*) &receiver, "post");
+        dmThread::Join(t);
+    }
+
+    ASSERT_EQ(1024U * 8U, dmMessage::Dispatch(receiver.m_Socket, HandleMessage, 0));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
+
+TEST(dmMessage, RecreateSocket)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    uint32_t m = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(0x0, &receiver, m_HashMessage1, 0, 0x0, &m, sizeof(m), 0));
+        ASSERT_EQ(1U, dmMessage::Dispatch(receiver.m_Socket, HandleMessage, 0));
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+
+        // The socket is no longer found, even if its lookup was cached by the post
+        ASSERT_EQ(dmMessage::RESULT_SOCKET_NOT_FOUND, dmMessage::Post(0x0, &receiver, m_HashMessage1, 0, 0x0, &m, sizeof(m), 0));
+        ASSERT_FALSE(dmMessage::HasMessages(receiver.m_Socket));
+    }
+}
+
+struct BenchThreadContext
+{
+    dmMessage::URL* m_Receiver;
+    uint32_t        m_ThreadIndex;
+    uint32_t        m_Count;
+};
+
+struct BenchThreadMessage
+{
+    uint32_t m_ThreadIndex;
+    uint32_t m_Sequence;
+};
+
+static void BenchPostThread(void* arg)
+{
+    BenchThreadContext* ctx = (BenchThreadContext*) arg;
+    for (uint32_t i = 0; i < ctx->m_Count; ++i)
+    {
+        BenchThreadMessage m = { ctx->m_ThreadIndex, i };
+        dmMessage::Result result = dmMessage::Post(0x0, ctx->m_Receiver, m_HashMessage1, 0, 0x0, &m, sizeof(m), 0);
+        T_ASSERT_EQ(dmMessage::RESULT_OK, result);
+    }
+}
+
+static void HandleBenchThreadMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    // Messages from the same thread must arrive in the order they were posted
+    uint32_t* next_sequence = (uint32_t*) user_ptr;
+    BenchThreadMessage* m = (BenchThreadMessage*) message_object->m_Data;
+    T_ASSERT_EQ(next_sequence[m->m_ThreadIndex], m->m_Sequence);
+    next_sequence[m->m_ThreadIndex]++;
+}
+
+TEST(dmMessage, BenchThreads)
+{
+    const uint32_t thread_count = 4;
+    const uint32_t iter_count = 1024 * 64;
+
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    BenchThreadContext contexts[thread_count];
+    dmThread::Thread threads[thread_count];
+    uint32_t next_sequence[thread_count] = {};
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        contexts[i].m_Receiver = &receiver;
+        contexts[i].m_ThreadIndex = i;
+        contexts[i].m_Count = iter_count;
+        threads[i] = dmThread::New(&BenchPostThread, 0xf0000, (void*) &contexts[i], "post");
+    }
+
+    uint32_t count = 0;
+    while (count < thread_count * iter_count)
+    {
+        count += dmMessage::Dispatch(receiver.m_Socket, HandleBenchThreadMessage, next_sequence);
+    }
+    uint64_t end = dmTime::GetTime();
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        dmThread::Join(threads[i]);
+        ASSERT_EQ(iter_count, next_sequence[i]);
+    }
+    ASSERT_EQ(thread_count * iter_count, count);
+    printf("Bench elapsed: %f ms for %u threads (%f us per message)\n", (end-start) / 1000.0f, thread_count, (end-start) / float(thread_count * iter_count));
+
+    ASSERT_EQ(0u, dmMessage::Dispatch(receiver.m_Socket, HandleBenchThreadMessage, next_sequence));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
+
+static void HandlePostBatchMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    // Stores the receiver paths in dispatch order
+    dmArray<dmhash_t>* paths = (dmArray<dmhash_t>*) user_ptr;
+    assert(message_object->m_Id == m_HashMessage1);
+    assert(*(uint32_t*) message_object->m_Data == 42);
+    paths->OffsetCapacity(1);
+    paths->Push(message_object->m_Receiver.m_Path);
+}
+
+TEST(dmMessage, PostBatch)
+{
+    dmMessage::HSocket socket1;
+    dmMessage::HSocket socket2;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("socket1", &socket1));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("socket2", &socket2));
+
+    dmMessage::URL receivers[5];
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        dmMessage::ResetURL(&receivers[i]);
+        receivers[i].m_Socket = (i % 2) == 0 ? socket1 : socket2;
+        receivers[i].m_Path = i;
+    }
+
+    uint32_t data = 42;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostBatch(0x0, receivers, 5, m_HashMessage1, 0, 0, 0, &data, sizeof(data), 0));
+
+    dmArray<dmhash_t> paths;
+    ASSERT_EQ(3u, dmMessage::Dispatch(socket1, HandlePostBatchMessage, &paths));
+    ASSERT_EQ(2u, dmMessage::Dispatch(socket2, HandlePostBatchMessage, &paths));
+    ASSERT_EQ(5u, paths.Size());
+    ASSERT_EQ(0u, paths[0]);
+    ASSERT_EQ(2u, paths[1]);
+    ASSERT_EQ(4u, paths[2]);
+    ASSERT_EQ(1u, paths[3]);
+    ASSERT_EQ(3u, paths[4]);
+
+    // The other receivers still get the message
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(socket2));
+    ASSERT_EQ(dmMessage::RESULT_SOCKET_NOT_FOUND, dmMessage::PostBatch(0x0, receivers, 5, m_HashMessage1, 0, 0, 0, &data, sizeof(data), 0));
+    paths.SetSize(0);
+    ASSERT_EQ(3u, dmMessage::Dispatch(socket1, HandlePostBatchMessage, &paths));
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostBatch(0x0, receivers, 0, m_HashMessage1, 0, 0, 0, &data, sizeof(data), 0));
+    ASSERT_EQ(0u, dmMessage::Dispatch(socket1, HandlePostBatchMessage, &paths));
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(socket1));
+}
+
+TEST(dmMessage, PostBatchMany)
+{
+    const uint32_t socket_count = 3;
+    const uint32_t receiver_count = 1000;
+    dmMessage::HSocket sockets[socket_count];
+    char name[32];
+    for (uint32_t i = 0; i < socket_count; ++i)
+    {
+        dmSnPrintf(name, sizeof(name), "batch_socket%u", i);
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket(name, &sockets[i]));
+    }
+
+    // Interleaved receivers, more than fit on the stack
+    dmArray<dmMessage::URL> receivers;
+    receivers.SetCapacity(receiver_count);
+    receivers.SetSize(receiver_count);
+    for (uint32_t i = 0; i < receiver_count; ++i)
+    {
+        dmMessage::ResetURL(&receivers[i]);
+        receivers[i].m_Socket = sockets[(i * 7) % socket_count];
+        receivers[i].m_Path = i;
+    }
+
+    uint32_t data = 42;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostBatch(0x0, receivers.Begin(), receiver_count, m_HashMessage1, 0, 0, 0, &data, sizeof(data), 0));
+
+    // Each socket gets its receivers in the original order
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < socket_count; ++i)
+    {
+        dmArray<dmhash_t> paths;
+        total += dmMessage::Dispatch(sockets[i], HandlePostBatchMessage, &paths);
+        for (uint32_t j = 0; j < paths.Size(); ++j)
+        {
+            ASSERT_EQ(sockets[i], receivers[paths[j]].m_Socket);
+            if (j > 0)
+            {
+                ASSERT_LT(paths[j - 1], paths[j]);
+            }
+        }
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(sockets[i]));
+    }
+    ASSERT_EQ(receiver_count, total);
+}
+
+struct SharedPayloadContext
+{
+    const void* m_Data;
+    uint32_t    m_Count;
+    uint32_t    m_DestroyCount;
+};
+
+static SharedPayloadContext g_SharedPayloadContext;
+
+static void HandleSharedPayloadMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    SharedPayloadContext* ctx = (SharedPayloadContext*) user_ptr;
+    assert(message_object->m_Receiver.m_Path == ctx->m_Count);
+    assert(message_object->m_DataSize == 100);
+    for (uint32_t i = 0; i < message_object->m_DataSize; ++i)
+    {
+        assert(message_object->m_Data[i] == (uint8_t) i);
+    }
+    // The receivers of a socket share the payload
+    assert(ctx->m_Data == 0 || ctx->m_Data == message_object->m_Data);
+    ctx->m_Data = message_object->m_Data;
+    ctx->m_Count++;
+}
+
+static void DestroySharedPayloadMessage(dmMessage::Message* message_object)
+{
+    g_SharedPayloadContext.m_DestroyCount++;
+}
+
+TEST(dmMessage, PostBatchSharedPayload)
+{
+    dmMessage::HSocket socket;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("socket", &socket));
+
+    const uint32_t receiver_count = 8;
+    dmMessage::URL receivers[receiver_count];
+    for (uint32_t i = 0; i < receiver_count; ++i)
+    {
+        dmMessage::ResetURL(&receivers[i]);
+        receivers[i].m_Socket = socket;
+        receivers[i].m_Path = i;
+    }
+
+    uint8_t data[100];
+    for (uint32_t i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    // Enough batches to go through several pages, to make sure the shared payloads are released
+    for (uint32_t iteration = 0; iteration < 1000; ++iteration)
+    {
+        memset(&g_SharedPayloadContext, 0, sizeof(g_SharedPayloadContext));
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostBatch(0x0, receivers, receiver_count, m_HashMessage1, 0, 0, 0, data, sizeof(data), DestroySharedPayloadMessage));
+        ASSERT_EQ(receiver_count, dmMessage::Dispatch(socket, HandleSharedPayloadMessage, &g_SharedPayloadContext));
+        ASSERT_EQ(receiver_count, g_SharedPayloadContext.m_Count);
+        ASSERT_EQ(receiver_count, g_SharedPayloadContext.m_DestroyCount);
+    }
+
+    // Pending messages are destroyed with the socket
+    memset(&g_SharedPayloadContext, 0, sizeof(g_SharedPayloadContext));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::PostBatch(0x0, receivers, receiver_count, m_HashMessage1, 0, 0, 0, data, sizeof(data), DestroySharedPayloadMessage));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(socket));
+    ASSERT_EQ(receiver_count, g_SharedPayloadContext.m_DestroyCount);
+}
+
 void HandleIntegrityMessage(dmMessage::Message *message_object, void *user_ptr)
 {
     dmhash_t hash = dmHashBuffer64(message_object->m_Data, message_object->m_DataSize);
@@ -101,6 +101,9 @@ extern "C" {
 DM_PROPERTY_EXTERN(rmtp_Script);
 DM_PROPERTY_U32(rmtp_LuaMem, 0, FrameReset, "kb", &rmtp_Script); // kilo bytes
 DM_PROPERTY_U32(rmtp_LuaRefs, 0, FrameReset, "# Lua references", &rmtp_Script);
+DM_PROPERTY_GROUP(rmtp_RenderThread, "Render Thread");
+DM_PROPERTY_U32(rmtp_RenderThreadSubmit, 0, FrameReset, "us spent submitting the previous frame", &rmtp_RenderThread);
+DM_PROPERTY_U32(rmtp_RenderThreadOverlap, 0, FrameReset, "us of the submission that overlapped the simulation", &rmtp_RenderThread);
 
 namespace dmEngine
 {
@@ -215,6 +218,8 @@ namespace dmEngine
     Stats::Stats()
     : m_FrameCount(0)
     , m_TotalTime(0.0f)
+    , m_RenderSubmitTime(0)
+    , m_RenderOverlapTime(0)
     {
 
     }
@@ -240,6 +245,7 @@ namespace dmEngine
     , m_GameInputBinding(0x0)
     , m_DisplayProfiles(0x0)
     , m_RenderScriptPrototype(0x0)
+    , m_RenderThread(0x0)
     , m_Stats()
     , m_WasIconified(true)
     , m_QuitOnEsc(false)
@@ -272,8 +278,40 @@ namespace dmEngine
         return new Engine(engine_service);
     }
 
+    // Waits for the frame submitted on the render thread, and presents it
+    static void WaitForRenderFrame(HEngine engine)
+    {
+        uint64_t wait_time, submit_time;
+        if (engine->m_RenderThread && WaitRenderThread(engine->m_RenderThread, &wait_time, &submit_time))
+        {
+            // The part of the submission we didn't have to wait for ran in parallel with the simulation
+            uint64_t overlap_time = submit_time > wait_time ? submit_time - wait_time : 0;
+            engine->m_Stats.m_RenderSubmitTime += submit_time;
+            engine->m_Stats.m_RenderOverlapTime += overlap_time;
+            DM_PROPERTY_SET_U32(rmtp_RenderThreadSubmit, (uint32_t) submit_time);
+            DM_PROPERTY_SET_U32(rmtp_RenderThreadOverlap, (uint32_t) overlap_time);
+
+            dmGraphics::Flip(engine->m_GraphicsContext);
+        }
+    }
+
+    // The frame in flight still uses the graphics objects that the next update may delete or write to
+    // (components, resources or scripts), so its submission must be done first. It's presented as usual after the update.
+    static void OnGraphicsResourceChange(void* user_data)
+    {
+        SyncRenderThread(((HEngine) user_data)->m_RenderThread);
+    }
+
     void Delete(HEngine engine)
     {
+        if (engine->m_RenderThread)
+        {
+            dmGraphics::SetResourceChangeCallback(0, 0);
+            WaitForRenderFrame(engine);
+            DeleteRenderThread(engine->m_RenderThread);
+            engine->m_RenderThread = 0;
+        }
+
         {
             dmExtension::Params params;
             params.m_ConfigFile = engine->m_Config;
@@ -946,6 +984,7 @@ namespace dmEngine
         dmResource::NewFactoryParams params;
         params.m_MaxResources = max_resources;
         params.m_Flags = 0;
+        params.m_LoadThreadCount = dmMath::Max(1, dmConfigFile::GetInt(engine->m_Config, dmResource::LOAD_THREAD_COUNT_KEY, 1));
 
         if (dLib::IsDebugMode())
         {
@@ -1027,6 +1066,11 @@ namespace dmEngine
             return false;
         }
         dmGameObject::SetInputStackDefaultCapacity(engine->m_Register, dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY, dmGameObject::DEFAULT_MAX_INPUT_STACK_CAPACITY));
+        dmGameObject::SetIncrementalTransforms(engine->m_Register, dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_INCREMENTAL_TRANSFORMS_KEY, 0) != 0);
+        if (dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_PARALLEL_TRANSFORMS_KEY, 0) != 0)
+        {
+            dmGameObject::SetTransformJobThread(engine->m_Register, engine->m_JobThreadContext);
+        }
 
         dmRender::RenderContextParams render_params;
         render_params.m_MaxRenderTypes = 16;
@@ -1047,6 +1091,21 @@ namespace dmEngine
         render_params.m_MaxBatches = (uint32_t) dmConfigFile::GetInt(engine->m_Config, "graphics.max_font_batches", 128);
         engine->m_RenderContext = dmRender::NewRenderContext(engine->m_GraphicsContext, render_params);
 
+        if (dmConfigFile::GetInt(engine->m_Config, "engine.render_thread", 0))
+        {
+            // The graphics calls are made from the render thread while the main thread owns the window,
+            // which only the null adapter allows for now
+            if (dmGraphics::GetInstalledAdapterFamily() == dmGraphics::ADAPTER_FAMILY_NULL)
+            {
+                engine->m_RenderThread = NewRenderThread(engine->m_RenderContext);
+                dmGraphics::SetResourceChangeCallback(OnGraphicsResourceChange, engine);
+            }
+            else
+            {
+                dmLogWarning("engine.render_thread is only supported with the null graphics adapter, the frames will be submitted on the main thread");
+            }
+        }
+
         dmGameObject::Initialize(engine->m_Register, engine->m_GOScriptContext);
 
         engine->m_ParticleFXContext.m_Factory = engine->m_Factory;
@@ -1054,6 +1113,10 @@ namespace dmEngine
         engine->m_ParticleFXContext.m_MaxParticleFXCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_INSTANCE_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxEmitterCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_EMITTER_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxParticleCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_PARTICLE_COUNT_KEY, 1024);
+        if (dmConfigFile::GetInt(engine->m_Config, dmParticle::PARALLEL_UPDATE_KEY, 0) != 0)
+        {
+            engine->m_ParticleFXContext.m_JobThread = engine->m_JobThreadContext;
+        }
         engine->m_ParticleFXContext.m_Debug = false;
 
         dmInput::NewContextParams input_params;
@@ -1175,6 +1238,7 @@ namespace dmEngine
         engine->m_ModelContext.m_RenderContext = engine->m_RenderContext;
         engine->m_ModelContext.m_Factory = engine->m_Factory;
         engine->m_ModelContext.m_MaxModelCount = dmConfigFile::GetInt(engine->m_Config, "model.max_count", 128);
+        engine->m_ModelContext.m_PoseCache = dmConfigFile::GetInt(engine->m_Config, "model.pose_cache", 0) != 0;
 
         engine->m_LabelContext.m_RenderContext      = engine->m_RenderContext;
         engine->m_LabelContext.m_MaxLabelCount      = dmConfigFile::GetInt(engine->m_Config, "label.max_count", 64);
@@ -1574,6 +1638,8 @@ bail:
         {
             DM_PROFILE("Frame");
 
+            bool record_render_frame = false;
+
             {
                 DM_PROFILE("Sim");
 
@@ -1679,6 +1745,17 @@ bail:
                 update_context.m_AccumFrameTime = engine->m_AccumFrameTime;
                 dmGameObject::Update(engine->m_MainCollection, &update_context);
 
+                // With a render thread, the previous frame was submitted while this frame was simulated.
+                // It must be done before the render lists are dispatched, since that writes the graphics buffers.
+                WaitForRenderFrame(engine);
+
+                // The frame is read back after the flip when recording, so it is submitted on the main thread
+                record_render_frame = engine->m_RenderThread != 0 && engine->m_RecordData.m_Recorder == 0;
+                if (record_render_frame)
+                {
+                    dmRender::BeginRenderFrame(engine->m_RenderContext);
+                }
+
                 // Don't render while iconified
                 if (!dmGraphics::GetWindowStateParam(engine->m_GraphicsContext, dmPlatform::WINDOW_STATE_ICONIFIED))
                 {
@@ -1772,13 +1849,23 @@ bail:
                 dmExtension::PostRender(&ext_params);
             }
 
-            dmGraphics::Flip(engine->m_GraphicsContext);
+            if (record_render_frame)
+            {
+                // Submitted while the next frame is simulated, and flipped when it has been waited for
+                dmRender::EndRenderFrame(engine->m_RenderContext);
+                KickRenderThread(engine->m_RenderThread);
+            }
+            else
+            {
+                dmGraphics::Flip(engine->m_GraphicsContext);
+            }
 
             RecordData* record_data = &engine->m_RecordData;
             if (record_data->m_Recorder)
             {
                 if (record_data->m_FrameCount % record_data->m_FramePeriod == 0)
                 {
+                    DM_PROFILE("RecordFrame");
                     uint32_t width = dmGraphics::GetWidth(engine->m_GraphicsContext);
                     uint32_t height = dmGraphics::GetHeight(engine->m_GraphicsContext);
                     uint32_t buffer_size = width * height * 4;
@@ -1977,6 +2064,10 @@ bail:
                 RecordData* record_data = &self->m_RecordData;
                 if (record_data->m_Recorder)
                 {
+                    dmRecord::Stats stats;
+                    dmRecord::GetStats(record_data->m_Recorder, &stats);
+                    dmLogInfo("Recorded %u frames, %u dropped (at most %u frames waited for the encoder)", stats.m_FramesRecorded, stats.m_FramesDropped, stats.m_MaxQueued);
+
                     dmRecord::Delete(record_data->m_Recorder);
                     delete[] record_data->m_Buffer;
                     record_data->m_Recorder = 0;
@@ -39,6 +39,7 @@
 #include <record/record.h>
 
 #include "engine.h"
+#include "engine_render_thread.h"
 #include "engine_service.h"
 #include "engine.h"
 #include <engine/engine_ddf.h>
@@ -84,7 +85,9 @@ namespace dmEngine
         Stats();
 
         uint32_t m_FrameCount;
-        float    m_TotalTime;   // Total running time of the game
+        float    m_TotalTime;           // Total running time of the game
+        uint64_t m_RenderSubmitTime;    // Total time spent submitting frames on the render thread (us)
+        uint64_t m_RenderOverlapTime;   // Part of m_RenderSubmitTime that overlapped the simulation (us)
     };
 
     struct RecordData
@@ -150,6 +153,7 @@ namespace dmEngine
         dmRender::HDisplayProfiles                  m_DisplayProfiles;
 
         dmGameSystem::RenderScriptPrototype*        m_RenderScriptPrototype;
+        HRenderThread                               m_RenderThread;             // Set if the frames are submitted on a separate thread (engine.render_thread)
 
         Stats                                       m_Stats;
 
@@ -0,0 +1,141 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "engine_render_thread.h"
+
+#include <assert.h>
+#include <dlib/condition_variable.h>
+#include <dlib/mutex.h>
+#include <dlib/profile.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
+
+namespace dmEngine
+{
+    struct RenderThread
+    {
+        dmRender::HRenderContext                m_RenderContext;
+        dmThread::Thread                        m_Thread;
+        dmMutex::HMutex                         m_Mutex;
+        dmConditionVariable::HConditionVariable m_Condition;
+        uint64_t                                m_SubmitTime;
+        // Set by the main thread when a frame is kicked, cleared by the render thread when it has been submitted.
+        // The render thread and the threads waiting for the frame share the condition variable, so it is broadcast.
+        bool                                    m_Pending;
+        bool                                    m_Quit;
+        // Only used by the main thread, a frame has been kicked but not waited for
+        bool                                    m_InFlight;
+    };
+
+    static void RenderThreadMain(void* arg)
+    {
+        RenderThread* render_thread = (RenderThread*) arg;
+
+        while (true)
+        {
+            {
+                DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+                while (!render_thread->m_Pending && !render_thread->m_Quit)
+                {
+                    dmConditionVariable::Wait(render_thread->m_Condition, render_thread->m_Mutex);
+                }
+                if (!render_thread->m_Pending)
+                {
+                    return;
+                }
+            }
+
+            uint64_t start = dmTime::GetTime();
+            dmRender::SubmitRenderFrame(render_thread->m_RenderContext);
+            uint64_t submit_time = dmTime::GetTime() - start;
+
+            DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+            render_thread->m_SubmitTime = submit_time;
+            render_thread->m_Pending    = false;
+            dmConditionVariable::Broadcast(render_thread->m_Condition);
+        }
+    }
+
+    HRenderThread NewRenderThread(dmRender::HRenderContext render_context)
+    {
+        RenderThread* render_thread    = new RenderThread;
+        render_thread->m_RenderContext = render_context;
+        render_thread->m_Mutex         = dmMutex::New();
+        render_thread->m_Condition     = dmConditionVariable::New();
+        render_thread->m_SubmitTime    = 0;
+        render_thread->m_Pending       = false;
+        render_thread->m_Quit          = false;
+        render_thread->m_InFlight      = false;
+        render_thread->m_Thread        = dmThread::New(RenderThreadMain, 0x80000, render_thread, "render");
+        return render_thread;
+    }
+
+    void DeleteRenderThread(HRenderThread render_thread)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+            render_thread->m_Quit = true;
+            dmConditionVariable::Broadcast(render_thread->m_Condition);
+        }
+        // The thread submits the frame in flight before it exits
+        dmThread::Join(render_thread->m_Thread);
+        dmConditionVariable::Delete(render_thread->m_Condition);
+        dmMutex::Delete(render_thread->m_Mutex);
+        delete render_thread;
+    }
+
+    void KickRenderThread(HRenderThread render_thread)
+    {
+        DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+        assert(!render_thread->m_InFlight);
+        render_thread->m_Pending  = true;
+        render_thread->m_InFlight = true;
+        dmConditionVariable::Broadcast(render_thread->m_Condition);
+    }
+
+    void SyncRenderThread(HRenderThread render_thread)
+    {
+        DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+        if (render_thread->m_Pending)
+        {
+            DM_PROFILE("SyncRenderThread");
+            while (render_thread->m_Pending)
+            {
+                dmConditionVariable::Wait(render_thread->m_Condition, render_thread->m_Mutex);
+            }
+        }
+    }
+
+    bool WaitRenderThread(HRenderThread render_thread, uint64_t* wait_time, uint64_t* submit_time)
+    {
+        if (!render_thread->m_InFlight)
+        {
+            return false;
+        }
+
+        DM_PROFILE("WaitRenderThread");
+
+        uint64_t start = dmTime::GetTime();
+        DM_MUTEX_SCOPED_LOCK(render_thread->m_Mutex);
+        while (render_thread->m_Pending)
+        {
+            dmConditionVariable::Wait(render_thread->m_Condition, render_thread->m_Mutex);
+        }
+        *wait_time   = dmTime::GetTime() - start;
+        *submit_time = render_thread->m_SubmitTime;
+        render_thread->m_InFlight = false;
+        return true;
+    }
+}
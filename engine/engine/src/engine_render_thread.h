@@ -0,0 +1,42 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#ifndef DM_ENGINE_RENDER_THREAD_H
+#define DM_ENGINE_RENDER_THREAD_H
+
+#include <stdint.h>
+#include <render/render.h>
+
+namespace dmEngine
+{
+    // Submits the recorded render frames (see dmRender::BeginRenderFrame) on a separate thread,
+    // so that the submission of frame N overlaps the simulation of frame N+1
+    typedef struct RenderThread* HRenderThread;
+
+    HRenderThread NewRenderThread(dmRender::HRenderContext render_context);
+    // Waits for the frame in flight, if any, before stopping the thread
+    void          DeleteRenderThread(HRenderThread render_thread);
+
+    // Starts submitting the last ended frame. The previous frame must have been waited for.
+    void          KickRenderThread(HRenderThread render_thread);
+    // Waits until the kicked frame has been submitted. Returns false if no frame was in flight.
+    // The time spent waiting and the time the thread spent submitting are returned in microseconds.
+    bool          WaitRenderThread(HRenderThread render_thread, uint64_t* wait_time, uint64_t* submit_time);
+    // Blocks until the kicked frame, if any, has been submitted. May be called from any thread but the render thread.
+    // The frame is still in flight for WaitRenderThread, which must be called before the next kick.
+    void          SyncRenderThread(HRenderThread render_thread);
+}
+
+#endif // DM_ENGINE_RENDER_THREAD_H
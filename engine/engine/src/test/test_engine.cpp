@@ -120,11 +120,6 @@ static void PostRunFrameCount(dmEngine::HEngine engine, void* ctx)
     *((uint32_t*) ctx) = stats.m_FrameCount;
 }
 
-// static void PostRunGetStats(dmEngine::HEngine engine, void* stats)
-// {
-//     dmEngine::GetStats(engine, *((dmEngine::Stats*)stats));
-// }
-
 TEST_F(EngineTest, Project)
 {
     uint32_t frame_count = 0;
@@ -134,6 +129,21 @@ TEST_F(EngineTest, Project)
     ASSERT_GT(frame_count, 5u);
 }
 
+static void PostRunGetStats(dmEngine::HEngine engine, void* stats)
+{
+    dmEngine::GetStats(engine, *((dmEngine::Stats*)stats));
+}
+
+TEST_F(EngineTest, RenderThread)
+{
+    dmEngine::Stats stats;
+    char project_path[256];
+    const char* argv[] = {"test_engine", "--config=engine.render_thread=1", "--config=dmengine.unload_builtins=0", MAKE_PATH(project_path, "/game.projectc")};
+    ASSERT_EQ(0, Launch(DM_ARRAY_SIZE(argv), (char**)argv, 0, PostRunGetStats, &stats));
+    ASSERT_GT(stats.m_FrameCount, 5u);
+    ASSERT_LE(stats.m_RenderOverlapTime, stats.m_RenderSubmitTime);
+}
+
 TEST_F(EngineTest, SharedLuaState)
 {
     uint32_t frame_count = 0;
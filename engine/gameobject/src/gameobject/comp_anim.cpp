@@ -21,6 +21,7 @@
 #include <script/script.h>
 
 #include "component.h"
+#include "gameobject_private.h"
 #include "gameobject_script.h"
 #include "gameobject_props_lua.h"
 
@@ -313,6 +314,9 @@ namespace dmGameObject
                 if (anim.m_Value != 0x0)
                 {
                     *anim.m_Value = v;
+                    // Game object properties point into the local transform
+                    if (anim.m_ComponentId == 0)
+                        MarkTransformDirty(anim.m_Instance);
                 }
                 else
                 {
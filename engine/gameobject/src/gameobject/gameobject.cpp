@@ -26,6 +26,7 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/mutex.h>
+#include <dlib/time.h>
 #include <ddf/ddf.h>
 #include "gameobject.h"
 #include "gameobject_script.h"
@@ -43,11 +44,14 @@ DM_PROPERTY_GROUP(rmtp_GameObject, "Gameobjects");
 
 DM_PROPERTY_U32(rmtp_GOInstances, 0, FrameReset, "# alive go instances / frame", &rmtp_GameObject);
 DM_PROPERTY_U32(rmtp_GODeleted, 0, FrameReset, "# deleted instances / frame", &rmtp_GameObject);
+DM_PROPERTY_U32(rmtp_GOTransforms, 0, FrameReset, "# world transforms calculated / frame", &rmtp_GameObject);
 
 namespace dmGameObject
 {
     const char* COLLECTION_MAX_INSTANCES_KEY = "collection.max_instances";
     const char* COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY = "collection.max_input_stack_entries";
+    const char* COLLECTION_INCREMENTAL_TRANSFORMS_KEY = "collection.incremental_transforms";
+    const char* COLLECTION_PARALLEL_TRANSFORMS_KEY = "collection.parallel_transforms";
     const dmhash_t UNNAMED_IDENTIFIER = dmHashBuffer64("__unnamed__", strlen("__unnamed__"));
     const char* ID_SEPARATOR = "/";
     const uint32_t MAX_DISPATCH_ITERATION_COUNT = 10;
@@ -180,6 +184,8 @@ namespace dmGameObject
         m_ComponentTypeCount = 0;
         m_DefaultCollectionCapacity = DEFAULT_MAX_COLLECTION_CAPACITY;
         m_DefaultInputStackCapacity = DEFAULT_MAX_INPUT_STACK_CAPACITY;
+        m_TransformJobThread = 0;
+        m_IncrementalTransforms = 0;
         m_Mutex = dmMutex::New();
     }
 
@@ -213,6 +219,10 @@ namespace dmGameObject
         m_InstanceIndices.SetCapacity(max_instances);
         m_WorldTransforms.SetCapacity(max_instances);
         m_WorldTransforms.SetSize(max_instances);
+        m_TransformSoA.SetCapacity(max_instances);
+        m_TransformSoA.m_LevelOffsets.SetCapacity(MAX_HIERARCHICAL_DEPTH + 1);
+        m_DirtyTransformIndices.SetCapacity(max_instances);
+        memset(&m_TransformJobs, 0, sizeof(m_TransformJobs));
         m_IDToInstance.SetCapacity(dmMath::Max(1U, max_instances/3), max_instances);
         m_InputFocusStack.SetCapacity(max_input_stack_entries);
         m_NameHash = 0;
@@ -228,6 +238,8 @@ namespace dmGameObject
         m_ToBeDeleted = 0;
         m_ScaleAlongZ = 0;
         m_DirtyTransforms = 1;
+        m_TransformSoADirty = 1;
+        m_IncrementalTransforms = 0;
         m_Initialized = 0;
         m_FixedAccumTime = 0.0f;
         m_FirstUpdate = 1;
@@ -270,6 +282,18 @@ namespace dmGameObject
         return regist->m_DefaultInputStackCapacity;
     }
 
+    void SetIncrementalTransforms(HRegister regist, bool enabled)
+    {
+        assert(regist != 0x0);
+        regist->m_IncrementalTransforms = enabled;
+    }
+
+    void SetTransformJobThread(HRegister regist, dmJobThread::HContext job_thread)
+    {
+        assert(regist != 0x0);
+        regist->m_TransformJobThread = job_thread;
+    }
+
     void AddDynamicResourceHash(HCollection hcollection, dmhash_t resource_hash)
     {
         Collection* collection = hcollection->m_Collection;
@@ -352,6 +376,8 @@ namespace dmGameObject
     {
         Collection* collection = new Collection(0, 0, max_instances, GetInputStackDefaultCapacity(regist));
         collection->m_Mutex = dmMutex::New();
+        collection->m_IncrementalTransforms = regist->m_IncrementalTransforms;
+        collection->m_TransformJobs.m_JobThread = regist->m_TransformJobThread;
 
         for (uint32_t i = 0; i < regist->m_ComponentTypeCount; ++i)
         {
@@ -682,6 +708,7 @@ namespace dmGameObject
         HInstance swap_in_instance = collection->m_Instances[swap_in_index];
         assert(swap_in_instance->m_Index == swap_in_index);
         swap_in_instance->m_LevelIndex = level_index;
+        collection->m_TransformSoADirty = 1;
     }
 
     /*
@@ -712,6 +739,7 @@ namespace dmGameObject
         level.SetSize(level_index + 1);
         level[level_index] = instance->m_Index;
         instance->m_LevelIndex = level_index;
+        collection->m_TransformSoADirty = 1;
     }
 
     static HInstance AllocInstance(Prototype* proto, const char* prototype_name) {
@@ -764,6 +792,7 @@ namespace dmGameObject
         collection->m_Instances[instance_index] = instance;
 
         InsertInstanceInLevelIndex(collection, instance);
+        MarkTransformDirty(instance);
 
         return instance;
     }
@@ -1271,6 +1300,7 @@ namespace dmGameObject
             Instance* child = collection->m_Instances[index];
             assert(child->m_Parent == instance->m_Index);
             child->m_Parent = instance->m_Parent;
+            MarkTransformDirty(child);
             index = collection->m_Instances[index]->m_SiblingIndex;
         }
 
@@ -2171,6 +2201,7 @@ namespace dmGameObject
                 if (component_transform && count == 1) {
                     instance->m_Transform = dmTransform::Mul(*component_transform, instance->m_Transform);
                 }
+                MarkTransformDirty(instance);
                 if (count < transform_count)
                 {
                     count += DoSetBoneTransforms(hcollection, 0x0, instance->m_FirstChildIndex, &transforms[count], transform_count - count);
@@ -2484,66 +2515,295 @@ namespace dmGameObject
         }
     }
 
-    void UpdateTransforms(Collection* collection)
+    static inline void CalcWorldTransform(Collection* collection, Instance* instance)
     {
-        DM_PROFILE("UpdateTransforms");
+        Matrix4* trans = &collection->m_WorldTransforms[instance->m_Index];
+        Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
+        uint16_t parent_index = instance->m_Parent;
+        if (parent_index == INVALID_INSTANCE_INDEX)
+        {
+            *trans = own;
+        }
+        else
+        {
+            Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
+            if (collection->m_ScaleAlongZ)
+                *trans = *parent_trans * own;
+            else
+                *trans = dmTransform::MulNoScaleZ(*parent_trans, own);
+        }
+    }
+
+    // Recalculates the world transform of the instance and all of its descendants.
+    // The world transform of the parent must be up to date.
+    static uint32_t UpdateSubTreeTransforms(Collection* collection, Instance* instance)
+    {
+        CheckEuler(instance);
+        CalcWorldTransform(collection, instance);
+        instance->m_TransformDirty = 0;
+        uint32_t count = 1;
+
+        uint32_t index = instance->m_FirstChildIndex;
+        while (index != INVALID_INSTANCE_INDEX)
+        {
+            Instance* child = collection->m_Instances[index];
+            count += UpdateSubTreeTransforms(collection, child);
+            index = child->m_SiblingIndex;
+        }
+        return count;
+    }
 
-        // Calculate world transforms
-        // First root-level instances
-        dmArray<uint16_t>& root_level = collection->m_LevelIndices[0];
-        uint32_t root_count = root_level.Size();
-        for (uint32_t i = 0; i < root_count; ++i)
+    static bool HasDirtyAncestor(Collection* collection, Instance* instance)
+    {
+        uint16_t parent_index = instance->m_Parent;
+        while (parent_index != INVALID_INSTANCE_INDEX)
         {
-            uint16_t index = root_level[i];
-            Instance* instance = collection->m_Instances[index];
+            Instance* parent = collection->m_Instances[parent_index];
+            if (parent->m_TransformDirty)
+                return true;
+            parent_index = parent->m_Parent;
+        }
+        return false;
+    }
+
+    // Only recalculates the sub trees of the instances in m_DirtyTransformIndices.
+    // An instance with a dirty ancestor is skipped, since it is updated along with the sub tree of that ancestor,
+    // which means that the world transform of the parent is always up to date when a sub tree is updated.
+    static uint32_t UpdateTransformsIncremental(Collection* collection)
+    {
+        dmArray<uint16_t>& dirty = collection->m_DirtyTransformIndices;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < dirty.Size(); ++i)
+        {
+            Instance* instance = collection->m_Instances[dirty[i]];
+            // Deleted, or already updated as part of another sub tree
+            if (instance == 0x0 || !instance->m_TransformDirty)
+                continue;
+            if (!HasDirtyAncestor(collection, instance))
+            {
+                count += UpdateSubTreeTransforms(collection, instance);
+            }
+        }
+        dirty.SetSize(0);
+        return count;
+    }
+
+    // All world transforms are recalculated, so the dirty instances only need to be reset
+    static void ClearDirtyTransforms(Collection* collection)
+    {
+        dmArray<uint16_t>& dirty = collection->m_DirtyTransformIndices;
+        for (uint32_t i = 0; i < dirty.Size(); ++i)
+        {
+            Instance* instance = collection->m_Instances[dirty[i]];
+            if (instance != 0x0)
+                instance->m_TransformDirty = 0;
+        }
+        dirty.SetSize(0);
+    }
+
+    // Chunk size when splitting a level to calculate it on several threads. Levels with fewer instances are never split
+    // Must be a multiple of 4, so that the kernel never reads stream entries that are written by another chunk
+    static const uint32_t TRANSFORM_CHUNK_SIZE = 256;
+
+    // Sets up the level ranges of m_TransformSoA. Returns the number of used levels
+    static uint32_t CalcTransformLevelOffsets(Collection* collection)
+    {
+        TransformSoA& soa = collection->m_TransformSoA;
+        soa.m_LevelOffsets.SetSize(0);
+        uint32_t count = 0;
+        uint32_t level_count = 0;
+        for (uint32_t level_i = 0; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+        {
+            uint32_t instance_count = collection->m_LevelIndices[level_i].Size();
+            soa.m_LevelOffsets.Push(count);
+            count += instance_count;
+            if (instance_count > 0)
+                level_count = level_i + 1;
+        }
+        soa.m_LevelOffsets.Push(count);
+        soa.m_Count = count;
+        return level_count;
+    }
+
+    // Gathers the local transforms of the instances [begin, end) in a level into m_TransformSoA
+    static void GatherTransformRange(Collection* collection, uint32_t level_i, uint32_t begin, uint32_t end)
+    {
+        TransformSoA& soa = collection->m_TransformSoA;
+        const dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
+        uint32_t offset = soa.m_LevelOffsets[level_i];
+
+        // The transforms are written in small batches, so that they can be transposed four at a time
+        const uint32_t batch_size = 64;
+        const dmTransform::Transform* transforms[batch_size];
+        uint16_t parents[batch_size];
+        for (uint32_t batch_begin = begin; batch_begin < end; batch_begin += batch_size)
+        {
+            uint32_t count = dmMath::Min(batch_size, end - batch_begin);
+            const uint16_t* indices = &level[batch_begin];
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Instance* instance = collection->m_Instances[indices[i]];
+                CheckEuler(instance);
+                uint16_t parent_index = instance->m_Parent;
+                assert((level_i == 0) == (parent_index == INVALID_INSTANCE_INDEX));
+                transforms[i] = &instance->m_Transform;
+                parents[i] = parent_index;
+            }
+            soa.SetTransforms(offset + batch_begin, transforms, indices, parents, count);
+        }
+    }
+
+    // Writes the local transforms of the dirty instances to m_TransformSoA, when the levels are unchanged since the last update
+    static void UpdateDirtyTransformSoA(Collection* collection)
+    {
+        TransformSoA& soa = collection->m_TransformSoA;
+        const dmArray<uint16_t>& dirty = collection->m_DirtyTransformIndices;
+        for (uint32_t i = 0; i < dirty.Size(); ++i)
+        {
+            Instance* instance = collection->m_Instances[dirty[i]];
+            if (instance == 0x0 || !instance->m_TransformDirty)
+                continue;
             CheckEuler(instance);
-            collection->m_WorldTransforms[index] = dmTransform::ToMatrix4(instance->m_Transform);
-            uint16_t parent_index = instance->m_Parent;
-            assert(parent_index == INVALID_INSTANCE_INDEX);
+            soa.Set(soa.m_LevelOffsets[instance->m_Depth] + instance->m_LevelIndex, instance->m_Transform, instance->m_Index, instance->m_Parent);
         }
+    }
 
+    // Calculates the world transforms of the instances [begin, end) in a level, gathering their local transforms first if the levels have changed.
+    // The parent level must be calculated. Different ranges may be calculated on different threads
+    static void UpdateTransformRange(Collection* collection, uint32_t level_i, uint32_t begin, uint32_t end)
+    {
+        if (collection->m_TransformSoADirty)
+        {
+            GatherTransformRange(collection, level_i, begin, end);
+        }
+        uint32_t offset = collection->m_TransformSoA.m_LevelOffsets[level_i];
+        CalcWorldTransformsSoA(collection->m_TransformSoA, offset + begin, offset + end, level_i > 0, collection->m_ScaleAlongZ != 0, collection->m_WorldTransforms.Begin());
+    }
 
-        if (collection->m_ScaleAlongZ) {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+    // Claims the next chunk of the current level. Returns false when all chunks are claimed
+    static bool ClaimTransformChunk(TransformJobs& jobs, uint32_t* chunk)
+    {
+        while (true)
+        {
+            int32_t claim = dmAtomicGet32(&jobs.m_Claim);
+            uint32_t next = claim & 0xffff;
+            uint32_t chunk_count = ((uint32_t) claim) >> 16;
+            if (next >= chunk_count)
+                return false;
+            if (dmAtomicCompareStore32(&jobs.m_Claim, claim + 1, claim) == claim)
             {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
-                {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
+                *chunk = next;
+                return true;
+            }
+        }
+    }
 
-                    uint16_t parent_index = instance->m_Parent;
-                    assert(parent_index != INVALID_INSTANCE_INDEX);
+    static void ProcessTransformChunks(Collection* collection)
+    {
+        TransformJobs& jobs = collection->m_TransformJobs;
+        uint32_t chunk;
+        while (ClaimTransformChunk(jobs, &chunk))
+        {
+            // The level can't change until this chunk is done
+            uint32_t level_i = (uint32_t) dmAtomicGet32(&jobs.m_Level);
+            uint32_t begin = chunk * TRANSFORM_CHUNK_SIZE;
+            uint32_t end = dmMath::Min(begin + TRANSFORM_CHUNK_SIZE, collection->m_LevelIndices[level_i].Size());
+            UpdateTransformRange(collection, level_i, begin, end);
+        }
+    }
 
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = *parent_trans * own;
-                }
+    static int TransformJob(void* context, void* data)
+    {
+        DM_PROFILE("TransformJob");
+        // Returns when there are no chunks left to claim in the current level
+        ProcessTransformChunks((Collection*) context);
+        return 0;
+    }
+
+    static void UpdateTransformsParallel(Collection* collection, uint32_t level_count)
+    {
+        TransformJobs& jobs = collection->m_TransformJobs;
+        uint32_t worker_count = dmJobThread::GetWorkerCount(jobs.m_JobThread);
+        for (uint32_t level_i = 0; level_i < level_count; ++level_i)
+        {
+            uint32_t instance_count = collection->m_LevelIndices[level_i].Size();
+            uint32_t chunk_count = (instance_count + TRANSFORM_CHUNK_SIZE - 1) / TRANSFORM_CHUNK_SIZE;
+            if (chunk_count < 2)
+            {
+                UpdateTransformRange(collection, level_i, 0, instance_count);
+                continue;
             }
-        } else {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+
+            // The jobs of the previous level are done at this point, so no thread reads the level until the chunks are published
+            dmAtomicStore32(&jobs.m_Level, level_i);
+            dmAtomicStore32(&jobs.m_Claim, chunk_count << 16);
+
+            // One root job with a child job per additional worker, the calling thread processes chunks as well
+            uint32_t job_count = dmMath::Min(worker_count, chunk_count - 1);
+            dmJobThread::HJob root = dmJobThread::CreateJob(jobs.m_JobThread, TransformJob, collection, 0, dmJobThread::INVALID_JOB);
+            if (root != dmJobThread::INVALID_JOB)
             {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
+                for (uint32_t i = 1; i < job_count; ++i)
                 {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
+                    dmJobThread::HJob job = dmJobThread::CreateJob(jobs.m_JobThread, TransformJob, collection, 0, root);
+                    if (job == dmJobThread::INVALID_JOB)
+                        break;
+                    dmJobThread::RunJob(jobs.m_JobThread, job);
+                }
+                dmJobThread::RunJob(jobs.m_JobThread, root);
+            }
+            ProcessTransformChunks(collection);
+
+            // Wait for the chunks claimed by the jobs, since the next level depends on them.
+            // A job that hasn't started yet finds no chunks left, and is run by the waiting thread if no worker took it.
+            if (root != dmJobThread::INVALID_JOB)
+            {
+                DM_PROFILE("WaitForTransformJobs");
+                dmJobThread::WaitJob(jobs.m_JobThread, root);
+            }
+        }
+    }
 
-                    uint16_t parent_index = instance->m_Parent;
-                    assert(parent_index != INVALID_INSTANCE_INDEX);
+    static uint32_t UpdateTransformsFull(Collection* collection)
+    {
+        uint32_t level_count = CalcTransformLevelOffsets(collection);
+        if (!collection->m_TransformSoADirty)
+        {
+            UpdateDirtyTransformSoA(collection);
+        }
 
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = dmTransform::MulNoScaleZ(*parent_trans, own);
-                }
+        // Instances in a level only depend on the previous level, so each level is processed as one batch
+        dmJobThread::HContext job_thread = collection->m_TransformJobs.m_JobThread;
+        if (job_thread && dmJobThread::GetWorkerCount(job_thread) > 0)
+        {
+            UpdateTransformsParallel(collection, level_count);
+        }
+        else
+        {
+            for (uint32_t level_i = 0; level_i < level_count; ++level_i)
+            {
+                UpdateTransformRange(collection, level_i, 0, collection->m_LevelIndices[level_i].Size());
             }
         }
+        collection->m_TransformSoADirty = 0;
+        return collection->m_TransformSoA.m_Count;
+    }
+
+    void UpdateTransforms(Collection* collection)
+    {
+        DM_PROFILE("UpdateTransforms");
+
+        uint32_t count;
+        if (collection->m_IncrementalTransforms)
+        {
+            count = UpdateTransformsIncremental(collection);
+        }
+        else
+        {
+            count = UpdateTransformsFull(collection);
+            ClearDirtyTransforms(collection);
+        }
+        DM_PROPERTY_ADD_U32(rmtp_GOTransforms, count);
 
         collection->m_DirtyTransforms = false;
     }
@@ -3021,6 +3281,7 @@ namespace dmGameObject
     void SetPosition(HInstance instance, Point3 position)
     {
         instance->m_Transform.SetTranslation(Vector3(position));
+        MarkTransformDirty(instance);
     }
 
     Point3 GetPosition(HInstance instance)
@@ -3031,6 +3292,7 @@ namespace dmGameObject
     void SetRotation(HInstance instance, Quat rotation)
     {
         instance->m_Transform.SetRotation(rotation);
+        MarkTransformDirty(instance);
     }
 
     Quat GetRotation(HInstance instance)
@@ -3041,11 +3303,13 @@ namespace dmGameObject
     void SetScale(HInstance instance, float scale)
     {
         instance->m_Transform.SetUniformScale(scale);
+        MarkTransformDirty(instance);
     }
 
     void SetScale(HInstance instance, Vector3 scale)
     {
         instance->m_Transform.SetScale(scale);
+        MarkTransformDirty(instance);
     }
 
     float GetUniformScale(HInstance instance)
@@ -3168,6 +3432,7 @@ namespace dmGameObject
             child->m_Parent = INVALID_INSTANCE_INDEX;
             child->m_Depth = 0;
         }
+        MarkTransformDirty(child);
         InsertInstanceInLevelIndex(collection, child);
 
         int32_t n_steps =  (int32_t) original_child_depth - (int32_t) child->m_Depth;
@@ -3259,6 +3524,8 @@ namespace dmGameObject
         if (component_id == 0)
         {
             out_value.m_ValuePtr = 0x0;
+            // The caller may write to the transform through the returned pointer
+            MarkTransformDirty(instance);
 
             // Scale used to be a uniform scalar, but is now a non-uniform 3-component scale
             if (property_id == PROP_SCALE)
@@ -3471,6 +3738,7 @@ namespace dmGameObject
             return PROPERTY_RESULT_INVALID_INSTANCE;
         if (component_id == 0)
         {
+            MarkTransformDirty(instance);
             float* position = instance->m_Transform.GetPositionPtr();
             float* rotation = instance->m_Transform.GetRotationPtr();
             float* scale = instance->m_Transform.GetScalePtr();
@@ -3691,6 +3959,8 @@ namespace dmGameObject
         new_instance->m_EulerRotation = instance->m_EulerRotation;
         new_instance->m_PrevEulerRotation = instance->m_PrevEulerRotation;
         new_instance->m_ScaleAlongZ = instance->m_ScaleAlongZ;
+        // Still in Collection::m_DirtyTransformIndices, since the index is the same
+        new_instance->m_TransformDirty = instance->m_TransformDirty;
         // id-related
         new_instance->m_Identifier = instance->m_Identifier;
         new_instance->m_IdentifierIndex = instance->m_IdentifierIndex;
@@ -21,6 +21,7 @@
 
 #include <dlib/easing.h>
 #include <dlib/hashtable.h>
+#include <dlib/job_thread.h>
 #include <dlib/message.h>
 #include <dlib/transform.h>
 
@@ -46,6 +47,11 @@ namespace dmGameObject
     /// Config key to use for tweaking the maximum capacity of the input stack
     extern const char* COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY;
 
+    /// Config key to use for only recalculating world transforms of changed game objects and their children
+    extern const char* COLLECTION_INCREMENTAL_TRANSFORMS_KEY;
+    /// Config key to calculate world transforms of large hierarchy levels on the job threads
+    extern const char* COLLECTION_PARALLEL_TRANSFORMS_KEY;
+
     extern const dmhash_t UNNAMED_IDENTIFIER;
 
     typedef struct PropertyContainer* HPropertyContainer;
@@ -97,6 +103,24 @@ namespace dmGameObject
      */
     void SetInputStackDefaultCapacity(HRegister regist, uint32_t capacity);
 
+    /**
+     * Set if collections in this register should update world transforms incrementally. This does not affect existing collections.
+     * When enabled, only the world transforms of instances whose local transform (or parent) changed are recalculated,
+     * along with their descendants. Otherwise all world transforms are recalculated whenever any transform is dirty.
+     * @param regist Register
+     * @param enabled true to only recalculate changed sub trees
+     */
+    void SetIncrementalTransforms(HRegister regist, bool enabled);
+
+    /**
+     * Set the job thread used by collections in this register to calculate world transforms in parallel. This does not affect existing collections.
+     * Levels in the hierarchy that are large enough are split into chunks, which are processed by the job threads and the calling thread,
+     * one level at a time. Smaller levels are processed on the calling thread only. Only used when all world transforms are recalculated (see SetIncrementalTransforms).
+     * @param regist Register
+     * @param job_thread Job thread context, or 0 to calculate the world transforms on the calling thread only
+     */
+    void SetTransformJobThread(HRegister regist, dmJobThread::HContext job_thread);
+
     /**
      * Creates a new gameobject collection
      * @param name Collection name, which must be unique and follow the same naming as for sockets
@@ -15,9 +15,11 @@
 #ifndef GAMEOBJECT_COMMON_H
 #define GAMEOBJECT_COMMON_H
 
+#include <dlib/atomic.h>
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/index_pool.h>
+#include <dlib/job_thread.h>
 #include <dlib/math.h>
 #include <dlib/mutex.h>
 #include <dlib/transform.h>
@@ -25,6 +27,7 @@
 #include "gameobject.h"
 #include "gameobject_props.h"
 #include "component.h"
+#include "gameobject_transform_soa.h"
 
 extern "C"
 {
@@ -106,6 +109,7 @@ namespace dmGameObject
             m_ScaleAlongZ = 0;
             m_Bone = 0;
             m_Generated = 0;
+            m_TransformDirty = 0;
             m_Parent = INVALID_INSTANCE_INDEX;
             m_Index = INVALID_INSTANCE_INDEX;
             m_LevelIndex = INVALID_INSTANCE_INDEX;
@@ -149,8 +153,11 @@ namespace dmGameObject
         uint16_t        m_Bone : 1;
         // If this is a generated instance, i.e. if the instance id is uniquely generated
         uint16_t        m_Generated : 1;
+        // If the local transform has changed, or the instance was created or reparented, since the world transform was last calculated.
+        // Set by MarkTransformDirty(), which also adds the instance to Collection::m_DirtyTransformIndices
+        uint16_t        m_TransformDirty : 1;
         // Padding
-        uint16_t        m_Pad : 4;
+        uint16_t        m_Pad : 3;
 
         // Index to parent
         uint16_t        m_Parent : 16;
@@ -201,6 +208,10 @@ namespace dmGameObject
         // Default capacity of collections
         uint32_t                    m_DefaultCollectionCapacity;
         uint32_t                    m_DefaultInputStackCapacity;
+        // Job thread used by new collections to calculate world transforms in parallel (0 to disable)
+        dmJobThread::HContext       m_TransformJobThread;
+        // If new collections should only recalculate world transforms for changed sub trees
+        uint32_t                    m_IncrementalTransforms : 1;
 
         Register();
         ~Register();
@@ -210,6 +221,17 @@ namespace dmGameObject
     // depth is interpreted as up to <depth> levels of child nodes including root-nodes
     // Must be greater than zero
     const uint32_t MAX_HIERARCHICAL_DEPTH = 128;
+
+    // State for calculating the world transforms of one level on the job threads (see UpdateTransformsParallel)
+    // The level is split into chunks, which are claimed by the calling thread and the jobs alike
+    struct TransformJobs
+    {
+        dmJobThread::HContext   m_JobThread;
+        // (chunk count << 16) | next chunk to claim, for the current level
+        int32_atomic_t          m_Claim;
+        int32_atomic_t          m_Level;
+    };
+
     struct Collection
     {
         Collection(dmResource::HFactory factory, HRegister regist, uint32_t max_instances, uint32_t max_input_stack_entries);
@@ -250,6 +272,16 @@ namespace dmGameObject
         // Array of world transforms. Calculated using m_LevelIndices above
         dmArray<Matrix4>         m_WorldTransforms;
 
+        // Local transforms in structure-of-arrays form, grouped by level, used when all world transforms are recalculated.
+        // Kept between updates: only the dirty instances are written, unless the levels have changed (see m_TransformSoADirty)
+        TransformSoA             m_TransformSoA;
+
+        // Instances whose local transform has changed (see Instance::m_TransformDirty), in no particular order.
+        // May contain stale or duplicate indices of deleted instances, which are skipped when the list is processed
+        dmArray<uint16_t>        m_DirtyTransformIndices;
+
+        TransformJobs            m_TransformJobs;
+
         // Identifier to Instance mapping
         dmHashTable64<Instance*> m_IDToInstance;
 
@@ -293,6 +325,10 @@ namespace dmGameObject
         // If the game object dynamically created in this collection should have the Z component of the position affected by scale
         uint32_t                 m_ScaleAlongZ : 1;
         uint32_t                 m_DirtyTransforms : 1;
+        // If instances were added to, removed from or moved in m_LevelIndices, so that all of m_TransformSoA must be gathered again
+        uint32_t                 m_TransformSoADirty : 1;
+        // Only recalculate world transforms of instances whose local transform changed, and their descendants
+        uint32_t                 m_IncrementalTransforms : 1;
         uint32_t                 m_Initialized : 1;
         uint32_t                 m_FirstUpdate : 1;
     };
@@ -302,6 +338,19 @@ namespace dmGameObject
         Collection* m_Collection;
     };
 
+    // Flags the world transform of the instance (and its descendants) to be recalculated in the next UpdateTransforms()
+    // Must be called whenever Instance::m_Transform or Instance::m_EulerRotation is written, or the instance is reparented
+    inline void MarkTransformDirty(Instance* instance)
+    {
+        if (instance->m_TransformDirty)
+            return;
+        instance->m_TransformDirty = 1;
+        dmArray<uint16_t>& dirty = instance->m_Collection->m_DirtyTransformIndices;
+        if (dirty.Full())
+            dirty.OffsetCapacity(64);
+        dirty.Push(instance->m_Index);
+    }
+
     // Used by res_collection.cpp
     HInstance NewInstance(Collection* collection, Prototype* proto, const char* prototype_name);
     HInstance GetInstanceFromIdentifier(Collection* collection, dmhash_t identifier);
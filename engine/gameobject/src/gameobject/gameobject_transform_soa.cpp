@@ -0,0 +1,234 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "gameobject_transform_soa.h"
+
+#include <string.h>
+#include <dlib/simd.h>
+
+namespace dmGameObject
+{
+    using namespace dmSimd;
+
+    // Extra room to allow reading 4 entries at the end of a stream
+    static const uint32_t SOA_PADDING = 3;
+
+    TransformSoA::TransformSoA()
+    : m_Count(0)
+    , m_Capacity(0)
+    {
+    }
+
+    static void SetStreamCapacity(dmArray<float>& stream, uint32_t capacity)
+    {
+        stream.SetCapacity(capacity + SOA_PADDING);
+        stream.SetSize(capacity + SOA_PADDING);
+        // Keep the padding (and unused entries) valid floats
+        for (uint32_t i = 0; i < stream.Size(); ++i)
+            stream[i] = 0.0f;
+    }
+
+    void TransformSoA::SetCapacity(uint32_t capacity)
+    {
+        SetStreamCapacity(m_PosX, capacity);
+        SetStreamCapacity(m_PosY, capacity);
+        SetStreamCapacity(m_PosZ, capacity);
+        SetStreamCapacity(m_RotX, capacity);
+        SetStreamCapacity(m_RotY, capacity);
+        SetStreamCapacity(m_RotZ, capacity);
+        SetStreamCapacity(m_RotW, capacity);
+        SetStreamCapacity(m_ScaleX, capacity);
+        SetStreamCapacity(m_ScaleY, capacity);
+        SetStreamCapacity(m_ScaleZ, capacity);
+        m_Index.SetCapacity(capacity + SOA_PADDING);
+        m_Index.SetSize(capacity + SOA_PADDING);
+        m_Parent.SetCapacity(capacity + SOA_PADDING);
+        m_Parent.SetSize(capacity + SOA_PADDING);
+        m_Count = 0;
+        m_Capacity = capacity;
+    }
+
+    void TransformSoA::SetTransforms(uint32_t offset, const dmTransform::Transform* const* transforms, const uint16_t* indices, const uint16_t* parents, uint32_t count)
+    {
+        assert(offset + count <= m_Capacity);
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const dmTransform::Transform* t0 = transforms[i + 0];
+            const dmTransform::Transform* t1 = transforms[i + 1];
+            const dmTransform::Transform* t2 = transforms[i + 2];
+            const dmTransform::Transform* t3 = transforms[i + 3];
+            uint32_t n = offset + i;
+
+            // Vector3 and Quat are both four floats, the w component of the vectors is ignored
+            Vec4f x = Load(t0->GetPositionPtr());
+            Vec4f y = Load(t1->GetPositionPtr());
+            Vec4f z = Load(t2->GetPositionPtr());
+            Vec4f w = Load(t3->GetPositionPtr());
+            Transpose(x, y, z, w);
+            Store(m_PosX.Begin() + n, x);
+            Store(m_PosY.Begin() + n, y);
+            Store(m_PosZ.Begin() + n, z);
+
+            x = Load(t0->GetRotationPtr());
+            y = Load(t1->GetRotationPtr());
+            z = Load(t2->GetRotationPtr());
+            w = Load(t3->GetRotationPtr());
+            Transpose(x, y, z, w);
+            Store(m_RotX.Begin() + n, x);
+            Store(m_RotY.Begin() + n, y);
+            Store(m_RotZ.Begin() + n, z);
+            Store(m_RotW.Begin() + n, w);
+
+            x = Load(t0->GetScalePtr());
+            y = Load(t1->GetScalePtr());
+            z = Load(t2->GetScalePtr());
+            w = Load(t3->GetScalePtr());
+            Transpose(x, y, z, w);
+            Store(m_ScaleX.Begin() + n, x);
+            Store(m_ScaleY.Begin() + n, y);
+            Store(m_ScaleZ.Begin() + n, z);
+
+            memcpy(m_Index.Begin() + n, indices + i, 4 * sizeof(uint16_t));
+            memcpy(m_Parent.Begin() + n, parents + i, 4 * sizeof(uint16_t));
+        }
+        for (; i < count; ++i)
+        {
+            Set(offset + i, *transforms[i], indices[i], parents[i]);
+        }
+    }
+
+    // Multiplies the column 'c' with the matrix (p0, p1, p2), ignoring the w component of the column
+    static inline Vec4f MulColumn(Vec4f p0, Vec4f p1, Vec4f p2, Vec4f c)
+    {
+        Vec4f v = Mul(p0, SplatX(c));
+        v = MulAdd(p1, SplatY(c), v);
+        return MulAdd(p2, SplatZ(c), v);
+    }
+
+    void CalcWorldTransformsSoA(const TransformSoA& soa, uint32_t begin, uint32_t end, bool has_parent, bool scale_along_z, dmVMath::Matrix4* world_transforms)
+    {
+        const float* pos_x = soa.m_PosX.Begin();
+        const float* pos_y = soa.m_PosY.Begin();
+        const float* pos_z = soa.m_PosZ.Begin();
+        const float* rot_x = soa.m_RotX.Begin();
+        const float* rot_y = soa.m_RotY.Begin();
+        const float* rot_z = soa.m_RotZ.Begin();
+        const float* rot_w = soa.m_RotW.Begin();
+        const float* scale_x = soa.m_ScaleX.Begin();
+        const float* scale_y = soa.m_ScaleY.Begin();
+        const float* scale_z = soa.m_ScaleZ.Begin();
+        const uint16_t* indices = soa.m_Index.Begin();
+        const uint16_t* parents = soa.m_Parent.Begin();
+        float* world = (float*) world_transforms;
+
+        const Vec4f zero = Zero();
+        const Vec4f one = Splat(1.0f);
+
+        for (uint32_t i = begin; i < end; i += 4)
+        {
+            uint32_t lanes = end - i;
+            if (lanes > 4)
+                lanes = 4;
+
+            // Local transform, same operation order as Matrix3(Quat) and appendScale in vectormath
+            Vec4f qx = Load(rot_x + i);
+            Vec4f qy = Load(rot_y + i);
+            Vec4f qz = Load(rot_z + i);
+            Vec4f qw = Load(rot_w + i);
+            Vec4f qx2 = Add(qx, qx);
+            Vec4f qy2 = Add(qy, qy);
+            Vec4f qz2 = Add(qz, qz);
+            Vec4f qxqx2 = Mul(qx, qx2);
+            Vec4f qxqy2 = Mul(qx, qy2);
+            Vec4f qxqz2 = Mul(qx, qz2);
+            Vec4f qxqw2 = Mul(qw, qx2);
+            Vec4f qyqy2 = Mul(qy, qy2);
+            Vec4f qyqz2 = Mul(qy, qz2);
+            Vec4f qyqw2 = Mul(qw, qy2);
+            Vec4f qzqz2 = Mul(qz, qz2);
+            Vec4f qzqw2 = Mul(qw, qz2);
+
+            Vec4f sx = Load(scale_x + i);
+            Vec4f sy = Load(scale_y + i);
+            Vec4f sz = Load(scale_z + i);
+
+            // local[column][row]
+            Vec4f local[3][3];
+            local[0][0] = Mul(Sub(Sub(one, qyqy2), qzqz2), sx);
+            local[0][1] = Mul(Add(qxqy2, qzqw2), sx);
+            local[0][2] = Mul(Sub(qxqz2, qyqw2), sx);
+            local[1][0] = Mul(Sub(qxqy2, qzqw2), sy);
+            local[1][1] = Mul(Sub(Sub(one, qxqx2), qzqz2), sy);
+            local[1][2] = Mul(Add(qyqz2, qxqw2), sy);
+            local[2][0] = Mul(Add(qxqz2, qyqw2), sz);
+            local[2][1] = Mul(Sub(qyqz2, qxqw2), sz);
+            local[2][2] = Mul(Sub(Sub(one, qxqx2), qyqy2), sz);
+
+            Vec4f tx = Load(pos_x + i);
+            Vec4f ty = Load(pos_y + i);
+            Vec4f tz = Load(pos_z + i);
+
+            // Transpose to one column per lane: columns[column][lane]
+            // The w component of the local columns 0-2 is zero, and one for column 3
+            Vec4f columns[4][4];
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                columns[c][0] = local[c][0];
+                columns[c][1] = local[c][1];
+                columns[c][2] = local[c][2];
+                columns[c][3] = zero;
+                Transpose(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+            }
+            columns[3][0] = tx;
+            columns[3][1] = ty;
+            columns[3][2] = tz;
+            columns[3][3] = one;
+            Transpose(columns[3][0], columns[3][1], columns[3][2], columns[3][3]);
+
+            for (uint32_t l = 0; l < lanes; ++l)
+            {
+                float* out = world + indices[i + l] * 16;
+                if (!has_parent)
+                {
+                    Store(out + 0, columns[0][l]);
+                    Store(out + 4, columns[1][l]);
+                    Store(out + 8, columns[2][l]);
+                    Store(out + 12, columns[3][l]);
+                    continue;
+                }
+
+                // The parent is multiplied in its own (column major) layout, which avoids transposing four parents per iteration
+                const float* parent = (const float*) &world_transforms[parents[i + l]];
+                Vec4f p0 = Load(parent + 0);
+                Vec4f p1 = Load(parent + 4);
+                Vec4f p2 = Load(parent + 8);
+                Vec4f p3 = Load(parent + 12);
+                Store(out + 0, MulColumn(p0, p1, p2, columns[0][l]));
+                Store(out + 4, MulColumn(p0, p1, p2, columns[1][l]));
+                Store(out + 8, MulColumn(p0, p1, p2, columns[2][l]));
+                if (!scale_along_z)
+                {
+                    // See dmTransform::NormalizeZScale, the z axis of the parent is normalized before transforming the translation
+                    Vec4f sq = Mul(p2, p2);
+                    Vec4f len_sqr = Add(Add(Add(SplatX(sq), SplatY(sq)), SplatZ(sq)), SplatW(sq));
+                    Vec4f mask = CmpGt(len_sqr, zero);
+                    Vec4f inv_len = Div(one, Sqrt(Select(mask, len_sqr, one)));
+                    p2 = Select(mask, Mul(p2, inv_len), p2);
+                }
+                Store(out + 12, Add(MulColumn(p0, p1, p2, columns[3][l]), p3));
+            }
+        }
+    }
+}
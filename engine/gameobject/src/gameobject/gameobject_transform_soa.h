@@ -0,0 +1,93 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_GAMEOBJECT_TRANSFORM_SOA_H
+#define DM_GAMEOBJECT_TRANSFORM_SOA_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <dlib/array.h>
+#include <dmsdk/dlib/vmath.h>
+#include <dmsdk/dlib/transform.h>
+
+namespace dmGameObject
+{
+    /*
+     * Structure-of-arrays copy of local transforms, grouped by hierarchical level.
+     * Entries for level L are stored in [m_LevelOffsets[L], m_LevelOffsets[L+1]).
+     * Each stream has room for 3 extra entries, so that the kernels can always read 4 entries at a time.
+     */
+    struct TransformSoA
+    {
+        TransformSoA();
+
+        void SetCapacity(uint32_t capacity);
+        uint32_t Capacity() const { return m_Capacity; }
+
+        // Writes a local transform to the stream index i
+        inline void Set(uint32_t i, const dmTransform::Transform& t, uint16_t index, uint16_t parent)
+        {
+            assert(i < m_Capacity);
+            const float* p = t.GetPositionPtr();
+            const float* r = t.GetRotationPtr();
+            const float* s = t.GetScalePtr();
+            m_PosX.Begin()[i] = p[0];
+            m_PosY.Begin()[i] = p[1];
+            m_PosZ.Begin()[i] = p[2];
+            m_RotX.Begin()[i] = r[0];
+            m_RotY.Begin()[i] = r[1];
+            m_RotZ.Begin()[i] = r[2];
+            m_RotW.Begin()[i] = r[3];
+            m_ScaleX.Begin()[i] = s[0];
+            m_ScaleY.Begin()[i] = s[1];
+            m_ScaleZ.Begin()[i] = s[2];
+            m_Index.Begin()[i] = index;
+            m_Parent.Begin()[i] = parent;
+        }
+
+        // Writes count local transforms to the stream indices [offset, offset + count), four at a time.
+        // Equivalent to calling Set() for each transform. Different ranges may be written from different threads
+        void SetTransforms(uint32_t offset, const dmTransform::Transform* const* transforms, const uint16_t* indices, const uint16_t* parents, uint32_t count);
+
+        dmArray<float>      m_PosX;
+        dmArray<float>      m_PosY;
+        dmArray<float>      m_PosZ;
+        dmArray<float>      m_RotX;
+        dmArray<float>      m_RotY;
+        dmArray<float>      m_RotZ;
+        dmArray<float>      m_RotW;
+        dmArray<float>      m_ScaleX;
+        dmArray<float>      m_ScaleY;
+        dmArray<float>      m_ScaleZ;
+        // Index of the world transform to write
+        dmArray<uint16_t>   m_Index;
+        // Index of the parent world transform (ignored for root level entries)
+        dmArray<uint16_t>   m_Parent;
+        // Level ranges, see above. Only the levels up to the deepest used one are valid
+        dmArray<uint32_t>   m_LevelOffsets;
+        uint32_t            m_Count;
+        uint32_t            m_Capacity;
+    };
+
+    /*
+     * Calculates the world transforms for the entries [begin, end) in the streams.
+     * Four entries are processed per iteration.
+     * Root entries (has_parent == false) get their local transform as world transform, other entries are
+     * multiplied with world_transforms[m_Parent[i]], the same way as in the scalar path (see UpdateTransforms).
+     * The parent transforms must not be written by the same call, i.e. the range must not span several levels.
+     */
+    void CalcWorldTransformsSoA(const TransformSoA& soa, uint32_t begin, uint32_t end, bool has_parent, bool scale_along_z, dmVMath::Matrix4* world_transforms);
+}
+
+#endif // DM_GAMEOBJECT_TRANSFORM_SOA_H
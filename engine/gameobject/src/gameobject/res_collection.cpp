@@ -247,6 +247,8 @@ bail:
         size_t size = sizeof(Collection) + sizeof(CollectionHandle);
         size += collection->m_InstanceIndices.Capacity()*sizeof(uint16_t);
         size += collection->m_WorldTransforms.Capacity()*sizeof(Matrix4);
+        size += collection->m_TransformSoA.m_PosX.Capacity()*(10*sizeof(float)+2*sizeof(uint16_t));
+        size += collection->m_DirtyTransformIndices.Capacity()*sizeof(uint16_t);
         size += collection->m_IDToInstance.Capacity()*(sizeof(Instance*)+sizeof(dmhash_t));
         size += collection->m_InputFocusStack.Capacity()*sizeof(Instance*);
         size += collection->m_Instances.Capacity()*sizeof(Instance*);
@@ -156,14 +156,17 @@ namespace dmGameObject
         // The engine.cpp creates the contexts for some of our our built in types (i.e. same context for some types)
         void* context = ResourceTypeContextGetContextByHash(ctx, ResourceTypeGetNameHash(type));
         assert(context);
-        return (ResourceResult)dmResource::SetupType(ctx,
-                                                    type,
-                                                    context,
-                                                    0,
-                                                    ResLuaCreate,
-                                                    0,
-                                                    ResLuaDestroy,
-                                                    ResLuaRecreate);
+        ResourceResult r = (ResourceResult)dmResource::SetupType(ctx,
+                                                                type,
+                                                                context,
+                                                                0,
+                                                                ResLuaCreate,
+                                                                0,
+                                                                ResLuaDestroy,
+                                                                ResLuaRecreate);
+        // The script data is only parsed, so it can be read directly from a memory mapped archive
+        ResourceTypeSetBorrowBuffer(type, true);
+        return r;
     }
 }
 
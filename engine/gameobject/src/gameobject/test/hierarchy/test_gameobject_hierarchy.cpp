@@ -998,6 +998,207 @@ static void SetProperties(dmGameObject::HInstance instance)
     }
 }
 
+TEST_F(HierarchyTest, TestHierarchyIncrementalTransforms)
+{
+    dmGameObject::Collection* collection = m_Collection->m_Collection;
+    collection->m_IncrementalTransforms = 1;
+
+    // parent
+    // +--child1
+    //   +--child2
+    // other
+    dmGameObject::HInstance parent = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance child1 = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance child2 = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance other = dmGameObject::New(m_Collection, "/go.goc");
+
+    dmGameObject::SetParent(child1, parent);
+    dmGameObject::SetParent(child2, child1);
+    dmGameObject::SetPosition(parent, Point3(1, 0, 0));
+    dmGameObject::SetPosition(child1, Point3(0, 1, 0));
+    dmGameObject::SetPosition(child2, Point3(0, 0, 1));
+    dmGameObject::SetPosition(other, Point3(5, 5, 5));
+
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(1, 1, 1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(other) - Point3(5, 5, 5)), EPSILON);
+
+    // Tag the world transform of the unchanged instance to verify that it isn't recalculated
+    Matrix4 tagged = Matrix4::translation(Vector3(-1, -1, -1));
+    collection->m_WorldTransforms[other->m_Index] = tagged;
+
+    // Moving the parent must update all descendants
+    dmGameObject::SetPosition(parent, Point3(2, 0, 0));
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(parent) - Point3(2, 0, 0)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child1) - Point3(2, 1, 0)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 1, 1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(other) - Point3(-1, -1, -1)), EPSILON);
+    ASSERT_EQ(0u, collection->m_DirtyTransformIndices.Size());
+
+    // Moving a child only updates its sub tree, even if a descendant is dirty as well
+    collection->m_WorldTransforms[parent->m_Index] = tagged;
+    dmGameObject::SetPosition(child2, Point3(0, 0, 2));
+    dmGameObject::SetPosition(child1, Point3(0, 2, 0));
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(parent) - Point3(-1, -1, -1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child1) - Point3(-1, 1, -1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(-1, 1, 1)), EPSILON);
+    collection->m_WorldTransforms[parent->m_Index] = Matrix4::translation(Vector3(2, 0, 0));
+    dmGameObject::SetPosition(child1, Point3(0, 1, 0));
+    dmGameObject::SetPosition(child2, Point3(0, 0, 1));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 1, 1)), EPSILON);
+
+    // Writes through property pointers (e.g. from animations) must also be detected
+    dmGameObject::PropertyDesc desc;
+    dmGameObject::PropertyOptions opt;
+    ASSERT_EQ(dmGameObject::PROPERTY_RESULT_OK, dmGameObject::GetProperty(child1, 0, dmHashString64("position.y"), opt, desc));
+    *desc.m_ValuePtr = 3.0f;
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child1) - Point3(2, 3, 0)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 3, 1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(other) - Point3(-1, -1, -1)), EPSILON);
+
+    // Reparenting must update the world transform even though the local transform is unchanged
+    dmGameObject::SetParent(child2, 0);
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(0, 0, 1)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(other) - Point3(-1, -1, -1)), EPSILON);
+
+    // Children of a deleted parent are reparented to the grand parent
+    dmGameObject::SetParent(child2, child1);
+    dmGameObject::UpdateTransforms(m_Collection);
+    dmGameObject::Delete(m_Collection, child1, false);
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+    dmGameObject::UpdateTransforms(m_Collection);
+
+    ASSERT_EQ(parent, dmGameObject::GetParent(child2));
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 0, 1)), EPSILON);
+
+    dmGameObject::Delete(m_Collection, parent, false);
+    dmGameObject::Delete(m_Collection, child2, false);
+    dmGameObject::Delete(m_Collection, other, false);
+}
+
+TEST_F(HierarchyTest, TestHierarchyParallelTransforms)
+{
+    dmGameObject::Collection* collection = m_Collection->m_Collection;
+
+    // Large enough levels to be split into several chunks
+    const uint32_t root_count = 100;
+    const uint32_t child_count = 900;
+    dmGameObject::HInstance instances[root_count + child_count];
+    for (uint32_t i = 0; i < root_count + child_count; ++i)
+    {
+        instances[i] = dmGameObject::New(m_Collection, "/go.goc");
+        ASSERT_NE((void*)0, instances[i]);
+        dmGameObject::SetPosition(instances[i], Point3((float)i, (float)(i % 7), 1.0f));
+        dmGameObject::SetRotation(instances[i], Quat::rotationZ(i * 0.01f));
+        dmGameObject::SetScale(instances[i], Vector3(1.0f + (i % 3), 1.0f, 2.0f));
+        if (i >= root_count)
+        {
+            dmGameObject::SetParent(instances[i], instances[i % root_count]);
+        }
+    }
+
+    dmGameObject::UpdateTransforms(m_Collection);
+    Matrix4 expected[root_count + child_count];
+    for (uint32_t i = 0; i < root_count + child_count; ++i)
+    {
+        expected[i] = dmGameObject::GetWorldMatrix(instances[i]);
+        collection->m_WorldTransforms[instances[i]->m_Index] = Matrix4::identity();
+    }
+
+    // Fewer workers than chunks
+    for (uint8_t thread_count = 1; thread_count <= 2; ++thread_count)
+    {
+        dmJobThread::JobThreadCreationParams job_thread_params;
+        job_thread_params.m_ThreadNames[0] = "TransformJob";
+        job_thread_params.m_ThreadNames[1] = "TransformJob";
+        job_thread_params.m_ThreadCount = thread_count;
+        dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+        collection->m_TransformJobs.m_JobThread = job_thread;
+
+        for (uint32_t iteration = 0; iteration < 10; ++iteration)
+        {
+            dmGameObject::UpdateTransforms(m_Collection);
+            for (uint32_t i = 0; i < root_count + child_count; ++i)
+            {
+                ASSERT_EQ(0, memcmp(&expected[i], &dmGameObject::GetWorldMatrix(instances[i]), sizeof(Matrix4)));
+                collection->m_WorldTransforms[instances[i]->m_Index] = Matrix4::identity();
+            }
+            dmJobThread::Update(job_thread);
+        }
+
+        collection->m_TransformJobs.m_JobThread = 0;
+        dmJobThread::Destroy(job_thread);
+    }
+
+    for (uint32_t i = 0; i < root_count + child_count; ++i)
+    {
+        dmGameObject::Delete(m_Collection, instances[i], false);
+    }
+}
+
+TEST_F(HierarchyTest, TestHierarchyPersistentTransformSoA)
+{
+    dmGameObject::Collection* collection = m_Collection->m_Collection;
+
+    // parent
+    // +--child1
+    // +--child2
+    dmGameObject::HInstance parent = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance child1 = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance child2 = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::SetParent(child1, parent);
+    dmGameObject::SetParent(child2, parent);
+    dmGameObject::SetPosition(parent, Point3(1, 0, 0));
+    dmGameObject::SetPosition(child1, Point3(0, 1, 0));
+    dmGameObject::SetPosition(child2, Point3(0, 0, 1));
+
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_FALSE(collection->m_TransformSoADirty);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(1, 0, 1)), EPSILON);
+
+    // Only the moved instance is written to the streams, the other world transforms are still recalculated
+    dmGameObject::SetPosition(child1, Point3(0, 2, 0));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_FALSE(collection->m_TransformSoADirty);
+    ASSERT_EQ(0u, collection->m_DirtyTransformIndices.Size());
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child1) - Point3(1, 2, 0)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(1, 0, 1)), EPSILON);
+
+    dmGameObject::SetPosition(parent, Point3(2, 0, 0));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child1) - Point3(2, 2, 0)), EPSILON);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 0, 1)), EPSILON);
+
+    // Changing the levels gathers all transforms again
+    dmGameObject::SetParent(child2, child1);
+    ASSERT_TRUE(collection->m_TransformSoADirty);
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 2, 1)), EPSILON);
+
+    dmGameObject::Delete(m_Collection, child1, false);
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 0, 1)), EPSILON);
+
+    dmGameObject::SetPosition(child2, Point3(0, 0, 3));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_FALSE(collection->m_TransformSoADirty);
+    ASSERT_NEAR(0.0f, length(dmGameObject::GetWorldPosition(child2) - Point3(2, 0, 3)), EPSILON);
+
+    dmGameObject::Delete(m_Collection, parent, false);
+    dmGameObject::Delete(m_Collection, child2, false);
+}
+
 // Testing the debug inspection api
 TEST_F(HierarchyTest, TestIterateHierarchy)
 {
@@ -0,0 +1,267 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <jc_test/jc_test.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlib/array.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <dlib/transform.h>
+#include "../gameobject_transform_soa.h"
+
+using namespace dmVMath;
+
+// Compares the structure-of-arrays transform kernel with the scalar path in dmGameObject::UpdateTransforms.
+// The streams are either gathered from all instances (after the levels have changed), or kept and only written for
+// the instances that moved (DIRTY_PERCENT of them), as when the hierarchy is unchanged between updates.
+// The instance count is not limited by the collection capacity here, since the kernel works on plain arrays.
+
+static const uint32_t INVALID_INDEX = 0xffff;
+static const uint32_t LEVEL_COUNT = 4;
+static const uint32_t ITERATIONS = 20;
+static const uint32_t DIRTY_PERCENT = 10;
+
+// Mimics the parts of dmGameObject::Instance that the scalar path reads. Allocated individually to keep the pointer chasing
+struct TestInstance
+{
+    dmTransform::Transform m_Transform;
+    Vector3                m_EulerRotation;
+    Vector3                m_PrevEulerRotation;
+    void*                  m_Padding[8];
+    uint16_t               m_Parent;
+};
+
+class TransformPerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        srand(1234);
+    }
+
+    virtual void TearDown()
+    {
+        for (uint32_t i = 0; i < m_Instances.Size(); ++i)
+            delete m_Instances[i];
+        m_Instances.SetSize(0);
+    }
+
+    static float Rand(float min, float max)
+    {
+        return min + (max - min) * (rand() / (float) RAND_MAX);
+    }
+
+    // Creates instance_count instances spread over LEVEL_COUNT levels, where every instance has a random parent in the previous level
+    void Setup(uint32_t instance_count)
+    {
+        m_Instances.SetCapacity(instance_count);
+        m_Instances.SetSize(instance_count);
+        for (uint32_t l = 0; l < LEVEL_COUNT + 1; ++l)
+        {
+            m_LevelOffsets[l] = (instance_count * l) / LEVEL_COUNT;
+        }
+
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            TestInstance* instance = new TestInstance;
+            Quat rotation = normalize(Quat(Rand(-1, 1), Rand(-1, 1), Rand(-1, 1), Rand(-1, 1)));
+            instance->m_Transform = dmTransform::Transform(Vector3(Rand(-100, 100), Rand(-100, 100), Rand(-100, 100)), rotation, Vector3(Rand(0.5f, 2.0f), Rand(0.5f, 2.0f), Rand(0.5f, 2.0f)));
+            instance->m_Parent = INVALID_INDEX;
+            m_Instances[i] = instance;
+        }
+
+        for (uint32_t l = 1; l < LEVEL_COUNT; ++l)
+        {
+            uint32_t parent_begin = m_LevelOffsets[l - 1];
+            uint32_t parent_count = m_LevelOffsets[l] - parent_begin;
+            for (uint32_t i = m_LevelOffsets[l]; i < m_LevelOffsets[l + 1]; ++i)
+            {
+                m_Instances[i]->m_Parent = (uint16_t) (parent_begin + rand() % parent_count);
+            }
+        }
+
+        m_WorldScalar.SetCapacity(instance_count);
+        m_WorldScalar.SetSize(instance_count);
+        m_WorldSoA.SetCapacity(instance_count);
+        m_WorldSoA.SetSize(instance_count);
+        m_SoA.SetCapacity(instance_count);
+    }
+
+    // Same as the scalar path that was used in dmGameObject::UpdateTransforms
+    void UpdateScalar(bool scale_along_z)
+    {
+        for (uint32_t i = m_LevelOffsets[0]; i < m_LevelOffsets[1]; ++i)
+        {
+            m_WorldScalar[i] = dmTransform::ToMatrix4(m_Instances[i]->m_Transform);
+        }
+        for (uint32_t l = 1; l < LEVEL_COUNT; ++l)
+        {
+            for (uint32_t i = m_LevelOffsets[l]; i < m_LevelOffsets[l + 1]; ++i)
+            {
+                TestInstance* instance = m_Instances[i];
+                Matrix4* parent_trans = &m_WorldScalar[instance->m_Parent];
+                Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
+                if (scale_along_z)
+                    m_WorldScalar[i] = *parent_trans * own;
+                else
+                    m_WorldScalar[i] = dmTransform::MulNoScaleZ(*parent_trans, own);
+            }
+        }
+    }
+
+    // Copies the local transforms into the streams, as in dmGameObject::UpdateTransforms
+    void Gather()
+    {
+        const uint32_t batch_size = 64;
+        const dmTransform::Transform* transforms[batch_size];
+        uint16_t indices[batch_size];
+        uint16_t parents[batch_size];
+        uint32_t instance_count = m_Instances.Size();
+        for (uint32_t batch_begin = 0; batch_begin < instance_count; batch_begin += batch_size)
+        {
+            uint32_t count = dmMath::Min(batch_size, instance_count - batch_begin);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                TestInstance* instance = m_Instances[batch_begin + i];
+                transforms[i] = &instance->m_Transform;
+                indices[i] = (uint16_t) (batch_begin + i);
+                parents[i] = instance->m_Parent;
+            }
+            m_SoA.SetTransforms(batch_begin, transforms, indices, parents, count);
+        }
+        m_SoA.m_Count = instance_count;
+    }
+
+    // Moves every n:th instance, and writes it to the streams, as in dmGameObject::UpdateTransforms when the levels are unchanged
+    void UpdateDirty(uint32_t iteration)
+    {
+        uint32_t instance_count = m_Instances.Size();
+        uint32_t step = 100 / DIRTY_PERCENT;
+        for (uint32_t i = iteration % step; i < instance_count; i += step)
+        {
+            TestInstance* instance = m_Instances[i];
+            instance->m_Transform.SetTranslation(instance->m_Transform.GetTranslation() + Vector3(0.01f, 0.0f, 0.0f));
+            m_SoA.Set(i, instance->m_Transform, (uint16_t) i, instance->m_Parent);
+        }
+    }
+
+    void Kernel(bool scale_along_z)
+    {
+        for (uint32_t l = 0; l < LEVEL_COUNT; ++l)
+        {
+            dmGameObject::CalcWorldTransformsSoA(m_SoA, m_LevelOffsets[l], m_LevelOffsets[l + 1], l > 0, scale_along_z, m_WorldSoA.Begin());
+        }
+    }
+
+    void Run(uint32_t instance_count, bool scale_along_z)
+    {
+        Setup(instance_count);
+
+        UpdateScalar(scale_along_z);
+        Gather();
+        Kernel(scale_along_z);
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                for (uint32_t r = 0; r < 4; ++r)
+                {
+                    ASSERT_NEAR(m_WorldScalar[i].getElem(c, r), m_WorldSoA[i].getElem(c, r), 0.0001f);
+                }
+            }
+        }
+
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t i = 0; i < ITERATIONS; ++i)
+            UpdateScalar(scale_along_z);
+        uint64_t scalar_time = dmTime::GetTime() - start;
+
+        uint64_t gather_time = 0;
+        uint64_t kernel_time = 0;
+        for (uint32_t i = 0; i < ITERATIONS; ++i)
+        {
+            start = dmTime::GetTime();
+            Gather();
+            uint64_t mid = dmTime::GetTime();
+            Kernel(scale_along_z);
+            gather_time += mid - start;
+            kernel_time += dmTime::GetTime() - mid;
+        }
+        uint64_t soa_time = gather_time + kernel_time;
+
+        start = dmTime::GetTime();
+        for (uint32_t i = 0; i < ITERATIONS; ++i)
+        {
+            UpdateDirty(i);
+            Kernel(scale_along_z);
+        }
+        uint64_t persistent_time = dmTime::GetTime() - start;
+
+        // The streams must match the moved instances
+        UpdateScalar(scale_along_z);
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                for (uint32_t r = 0; r < 4; ++r)
+                {
+                    ASSERT_NEAR(m_WorldScalar[i].getElem(c, r), m_WorldSoA[i].getElem(c, r), 0.001f);
+                }
+            }
+        }
+
+        printf("[%s] %6u instances | scalar: %7.3f ms | soa gathered: %7.3f ms (gather %7.3f ms, kernel %7.3f ms) x%.2f | soa kept (%u%% dirty): %7.3f ms x%.2f\n", scale_along_z ? "scale along z" : "no scale z   ", instance_count,
+                scalar_time * 0.001f / ITERATIONS, soa_time * 0.001f / ITERATIONS, gather_time * 0.001f / ITERATIONS, kernel_time * 0.001f / ITERATIONS,
+                soa_time ? scalar_time / (float) soa_time : 0.0f,
+                DIRTY_PERCENT, persistent_time * 0.001f / ITERATIONS, persistent_time ? scalar_time / (float) persistent_time : 0.0f);
+    }
+
+    dmArray<TestInstance*>          m_Instances;
+    dmArray<Matrix4>                m_WorldScalar;
+    dmArray<Matrix4>                m_WorldSoA;
+    dmGameObject::TransformSoA      m_SoA;
+    uint32_t                        m_LevelOffsets[LEVEL_COUNT + 1];
+};
+
+TEST_F(TransformPerfTest, ScaleAlongZ_1k)
+{
+    Run(1000, true);
+}
+
+TEST_F(TransformPerfTest, ScaleAlongZ_10k)
+{
+    Run(10000, true);
+}
+
+TEST_F(TransformPerfTest, ScaleAlongZ_60k)
+{
+    Run(60000, true);
+}
+
+TEST_F(TransformPerfTest, NoScaleZ_1k)
+{
+    Run(1000, false);
+}
+
+TEST_F(TransformPerfTest, NoScaleZ_10k)
+{
+    Run(10000, false);
+}
+
+TEST_F(TransformPerfTest, NoScaleZ_60k)
+{
+    Run(60000, false);
+}
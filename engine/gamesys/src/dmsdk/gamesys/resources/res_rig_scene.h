@@ -31,6 +31,7 @@ namespace dmGameSystem
     struct RigSceneResource
     {
         dmArray<dmRig::RigBone> m_BindPose;
+        dmRig::TrackBoneIndices m_TrackBoneIndices;
         dmRigDDF::RigScene*     m_RigScene;
 
         SkeletonResource*       m_SkeletonRes;
@@ -146,6 +146,7 @@ namespace dmGameSystem
 
         dmRig::NewContextParams rig_params = {0};
         rig_params.m_MaxRigInstanceCount = comp_count;
+        rig_params.m_PoseCache = context->m_PoseCache;
         dmRig::Result rr = dmRig::NewContext(rig_params, &world->m_RigContext);
         if (rr != dmRig::RESULT_OK)
         {
@@ -649,6 +650,7 @@ namespace dmGameSystem
         {
             create_params.m_BoneIndices      = rig_resource->m_SkeletonRes == 0x0 ? 0x0 : &rig_resource->m_SkeletonRes->m_BoneIndices;
             create_params.m_AnimationSet     = rig_resource->m_AnimationSetRes == 0x0 ? 0x0 : rig_resource->m_AnimationSetRes->m_AnimationSet;
+            create_params.m_TrackBoneIndices = &rig_resource->m_TrackBoneIndices;
         }
         else
         {
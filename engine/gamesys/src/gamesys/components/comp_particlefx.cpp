@@ -79,6 +79,9 @@ namespace dmGameSystem
         dmParticle::HParticleContext            m_ParticleContext;
         dmRender::HBufferedRenderBuffer         m_VertexBuffer;
         dmArray<uint8_t>                        m_VertexBufferData;
+        // Emitters of the current render batch, see RenderBatch
+        dmArray<dmParticle::EmitterVertexData>  m_EmitterVertexData;
+        dmArray<dmGraphics::VertexAttributeInfos> m_EmitterAttributeInfos;
         uint32_t                                m_VerticesWritten;
         uint32_t                                m_EmitterCount;
         uint32_t                                m_DispatchCount;
@@ -95,6 +98,7 @@ namespace dmGameSystem
         world->m_Context = ctx;
         uint32_t particle_fx_count = dmMath::Min(params.m_MaxComponentInstances, ctx->m_MaxParticleFXCount);
         world->m_ParticleContext = dmParticle::CreateContext(ctx->m_MaxParticleFXCount, ctx->m_MaxParticleCount);
+        dmParticle::SetContextJobThread(world->m_ParticleContext, ctx->m_JobThread);
         world->m_Components.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetSize(particle_fx_count);
@@ -293,24 +297,46 @@ namespace dmGameSystem
         uint32_t vb_size      = vb_size_init;
         uint32_t vb_max_size  = pfx_world->m_VertexBufferData.Capacity();
 
-        dmGraphics::VertexAttributeInfos emitter_attribute_info = {};
         dmGraphics::VertexAttributeInfos material_attribute_info;
         FillMaterialAttributeInfos(material_res->m_Material, vx_decl, &material_attribute_info);
 
-        for (uint32_t *i = begin; i != end; ++i)
+        // The vertex data of the emitters is generated in one go, so that it can be done in parallel (see dmParticle::SetContextJobThread)
+        uint32_t emitter_count = end - begin;
+        dmArray<dmParticle::EmitterVertexData>& emitter_vertex_data = pfx_world->m_EmitterVertexData;
+        dmArray<dmGraphics::VertexAttributeInfos>& emitter_attribute_infos = pfx_world->m_EmitterAttributeInfos;
+        if (emitter_vertex_data.Capacity() < emitter_count)
+        {
+            emitter_vertex_data.SetCapacity(emitter_count);
+            emitter_attribute_infos.SetCapacity(emitter_count);
+        }
+        emitter_vertex_data.SetSize(emitter_count);
+        emitter_attribute_infos.SetSize(emitter_count);
+
+        for (uint32_t i = 0; i < emitter_count; ++i)
         {
-            const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[*i].m_UserData;
+            const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[begin[i]].m_UserData;
 
+            dmGraphics::VertexAttributeInfos& emitter_attribute_info = emitter_attribute_infos[i];
+            emitter_attribute_info = dmGraphics::VertexAttributeInfos();
             FillAttributeInfos(0, INVALID_DYNAMIC_ATTRIBUTE_INDEX, // Not supported yet
                     emitter_render_data->m_Attributes,
                     emitter_render_data->m_AttributeCount,
                     &material_attribute_info,
                     &emitter_attribute_info);
 
-            dmParticle::GenerateVertexDataResult res = dmParticle::GenerateVertexData(particle_context,
-                pfx_world->m_DT, emitter_render_data->m_Instance, emitter_render_data->m_EmitterIndex,
-                emitter_attribute_info, Vector4(1,1,1,1), (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
+            dmParticle::EmitterVertexData& data = emitter_vertex_data[i];
+            data.m_Instance = emitter_render_data->m_Instance;
+            data.m_EmitterIndex = emitter_render_data->m_EmitterIndex;
+            data.m_AttributeInfos = &emitter_attribute_info;
+            data.m_Color = Vector4(1,1,1,1);
+        }
+
+        dmParticle::GenerateVertexDataBatch(particle_context, pfx_world->m_DT, emitter_vertex_data.Begin(), emitter_count,
+            (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
 
+        for (uint32_t *i = begin; i != end; ++i)
+        {
+            dmParticle::GenerateVertexDataResult res = emitter_vertex_data[i - begin].m_Result;
             if (res != dmParticle::GENERATE_VERTEX_DATA_OK)
             {
                 if (res == dmParticle::GENERATE_VERTEX_DATA_MAX_PARTICLES_EXCEEDED)
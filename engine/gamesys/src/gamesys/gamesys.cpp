@@ -135,6 +135,17 @@ namespace dmGameSystem
 
 #undef REGISTER_RESOURCE_TYPE
 
+        // These types only parse (or copy) their data, so it can be read directly from a memory mapped archive
+        const char* borrow_buffer_types[] = { "wavc", "oggc", "camerac", "lightc", "gamepadsc", "input_bindingc", "factoryc", "labelc" };
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(borrow_buffer_types); ++i)
+        {
+            HResourceType type;
+            if (dmResource::GetTypeFromExtension(factory, borrow_buffer_types[i], &type) == dmResource::RESULT_OK)
+            {
+                ResourceTypeSetBorrowBuffer(type, true);
+            }
+        }
+
         return e;
     }
 
@@ -102,6 +102,8 @@ namespace dmGameSystem
         uint32_t m_MaxParticleFXCount;
         uint32_t m_MaxParticleCount;
         uint32_t m_MaxEmitterCount;
+        // Job thread used to update the emitters in parallel (0 to disable)
+        dmJobThread::HContext m_JobThread;
         bool m_Debug;
     };
 
@@ -133,6 +135,8 @@ namespace dmGameSystem
         dmRender::HRenderContext    m_RenderContext;
         dmResource::HFactory        m_Factory;
         uint32_t                    m_MaxModelCount;
+        // Share the evaluated poses between models playing the same animation
+        bool                        m_PoseCache;
     };
 
     struct SoundContext
@@ -16,6 +16,7 @@
 
 #include <dlib/log.h>
 #include <dmsdk/dlib/vmath.h>
+#include <rig/rig.h>
 
 namespace dmGameSystem
 {
@@ -23,6 +24,8 @@ namespace dmGameSystem
 
     dmResource::Result AcquireResources(dmResource::HFactory factory, MeshSetResource* resource, const char* filename)
     {
+        // The skinning expects four normalized bone influences per vertex
+        dmRig::NormalizeBoneWeights(*resource->m_MeshSet);
         return dmResource::RESULT_OK;
     }
 
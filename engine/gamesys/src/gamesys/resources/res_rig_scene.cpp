@@ -90,6 +90,14 @@ namespace dmGameSystem
         {
             dmRig::CopyBindPose(*resource->m_SkeletonRes->m_Skeleton, resource->m_BindPose);
         }
+        if (result == dmResource::RESULT_OK && resource->m_SkeletonRes && resource->m_AnimationSetRes)
+        {
+            dmRig::CreateTrackBoneIndices(*resource->m_SkeletonRes->m_Skeleton, *resource->m_AnimationSetRes->m_AnimationSet, resource->m_SkeletonRes->m_BoneIndices, resource->m_TrackBoneIndices);
+        }
+        else
+        {
+            resource->m_TrackBoneIndices.m_AnimationSet = 0x0;
+        }
         return result;
     }
 
@@ -113,6 +121,8 @@ namespace dmGameSystem
         uint32_t size = sizeof(RigSceneResource);
         size += ddf_size;
         size += res->m_BindPose.Capacity()*sizeof(dmRig::RigBone);
+        size += res->m_TrackBoneIndices.m_AnimationOffsets.Capacity()*sizeof(uint32_t);
+        size += res->m_TrackBoneIndices.m_BoneIndices.Capacity()*sizeof(uint32_t);
         return size;
     }
 
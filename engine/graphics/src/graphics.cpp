@@ -35,6 +35,16 @@ namespace dmGraphics
     static GraphicsAdapter*             g_adapter_list = 0;
     static GraphicsAdapter*             g_adapter = 0;
     static GraphicsAdapterFunctionTable g_functions;
+    static ResourceChangeCallback       g_resource_change_callback = 0;
+    static void*                        g_resource_change_callback_user_data = 0;
+
+    static inline void OnResourceChange()
+    {
+        if (g_resource_change_callback)
+        {
+            g_resource_change_callback(g_resource_change_callback_user_data);
+        }
+    }
 
     void RegisterGraphicsAdapter(GraphicsAdapter* adapter,
         GraphicsAdapterIsSupportedCb              is_supported_cb,
@@ -562,6 +572,7 @@ namespace dmGraphics
 
     void DeleteVertexDeclaration(HVertexDeclaration vertex_declaration)
     {
+        OnResourceChange();
         delete vertex_declaration;
     }
 
@@ -1128,6 +1139,12 @@ namespace dmGraphics
         g_functions.m_DeleteContext(context);
     }
 
+    void SetResourceChangeCallback(ResourceChangeCallback callback, void* user_data)
+    {
+        g_resource_change_callback           = callback;
+        g_resource_change_callback_user_data = user_data;
+    }
+
     bool InstallAdapter(AdapterFamily family)
     {
         if (g_adapter)
@@ -1249,14 +1266,17 @@ namespace dmGraphics
     }
     void DeleteVertexBuffer(HVertexBuffer buffer)
     {
+        OnResourceChange();
         g_functions.m_DeleteVertexBuffer(buffer);
     }
     void SetVertexBufferData(HVertexBuffer buffer, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        OnResourceChange();
         g_functions.m_SetVertexBufferData(buffer, size, data, buffer_usage);
     }
     void SetVertexBufferSubData(HVertexBuffer buffer, uint32_t offset, uint32_t size, const void* data)
     {
+        OnResourceChange();
         g_functions.m_SetVertexBufferSubData(buffer, offset, size, data);
     }
     uint32_t GetMaxElementsVertices(HContext context)
@@ -1269,14 +1289,17 @@ namespace dmGraphics
     }
     void DeleteIndexBuffer(HIndexBuffer buffer)
     {
+        OnResourceChange();
         g_functions.m_DeleteIndexBuffer(buffer);
     }
     void SetIndexBufferData(HIndexBuffer buffer, uint32_t size, const void* data, BufferUsage buffer_usage)
     {
+        OnResourceChange();
         g_functions.m_SetIndexBufferData(buffer, size, data, buffer_usage);
     }
     void SetIndexBufferSubData(HIndexBuffer buffer, uint32_t offset, uint32_t size, const void* data)
     {
+        OnResourceChange();
         g_functions.m_SetIndexBufferSubData(buffer, offset, size, data);
     }
     bool IsIndexBufferFormatSupported(HContext context, IndexBufferFormat format)
@@ -1337,6 +1360,7 @@ namespace dmGraphics
     }
     void DeleteProgram(HContext context, HProgram program)
     {
+        OnResourceChange();
         g_functions.m_DeleteProgram(context, program);
     }
     bool ReloadVertexProgram(HVertexProgram prog, ShaderDesc::Shader* ddf)
@@ -1349,10 +1373,12 @@ namespace dmGraphics
     }
     void DeleteVertexProgram(HVertexProgram prog)
     {
+        OnResourceChange();
         g_functions.m_DeleteVertexProgram(prog);
     }
     void DeleteFragmentProgram(HFragmentProgram prog)
     {
+        OnResourceChange();
         g_functions.m_DeleteFragmentProgram(prog);
     }
     ShaderDesc::Language GetProgramLanguage(HProgram program)
@@ -1485,6 +1511,7 @@ namespace dmGraphics
     }
     void DeleteRenderTarget(HRenderTarget render_target)
     {
+        OnResourceChange();
         g_functions.m_DeleteRenderTarget(render_target);
     }
     void SetRenderTarget(HContext context, HRenderTarget render_target, uint32_t transient_buffer_types)
@@ -1501,6 +1528,7 @@ namespace dmGraphics
     }
     void SetRenderTargetSize(HRenderTarget render_target, uint32_t width, uint32_t height)
     {
+        OnResourceChange();
         g_functions.m_SetRenderTargetSize(render_target, width, height);
     }
     bool IsTextureFormatSupported(HContext context, TextureFormat format)
@@ -1513,14 +1541,17 @@ namespace dmGraphics
     }
     void DeleteTexture(HTexture t)
     {
+        OnResourceChange();
         g_functions.m_DeleteTexture(t);
     }
     void SetTexture(HTexture texture, const TextureParams& params)
     {
+        OnResourceChange();
         g_functions.m_SetTexture(texture, params);
     }
     void SetTextureAsync(HTexture texture, const TextureParams& params, SetTextureAsyncCallback callback, void* user_data)
     {
+        OnResourceChange();
         g_functions.m_SetTextureAsync(texture, params, callback, user_data);
     }
     void SetTextureParams(HTexture texture, TextureFilter minfilter, TextureFilter magfilter, TextureWrap uwrap, TextureWrap vwrap, float max_anisotropy)
@@ -1630,6 +1661,7 @@ namespace dmGraphics
     }
     void DeleteComputeProgram(HComputeProgram prog)
     {
+        OnResourceChange();
         return g_functions.m_DeleteComputeProgram(prog);
     }
 
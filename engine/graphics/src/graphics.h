@@ -372,6 +372,18 @@ namespace dmGraphics
     AdapterFamily GetAdapterFamily(const char* adapter_name);
     AdapterFamily GetInstalledAdapterFamily();
 
+    typedef void (*ResourceChangeCallback)(void* user_data);
+
+    /**
+     * Set a callback that is called before a graphics object (buffer, texture, render target, program or
+     * vertex declaration) is deleted, or before the data of a buffer, texture or render target is replaced.
+     * Used to wait for a frame that is still being submitted on another thread.
+     * @note The callback is called on the thread changing the object
+     * @param callback Callback, or 0x0 to remove it
+     * @param user_data User data passed to the callback
+     */
+    void SetResourceChangeCallback(ResourceChangeCallback callback, void* user_data);
+
     /**
      * Finalize graphics system
      */
@@ -49,6 +49,8 @@ DM_PROPERTY_U32(rmtp_GuiStaticTextures, 0, FrameReset, "", &rmtp_Gui);
 DM_PROPERTY_U32(rmtp_GuiDynamicTextures, 0, FrameReset, "", &rmtp_Gui);
 DM_PROPERTY_U32(rmtp_GuiTextures, 0, FrameReset, "", &rmtp_Gui);
 DM_PROPERTY_U32(rmtp_GuiParticlefx, 0, FrameReset, "", &rmtp_Gui);
+DM_PROPERTY_U32(rmtp_GuiNodesRecomputed, 0, FrameReset, "# node world transforms calculated", &rmtp_Gui);
+DM_PROPERTY_U32(rmtp_GuiSortsSkipped, 0, FrameReset, "# scenes rendered with the cached render order", &rmtp_Gui);
 DM_PROPERTY_F32(rmtp_GuiDynamicTexturesSizeMb, 0, NoFlags, "size of dynamic tex in Mb", &rmtp_Gui);
 
 namespace dmGui
@@ -353,6 +355,8 @@ namespace dmGui
         scene->m_RenderTail = INVALID_INDEX;
         scene->m_NextVersionNumber = 0;
         scene->m_RenderOrder = 0;
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion = 0;
         scene->m_Width = context->m_DefaultProjectWidth;
         scene->m_Height = context->m_DefaultProjectHeight;
         scene->m_FetchTextureSetAnimCallback = params->m_FetchTextureSetAnimCallback;
@@ -831,6 +835,7 @@ namespace dmGui
         uint64_t layer_hash = dmHashString64(layer_name);
         uint16_t index = scene->m_NextLayerIndex++;
         scene->m_Layers.Put(layer_hash, index);
+        scene->m_RenderEntriesChanged = 1;
         uint32_t n = scene->m_Nodes.Size();
         InternalNode* nodes = scene->m_Nodes.Begin();
         for (uint32_t i = 0; i < n; ++i)
@@ -926,6 +931,8 @@ namespace dmGui
     Result SetLayout(const HScene scene, dmhash_t layout_id, SetNodeCallback set_node_callback)
     {
         scene->m_LayoutId = layout_id;
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
         uint16_t index = GetLayoutIndex(scene, layout_id);
         uint32_t n = scene->m_Nodes.Size();
         InternalNode* nodes = scene->m_Nodes.Begin();
@@ -1183,14 +1190,6 @@ namespace dmGui
         }
     };
 
-    struct RenderEntrySortDisabledPred
-    {
-        bool operator ()(const RenderEntry& a, const RenderEntry& b) const
-        {
-            return a.m_RenderKey < b.m_RenderKey;
-        }
-    };
-
     struct ScopeContext {
         ScopeContext() {
             memset(this, 0, sizeof(*this));
@@ -1432,16 +1431,99 @@ namespace dmGui
         }
         #undef PUSH_RENDER_ENTRY
 
-        DM_PROPERTY_ADD_U32(rmtp_GuiActiveNodes, active_nodes);
+        scene->m_ActiveNodeCount += active_nodes;
         return order;
     }
 
     static void CollectNodes(HScene scene, dmArray<InternalClippingNode>& clippers, dmArray<RenderEntry>& render_entries)
     {
+        scene->m_ActiveNodeCount = 0;
         CollectClippers(scene, scene->m_RenderHead, 0, 0, clippers, INVALID_INDEX);
         CollectRenderEntries(scene, scene->m_RenderHead, 0, clippers, render_entries);
     }
 
+    // Validates the world cache of the node (and its ancestors), and recalculates it if needed.
+    // Returns the number of recalculated nodes.
+    static uint32_t UpdateNodeWorldCache(HScene scene, InternalNode* n)
+    {
+        NodeWorldCache& cache = n->m_WorldCache;
+        uint32_t frame = scene->m_RenderFrame;
+        if (cache.m_VisitFrame == frame)
+        {
+            return 0;
+        }
+        cache.m_VisitFrame = frame;
+
+        uint32_t recomputed = 0;
+        InternalNode* parent = 0x0;
+        if (n->m_ParentIndex != INVALID_INDEX)
+        {
+            parent = &scene->m_Nodes[n->m_ParentIndex];
+            recomputed = UpdateNodeWorldCache(scene, parent);
+        }
+
+        Node& node = n->m_Node;
+        if (node.m_DirtyLocal || (scene->m_ResChanged && scene->m_AdjustReference != ADJUST_REFERENCE_DISABLED))
+        {
+            UpdateLocalTransform(scene, n);
+        }
+
+        float alpha = node.m_Properties[dmGui::PROPERTY_COLOR].getW();
+        if (cache.m_Valid && cache.m_ParentIndex == n->m_ParentIndex && cache.m_Alpha == alpha && cache.m_InheritAlpha == node.m_InheritAlpha &&
+            (parent == 0x0 || parent->m_WorldCache.m_Frame <= cache.m_Frame))
+        {
+            return recomputed;
+        }
+
+        cache.m_Transform = node.m_LocalTransform;
+        cache.m_Opacity = alpha;
+        if (parent != 0x0)
+        {
+            cache.m_Transform = parent->m_WorldCache.m_Transform * cache.m_Transform;
+            if (node.m_InheritAlpha)
+            {
+                cache.m_Opacity *= parent->m_WorldCache.m_Opacity;
+            }
+        }
+
+        cache.m_Alpha = alpha;
+        cache.m_ParentIndex = n->m_ParentIndex;
+        cache.m_InheritAlpha = node.m_InheritAlpha;
+        cache.m_Frame = frame;
+        cache.m_Valid = 1;
+        cache.m_RenderValid = 0;
+        return recomputed + 1;
+    }
+
+    // Same result as CalculateNodeTransformAndAlphaCached with CALCULATE_NODE_INCLUDE_SIZE | CALCULATE_NODE_RESET_PIVOT,
+    // but reuses the transforms calculated in previous frames if nothing has changed
+    static uint32_t GetNodeRenderTransformAndAlpha(HScene scene, InternalNode* n, Matrix4& out_transform, float& out_opacity)
+    {
+        uint32_t recomputed = UpdateNodeWorldCache(scene, n);
+
+        NodeWorldCache& cache = n->m_WorldCache;
+        const Node& node = n->m_Node;
+        const Vector4& size = node.m_Properties[PROPERTY_SIZE];
+        if (!cache.m_RenderValid || cache.m_Size[0] != size.getX() || cache.m_Size[1] != size.getY() || cache.m_Pivot != node.m_Pivot)
+        {
+            Matrix4 transform = node.m_LocalTransform;
+            CalculateNodeExtents(node, CalculateNodeTransformFlags(CALCULATE_NODE_INCLUDE_SIZE | CALCULATE_NODE_RESET_PIVOT), transform);
+            if (n->m_ParentIndex != INVALID_INDEX)
+            {
+                transform = scene->m_Nodes[n->m_ParentIndex].m_WorldCache.m_Transform * transform;
+            }
+            cache.m_RenderTransform = transform;
+            cache.m_Size[0] = size.getX();
+            cache.m_Size[1] = size.getY();
+            cache.m_Pivot = node.m_Pivot;
+            cache.m_RenderValid = 1;
+        }
+
+        out_transform = cache.m_RenderTransform;
+        out_opacity = cache.m_Opacity;
+        return recomputed;
+    }
+
     static inline bool IsVisible(InternalNode* n, float opacity)
     {
         bool use_clipping = n->m_ClipperIndex != INVALID_INDEX;
@@ -1481,9 +1563,53 @@ namespace dmGui
             c->m_SceneTraversalCache.m_Version = 0;
         }
 
-        CollectNodes(scene, c->m_StencilClippingNodes, c->m_RenderNodes);
-        uint32_t node_count = c->m_RenderNodes.Size();
-        std::sort(c->m_RenderNodes.Begin(), c->m_RenderNodes.End(), RenderEntrySortPred());
+        // Frame 0 is never used, so that new nodes don't have a valid world cache
+        if (++scene->m_RenderFrame == 0)
+        {
+            scene->m_RenderFrame = 1;
+        }
+
+        // The render entries only depend on the hierarchy, layers, clipping and enabled state of the nodes,
+        // except for particlefx nodes that have one entry per emitter
+        if (scene->m_RenderEntriesChanged || scene->m_AliveParticlefxs.Size() > 0)
+        {
+            dmArray<RenderEntry>& entries = scene->m_CachedRenderEntries;
+            dmArray<InternalClippingNode>& clippers = scene->m_CachedClippers;
+            entries.SetSize(0);
+            clippers.SetSize(0);
+            if (capacity > entries.Capacity())
+            {
+                entries.SetCapacity(capacity);
+            }
+            if (capacity > clippers.Capacity())
+            {
+                clippers.SetCapacity(capacity);
+            }
+            CollectNodes(scene, clippers, entries);
+            std::sort(entries.Begin(), entries.End(), RenderEntrySortPred());
+            scene->m_RenderEntriesChanged = 0;
+        }
+        else
+        {
+            DM_PROPERTY_ADD_U32(rmtp_GuiSortsSkipped, 1);
+        }
+        DM_PROPERTY_ADD_U32(rmtp_GuiActiveNodes, scene->m_ActiveNodeCount);
+
+        uint32_t node_count = scene->m_CachedRenderEntries.Size();
+        if (node_count > c->m_RenderNodes.Capacity())
+        {
+            c->m_RenderNodes.SetCapacity(node_count);
+        }
+        c->m_RenderNodes.SetSize(node_count);
+        memcpy(c->m_RenderNodes.Begin(), scene->m_CachedRenderEntries.Begin(), sizeof(RenderEntry) * node_count);
+        uint32_t clipper_count = scene->m_CachedClippers.Size();
+        if (clipper_count > c->m_StencilClippingNodes.Capacity())
+        {
+            c->m_StencilClippingNodes.SetCapacity(clipper_count);
+        }
+        c->m_StencilClippingNodes.SetSize(clipper_count);
+        memcpy(c->m_StencilClippingNodes.Begin(), scene->m_CachedClippers.Begin(), sizeof(InternalClippingNode) * clipper_count);
+
         Matrix4 transform;
 
         if (c->m_RenderNodes.Capacity() > c->m_RenderTransforms.Capacity())
@@ -1499,6 +1625,7 @@ namespace dmGui
         }
 
         uint32_t num_pruned = 0;
+        uint32_t num_recomputed = 0;
         for (uint32_t i = 0; i < node_count; ++i)
         {
             RenderEntry& entry = c->m_RenderNodes[i];
@@ -1511,7 +1638,7 @@ namespace dmGui
             // for any late scripting changes
             // Note: We need this update step for bones as well, since they update their transform
             CalculateNodeSize(n);
-            CalculateNodeTransformAndAlphaCached(scene, n, CalculateNodeTransformFlags(CALCULATE_NODE_INCLUDE_SIZE | CALCULATE_NODE_RESET_PIVOT), transform, opacity);
+            num_recomputed += GetNodeRenderTransformAndAlpha(scene, n, transform, opacity);
 
             // Ideally, we'd like to have this update step in the Update function (I'm not even sure why it isn't tbh)
             // But for now, let's prune the list here
@@ -1545,11 +1672,21 @@ namespace dmGui
             }
         }
 
+        // The entries are already sorted, so the pruned ones are removed in place
         if (num_pruned)
         {
-            std::sort(c->m_RenderNodes.Begin(), c->m_RenderNodes.End(), RenderEntrySortDisabledPred());
-            c->m_RenderNodes.SetSize(c->m_RenderNodes.Size() - num_pruned);
+            RenderEntry* entries = c->m_RenderNodes.Begin();
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < node_count; ++i)
+            {
+                if (entries[i].m_Node != INVALID_HANDLE)
+                {
+                    entries[count++] = entries[i];
+                }
+            }
+            c->m_RenderNodes.SetSize(count);
         }
+        DM_PROPERTY_ADD_U32(rmtp_GuiNodesRecomputed, num_recomputed);
 
         scene->m_ResChanged = 0;
         params.m_RenderNodes(scene, c->m_RenderNodes.Begin(), c->m_RenderTransforms.Begin(), c->m_RenderOpacities.Begin(), (const StencilScope**)c->m_StencilScopes.Begin(), c->m_RenderNodes.Size(), context);
@@ -1638,12 +1775,107 @@ namespace dmGui
         }
     }
 
+    // Same as IsNodeEnabledRecursive, but the state is resolved once per node until the nodes change
+    static bool IsNodeEnabledCached(HScene scene, uint8_t* enabled, uint16_t node_index)
+    {
+        uint8_t state = enabled[node_index];
+        if (state == 0)
+        {
+            InternalNode* node = &scene->m_Nodes[node_index];
+            bool node_enabled = node->m_Node.m_Enabled && (node->m_ParentIndex == INVALID_INDEX || IsNodeEnabledCached(scene, enabled, node->m_ParentIndex));
+            state = node_enabled ? 2 : 1;
+            enabled[node_index] = state;
+        }
+        return state == 2;
+    }
+
+    // Evaluates the easing curves of the batched animations, one curve type at a time, and applies the values
+    static void ApplyAnimationBatch(HScene scene, AnimationBatch& batch)
+    {
+        uint32_t count = batch.m_Count;
+        if (count == 0)
+        {
+            return;
+        }
+        batch.m_Count = 0;
+
+        const uint8_t* curve_type = batch.m_CurveType;
+        const float* curve_time = batch.m_CurveTime;
+        float* curve_value = batch.m_CurveValue;
+        uint16_t* order = batch.m_Order;
+        float* sorted_time = batch.m_SortedTime;
+        float* sorted_value = batch.m_SortedValue;
+
+        // Counting sort by curve type. The custom curves (TYPE_FLOAT_VECTOR) end up last
+        uint32_t offsets[dmEasing::TYPE_COUNT + 1];
+        memset(offsets, 0, sizeof(offsets));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            offsets[curve_type[i] + 1]++;
+        }
+        for (uint32_t type = 1; type <= dmEasing::TYPE_COUNT; ++type)
+        {
+            offsets[type] += offsets[type - 1];
+        }
+        uint32_t cursor[dmEasing::TYPE_COUNT];
+        memcpy(cursor, offsets, sizeof(cursor));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t p = cursor[curve_type[i]]++;
+            order[p] = i;
+            sorted_time[p] = curve_time[i];
+        }
+
+        for (uint32_t type = 0; type < dmEasing::TYPE_FLOAT_VECTOR; ++type)
+        {
+            uint32_t type_count = offsets[type + 1] - offsets[type];
+            if (type_count)
+            {
+                dmEasing::GetValues((dmEasing::Type) type, type_count, sorted_time + offsets[type], sorted_value + offsets[type]);
+            }
+        }
+        const dmEasing::Curve** curves = batch.m_Curve;
+        for (uint32_t p = offsets[dmEasing::TYPE_FLOAT_VECTOR]; p < count; ++p)
+        {
+            sorted_value[p] = dmEasing::GetValue(*curves[order[p]], sorted_time[p]);
+        }
+        for (uint32_t p = 0; p < count; ++p)
+        {
+            curve_value[order[p]] = sorted_value[p];
+        }
+
+        float** value = batch.m_Value;
+        const float* from = batch.m_From;
+        const float* delta = batch.m_Delta;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            *value[i] = from[i] + delta[i] * curve_value[i];
+        }
+    }
+
+    static void ResetNodeEnabledCache(HScene scene, AnimationBatch& batch)
+    {
+        dmArray<uint8_t>& enabled = batch.m_NodeEnabled;
+        uint32_t node_count = scene->m_Nodes.Size();
+        if (enabled.Capacity() < node_count)
+        {
+            enabled.SetCapacity(node_count);
+        }
+        enabled.SetSize(node_count);
+        memset(enabled.Begin(), 0, node_count);
+    }
+
     void UpdateAnimations(HScene scene, float dt)
     {
         dmArray<Animation>* animations = &scene->m_Animations;
+        AnimationBatch& batch = scene->m_AnimationBatch;
 
         uint32_t active_animations = 0;
 
+        batch.m_Count = 0;
+        ResetNodeEnabledCache(scene, batch);
+        uint32_t node_state_version = scene->m_NodeStateVersion;
+
         for (uint32_t i = 0; i < animations->Size(); ++i)
         {
             Animation* anim = &(*animations)[i];
@@ -1657,7 +1889,13 @@ namespace dmGui
             {
                 continue;
             }
-            if (!IsNodeEnabledRecursive(scene, anim->m_Node & 0xffff))
+            // A completion callback may have enabled, disabled, moved or deleted nodes
+            if (node_state_version != scene->m_NodeStateVersion)
+            {
+                ResetNodeEnabledCache(scene, batch);
+                node_state_version = scene->m_NodeStateVersion;
+            }
+            if (!IsNodeEnabledCached(scene, batch.m_NodeEnabled.Begin(), anim->m_Node & 0xffff))
             {
                 continue;
             }
@@ -1697,9 +1935,14 @@ namespace dmGui
                     }
                 }
 
-                float x = dmEasing::GetValue(anim->m_Easing, t2);
-
-                *anim->m_Value = anim->m_From + (anim->m_To - anim->m_From) * x;
+                // The value is applied with the rest of the batch
+                uint32_t b = batch.m_Count++;
+                batch.m_Value[b] = anim->m_Value;
+                batch.m_From[b] = anim->m_From;
+                batch.m_Delta[b] = anim->m_To - anim->m_From;
+                batch.m_Curve[b] = &anim->m_Easing;
+                batch.m_CurveTime[b] = t2;
+                batch.m_CurveType[b] = (uint8_t) anim->m_Easing.type;
                 // Flag local transform as dirty for the node
                 scene->m_Nodes[anim->m_Node & 0xffff].m_Node.m_DirtyLocal = 1;
 
@@ -1712,9 +1955,16 @@ namespace dmGui
                             anim->m_Backwards ^= 1;
                         }
                     } else {
+                        // The callback sees the values of all animations before it, and may change the animations
+                        // and the nodes, so the batch is applied first
+                        ApplyAnimationBatch(scene, batch);
                         CompleteAnimation(scene, anim, true);
                     }
                 }
+                if (batch.m_Count == AnimationBatch::MAX_COUNT)
+                {
+                    ApplyAnimationBatch(scene, batch);
+                }
             }
             else
             {
@@ -1722,6 +1972,8 @@ namespace dmGui
             }
         }
 
+        ApplyAnimationBatch(scene, batch);
+
         uint32_t n = animations->Size();
         for (uint32_t i = 0; i < n; ++i)
         {
@@ -2246,6 +2498,7 @@ namespace dmGui
                 dmParticle::DestroyInstance(scene->m_ParticlefxContext, c->m_Instance);
                 scene->m_AliveParticlefxs.EraseSwap(i);
                 --count;
+                scene->m_RenderEntriesChanged = 1;
             }
             else
             {
@@ -2573,6 +2826,8 @@ namespace dmGui
                 *tail = n->m_Index;
             }
         }
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
     }
 
     static void RemoveFromNodeList(HScene scene, InternalNode* n)
@@ -2589,6 +2844,8 @@ namespace dmGui
             *head_ptr = n->m_NextIndex;
         if (*tail_ptr == n->m_Index)
             *tail_ptr = n->m_PrevIndex;
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
     }
 
     static inline void ResetInternalNode(HScene scene, InternalNode* n)
@@ -2632,6 +2889,7 @@ namespace dmGui
                         n->m_Node.m_ParticleInstance = dmParticle::INVALID_INSTANCE;
                         scene->m_AliveParticlefxs.EraseSwap(i);
                         --count;
+                        scene->m_RenderEntriesChanged = 1;
                     }
                     else
                     {
@@ -2695,6 +2953,8 @@ namespace dmGui
         scene->m_Nodes.SetSize(0);
         scene->m_RenderHead = INVALID_INDEX;
         scene->m_RenderTail = INVALID_INDEX;
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
         scene->m_NodePool.Clear();
         scene->m_Animations.SetSize(0);
     }
@@ -2832,6 +3092,7 @@ namespace dmGui
         }
 
         node.m_DirtyLocal = 0;
+        n->m_WorldCache.m_Valid = 0;
     }
 
     void ResetNodes(HScene scene)
@@ -2848,6 +3109,8 @@ namespace dmGui
             }
         }
         scene->m_Animations.SetSize(0);
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
     }
 
     uint16_t GetRenderOrder(HScene scene)
@@ -3243,6 +3506,7 @@ namespace dmGui
             InternalNode* n = GetNode(scene, node);
             n->m_Node.m_LayerHash = layer_id;
             n->m_Node.m_LayerIndex = *layer_index;
+            scene->m_RenderEntriesChanged = 1;
             return RESULT_OK;
         }
         else
@@ -3415,6 +3679,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingMode = mode;
+        scene->m_RenderEntriesChanged = 1;
     }
 
     ClippingMode GetNodeClippingMode(HScene scene, HNode node)
@@ -3427,6 +3692,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingVisible = (uint32_t) visible;
+        scene->m_RenderEntriesChanged = 1;
     }
 
     bool GetNodeClippingVisible(HScene scene, HNode node)
@@ -3439,6 +3705,7 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_ClippingInverted = (uint32_t) inverted;
+        scene->m_RenderEntriesChanged = 1;
     }
 
     bool GetNodeClippingInverted(HScene scene, HNode node)
@@ -4029,6 +4296,8 @@ namespace dmGui
     {
         InternalNode* n = GetNode(scene, node);
         n->m_Node.m_Enabled = enabled;
+        scene->m_RenderEntriesChanged = 1;
+        scene->m_NodeStateVersion++;
         if(enabled)
         {
             SetDirtyLocalRecursive(scene, node);
@@ -171,9 +171,32 @@ namespace dmGui
         dmParticle::HInstance   m_ParticleInstance;
     };
 
+    /** World transform and opacity of a node, kept between frames by RenderScene.
+     * The cache is invalidated when the local transform is updated (see UpdateLocalTransform), and
+     * recalculated when an ancestor has been recalculated since, or when any of the other inputs differ.
+     */
+    struct NodeWorldCache
+    {
+        dmVMath::Matrix4 m_Transform;
+        dmVMath::Matrix4 m_RenderTransform; // Includes the size and resets the pivot
+        float            m_Opacity;
+        // Inputs not covered by the local transform
+        float            m_Alpha;
+        float            m_Size[2];
+        uint32_t         m_Frame;      // Render frame the transforms were last calculated
+        uint32_t         m_VisitFrame; // Render frame the cache was last validated
+        uint16_t         m_ParentIndex;
+        uint16_t         m_Pivot : 4;
+        uint16_t         m_InheritAlpha : 1;
+        uint16_t         m_Valid : 1;
+        uint16_t         m_RenderValid : 1;
+        uint16_t         : 9;
+    };
+
     struct InternalNode
     {
         Node            m_Node;
+        NodeWorldCache  m_WorldCache;
         dmhash_t        m_NameHash;
         uint16_t        m_Version;
         uint16_t        m_Index;
@@ -216,6 +239,29 @@ namespace dmGui
         uint16_t m_Backwards : 1;
     };
 
+    /** Scratch data used by UpdateAnimations. The animations advanced between two completion callbacks are
+     * collected here, in chunks small enough for their nodes to stay in the cache. The easing curves of a chunk
+     * are evaluated one curve type at a time before the values are applied.
+     */
+    struct AnimationBatch
+    {
+        static const uint32_t MAX_COUNT = 256;
+
+        float*                 m_Value[MAX_COUNT];      // Animated value
+        float                  m_From[MAX_COUNT];
+        float                  m_Delta[MAX_COUNT];      // m_To - m_From
+        const dmEasing::Curve* m_Curve[MAX_COUNT];
+        float                  m_CurveTime[MAX_COUNT];  // Normalized time after applying the playback mode
+        float                  m_CurveValue[MAX_COUNT];
+        uint8_t                m_CurveType[MAX_COUNT];
+        uint16_t               m_Order[MAX_COUNT];      // Batch indices sorted by curve type
+        float                  m_SortedTime[MAX_COUNT];
+        float                  m_SortedValue[MAX_COUNT];
+        uint32_t               m_Count;
+        // Recursive enabled state per node index: 0 unresolved, 1 disabled, 2 enabled
+        dmArray<uint8_t>       m_NodeEnabled;
+    };
+
     struct Script
     {
         int         m_FunctionReferences[MAX_SCRIPT_FUNCTION_COUNT];
@@ -298,6 +344,7 @@ namespace dmGui
         uint16_t                m_RenderOrder; // For the render-key
         uint16_t                m_NextLayerIndex;
         uint16_t                m_ResChanged : 1;
+        uint16_t                m_RenderEntriesChanged : 1; // The cached render entries need to be collected and sorted again
         uint32_t                m_Width;
         uint32_t                m_Height;
         dmScript::ScriptWorld*  m_ScriptWorld;
@@ -310,12 +357,25 @@ namespace dmGui
         void*                       m_GetResourceCallbackContext;
         FetchTextureSetAnimCallback m_FetchTextureSetAnimCallback;
         OnWindowResizeCallback   m_OnWindowResizeCallback;
+        // Sorted render entries and clippers, reused until the hierarchy, layers, clipping or enabled state change
+        dmArray<RenderEntry>            m_CachedRenderEntries;
+        dmArray<InternalClippingNode>   m_CachedClippers;
+        uint32_t                        m_ActiveNodeCount;
+        uint32_t                        m_RenderFrame;
+        AnimationBatch                  m_AnimationBatch;
+        // Incremented when nodes are enabled, disabled, added to or removed from the hierarchy
+        uint32_t                        m_NodeStateVersion;
     };
 
     InternalNode* GetNode(HScene scene, HNode node);
 
     bool IsNodeValid(HScene scene, HNode node);
 
+    /** advances and applies the animations of the scene, invoking the callbacks of the completed animations
+     * Called from UpdateScene.
+     */
+    void UpdateAnimations(HScene scene, float dt);
+
     /** calculates the transform of a node
      * A boundary transform maps the local rectangle (0,1),(0,1) to screen space such that it inclusively encapsulates the node boundaries in screen space.
      * Box nodes are rendered in boundary space (quad with dimensions (0,1),(0,1)), so the same transform is calculated whether or not the CALCULATE_NODE_BOUNDARY flag is set.
@@ -2429,9 +2429,9 @@ namespace dmGui
     static int LuaSetClippingMode(lua_State* L)
     {
         HNode hnode;
-        InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
+        LuaCheckNodeInternal(L, 1, &hnode);
         int clipping_mode = (int) luaL_checknumber(L, 2);
-        n->m_Node.m_ClippingMode = (ClippingMode) clipping_mode;
+        SetNodeClippingMode(GetScene(L), hnode, (ClippingMode) clipping_mode);
         return 0;
     }
 
@@ -2460,9 +2460,9 @@ namespace dmGui
     static int LuaSetClippingVisible(lua_State* L)
     {
         HNode hnode;
-        InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
+        LuaCheckNodeInternal(L, 1, &hnode);
         int visible = lua_toboolean(L, 2);
-        n->m_Node.m_ClippingVisible = visible;
+        SetNodeClippingVisible(GetScene(L), hnode, visible);
         return 0;
     }
 
@@ -2491,9 +2491,9 @@ namespace dmGui
     static int LuaSetClippingInverted(lua_State* L)
     {
         HNode hnode;
-        InternalNode* n = LuaCheckNodeInternal(L, 1, &hnode);
+        LuaCheckNodeInternal(L, 1, &hnode);
         int inverted = lua_toboolean(L, 2);
-        n->m_Node.m_ClippingInverted = inverted;
+        SetNodeClippingInverted(GetScene(L), hnode, inverted);
         return 0;
     }
 
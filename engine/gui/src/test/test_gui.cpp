@@ -1301,6 +1301,113 @@ TEST_F(dmGuiTest, AnimateNodeOfDisabledParent)
     dmGui::DeleteNode(m_Scene, parent, true);
 }
 
+// Verify that animations with different easing curves in the same scene get the values of their curves
+TEST_F(dmGuiTest, AnimateNodeMixedEasing)
+{
+    const dmEasing::Type types[] = {dmEasing::TYPE_LINEAR, dmEasing::TYPE_INQUAD, dmEasing::TYPE_OUTBOUNCE, dmEasing::TYPE_INQUAD, dmEasing::TYPE_OUTBACK, dmEasing::TYPE_LINEAR};
+    const uint32_t node_count = sizeof(types) / sizeof(types[0]);
+    dmGui::HNode nodes[node_count];
+    dmhash_t property = dmGui::GetPropertyHash(dmGui::PROPERTY_POSITION);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        nodes[i] = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+        dmGui::AnimateNodeHash(m_Scene, nodes[i], property, Vector4(10,0,0,0), dmEasing::Curve(types[i]), dmGui::PLAYBACK_ONCE_FORWARD, 1.0f, 0.0f, 0, 0, 0);
+    }
+
+    for (int i = 0; i < 15; ++i)
+        dmGui::UpdateScene(m_Scene, 1.0f / 60.0f);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        ASSERT_NEAR(10.0f * dmEasing::GetValue(types[i], 0.25f), dmGui::GetNodePosition(m_Scene, nodes[i]).getX(), 0.001f);
+    }
+
+    for (int i = 0; i < 45; ++i)
+        dmGui::UpdateScene(m_Scene, 1.0f / 60.0f);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        ASSERT_NEAR(10.0f, dmGui::GetNodePosition(m_Scene, nodes[i]).getX(), EPSILON);
+        dmGui::DeleteNode(m_Scene, nodes[i], true);
+    }
+}
+
+static void DeleteOtherNodeComplete(dmGui::HScene scene, dmGui::HNode node, bool finished, void* userdata1, void* userdata2)
+{
+    dmGui::HNode* other = (dmGui::HNode*) userdata1;
+    uint32_t* count = (uint32_t*) userdata2;
+    ++*count;
+    if (finished && *other != 0)
+    {
+        dmGui::HNode n = *other;
+        *other = 0;
+        dmGui::DeleteNode(scene, n, true);
+    }
+}
+
+// Completion callbacks that delete nodes with animations that complete in the same frame
+TEST_F(dmGuiTest, AnimateCompleteDeleteOther)
+{
+    dmGui::HNode nodes[2];
+    nodes[0] = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    nodes[1] = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    dmGui::HNode others[2] = {nodes[1], nodes[0]};
+    dmGui::HNode keep = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+
+    uint32_t count = 0;
+    dmhash_t property = dmGui::GetPropertyHash(dmGui::PROPERTY_POSITION);
+    dmGui::AnimateNodeHash(m_Scene, nodes[0], property, Vector4(1,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 1.0f, 0.0f, DeleteOtherNodeComplete, &others[0], &count);
+    dmGui::AnimateNodeHash(m_Scene, nodes[1], property, Vector4(1,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 1.0f, 0.0f, DeleteOtherNodeComplete, &others[1], &count);
+    dmGui::AnimateNodeHash(m_Scene, keep, property, Vector4(1,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 1.0f, 0.0f, 0, 0, 0);
+
+    for (int i = 0; i < 60; ++i)
+        dmGui::UpdateScene(m_Scene, 1.0f / 60.0f);
+
+    // Both callbacks are invoked, one finished and one for the deleted node
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(2u, dmGui::GetNodeCount(m_Scene));
+    ASSERT_NEAR(1.0f, dmGui::GetNodePosition(m_Scene, keep).getX(), EPSILON);
+    dmGui::HNode remaining = others[0] == 0 ? nodes[0] : nodes[1];
+    ASSERT_NEAR(1.0f, dmGui::GetNodePosition(m_Scene, remaining).getX(), EPSILON);
+    dmGui::DeleteNode(m_Scene, remaining, true);
+    dmGui::DeleteNode(m_Scene, keep, true);
+}
+
+static void DisableOtherNodeComplete(dmGui::HScene scene, dmGui::HNode node, bool finished, void* userdata1, void* userdata2)
+{
+    dmGui::SetNodeEnabled(scene, *(dmGui::HNode*) userdata1, false);
+}
+
+// A completion callback that disables a node stops its animations in the same frame
+TEST_F(dmGuiTest, AnimateCompleteDisableOther)
+{
+    dmGui::HNode node = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    dmGui::HNode parent = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    dmGui::HNode child = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+    dmGui::SetNodeParent(m_Scene, child, parent, false);
+
+    dmhash_t property = dmGui::GetPropertyHash(dmGui::PROPERTY_POSITION);
+    dmGui::AnimateNodeHash(m_Scene, node, property, Vector4(1,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 0.5f, 0.0f, DisableOtherNodeComplete, &parent, 0);
+    dmGui::AnimateNodeHash(m_Scene, child, property, Vector4(60,0,0,0), dmEasing::Curve(dmEasing::TYPE_LINEAR), dmGui::PLAYBACK_ONCE_FORWARD, 1.0f, 0.0f, 0, 0, 0);
+
+    // The first animation completes in the last of these frames
+    for (int i = 0; i < 30; ++i)
+        dmGui::UpdateScene(m_Scene, 1.0f / 60.0f);
+
+    ASSERT_NEAR(1.0f, dmGui::GetNodePosition(m_Scene, node).getX(), EPSILON);
+    ASSERT_FALSE(dmGui::IsNodeEnabled(m_Scene, parent, true));
+    ASSERT_NEAR(29.0f, dmGui::GetNodePosition(m_Scene, child).getX(), 0.001f);
+
+    for (int i = 0; i < 30; ++i)
+        dmGui::UpdateScene(m_Scene, 1.0f / 60.0f);
+
+    ASSERT_NEAR(29.0f, dmGui::GetNodePosition(m_Scene, child).getX(), 0.001f);
+
+    dmGui::DeleteNode(m_Scene, child, true);
+    dmGui::DeleteNode(m_Scene, parent, true);
+    dmGui::DeleteNode(m_Scene, node, true);
+}
+
 TEST_F(dmGuiTest, Reset)
 {
     dmGui::HNode n1 = dmGui::NewNode(m_Scene, Point3(10, 20, 30), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
@@ -4180,6 +4287,89 @@ TEST_F(dmGuiTest, SceneTransformCacheCoherence)
     }
 }
 
+// Verify that the world transforms and opacities kept between frames by dmGui::RenderScene
+// are recalculated when the node, or any of its ancestors, change
+//
+// - n1
+//   - n2
+//     - n3
+//
+TEST_F(dmGuiTest, SceneWorldCacheAcrossFrames)
+{
+    Vector3 size(1, 1, 0);
+
+    dmGui::HNode node[3];
+    const size_t node_count = sizeof(node)/sizeof(dmGui::HNode);
+    for(uint32_t i = 0; i < node_count; ++i)
+    {
+        node[i] = dmGui::NewNode(m_Scene, Point3(1.0f, 0.0f, 0.0f), size, dmGui::NODE_TYPE_BOX, 0);
+        dmGui::SetNodeInheritAlpha(m_Scene, node[i], true);
+        dmGui::SetNodePivot(m_Scene, node[i], dmGui::PIVOT_SW);
+        if (i > 0)
+        {
+            dmGui::SetNodeParent(m_Scene, node[i], node[i-1], false);
+        }
+    }
+
+    dmGui::RenderSceneParams render_params;
+    render_params.m_RenderNodes = RenderNodesStoreOpacityAndTransform;
+
+    TransformColorData cbres[node_count];
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    for(uint32_t i = 0; i < node_count; ++i)
+    {
+        ASSERT_NEAR(i + 1.0f, cbres[i].m_Transform.getTranslation().getX(), EPSILON);
+        ASSERT_EQ(1.0f, cbres[i].m_Opacity);
+    }
+
+    // Nothing changed
+    memset(cbres, 0x0, sizeof(cbres));
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    for(uint32_t i = 0; i < node_count; ++i)
+    {
+        ASSERT_NEAR(i + 1.0f, cbres[i].m_Transform.getTranslation().getX(), EPSILON);
+        ASSERT_EQ(1.0f, cbres[i].m_Opacity);
+    }
+
+    // Moving the root moves the descendants
+    dmGui::SetNodePosition(m_Scene, node[0], Point3(2.0f, 0.0f, 0.0f));
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    for(uint32_t i = 0; i < node_count; ++i)
+    {
+        ASSERT_NEAR(i + 2.0f, cbres[i].m_Transform.getTranslation().getX(), EPSILON);
+    }
+
+    // Alpha of the middle node is inherited by the leaf only
+    dmGui::SetNodeProperty(m_Scene, node[1], dmGui::PROPERTY_COLOR, Vector4(1, 1, 1, 0.5f));
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    ASSERT_EQ(1.0f, cbres[0].m_Opacity);
+    ASSERT_EQ(0.5f, cbres[1].m_Opacity);
+    ASSERT_EQ(0.5f, cbres[2].m_Opacity);
+
+    dmGui::SetNodeInheritAlpha(m_Scene, node[2], false);
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    ASSERT_EQ(0.5f, cbres[1].m_Opacity);
+    ASSERT_EQ(1.0f, cbres[2].m_Opacity);
+
+    // Pivot and size only change the render transform of the node itself
+    dmGui::SetNodePivot(m_Scene, node[1], dmGui::PIVOT_CENTER);
+    dmGui::SetNodeProperty(m_Scene, node[1], dmGui::PROPERTY_SIZE, Vector4(2.0f, 2.0f, 0.0f, 0.0f));
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    ASSERT_NEAR(2.0f, cbres[1].m_Transform.getTranslation().getX(), EPSILON);
+    ASSERT_NEAR(-1.0f, cbres[1].m_Transform.getTranslation().getY(), EPSILON);
+    ASSERT_NEAR(2.0f, cbres[1].m_Transform.getCol0().getX(), EPSILON);
+    ASSERT_NEAR(4.0f, cbres[2].m_Transform.getTranslation().getX(), EPSILON);
+    ASSERT_NEAR(0.0f, cbres[2].m_Transform.getTranslation().getY(), EPSILON);
+
+    // Reparenting the leaf to the root
+    dmGui::SetNodeParent(m_Scene, node[2], node[0], false);
+    dmGui::RenderScene(m_Scene, render_params, &cbres);
+    ASSERT_NEAR(2.0f, cbres[0].m_Transform.getTranslation().getX(), EPSILON);
+    ASSERT_NEAR(2.0f, cbres[1].m_Transform.getTranslation().getX(), EPSILON);
+    ASSERT_NEAR(3.0f, cbres[2].m_Transform.getTranslation().getX(), EPSILON);
+    ASSERT_EQ(1.0f, cbres[2].m_Opacity);
+}
+
 TEST_F(dmGuiTest, ScriptClippingFunctions)
 {
     dmGui::HNode node = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(1,1,0), dmGui::NODE_TYPE_BOX, 0);
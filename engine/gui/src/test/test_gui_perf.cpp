@@ -0,0 +1,219 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <jc_test/jc_test.h>
+#include <testmain/testmain.h>
+#include <dlib/array.h>
+#include <dlib/easing.h>
+#include <dlib/hash.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <dmsdk/dlib/vmath.h>
+#include <script/script.h>
+#include "../gui.h"
+#include "../gui_private.h"
+
+using namespace dmVMath;
+
+// Compares the batched dmGui::UpdateAnimations with the scalar loop it replaced
+
+static const uint32_t NODE_COUNT = 10000;
+static const uint32_t ANIMATION_COUNT = NODE_COUNT;
+static const uint32_t HIERARCHY_DEPTH = 4;
+static const uint32_t ITERATIONS = 100;
+static const float DT = 1.0f / 60.0f;
+
+// The scalar path that was used in dmGui::UpdateAnimations, for animations that don't complete or call back
+static bool ScalarIsNodeEnabledRecursive(dmGui::HScene scene, uint16_t node_index)
+{
+    dmGui::InternalNode* node = &scene->m_Nodes[node_index];
+    if (node->m_Node.m_Enabled && node->m_ParentIndex != dmGui::INVALID_INDEX)
+    {
+        return ScalarIsNodeEnabledRecursive(scene, node->m_ParentIndex);
+    }
+    return node->m_Node.m_Enabled;
+}
+
+static void ScalarUpdateAnimations(dmGui::HScene scene, float dt)
+{
+    dmArray<dmGui::Animation>* animations = &scene->m_Animations;
+    for (uint32_t i = 0; i < animations->Size(); ++i)
+    {
+        dmGui::Animation* anim = &(*animations)[i];
+        dmGui::Playback playback = anim->m_Playback;
+        bool looping = playback == dmGui::PLAYBACK_LOOP_FORWARD || playback == dmGui::PLAYBACK_LOOP_BACKWARD || playback == dmGui::PLAYBACK_LOOP_PINGPONG;
+        if (anim->m_Elapsed > anim->m_Duration || anim->m_Cancelled || (!looping && anim->m_Elapsed == anim->m_Duration && anim->m_Duration != 0))
+            continue;
+        if (!ScalarIsNodeEnabledRecursive(scene, anim->m_Node & 0xffff))
+            continue;
+
+        if (anim->m_Delay < dt)
+        {
+            if (anim->m_FirstUpdate)
+            {
+                anim->m_From = *anim->m_Value;
+                anim->m_FirstUpdate = 0;
+                anim->m_Elapsed = -anim->m_Delay;
+                anim->m_Delay = 0;
+            }
+            anim->m_Elapsed += dt*anim->m_PlaybackRate;
+            anim->m_Elapsed = dmMath::Select(anim->m_Elapsed + dt * anim->m_PlaybackRate * 0.5f - anim->m_Duration, anim->m_Duration, anim->m_Elapsed);
+            float t = 1.0f;
+            if (anim->m_Duration != 0)
+                t = dmMath::Select(anim->m_Duration - anim->m_Elapsed, anim->m_Elapsed / anim->m_Duration, 1.0f);
+            float t2 = t;
+            if (playback == dmGui::PLAYBACK_ONCE_BACKWARD || playback == dmGui::PLAYBACK_LOOP_BACKWARD || anim->m_Backwards)
+                t2 = 1.0f - t;
+            if (playback == dmGui::PLAYBACK_ONCE_PINGPONG || playback == dmGui::PLAYBACK_LOOP_PINGPONG)
+            {
+                t2 *= 2.0f;
+                if (t2 > 1.0f)
+                    t2 = 2.0f - t2;
+            }
+
+            float x = dmEasing::GetValue(anim->m_Easing, t2);
+            *anim->m_Value = anim->m_From + (anim->m_To - anim->m_From) * x;
+            scene->m_Nodes[anim->m_Node & 0xffff].m_Node.m_DirtyLocal = 1;
+
+            if (t >= 1.0f && looping)
+            {
+                anim->m_Elapsed = anim->m_Elapsed - anim->m_Duration;
+                if (playback == dmGui::PLAYBACK_LOOP_PINGPONG)
+                    anim->m_Backwards ^= 1;
+            }
+        }
+        else
+        {
+            anim->m_Delay -= dt;
+        }
+    }
+
+    uint32_t n = animations->Size();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        dmGui::Animation* anim = &(*animations)[i];
+        if ((anim->m_Elapsed >= anim->m_Duration && anim->m_Delay == 0) || anim->m_Cancelled)
+        {
+            animations->EraseSwap(i);
+            i--;
+            n--;
+        }
+    }
+}
+
+class GuiPerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_ScriptContext = dmScript::NewContext(0, 0, true);
+        dmScript::Initialize(m_ScriptContext);
+
+        dmGui::NewContextParams context_params;
+        context_params.m_ScriptContext = m_ScriptContext;
+        m_Context = dmGui::NewContext(&context_params);
+
+        dmGui::NewSceneParams params;
+        params.m_MaxNodes = NODE_COUNT;
+        params.m_MaxAnimations = ANIMATION_COUNT;
+        m_Scene = dmGui::NewScene(m_Context, &params);
+
+        // Chains of HIERARCHY_DEPTH nodes, each animating the x position with a different curve
+        dmhash_t property = dmHashString64("position.x");
+        dmGui::HNode parent = 0;
+        for (uint32_t i = 0; i < NODE_COUNT; ++i)
+        {
+            dmGui::HNode node = dmGui::NewNode(m_Scene, Point3(0,0,0), Vector3(10,10,0), dmGui::NODE_TYPE_BOX, 0);
+            if (i % HIERARCHY_DEPTH != 0)
+            {
+                dmGui::SetNodeParent(m_Scene, node, parent, false);
+            }
+            parent = node;
+
+            dmEasing::Curve curve((dmEasing::Type) (i % dmEasing::TYPE_FLOAT_VECTOR));
+            float duration = 0.5f + (i % 7) * 0.25f;
+            dmGui::AnimateNodeHash(m_Scene, node, property, Vector4(100.0f), curve, dmGui::PLAYBACK_LOOP_PINGPONG, duration, 0.0f, 0, 0, 0);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        dmGui::DeleteScene(m_Scene);
+        dmGui::DeleteContext(m_Context, m_ScriptContext);
+        dmScript::Finalize(m_ScriptContext);
+        dmScript::DeleteContext(m_ScriptContext);
+    }
+
+    dmScript::HContext m_ScriptContext;
+    dmGui::HContext    m_Context;
+    dmGui::HScene      m_Scene;
+};
+
+TEST_F(GuiPerfTest, UpdateAnimations)
+{
+    ASSERT_EQ(ANIMATION_COUNT, m_Scene->m_Animations.Size());
+
+    // Both paths start from the same state, and must produce the same values
+    dmArray<dmGui::Animation> animations;
+    animations.SetCapacity(ANIMATION_COUNT);
+    animations.SetSize(ANIMATION_COUNT);
+    memcpy(animations.Begin(), m_Scene->m_Animations.Begin(), sizeof(dmGui::Animation) * ANIMATION_COUNT);
+    dmArray<dmGui::InternalNode> nodes;
+    nodes.SetCapacity(NODE_COUNT);
+    nodes.SetSize(NODE_COUNT);
+    memcpy(nodes.Begin(), m_Scene->m_Nodes.Begin(), sizeof(dmGui::InternalNode) * NODE_COUNT);
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        ScalarUpdateAnimations(m_Scene, DT);
+    }
+    uint64_t scalar_time = dmTime::GetTime() - start;
+
+    dmArray<float> scalar_values;
+    scalar_values.SetCapacity(ANIMATION_COUNT);
+    for (uint32_t i = 0; i < ANIMATION_COUNT; ++i)
+    {
+        scalar_values.Push(*m_Scene->m_Animations[i].m_Value);
+    }
+
+    memcpy(m_Scene->m_Animations.Begin(), animations.Begin(), sizeof(dmGui::Animation) * ANIMATION_COUNT);
+    memcpy(m_Scene->m_Nodes.Begin(), nodes.Begin(), sizeof(dmGui::InternalNode) * NODE_COUNT);
+
+    start = dmTime::GetTime();
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        dmGui::UpdateAnimations(m_Scene, DT);
+    }
+    uint64_t batch_time = dmTime::GetTime() - start;
+
+    ASSERT_EQ(ANIMATION_COUNT, m_Scene->m_Animations.Size());
+    for (uint32_t i = 0; i < ANIMATION_COUNT; ++i)
+    {
+        ASSERT_EQ(scalar_values[i], *m_Scene->m_Animations[i].m_Value);
+    }
+
+    printf("[animations] %u animations, %u frames | scalar: %7.3f ms | batch: %7.3f ms | x%.2f\n", ANIMATION_COUNT, ITERATIONS,
+            scalar_time / 1000.0, batch_time / 1000.0, scalar_time / (double) dmMath::Max(batch_time, (uint64_t) 1));
+}
+
+int main(int argc, char **argv)
+{
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
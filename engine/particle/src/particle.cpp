@@ -15,7 +15,6 @@
 #include <string.h>
 #include <stdint.h>
 #include <float.h>
-#include <algorithm>
 #include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
@@ -50,6 +49,8 @@ namespace dmParticle
     const char* MAX_EMITTER_COUNT_KEY  = "particle_fx.max_emitter_count";
     /// Config key to use for tweaking the total maximum number of particles in a context.
     const char* MAX_PARTICLE_COUNT_KEY = "particle_fx.max_particle_count";
+    /// Config key to use for enabling parallel emitter updates on the job thread.
+    const char* PARALLEL_UPDATE_KEY    = "particle_fx.parallel_update";
 
     /// Used for degree to radian conversion
     const float DEG_RAD = (float) (M_PI / 180.0);
@@ -57,6 +58,14 @@ namespace dmParticle
     /// Simulate motion blur at 60 fps with a 180 deg shutter
     const static float STRETCH_SCALING = (1.0f/60.0f) * 0.5f;
 
+    /// Emitters with up to this many particles are sorted with insertion sort, larger ones with a radix sort.
+    const static uint32_t INSERTION_SORT_MAX_PARTICLE_COUNT = 256;
+
+    /// Emitters processed in parallel are grouped into jobs of about this many particles, see RunEmitterJobs()
+    const static uint32_t JOB_PARTICLE_COUNT = 1024;
+    /// Fixed cost of processing an emitter, in particles
+    const static uint32_t JOB_EMITTER_COST = 64;
+
     AnimationData::AnimationData()
     {
         memset(this, 0, sizeof(*this));
@@ -112,6 +121,11 @@ namespace dmParticle
         context->m_MaxParticleCount = max_particle_count;
     }
 
+    void SetContextJobThread(HParticleContext context, dmJobThread::HContext job_thread)
+    {
+        context->m_JobThread = job_thread;
+    }
+
     static Instance* GetInstance(HParticleContext context, HInstance instance)
     {
         if (instance == INVALID_INSTANCE)
@@ -269,17 +283,18 @@ namespace dmParticle
         {
             Emitter* emitter = &i->m_Emitters[emitter_i];
             emitter->m_Particles.SetCapacity(0);
+            emitter->m_Streams.SetCapacity(0);
+            emitter->m_SortKeys.SetCapacity(0);
+            emitter->m_SortIndices.SetCapacity(0);
+            emitter->m_SortScratch.SetCapacity(0);
             emitter->m_RenderConstants.SetCapacity(0);
         }
         delete i;
     }
 
-    void SetEmitterState(Instance* instance, Emitter* emitter, EmitterState state)
+    static void NotifyEmitterStateChanged(Instance* instance, Emitter* emitter, EmitterState state)
     {
-        EmitterState old_emitter_state = emitter->m_State;
-        emitter->m_State = state;
-
-        if(state != old_emitter_state && instance->m_EmitterStateChangedData.m_UserData != 0x0)
+        if(instance->m_EmitterStateChangedData.m_UserData != 0x0)
         {
             if(state == EMITTER_STATE_PRESPAWN)
             {
@@ -293,11 +308,31 @@ namespace dmParticle
             instance->m_EmitterStateChangedData.m_StateChangedCallback(
                 instance->m_NumAwakeEmitters,
                 emitter->m_Id,
-                emitter->m_State,
+                state,
                 instance->m_EmitterStateChangedData.m_UserData);
         }
     }
 
+    void SetEmitterState(Instance* instance, Emitter* emitter, EmitterState state)
+    {
+        EmitterState old_emitter_state = emitter->m_State;
+        emitter->m_State = state;
+
+        if(state != old_emitter_state)
+        {
+            if (emitter->m_DeferStateChanges)
+            {
+                // The emitter is updated on a job thread, the callback is called afterwards (see UpdateParallel)
+                assert(emitter->m_DeferredStateCount < MAX_DEFERRED_STATE_CHANGES);
+                emitter->m_DeferredStates[emitter->m_DeferredStateCount++] = (uint8_t) state;
+            }
+            else
+            {
+                NotifyEmitterStateChanged(instance, emitter, state);
+            }
+        }
+    }
+
     static bool IsSleeping(Emitter* emitter);
     static void UpdateEmitter(Prototype* prototype, Instance* instance, EmitterPrototype* emitter_prototype, Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, float dt);
 
@@ -375,6 +410,10 @@ namespace dmParticle
                 for (uint32_t emitter_i = prototype_emitter_count; emitter_i < emitter_count; ++emitter_i)
                 {
                     emitters[emitter_i].m_Particles.SetCapacity(0);
+                    emitters[emitter_i].m_Streams.SetCapacity(0);
+                    emitters[emitter_i].m_SortKeys.SetCapacity(0);
+                    emitters[emitter_i].m_SortIndices.SetCapacity(0);
+                    emitters[emitter_i].m_SortScratch.SetCapacity(0);
                 }
             }
             emitters.SetCapacity(prototype_emitter_count);
@@ -489,9 +528,17 @@ namespace dmParticle
 
     static void ResetEmitter(Emitter* emitter)
     {
-        // Save particles array and id
+        // Save particles array, scratch buffers and id
         dmArray<Particle> tmp;
         tmp.Swap(emitter->m_Particles);
+        ParticleSoA tmp_streams;
+        tmp_streams.Swap(emitter->m_Streams);
+        dmArray<uint16_t> tmp_sort_keys;
+        tmp_sort_keys.Swap(emitter->m_SortKeys);
+        dmArray<uint32_t> tmp_sort_indices;
+        tmp_sort_indices.Swap(emitter->m_SortIndices);
+        dmArray<uint32_t> tmp_sort_scratch;
+        tmp_sort_scratch.Swap(emitter->m_SortScratch);
         dmhash_t id = emitter->m_Id;
         uint32_t original_seed = emitter->m_OriginalSeed;
         float duration = emitter->m_Duration;
@@ -501,8 +548,12 @@ namespace dmParticle
         // Clear emitter
         memset(emitter, 0, sizeof(Emitter));
 
-        // Restore particles and id
+        // Restore particles, scratch buffers and id
         tmp.Swap(emitter->m_Particles);
+        tmp_streams.Swap(emitter->m_Streams);
+        tmp_sort_keys.Swap(emitter->m_SortKeys);
+        tmp_sort_indices.Swap(emitter->m_SortIndices);
+        tmp_sort_scratch.Swap(emitter->m_SortScratch);
         emitter->m_Id = id;
 
         // Remove living particles
@@ -686,10 +737,272 @@ namespace dmParticle
         return res;
     }
 
+    // Shared by the jobs of one Update() or GenerateVertexDataBatch()
+    struct EmitterJobParams
+    {
+        Context*    m_Context;
+        float       m_Dt;
+        uint8_t*    m_VertexBuffer;
+        uint32_t    m_VertexBufferSize;
+    };
+
+    // Splits the job items into consecutive ranges of about JOB_PARTICLE_COUNT particles, and processes each range as a job.
+    // The calling thread processes jobs as well while waiting. Returns when all items are processed.
+    static void RunEmitterJobs(Context* context, dmJobThread::FProcess process, EmitterJobParams* params)
+    {
+        dmArray<EmitterJobItem>& items = context->m_JobItems;
+        dmArray<EmitterJobRange>& ranges = context->m_JobRanges;
+        ranges.SetSize(0);
+        uint32_t item_count = items.Size();
+        uint32_t begin = 0;
+        uint32_t cost = 0;
+        for (uint32_t i = 0; i < item_count; ++i)
+        {
+            Emitter* emitter = &items[i].m_Instance->m_Emitters[items[i].m_EmitterIndex];
+            cost += emitter->m_Particles.Size() + JOB_EMITTER_COST;
+            if (cost >= JOB_PARTICLE_COUNT || i + 1 == item_count)
+            {
+                if (ranges.Full())
+                    ranges.OffsetCapacity(32);
+                EmitterJobRange range;
+                range.m_Begin = begin;
+                range.m_End = i + 1;
+                ranges.Push(range);
+                begin = i + 1;
+                cost = 0;
+            }
+        }
+
+        // The ranges must not move while the jobs are running
+        dmJobThread::HContext job_thread = context->m_JobThread;
+        dmJobThread::HJob root = dmJobThread::CreateJob(job_thread, 0, 0, 0, dmJobThread::INVALID_JOB);
+        uint32_t range_count = ranges.Size();
+        for (uint32_t i = 0; i < range_count; ++i)
+        {
+            dmJobThread::HJob job = dmJobThread::INVALID_JOB;
+            if (root != dmJobThread::INVALID_JOB)
+                job = dmJobThread::CreateJob(job_thread, process, params, &ranges[i], root);
+            if (job != dmJobThread::INVALID_JOB)
+                dmJobThread::RunJob(job_thread, job);
+            else
+                process(params, &ranges[i]); // Too many jobs alive
+        }
+        if (root != dmJobThread::INVALID_JOB)
+        {
+            dmJobThread::RunJob(job_thread, root);
+            dmJobThread::WaitJob(job_thread, root);
+        }
+    }
+
+    static bool UseJobThread(Context* context)
+    {
+        return context->m_JobThread != 0 && dmJobThread::GetWorkerCount(context->m_JobThread) > 0;
+    }
+
+    static int GenerateVertexDataJob(void* _params, void* _range)
+    {
+        DM_PROFILE("GenerateVertexDataJob");
+        EmitterJobParams* params = (EmitterJobParams*) _params;
+        EmitterJobRange* range = (EmitterJobRange*) _range;
+        EmitterJobItem* items = params->m_Context->m_JobItems.Begin();
+        for (uint32_t i = range->m_Begin; i < range->m_End; ++i)
+        {
+            Instance* instance = items[i].m_Instance;
+            uint32_t emitter_i = items[i].m_EmitterIndex;
+            EmitterVertexData* data = items[i].m_VertexData;
+            Emitter* emitter = &instance->m_Emitters[emitter_i];
+            dmParticleDDF::Emitter* emitter_ddf = &instance->m_Prototype->m_DDF->m_Emitters[emitter_i];
+            uint32_t bytes_written = 0;
+            data->m_Result = UpdateRenderData(params->m_Context, instance, emitter, emitter_ddf, *data->m_AttributeInfos, data->m_Color, items[i].m_VertexIndex,
+                                              params->m_VertexBuffer, params->m_VertexBufferSize, &bytes_written, params->m_Dt);
+        }
+        return 0;
+    }
+
+    void GenerateVertexDataBatch(HParticleContext context, float dt, EmitterVertexData* emitters, uint32_t emitter_count, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        if (!UseJobThread(context) || vertex_buffer == 0x0 || vertex_buffer_size == 0)
+        {
+            for (uint32_t i = 0; i < emitter_count; ++i)
+            {
+                EmitterVertexData& data = emitters[i];
+                data.m_Result = GenerateVertexData(context, dt, data.m_Instance, data.m_EmitterIndex, *data.m_AttributeInfos, data.m_Color, vertex_buffer, vertex_buffer_size, out_vertex_buffer_size);
+            }
+            return;
+        }
+
+        // Assign the vertex ranges with a prefix sum over the vertex counts, which are known up front.
+        // The ranges (and stats) are the same as when calling GenerateVertexData() for one emitter at a time.
+        dmArray<EmitterJobItem>& items = context->m_JobItems;
+        items.SetSize(0);
+        if (items.Capacity() < emitter_count)
+            items.SetCapacity(emitter_count);
+
+        uint32_t vb_size = *out_vertex_buffer_size;
+        for (uint32_t i = 0; i < emitter_count; ++i)
+        {
+            EmitterVertexData& data = emitters[i];
+            assert(data.m_AttributeInfos->m_StructSize == sizeof(dmGraphics::VertexAttributeInfos));
+            assert(data.m_AttributeInfos->m_VertexStride != 0);
+
+            data.m_Result = GENERATE_VERTEX_DATA_OK;
+            if (data.m_Instance == INVALID_INSTANCE)
+            {
+                data.m_Result = GENERATE_VERTEX_DATA_INVALID_INSTANCE;
+                continue;
+            }
+
+            Instance* inst = GetInstance(context, data.m_Instance);
+            if (IsSleeping(inst))
+            {
+                continue;
+            }
+
+            uint32_t vertex_size = data.m_AttributeInfos->m_VertexStride;
+            uint32_t vertex_index = vb_size / vertex_size;
+            if (vb_size % vertex_size != 0)
+            {
+                vertex_index++;
+            }
+
+            // See the particle loop in UpdateRenderData()
+            uint32_t max_vertex_count = vertex_buffer_size / vertex_size;
+            uint32_t max_particle_count = vertex_index < max_vertex_count ? (max_vertex_count - vertex_index) / 6 : 0;
+            uint32_t particle_count = dmMath::Min(inst->m_Emitters[data.m_EmitterIndex].m_Particles.Size(), max_particle_count);
+            vb_size += particle_count * 6 * vertex_size;
+
+            context->m_Stats.m_Particles = particle_count; // Debug data for editor playback
+
+            EmitterJobItem item;
+            item.m_Instance = inst;
+            item.m_InstanceHandle = data.m_Instance;
+            item.m_EmitterIndex = data.m_EmitterIndex;
+            item.m_VertexData = &data;
+            item.m_VertexIndex = vertex_index;
+            items.Push(item);
+        }
+        *out_vertex_buffer_size = vb_size;
+
+        EmitterJobParams params;
+        params.m_Context = context;
+        params.m_Dt = dt;
+        params.m_VertexBuffer = (uint8_t*) vertex_buffer;
+        params.m_VertexBufferSize = vertex_buffer_size;
+        RunEmitterJobs(context, GenerateVertexDataJob, &params);
+    }
+
+    static int UpdateEmittersJob(void* _params, void* _range)
+    {
+        DM_PROFILE("UpdateEmittersJob");
+        EmitterJobParams* params = (EmitterJobParams*) _params;
+        EmitterJobRange* range = (EmitterJobRange*) _range;
+        EmitterJobItem* items = params->m_Context->m_JobItems.Begin();
+        for (uint32_t i = range->m_Begin; i < range->m_End; ++i)
+        {
+            Instance* instance = items[i].m_Instance;
+            uint32_t emitter_i = items[i].m_EmitterIndex;
+            Prototype* prototype = instance->m_Prototype;
+            UpdateEmitter(prototype, instance, &prototype->m_Emitters[emitter_i], &instance->m_Emitters[emitter_i], &prototype->m_DDF->m_Emitters[emitter_i], params->m_Dt);
+        }
+        return 0;
+    }
+
+    // Same as the serial loop in Update(), but the emitters are simulated on the job thread. An emitter only depends on its own
+    // state and the (constant) instance, so the result is the same. The state changed callbacks, and everything else that calls
+    // out of the particle system or is shared between emitters, is done on the calling thread before and after, in the serial order.
+    static void UpdateParallel(Context* context, float dt, FetchAnimationCallback fetch_animation_callback)
+    {
+        dmArray<EmitterJobItem>& items = context->m_JobItems;
+        items.SetSize(0);
+
+        uint32_t size = context->m_Instances.Size();
+        for (uint32_t i = 0; i < size; i++)
+        {
+            Instance* instance = context->m_Instances[i];
+
+            // empty slot
+            if (instance == 0x0) continue;
+            uint32_t emitter_count = instance->m_Emitters.Size();
+            // don't update sleeping instances
+            if (IsSleeping(instance))
+            {
+                // update velocity and clear vertex count (don't render)
+                for (uint32_t emitter_i = 0; emitter_i < emitter_count; ++emitter_i)
+                {
+                    Emitter* emitter = &instance->m_Emitters[emitter_i];
+                    emitter->m_VertexCount = 0;
+                    dmParticleDDF::Emitter* emitter_ddf = &instance->m_Prototype->m_DDF->m_Emitters[emitter_i];
+                    UpdateEmitterVelocity(instance, emitter, emitter_ddf, dt);
+                }
+                continue;
+            }
+            instance->m_PlayTime += dt;
+            if (items.Remaining() < emitter_count)
+                items.OffsetCapacity(dmMath::Max(emitter_count, 64u));
+            for (uint32_t emitter_i = 0; emitter_i < emitter_count; ++emitter_i)
+            {
+                Emitter* emitter = &instance->m_Emitters[emitter_i];
+                dmParticleDDF::Emitter* emitter_ddf = &instance->m_Prototype->m_DDF->m_Emitters[emitter_i];
+                UpdateEmitterVelocity(instance, emitter, emitter_ddf, dt);
+                emitter->m_DeferStateChanges = 1;
+
+                EmitterJobItem item;
+                memset(&item, 0, sizeof(item));
+                item.m_Instance = instance;
+                item.m_InstanceHandle = instance->m_VersionNumber << 16 | i;
+                item.m_EmitterIndex = emitter_i;
+                items.Push(item);
+            }
+        }
+
+        EmitterJobParams params;
+        memset(&params, 0, sizeof(params));
+        params.m_Context = context;
+        params.m_Dt = dt;
+        RunEmitterJobs(context, UpdateEmittersJob, &params);
+
+        uint32_t TotalAliveParticles = 0;
+        uint32_t item_count = items.Size();
+        for (uint32_t i = 0; i < item_count; ++i)
+        {
+            Instance* instance = items[i].m_Instance;
+            uint32_t emitter_i = items[i].m_EmitterIndex;
+            Prototype* prototype = instance->m_Prototype;
+            Emitter* emitter = &instance->m_Emitters[emitter_i];
+            EmitterPrototype* emitter_prototype = &prototype->m_Emitters[emitter_i];
+            dmParticleDDF::Emitter* emitter_ddf = &prototype->m_DDF->m_Emitters[emitter_i];
+
+            emitter->m_DeferStateChanges = 0;
+            for (uint32_t state_i = 0; state_i < emitter->m_DeferredStateCount; ++state_i)
+            {
+                NotifyEmitterStateChanged(instance, emitter, (EmitterState) emitter->m_DeferredStates[state_i]);
+            }
+            emitter->m_DeferredStateCount = 0;
+
+            TotalAliveParticles += (uint32_t)emitter->m_Particles.Size();
+            FetchAnimation(emitter, emitter_prototype, fetch_animation_callback);
+            UpdateEmitterRenderData(items[i].m_InstanceHandle, emitter_i, instance, emitter, emitter_ddf);
+
+            if (emitter->m_ReHash)
+                ReHashEmitter(emitter);
+        }
+
+        DM_PROPERTY_SET_U32(rmtp_ParticlesAlive, TotalAliveParticles);
+    }
+
     void Update(HParticleContext context, float dt, FetchAnimationCallback fetch_animation_callback)
     {
         DM_PROFILE(__FUNCTION__);
 
+        // Nothing is simulated when time is standing still, see UpdateEmitter()
+        if (dt > 0.0f && UseJobThread(context))
+        {
+            UpdateParallel(context, dt, fetch_animation_callback);
+            return;
+        }
+
         uint32_t size = context->m_Instances.Size();
         uint32_t TotalAliveParticles = 0;
         for (uint32_t i = 0; i < size; i++)
@@ -1320,35 +1633,118 @@ namespace dmParticle
         return res;
     }
 
-    struct SortPred
-    {
-        inline bool operator () (const Particle& p1, const Particle& p2)
-        {
-            return p1.GetSortKey().m_Key < p2.GetSortKey().m_Key;
-        }
-
-    };
-
     void GenerateKeys(Emitter* emitter, float max_particle_life_time)
     {
         dmArray<Particle>& particles = emitter->m_Particles;
         uint32_t n = particles.Size();
 
+        dmArray<uint16_t>& keys = emitter->m_SortKeys;
+        if (keys.Capacity() < n)
+            keys.SetCapacity(particles.Capacity());
+        keys.SetSize(n);
+
         float range = 1.0f / max_particle_life_time;
 
-        Particle* first = particles.Begin();
+        uint16_t* k = keys.Begin();
         for (uint32_t i = 0; i < n; ++i)
         {
             Particle* p = &particles[i];
-            uint32_t index = p - first;
-
             float life_time = (1.0f - p->GetTimeLeft() * range) * 65535;
             life_time = dmMath::Clamp(life_time, 0.0f, 65535.0f);
-            uint16_t lt = (uint16_t) life_time;
-            SortKey key;
-            key.m_LifeTime = lt;
-            key.m_Index = index;
-            p->SetSortKey(key);
+            k[i] = (uint16_t) life_time;
+        }
+    }
+
+    // Stable sort of the indices [0, n) by key.
+    // Cheap on the nearly sorted order that is left from the previous frame, since all particles age at the same rate.
+    static void InsertionSort(const uint16_t* keys, uint32_t* indices, uint32_t n)
+    {
+        for (uint32_t i = 0; i < n; ++i)
+            indices[i] = i;
+        for (uint32_t i = 1; i < n; ++i)
+        {
+            uint32_t index = indices[i];
+            uint16_t key = keys[index];
+            uint32_t j = i;
+            for (; j > 0 && keys[indices[j - 1]] > key; --j)
+                indices[j] = indices[j - 1];
+            indices[j] = index;
+        }
+    }
+
+    // Stable LSD radix sort of the indices [0, n) by key, one pass per byte
+    static void RadixSort(const uint16_t* keys, uint32_t* indices, uint32_t* scratch, uint32_t n)
+    {
+        uint32_t offsets[2][256];
+        memset(offsets, 0, sizeof(offsets));
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            uint16_t key = keys[i];
+            ++offsets[0][key & 0xff];
+            ++offsets[1][key >> 8];
+        }
+        // A pass can be skipped when all keys have the same byte
+        bool skip_low = offsets[0][keys[0] & 0xff] == n;
+        bool skip_high = offsets[1][keys[0] >> 8] == n;
+        for (uint32_t pass = 0; pass < 2; ++pass)
+        {
+            uint32_t sum = 0;
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                uint32_t count = offsets[pass][b];
+                offsets[pass][b] = sum;
+                sum += count;
+            }
+        }
+
+        if (skip_low)
+        {
+            for (uint32_t i = 0; i < n; ++i)
+                scratch[i] = i;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < n; ++i)
+                scratch[offsets[0][keys[i] & 0xff]++] = i;
+        }
+
+        if (skip_high)
+        {
+            memcpy(indices, scratch, n * sizeof(uint32_t));
+        }
+        else
+        {
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                uint32_t index = scratch[i];
+                indices[offsets[1][keys[index] >> 8]++] = index;
+            }
+        }
+    }
+
+    // Reorders the particles so that particles[i] = old particles[indices[i]], moving each particle once.
+    // The indices are destroyed.
+    static void ApplyPermutation(Particle* particles, uint32_t* indices, uint32_t n)
+    {
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (indices[i] == i)
+                continue;
+            // Follow the cycle starting at i
+            Particle tmp = particles[i];
+            uint32_t current = i;
+            while (true)
+            {
+                uint32_t next = indices[current];
+                indices[current] = current;
+                if (next == i)
+                {
+                    particles[current] = tmp;
+                    break;
+                }
+                particles[current] = particles[next];
+                current = next;
+            }
         }
     }
 
@@ -1356,7 +1752,37 @@ namespace dmParticle
     {
         DM_PROFILE(__FUNCTION__);
 
-        std::sort(emitter->m_Particles.Begin(), emitter->m_Particles.End(), SortPred());
+        dmArray<Particle>& particles = emitter->m_Particles;
+        uint32_t n = particles.Size();
+        const uint16_t* keys = emitter->m_SortKeys.Begin();
+
+        // Often still sorted from the previous frame
+        uint32_t first_unsorted = 1;
+        while (first_unsorted < n && keys[first_unsorted - 1] <= keys[first_unsorted])
+            ++first_unsorted;
+        if (first_unsorted >= n)
+            return;
+
+        // Sort a permutation, to avoid moving the particles more than once
+        dmArray<uint32_t>& indices = emitter->m_SortIndices;
+        if (indices.Capacity() < n)
+            indices.SetCapacity(particles.Capacity());
+        indices.SetSize(n);
+
+        if (n <= INSERTION_SORT_MAX_PARTICLE_COUNT)
+        {
+            InsertionSort(keys, indices.Begin(), n);
+        }
+        else
+        {
+            dmArray<uint32_t>& scratch = emitter->m_SortScratch;
+            if (scratch.Capacity() < n)
+                scratch.SetCapacity(particles.Capacity());
+            scratch.SetSize(n);
+            RadixSort(keys, indices.Begin(), scratch.Begin(), n);
+        }
+
+        ApplyPermutation(particles.Begin(), indices.Begin(), n);
     }
 
 #define SAMPLE_PROP(segment, x, target)\
@@ -1378,31 +1804,11 @@ namespace dmParticle
     void EvaluateParticleProperties(Emitter* emitter, Property* particle_properties, dmParticleDDF::Emitter* emitter_ddf, float dt)
     {
         float properties[PARTICLE_KEY_COUNT];
-        // TODO Optimize this
         dmArray<Particle>& particles = emitter->m_Particles;
         uint32_t count = particles.Size();
-        for (uint32_t i = 0; i < count; ++i)
-        {
-            Particle* particle = &particles[i];
-            float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
-            uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_SCALE].m_Segments[segment_index], x, properties[PARTICLE_KEY_SCALE])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_RED].m_Segments[segment_index], x, properties[PARTICLE_KEY_RED])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_GREEN].m_Segments[segment_index], x, properties[PARTICLE_KEY_GREEN])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_BLUE].m_Segments[segment_index], x, properties[PARTICLE_KEY_BLUE])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_ALPHA].m_Segments[segment_index], x, properties[PARTICLE_KEY_ALPHA])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_STRETCH_FACTOR_X].m_Segments[segment_index], x, properties[PARTICLE_KEY_STRETCH_FACTOR_X])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_STRETCH_FACTOR_Y].m_Segments[segment_index], x, properties[PARTICLE_KEY_STRETCH_FACTOR_Y])
-            Vector4 c = particle->GetSourceColor();
-            particle->SetScale(Vector3(properties[PARTICLE_KEY_SCALE]));
-            particle->SetColor(Vector4(dmMath::Clamp(c.getX() * properties[PARTICLE_KEY_RED], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getY() * properties[PARTICLE_KEY_GREEN], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getZ() * properties[PARTICLE_KEY_BLUE], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getW() * properties[PARTICLE_KEY_ALPHA], 0.0f, 1.0f)));
-            particle->m_StretchFactorX = particle->m_SourceStretchFactorX + (properties[PARTICLE_KEY_STRETCH_FACTOR_X]);
-            particle->m_StretchFactorY = particle->m_SourceStretchFactorY + (properties[PARTICLE_KEY_STRETCH_FACTOR_Y]);
-        }
+
+        // Scale, color and stretch factors are evaluated into the streams, which are gathered in Simulate
+        EvaluateParticlePropertiesSoA(emitter->m_Streams, particle_properties);
 
         if (emitter_ddf->m_ParticleOrientation == PARTICLE_ORIENTATION_MOVEMENT_DIRECTION) {
             for (uint32_t i = 0; i < count; ++i)
@@ -1446,117 +1852,55 @@ namespace dmParticle
 
     }
 
-    void ApplyAcceleration(dmArray<Particle>& particles, Property* modifier_properties, const Quat& rotation, float scale, float emitter_t, float dt)
+    void ApplyAcceleration(ParticleSoA& streams, Property* modifier_properties, const Quat& rotation, float scale, float emitter_t, float dt)
     {
-        uint32_t particle_count = particles.Size();
         Vector3 acc_step = rotate(rotation, ACCELERATION_LOCAL_DIR) * dt * scale;
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
         uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            particle->SetVelocity(particle->GetVelocity() + acc_step * (magnitude + mag_spread * particle->GetSpreadFactor()));
-        }
+        ApplyAccelerationSoA(streams, acc_step, magnitude, magnitude_property.m_Spread);
     }
 
-    void ApplyDrag(dmArray<Particle>& particles, Property* modifier_properties, dmParticleDDF::Modifier* modifier_ddf, const Quat& rotation, float emitter_t, float dt)
+    void ApplyDrag(ParticleSoA& streams, Property* modifier_properties, dmParticleDDF::Modifier* modifier_ddf, const Quat& rotation, float emitter_t, float dt)
     {
-        uint32_t particle_count = particles.Size();
         Vector3 direction = rotate(rotation, DRAG_LOCAL_DIR);
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
         uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 v = particle->GetVelocity();
-            if (modifier_ddf->m_UseDirection)
-                v = projection(Point3(particle->GetVelocity()), direction) * direction;
-            // Applied drag > 1 means the particle would travel in the reverse direction
-            float applied_drag = dmMath::Min((magnitude + mag_spread * particle->GetSpreadFactor()) * dt, 1.0f);
-            particle->SetVelocity(particle->GetVelocity() - v * applied_drag);
-        }
+        ApplyDragSoA(streams, modifier_ddf->m_UseDirection, direction, magnitude, magnitude_property.m_Spread, dt);
     }
 
-    static Vector3 GetParticleDir(Particle* particle)
+    void ApplyRadial(ParticleSoA& streams, const dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, float scale, float emitter_t, float dt)
     {
-        return rotate(particle->GetRotation(), PARTICLE_LOCAL_BASE_DIR);
-    }
-
-    static Vector3 NonZeroVector3(Vector3 v, float sq_length, Vector3 fallback)
-    {
-        Vector3 result;
-        float neg_sq_length = -sq_length;
-        result.setX(dmMath::Select(neg_sq_length, fallback.getX(), v.getX()));
-        result.setY(dmMath::Select(neg_sq_length, fallback.getY(), v.getY()));
-        result.setZ(dmMath::Select(neg_sq_length, fallback.getZ(), v.getZ()));
-        return result;
-    }
-
-    void ApplyRadial(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, float scale, float emitter_t, float dt)
-    {
-        uint32_t particle_count = particles.Size();
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
         const Property& max_distance_property = modifier_properties[MODIFIER_KEY_MAX_DISTANCE];
         uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
         // We temporarily only sample the first frame until we have decided what to animate over
         float max_distance = max_distance_property.m_Segments[0].m_Y * scale;
         float max_sq_distance = max_distance * max_distance;
         float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 delta = particle->GetPosition() - position;
-            float delta_sq_len = lengthSqr(delta);
-            float applied_magnitude = magnitude + mag_spread * particle->GetSpreadFactor();
-            // 0 acc delta lies outside max dist
-            float a = dmMath::Select(max_sq_distance - delta_sq_len, applied_magnitude, 0.0f);
-            Vector3 dir = normalize(NonZeroVector3(delta, delta_sq_len, GetParticleDir(particle)));
-            particle->SetVelocity(particle->GetVelocity() + dir * a * applied_factor);
-        }
+        // Particles located at the position are pushed along their own direction (PARTICLE_LOCAL_BASE_DIR)
+        ApplyRadialSoA(streams, particles.Begin(), position, PARTICLE_LOCAL_BASE_DIR, magnitude, magnitude_property.m_Spread, max_sq_distance, applied_factor);
     }
 
-    void ApplyVortex(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, const Quat& rotation, float scale, float emitter_t, float dt)
+    void ApplyVortex(ParticleSoA& streams, Property* modifier_properties, const Point3& position, const Quat& rotation, float scale, float emitter_t, float dt)
     {
-        uint32_t particle_count = particles.Size();
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
         const Property& max_distance_property = modifier_properties[MODIFIER_KEY_MAX_DISTANCE];
         uint32_t segment_index = dmMath::Min((uint32_t)(emitter_t * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
-        float mag_spread = magnitude_property.m_Spread;
         // We temporarily only sample the first frame until we have decided what to animate over
         float max_distance = max_distance_property.m_Segments[0].m_Y * scale;
         float max_sq_distance = max_distance * max_distance;
         Vector3 axis = rotate(rotation, VORTEX_LOCAL_AXIS);
         Vector3 start = rotate(rotation, VORTEX_LOCAL_START_DIR);
         float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            // delta from vortex position
-            Vector3 delta = particle->GetPosition() - position;
-            // normal from vortex axis (non-unit)
-            Vector3 normal = delta - projection(Point3(delta), axis) * axis;
-            // tangent is the direction of the vortex acceleration
-            Vector3 tangent = cross(axis, normal);
-            // In case the particle is directed along the axis, give it a guaranteed orthogonal start
-            tangent = NonZeroVector3(tangent, lengthSqr(tangent), start);
-            // tangent is now guaranteed to be non-zero
-            tangent = normalize(tangent);
-            // use normal for max distance test
-            float normal_sq_len = lengthSqr(normal);
-            float acceleration = dmMath::Select(max_sq_distance - normal_sq_len, magnitude + mag_spread * particle->GetSpreadFactor(), 0.0f);
-            particle->SetVelocity(particle->GetVelocity() + tangent * acceleration * applied_factor);
-        }
+        ApplyVortexSoA(streams, position, axis, start, magnitude, magnitude_property.m_Spread, max_sq_distance, applied_factor);
     }
 
 #undef SAMPLE_PROP
@@ -1584,7 +1928,14 @@ namespace dmParticle
     {
         DM_PROFILE(__FUNCTION__);
 
+        // The simulation runs on structure-of-arrays streams, four particles at a time. The streams are
+        // gathered from the particles here and scattered back when the simulation is done.
         dmArray<Particle>& particles = emitter->m_Particles;
+        ParticleSoA& streams = emitter->m_Streams;
+        if (streams.m_Capacity < particles.Capacity())
+            streams.SetCapacity(particles.Capacity());
+        streams.Gather(particles.Begin(), particles.Size());
+
         EvaluateParticleProperties(emitter, prototype->m_ParticleProperties, ddf, dt);
         float emitter_t = dmMath::Select(-ddf->m_Duration, 0.0f, emitter->m_Timer / ddf->m_Duration);
         float scale = 1.0f;
@@ -1601,44 +1952,32 @@ namespace dmParticle
             case dmParticleDDF::MODIFIER_TYPE_ACCELERATION:
                 {
                     Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyAcceleration(particles, modifier->m_Properties, rotation, scale, emitter_t, dt);
+                    ApplyAcceleration(streams, modifier->m_Properties, rotation, scale, emitter_t, dt);
                 }
                 break;
             case dmParticleDDF::MODIFIER_TYPE_DRAG:
                 {
                     Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyDrag(particles, modifier->m_Properties, modifier_ddf, rotation, emitter_t, dt);
+                    ApplyDrag(streams, modifier->m_Properties, modifier_ddf, rotation, emitter_t, dt);
                 }
                 break;
             case dmParticleDDF::MODIFIER_TYPE_RADIAL:
                 {
                     Point3 position = CalculateModifierPosition(instance, ddf, modifier_ddf);
-                    ApplyRadial(particles, modifier->m_Properties, position, scale, emitter_t, dt);
+                    ApplyRadial(streams, particles, modifier->m_Properties, position, scale, emitter_t, dt);
                 }
                 break;
             case dmParticleDDF::MODIFIER_TYPE_VORTEX:
                 {
                     Point3 position = CalculateModifierPosition(instance, ddf, modifier_ddf);
                     Quat rotation = CalculateModifierRotation(instance, ddf, modifier_ddf);
-                    ApplyVortex(particles, modifier->m_Properties, position, rotation, scale, emitter_t, dt);
+                    ApplyVortex(streams, modifier->m_Properties, position, rotation, scale, emitter_t, dt);
                 }
                 break;
             }
         }
-        uint32_t particle_count = particles.Size();
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* p = &particles[i];
-            // NOTE This velocity integration has a larger error than normal since we don't use the velocity at the
-            // beginning of the frame, but it's ok since particle movement does not need to be very exact
-            p->SetPosition(p->GetPosition() + p->m_Velocity * dt);
-
-            p->m_Scale[0] += p->m_Scale[0] * p->m_StretchFactorX;
-            if (!ddf->m_StretchWithVelocity)
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY;
-            else
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY * length(p->m_Velocity) * STRETCH_SCALING;
-        }
+        IntegrateSoA(streams, ddf->m_StretchWithVelocity, STRETCH_SCALING, dt);
+        streams.Scatter(particles.Begin());
     }
 
     void DebugRender(HParticleContext context, void* user_context, RenderLineCallback render_line_callback)
@@ -17,6 +17,7 @@
 
 #include <dmsdk/dlib/vmath.h>
 #include <dlib/hash.h>
+#include <dlib/job_thread.h>
 #include <ddf/ddf.h>
 #include <graphics/graphics.h>
 #include "particle/particle_ddf.h"
@@ -64,6 +65,8 @@ namespace dmParticle
     extern const char* MAX_EMITTER_COUNT_KEY;
     /// Config key to use for tweaking the total maximum number of particles in a context.
     extern const char* MAX_PARTICLE_COUNT_KEY;
+    /// Config key to use for enabling parallel emitter updates on the job thread, see SetContextJobThread.
+    extern const char* PARALLEL_UPDATE_KEY;
 
     /**
      * Render constants supplied to the render callback.
@@ -212,6 +215,21 @@ namespace dmParticle
         uint32_t m_StructSize;
     };
 
+    /**
+     * Emitter to generate vertex data for, see GenerateVertexDataBatch
+     */
+    struct EmitterVertexData
+    {
+        HInstance                               m_Instance;
+        uint32_t                                m_EmitterIndex;
+        /// Attribute information on the streams to write
+        const dmGraphics::VertexAttributeInfos* m_AttributeInfos;
+        /// The particle color to (potentially) write
+        dmVMath::Vector4                        m_Color;
+        /// Result of generating the vertex data for this emitter, set by GenerateVertexDataBatch
+        GenerateVertexDataResult                m_Result;
+    };
+
     // For tests
     dmVMath::Vector3 GetPosition(HParticleContext context, HInstance instance);
 
@@ -246,6 +264,14 @@ namespace dmParticle
      */
     DM_PARTICLE_PROTO(void, SetContextMaxParticleCount, HParticleContext context, uint32_t max_particle_count);
 
+    /**
+     * Set the job thread used to update the emitters (see Update) and generate their vertex data (see GenerateVertexDataBatch) in parallel.
+     * The result is the same as when the emitters are processed on the calling thread, and the callbacks are still called from the calling thread.
+     * @param context Context to update.
+     * @param job_thread Job thread context, or 0 to process the emitters on the calling thread only (default)
+     */
+    void SetContextJobThread(HParticleContext context, dmJobThread::HContext job_thread);
+
     /**
      * Create an instance from the supplied path and fetch resources using the supplied factory.
      * @param context Context in which to create the instance, must be valid.
@@ -334,6 +360,7 @@ namespace dmParticle
 
     /**
      * Update the instances within the specified context.
+     * If the context has a job thread (see SetContextJobThread), the emitters are simulated in parallel.
      * @param context Context of the instances to update.
      * @param dt Time step.
      */
@@ -363,6 +390,20 @@ namespace dmParticle
      */
     DM_PARTICLE_PROTO(GenerateVertexDataResult, GenerateVertexData, HParticleContext context, float dt, HInstance instance, uint32_t emitter_index, const dmGraphics::VertexAttributeInfos& attribute_infos, const dmVMath::Vector4& color, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size);
 
+    /**
+     * Generates vertex data for several emitters, with the same result as calling GenerateVertexData for each of them in order.
+     * The vertex buffer range of each emitter is calculated up front, so that the emitters can be written in parallel when
+     * the context has a job thread (see SetContextJobThread). An emitter must not occur more than once in the batch.
+     * @param context Particle context
+     * @param dt Time step.
+     * @param emitters Emitters to generate vertex data for. The result of each emitter is stored in EmitterVertexData::m_Result
+     * @param emitter_count Number of emitters
+     * @param vertex_buffer Vertex buffer into which to store the particle vertex data. If this is 0x0, no data will be generated.
+     * @param vertex_buffer_size Size in bytes of the supplied vertex buffer.
+     * @param out_vertex_buffer_size Size in bytes of the total data written to vertex buffer.
+     */
+    void GenerateVertexDataBatch(HParticleContext context, float dt, EmitterVertexData* emitters, uint32_t emitter_count, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size);
+
     /**
      * Debug render the status of the instances within the specified context.
      * @param context Context of the instances to render.
@@ -20,6 +20,7 @@
 #include <dlib/transform.h>
 
 #include "particle/particle_ddf.h"
+#include "particle_soa.h"
 
 namespace dmParticle
 {
@@ -29,19 +30,6 @@ namespace dmParticle
     struct EmitterPrototype;
     struct Prototype;
 
-    /**
-     * Key when sorting particles, based on life time with additional index for stable sort
-     */
-    union SortKey
-    {
-        struct
-        {
-            uint32_t m_Index : 16;  // Index is used to ensure stable sort
-            uint32_t m_LifeTime : 16; // Quantified relative life time
-        };
-        uint32_t     m_Key;
-    };
-
     /**
      * Representation of a particle.
      *
@@ -65,7 +53,6 @@ namespace dmParticle
         GET_SET(Scale, dmVMath::Vector3)
         GET_SET(SourceColor, dmVMath::Vector4)
         GET_SET(Color, dmVMath::Vector4)
-        GET_SET(SortKey, SortKey)
 #undef GET_SET
 
         /// Position, which is defined in emitter space or world space depending on how the emitter which spawned the particles is tweaked.
@@ -93,8 +80,6 @@ namespace dmParticle
         dmVMath::Vector4     m_Color;
         /// Particle scale
         dmVMath::Vector3     m_Scale;
-        // Sorting
-        SortKey     m_SortKey;
         /// Particle stretch factor
         float       m_StretchFactorX;
         float       m_StretchFactorY;
@@ -105,6 +90,9 @@ namespace dmParticle
     /**
      * Representation of an emitter.
      */
+    /// Max number of state changes of an emitter during one update (prespawn -> spawning -> postspawn -> sleeping)
+    const uint32_t MAX_DEFERRED_STATE_CHANGES = 3;
+
     struct Emitter
     {
         Emitter()
@@ -115,6 +103,12 @@ namespace dmParticle
         AnimationData           m_AnimationData;
         /// Particle buffer.
         dmArray<Particle>       m_Particles;
+        /// Simulation streams, see Simulate().
+        ParticleSoA             m_Streams;
+        /// Sort keys (relative life time) and scratch buffers for sorting the particles, see SortParticles().
+        dmArray<uint16_t>       m_SortKeys;
+        dmArray<uint32_t>       m_SortIndices;
+        dmArray<uint32_t>       m_SortScratch;
         dmArray<RenderConstant> m_RenderConstants;
         dmVMath::Vector3        m_Velocity;
         dmVMath::Point3         m_LastPosition;
@@ -148,6 +142,12 @@ namespace dmParticle
         uint16_t                m_Retiring : 1;
         /// If this emitter needs to be rehashed
         uint16_t                m_ReHash : 1;
+        /// If state changes should be stored in m_DeferredStates instead of calling the callback, see SetEmitterState()
+        uint16_t                m_DeferStateChanges : 1;
+        /// Number of deferred state changes
+        uint8_t                 m_DeferredStateCount;
+        /// State changes made while being updated on a job thread, in order
+        uint8_t                 m_DeferredStates[MAX_DEFERRED_STATE_CHANGES];
     };
 
     struct Instance
@@ -182,6 +182,26 @@ namespace dmParticle
         uint16_t                m_ScaleAlongZ : 1;
     };
 
+    /**
+     * Emitter processed by a job, see Update() and GenerateVertexDataBatch()
+     */
+    struct EmitterJobItem
+    {
+        Instance*                   m_Instance;
+        HInstance                   m_InstanceHandle;
+        uint32_t                    m_EmitterIndex;
+        /// Vertex data to generate, only used by GenerateVertexDataBatch()
+        EmitterVertexData*          m_VertexData;
+        /// Vertex index of the first particle, only used by GenerateVertexDataBatch()
+        uint32_t                    m_VertexIndex;
+    };
+
+    struct EmitterJobRange
+    {
+        uint32_t                    m_Begin;
+        uint32_t                    m_End;
+    };
+
     /**
      * Representation of a context to hold a set of emitters.
      */
@@ -192,6 +212,7 @@ namespace dmParticle
         , m_MaxParticleCount(max_particle_count)
         , m_NextVersionNumber(1)
         , m_InstanceSeeding(0)
+        , m_JobThread(0)
         {
             memset(&m_Stats, 0, sizeof(m_Stats));
             m_Instances.SetCapacity(max_instance_count);
@@ -224,6 +245,12 @@ namespace dmParticle
         uint16_t            m_InstanceSeeding;
         /// Stats
         Stats               m_Stats;
+        /// Job thread used to process the emitters in parallel, see SetContextJobThread()
+        dmJobThread::HContext       m_JobThread;
+        /// Emitters of the current Update() or GenerateVertexDataBatch(), in the order they would be processed serially
+        dmArray<EmitterJobItem>     m_JobItems;
+        /// Consecutive ranges of m_JobItems, one per job
+        dmArray<EmitterJobRange>    m_JobRanges;
     };
 
     struct LinearSegment
@@ -0,0 +1,498 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "particle_soa.h"
+
+#include <assert.h>
+#include <string.h>
+#include <dlib/math.h>
+#include <dlib/simd.h>
+
+#include "particle.h"
+#include "particle_private.h"
+
+namespace dmParticle
+{
+    using namespace dmSimd;
+    using namespace dmVMath;
+
+    // Extra room to allow reading 4 entries at the end of a stream
+    static const uint32_t SOA_PADDING = 3;
+
+    // The streams are zeroed, so that the kernels never see uninitialized lanes
+    template <typename T>
+    static void SetStreamCapacity(dmArray<T>& stream, uint32_t capacity)
+    {
+        stream.SetCapacity(capacity);
+        stream.SetSize(capacity);
+        if (capacity > 0)
+            memset(stream.Begin(), 0, capacity * sizeof(T));
+    }
+
+    void ParticleSoA::SetCapacity(uint32_t capacity)
+    {
+        uint32_t c = capacity > 0 ? capacity + SOA_PADDING : 0;
+        SetStreamCapacity(m_PosX, c);
+        SetStreamCapacity(m_PosY, c);
+        SetStreamCapacity(m_PosZ, c);
+        SetStreamCapacity(m_VelX, c);
+        SetStreamCapacity(m_VelY, c);
+        SetStreamCapacity(m_VelZ, c);
+        SetStreamCapacity(m_SpreadFactor, c);
+        SetStreamCapacity(m_Life, c);
+        SetStreamCapacity(m_Segment, c);
+        SetStreamCapacity(m_ColorR, c);
+        SetStreamCapacity(m_ColorG, c);
+        SetStreamCapacity(m_ColorB, c);
+        SetStreamCapacity(m_ColorA, c);
+        SetStreamCapacity(m_StretchFactorX, c);
+        SetStreamCapacity(m_StretchFactorY, c);
+        SetStreamCapacity(m_Scale, c);
+        SetStreamCapacity(m_ScaleX, c);
+        SetStreamCapacity(m_ScaleY, c);
+        m_Count = 0;
+        m_Capacity = capacity;
+    }
+
+    void ParticleSoA::Swap(ParticleSoA& other)
+    {
+        m_PosX.Swap(other.m_PosX);
+        m_PosY.Swap(other.m_PosY);
+        m_PosZ.Swap(other.m_PosZ);
+        m_VelX.Swap(other.m_VelX);
+        m_VelY.Swap(other.m_VelY);
+        m_VelZ.Swap(other.m_VelZ);
+        m_SpreadFactor.Swap(other.m_SpreadFactor);
+        m_Life.Swap(other.m_Life);
+        m_Segment.Swap(other.m_Segment);
+        m_ColorR.Swap(other.m_ColorR);
+        m_ColorG.Swap(other.m_ColorG);
+        m_ColorB.Swap(other.m_ColorB);
+        m_ColorA.Swap(other.m_ColorA);
+        m_StretchFactorX.Swap(other.m_StretchFactorX);
+        m_StretchFactorY.Swap(other.m_StretchFactorY);
+        m_Scale.Swap(other.m_Scale);
+        m_ScaleX.Swap(other.m_ScaleX);
+        m_ScaleY.Swap(other.m_ScaleY);
+        uint32_t tmp = m_Count;
+        m_Count = other.m_Count;
+        other.m_Count = tmp;
+        tmp = m_Capacity;
+        m_Capacity = other.m_Capacity;
+        other.m_Capacity = tmp;
+    }
+
+    // Reads the first four floats of a Point3, Vector3 or Vector4
+    static inline Vec4f LoadVector(const void* v)
+    {
+        return Load((const float*) v);
+    }
+
+    // Writes the per particle values that are not vectors
+    static inline void GatherScalars(ParticleSoA& soa, const Particle* p, uint32_t i)
+    {
+        // Same as the scalar sampling in EvaluateParticleProperties
+        float x = dmMath::Select(-p->m_MaxLifeTime, 0.0f, 1.0f - p->m_TimeLeft * p->m_ooMaxLifeTime);
+        soa.m_Life.Begin()[i] = x;
+        soa.m_Segment.Begin()[i] = (uint8_t) dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
+        soa.m_SpreadFactor.Begin()[i] = p->m_SpreadFactor;
+        soa.m_StretchFactorX.Begin()[i] = p->m_SourceStretchFactorX;
+        soa.m_StretchFactorY.Begin()[i] = p->m_SourceStretchFactorY;
+    }
+
+    void ParticleSoA::Gather(const Particle* particles, uint32_t count)
+    {
+        assert(count <= m_Capacity);
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const Particle* p0 = &particles[i + 0];
+            const Particle* p1 = &particles[i + 1];
+            const Particle* p2 = &particles[i + 2];
+            const Particle* p3 = &particles[i + 3];
+
+            Vec4f x = LoadVector(&p0->m_Position);
+            Vec4f y = LoadVector(&p1->m_Position);
+            Vec4f z = LoadVector(&p2->m_Position);
+            Vec4f w = LoadVector(&p3->m_Position);
+            Transpose(x, y, z, w);
+            Store(m_PosX.Begin() + i, x);
+            Store(m_PosY.Begin() + i, y);
+            Store(m_PosZ.Begin() + i, z);
+
+            x = LoadVector(&p0->m_Velocity);
+            y = LoadVector(&p1->m_Velocity);
+            z = LoadVector(&p2->m_Velocity);
+            w = LoadVector(&p3->m_Velocity);
+            Transpose(x, y, z, w);
+            Store(m_VelX.Begin() + i, x);
+            Store(m_VelY.Begin() + i, y);
+            Store(m_VelZ.Begin() + i, z);
+
+            x = LoadVector(&p0->m_SourceColor);
+            y = LoadVector(&p1->m_SourceColor);
+            z = LoadVector(&p2->m_SourceColor);
+            w = LoadVector(&p3->m_SourceColor);
+            Transpose(x, y, z, w);
+            Store(m_ColorR.Begin() + i, x);
+            Store(m_ColorG.Begin() + i, y);
+            Store(m_ColorB.Begin() + i, z);
+            Store(m_ColorA.Begin() + i, w);
+
+            GatherScalars(*this, p0, i + 0);
+            GatherScalars(*this, p1, i + 1);
+            GatherScalars(*this, p2, i + 2);
+            GatherScalars(*this, p3, i + 3);
+        }
+        for (; i < count; ++i)
+        {
+            const Particle* p = &particles[i];
+            m_PosX[i] = p->m_Position.getX();
+            m_PosY[i] = p->m_Position.getY();
+            m_PosZ[i] = p->m_Position.getZ();
+            m_VelX[i] = p->m_Velocity.getX();
+            m_VelY[i] = p->m_Velocity.getY();
+            m_VelZ[i] = p->m_Velocity.getZ();
+            m_ColorR[i] = p->m_SourceColor.getX();
+            m_ColorG[i] = p->m_SourceColor.getY();
+            m_ColorB[i] = p->m_SourceColor.getZ();
+            m_ColorA[i] = p->m_SourceColor.getW();
+            GatherScalars(*this, p, i);
+        }
+
+        // Zero the padding, also when the count shrinks. It is processed by the kernels but never scattered.
+        uint32_t end = dmMath::Min(count + SOA_PADDING, m_PosX.Size());
+        for (i = count; i < end; ++i)
+        {
+            m_PosX[i] = m_PosY[i] = m_PosZ[i] = 0.0f;
+            m_VelX[i] = m_VelY[i] = m_VelZ[i] = 0.0f;
+            m_ColorR[i] = m_ColorG[i] = m_ColorB[i] = m_ColorA[i] = 0.0f;
+            m_SpreadFactor[i] = m_Life[i] = 0.0f;
+            m_StretchFactorX[i] = m_StretchFactorY[i] = 0.0f;
+            m_Scale[i] = m_ScaleX[i] = m_ScaleY[i] = 0.0f;
+            m_Segment[i] = 0;
+        }
+        m_Count = count;
+    }
+
+    void ParticleSoA::Scatter(Particle* particles) const
+    {
+        uint32_t count = m_Count;
+        const Vec4f zero = Zero();
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            Particle* p0 = &particles[i + 0];
+            Particle* p1 = &particles[i + 1];
+            Particle* p2 = &particles[i + 2];
+            Particle* p3 = &particles[i + 3];
+
+            // The w component of Point3 and Vector3 is unused
+            Vec4f x = Load(m_PosX.Begin() + i);
+            Vec4f y = Load(m_PosY.Begin() + i);
+            Vec4f z = Load(m_PosZ.Begin() + i);
+            Vec4f w = zero;
+            Transpose(x, y, z, w);
+            Store((float*) &p0->m_Position, x);
+            Store((float*) &p1->m_Position, y);
+            Store((float*) &p2->m_Position, z);
+            Store((float*) &p3->m_Position, w);
+
+            x = Load(m_VelX.Begin() + i);
+            y = Load(m_VelY.Begin() + i);
+            z = Load(m_VelZ.Begin() + i);
+            w = zero;
+            Transpose(x, y, z, w);
+            Store((float*) &p0->m_Velocity, x);
+            Store((float*) &p1->m_Velocity, y);
+            Store((float*) &p2->m_Velocity, z);
+            Store((float*) &p3->m_Velocity, w);
+
+            x = Load(m_ColorR.Begin() + i);
+            y = Load(m_ColorG.Begin() + i);
+            z = Load(m_ColorB.Begin() + i);
+            w = Load(m_ColorA.Begin() + i);
+            Transpose(x, y, z, w);
+            Store((float*) &p0->m_Color, x);
+            Store((float*) &p1->m_Color, y);
+            Store((float*) &p2->m_Color, z);
+            Store((float*) &p3->m_Color, w);
+
+            x = Load(m_ScaleX.Begin() + i);
+            y = Load(m_ScaleY.Begin() + i);
+            z = Load(m_Scale.Begin() + i);
+            w = zero;
+            Transpose(x, y, z, w);
+            Store((float*) &p0->m_Scale, x);
+            Store((float*) &p1->m_Scale, y);
+            Store((float*) &p2->m_Scale, z);
+            Store((float*) &p3->m_Scale, w);
+
+            p0->m_StretchFactorX = m_StretchFactorX.Begin()[i + 0];
+            p0->m_StretchFactorY = m_StretchFactorY.Begin()[i + 0];
+            p1->m_StretchFactorX = m_StretchFactorX.Begin()[i + 1];
+            p1->m_StretchFactorY = m_StretchFactorY.Begin()[i + 1];
+            p2->m_StretchFactorX = m_StretchFactorX.Begin()[i + 2];
+            p2->m_StretchFactorY = m_StretchFactorY.Begin()[i + 2];
+            p3->m_StretchFactorX = m_StretchFactorX.Begin()[i + 3];
+            p3->m_StretchFactorY = m_StretchFactorY.Begin()[i + 3];
+        }
+        for (; i < count; ++i)
+        {
+            Particle* p = &particles[i];
+            p->m_Position = Point3(m_PosX[i], m_PosY[i], m_PosZ[i]);
+            p->m_Velocity = Vector3(m_VelX[i], m_VelY[i], m_VelZ[i]);
+            p->m_Color = Vector4(m_ColorR[i], m_ColorG[i], m_ColorB[i], m_ColorA[i]);
+            p->m_Scale = Vector3(m_ScaleX[i], m_ScaleY[i], m_Scale[i]);
+            p->m_StretchFactorX = m_StretchFactorX[i];
+            p->m_StretchFactorY = m_StretchFactorY[i];
+        }
+    }
+
+    // Gathers the linear segments of four particles and samples them: (x - s.m_X) * s.m_K + s.m_Y
+    static inline Vec4f SampleProperty(const Property& property, const uint8_t* segments, Vec4f x)
+    {
+        // Four floats are read per segment, the last segment is followed by Property::m_Spread
+        Vec4f s0 = Load(&property.m_Segments[segments[0]].m_X);
+        Vec4f s1 = Load(&property.m_Segments[segments[1]].m_X);
+        Vec4f s2 = Load(&property.m_Segments[segments[2]].m_X);
+        Vec4f s3 = Load(&property.m_Segments[segments[3]].m_X);
+        Transpose(s0, s1, s2, s3);
+        // s0 = x, s1 = y, s2 = k
+        return Add(Mul(Sub(x, s0), s2), s1);
+    }
+
+    static inline Vec4f Saturate(Vec4f v, Vec4f zero, Vec4f one)
+    {
+        return Min(Max(v, zero), one);
+    }
+
+    void EvaluateParticlePropertiesSoA(ParticleSoA& soa, const Property* particle_properties)
+    {
+        const Property& scale_property = particle_properties[dmParticleDDF::PARTICLE_KEY_SCALE];
+        const Property& red_property = particle_properties[dmParticleDDF::PARTICLE_KEY_RED];
+        const Property& green_property = particle_properties[dmParticleDDF::PARTICLE_KEY_GREEN];
+        const Property& blue_property = particle_properties[dmParticleDDF::PARTICLE_KEY_BLUE];
+        const Property& alpha_property = particle_properties[dmParticleDDF::PARTICLE_KEY_ALPHA];
+        const Property& stretch_x_property = particle_properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_X];
+        const Property& stretch_y_property = particle_properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_Y];
+
+        const Vec4f zero = Zero();
+        const Vec4f one = Splat(1.0f);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            const uint8_t* segments = soa.m_Segment.Begin() + i;
+            Vec4f x = Load(soa.m_Life.Begin() + i);
+
+            Store(soa.m_Scale.Begin() + i, SampleProperty(scale_property, segments, x));
+
+            Vec4f r = Mul(Load(soa.m_ColorR.Begin() + i), SampleProperty(red_property, segments, x));
+            Vec4f g = Mul(Load(soa.m_ColorG.Begin() + i), SampleProperty(green_property, segments, x));
+            Vec4f b = Mul(Load(soa.m_ColorB.Begin() + i), SampleProperty(blue_property, segments, x));
+            Vec4f a = Mul(Load(soa.m_ColorA.Begin() + i), SampleProperty(alpha_property, segments, x));
+            Store(soa.m_ColorR.Begin() + i, Saturate(r, zero, one));
+            Store(soa.m_ColorG.Begin() + i, Saturate(g, zero, one));
+            Store(soa.m_ColorB.Begin() + i, Saturate(b, zero, one));
+            Store(soa.m_ColorA.Begin() + i, Saturate(a, zero, one));
+
+            Vec4f sx = Add(Load(soa.m_StretchFactorX.Begin() + i), SampleProperty(stretch_x_property, segments, x));
+            Vec4f sy = Add(Load(soa.m_StretchFactorY.Begin() + i), SampleProperty(stretch_y_property, segments, x));
+            Store(soa.m_StretchFactorX.Begin() + i, sx);
+            Store(soa.m_StretchFactorY.Begin() + i, sy);
+        }
+    }
+
+    void ApplyAccelerationSoA(ParticleSoA& soa, const Vector3& acc_step, float magnitude, float mag_spread)
+    {
+        const Vec4f step_x = Splat(acc_step.getX());
+        const Vec4f step_y = Splat(acc_step.getY());
+        const Vec4f step_z = Splat(acc_step.getZ());
+        const Vec4f mag = Splat(magnitude);
+        const Vec4f spread = Splat(mag_spread);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec4f m = Add(mag, Mul(spread, Load(soa.m_SpreadFactor.Begin() + i)));
+            Store(soa.m_VelX.Begin() + i, Add(Load(soa.m_VelX.Begin() + i), Mul(step_x, m)));
+            Store(soa.m_VelY.Begin() + i, Add(Load(soa.m_VelY.Begin() + i), Mul(step_y, m)));
+            Store(soa.m_VelZ.Begin() + i, Add(Load(soa.m_VelZ.Begin() + i), Mul(step_z, m)));
+        }
+    }
+
+    void ApplyDragSoA(ParticleSoA& soa, bool use_direction, const Vector3& direction, float magnitude, float mag_spread, float dt)
+    {
+        const Vec4f dir_x = Splat(direction.getX());
+        const Vec4f dir_y = Splat(direction.getY());
+        const Vec4f dir_z = Splat(direction.getZ());
+        const Vec4f mag = Splat(magnitude);
+        const Vec4f spread = Splat(mag_spread);
+        const Vec4f vdt = Splat(dt);
+        const Vec4f one = Splat(1.0f);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec4f vel_x = Load(soa.m_VelX.Begin() + i);
+            Vec4f vel_y = Load(soa.m_VelY.Begin() + i);
+            Vec4f vel_z = Load(soa.m_VelZ.Begin() + i);
+            Vec4f v_x = vel_x;
+            Vec4f v_y = vel_y;
+            Vec4f v_z = vel_z;
+            if (use_direction)
+            {
+                Vec4f d = Add(Add(Mul(vel_x, dir_x), Mul(vel_y, dir_y)), Mul(vel_z, dir_z));
+                v_x = Mul(dir_x, d);
+                v_y = Mul(dir_y, d);
+                v_z = Mul(dir_z, d);
+            }
+            // Applied drag > 1 means the particle would travel in the reverse direction
+            Vec4f applied_drag = Min(Mul(Add(mag, Mul(spread, Load(soa.m_SpreadFactor.Begin() + i))), vdt), one);
+            Store(soa.m_VelX.Begin() + i, Sub(vel_x, Mul(v_x, applied_drag)));
+            Store(soa.m_VelY.Begin() + i, Sub(vel_y, Mul(v_y, applied_drag)));
+            Store(soa.m_VelZ.Begin() + i, Sub(vel_z, Mul(v_z, applied_drag)));
+        }
+    }
+
+    static inline Vec4f LengthSqr(Vec4f x, Vec4f y, Vec4f z)
+    {
+        return Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z));
+    }
+
+    void ApplyRadialSoA(ParticleSoA& soa, const Particle* particles, const Point3& position, const Vector3& particle_local_dir, float magnitude, float mag_spread, float max_sq_distance, float applied_factor)
+    {
+        const Vec4f pos_x = Splat(position.getX());
+        const Vec4f pos_y = Splat(position.getY());
+        const Vec4f pos_z = Splat(position.getZ());
+        const Vec4f mag = Splat(magnitude);
+        const Vec4f spread = Splat(mag_spread);
+        const Vec4f max_sq = Splat(max_sq_distance);
+        const Vec4f factor = Splat(applied_factor);
+        const Vec4f zero = Zero();
+        const Vec4f one = Splat(1.0f);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec4f delta_x = Sub(Load(soa.m_PosX.Begin() + i), pos_x);
+            Vec4f delta_y = Sub(Load(soa.m_PosY.Begin() + i), pos_y);
+            Vec4f delta_z = Sub(Load(soa.m_PosZ.Begin() + i), pos_z);
+            Vec4f delta_sq_len = LengthSqr(delta_x, delta_y, delta_z);
+            Vec4f applied_magnitude = Add(mag, Mul(spread, Load(soa.m_SpreadFactor.Begin() + i)));
+            // 0 acc delta lies outside max dist
+            Vec4f a = Select(CmpLt(Sub(max_sq, delta_sq_len), zero), zero, applied_magnitude);
+
+            // Particles located at the position are pushed along their own direction. This is rare, so it is checked per lane
+            float sq_len[4];
+            Store(sq_len, delta_sq_len);
+            uint32_t lanes = dmMath::Min(count - i, 4u);
+            for (uint32_t l = 0; l < lanes; ++l)
+            {
+                if (sq_len[l] <= 0.0f)
+                {
+                    Vector3 dir = rotate(particles[i + l].m_Rotation, particle_local_dir);
+                    float fallback[3][4];
+                    Store(fallback[0], delta_x);
+                    Store(fallback[1], delta_y);
+                    Store(fallback[2], delta_z);
+                    fallback[0][l] = dir.getX();
+                    fallback[1][l] = dir.getY();
+                    fallback[2][l] = dir.getZ();
+                    delta_x = Load(fallback[0]);
+                    delta_y = Load(fallback[1]);
+                    delta_z = Load(fallback[2]);
+                }
+            }
+
+            Vec4f inv_len = Div(one, Sqrt(LengthSqr(delta_x, delta_y, delta_z)));
+            Store(soa.m_VelX.Begin() + i, Add(Load(soa.m_VelX.Begin() + i), Mul(Mul(Mul(delta_x, inv_len), a), factor)));
+            Store(soa.m_VelY.Begin() + i, Add(Load(soa.m_VelY.Begin() + i), Mul(Mul(Mul(delta_y, inv_len), a), factor)));
+            Store(soa.m_VelZ.Begin() + i, Add(Load(soa.m_VelZ.Begin() + i), Mul(Mul(Mul(delta_z, inv_len), a), factor)));
+        }
+    }
+
+    void ApplyVortexSoA(ParticleSoA& soa, const Point3& position, const Vector3& axis, const Vector3& start, float magnitude, float mag_spread, float max_sq_distance, float applied_factor)
+    {
+        const Vec4f pos_x = Splat(position.getX());
+        const Vec4f pos_y = Splat(position.getY());
+        const Vec4f pos_z = Splat(position.getZ());
+        const Vec4f axis_x = Splat(axis.getX());
+        const Vec4f axis_y = Splat(axis.getY());
+        const Vec4f axis_z = Splat(axis.getZ());
+        const Vec4f start_x = Splat(start.getX());
+        const Vec4f start_y = Splat(start.getY());
+        const Vec4f start_z = Splat(start.getZ());
+        const Vec4f mag = Splat(magnitude);
+        const Vec4f spread = Splat(mag_spread);
+        const Vec4f max_sq = Splat(max_sq_distance);
+        const Vec4f factor = Splat(applied_factor);
+        const Vec4f zero = Zero();
+        const Vec4f one = Splat(1.0f);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            // delta from vortex position
+            Vec4f delta_x = Sub(Load(soa.m_PosX.Begin() + i), pos_x);
+            Vec4f delta_y = Sub(Load(soa.m_PosY.Begin() + i), pos_y);
+            Vec4f delta_z = Sub(Load(soa.m_PosZ.Begin() + i), pos_z);
+            // normal from vortex axis (non-unit)
+            Vec4f d = Add(Add(Mul(delta_x, axis_x), Mul(delta_y, axis_y)), Mul(delta_z, axis_z));
+            Vec4f normal_x = Sub(delta_x, Mul(axis_x, d));
+            Vec4f normal_y = Sub(delta_y, Mul(axis_y, d));
+            Vec4f normal_z = Sub(delta_z, Mul(axis_z, d));
+            // tangent is the direction of the vortex acceleration
+            Vec4f tangent_x = Sub(Mul(axis_y, normal_z), Mul(axis_z, normal_y));
+            Vec4f tangent_y = Sub(Mul(axis_z, normal_x), Mul(axis_x, normal_z));
+            Vec4f tangent_z = Sub(Mul(axis_x, normal_y), Mul(axis_y, normal_x));
+            // In case the particle is directed along the axis, give it a guaranteed orthogonal start
+            Vec4f non_zero = CmpGt(LengthSqr(tangent_x, tangent_y, tangent_z), zero);
+            tangent_x = Select(non_zero, tangent_x, start_x);
+            tangent_y = Select(non_zero, tangent_y, start_y);
+            tangent_z = Select(non_zero, tangent_z, start_z);
+            Vec4f inv_len = Div(one, Sqrt(LengthSqr(tangent_x, tangent_y, tangent_z)));
+            tangent_x = Mul(tangent_x, inv_len);
+            tangent_y = Mul(tangent_y, inv_len);
+            tangent_z = Mul(tangent_z, inv_len);
+            // use normal for max distance test
+            Vec4f normal_sq_len = LengthSqr(normal_x, normal_y, normal_z);
+            Vec4f acceleration = Select(CmpLt(Sub(max_sq, normal_sq_len), zero), zero, Add(mag, Mul(spread, Load(soa.m_SpreadFactor.Begin() + i))));
+            Store(soa.m_VelX.Begin() + i, Add(Load(soa.m_VelX.Begin() + i), Mul(Mul(tangent_x, acceleration), factor)));
+            Store(soa.m_VelY.Begin() + i, Add(Load(soa.m_VelY.Begin() + i), Mul(Mul(tangent_y, acceleration), factor)));
+            Store(soa.m_VelZ.Begin() + i, Add(Load(soa.m_VelZ.Begin() + i), Mul(Mul(tangent_z, acceleration), factor)));
+        }
+    }
+
+    void IntegrateSoA(ParticleSoA& soa, bool stretch_with_velocity, float stretch_scaling, float dt)
+    {
+        const Vec4f vdt = Splat(dt);
+        const Vec4f scaling = Splat(stretch_scaling);
+        uint32_t count = soa.m_Count;
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            Vec4f vel_x = Load(soa.m_VelX.Begin() + i);
+            Vec4f vel_y = Load(soa.m_VelY.Begin() + i);
+            Vec4f vel_z = Load(soa.m_VelZ.Begin() + i);
+            // NOTE This velocity integration has a larger error than normal since we don't use the velocity at the
+            // beginning of the frame, but it's ok since particle movement does not need to be very exact
+            Store(soa.m_PosX.Begin() + i, Add(Load(soa.m_PosX.Begin() + i), Mul(vel_x, vdt)));
+            Store(soa.m_PosY.Begin() + i, Add(Load(soa.m_PosY.Begin() + i), Mul(vel_y, vdt)));
+            Store(soa.m_PosZ.Begin() + i, Add(Load(soa.m_PosZ.Begin() + i), Mul(vel_z, vdt)));
+
+            Vec4f scale = Load(soa.m_Scale.Begin() + i);
+            Store(soa.m_ScaleX.Begin() + i, Add(scale, Mul(scale, Load(soa.m_StretchFactorX.Begin() + i))));
+            Vec4f stretch_y = Mul(scale, Load(soa.m_StretchFactorY.Begin() + i));
+            if (stretch_with_velocity)
+                stretch_y = Mul(Mul(stretch_y, Sqrt(LengthSqr(vel_x, vel_y, vel_z))), scaling);
+            Store(soa.m_ScaleY.Begin() + i, Add(scale, stretch_y));
+        }
+    }
+}
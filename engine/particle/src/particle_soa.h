@@ -0,0 +1,91 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_PARTICLE_SOA_H
+#define DM_PARTICLE_SOA_H
+
+#include <stdint.h>
+#include <dlib/array.h>
+#include <dmsdk/dlib/vmath.h>
+
+namespace dmParticle
+{
+    struct Particle;
+    struct Property;
+
+    /*
+     * Structure-of-arrays copy of the particle state that is touched by the simulation, see Simulate().
+     * The particles (dmArray<Particle>) are still the owners of the state, the streams are gathered from them
+     * before the simulation and scattered back afterwards. The streams are kept by the emitter to reuse the memory.
+     * Each stream has room for 3 extra entries, so that the kernels can always process 4 particles at a time.
+     * Must be valid when zero initialized, since emitters are memset.
+     */
+    struct ParticleSoA
+    {
+        ParticleSoA() : m_Count(0), m_Capacity(0) {}
+
+        void SetCapacity(uint32_t capacity);
+        void Swap(ParticleSoA& other);
+
+        // Copies the simulation state of the particles to the streams
+        void Gather(const Particle* particles, uint32_t count);
+        // Copies the simulated state back to the particles
+        void Scatter(Particle* particles) const;
+
+        dmArray<float>      m_PosX;
+        dmArray<float>      m_PosY;
+        dmArray<float>      m_PosZ;
+        dmArray<float>      m_VelX;
+        dmArray<float>      m_VelY;
+        dmArray<float>      m_VelZ;
+        dmArray<float>      m_SpreadFactor;
+        /// Relative life time [0,1] of the particle, used to sample the particle properties
+        dmArray<float>      m_Life;
+        /// Property segment index that corresponds to m_Life
+        dmArray<uint8_t>    m_Segment;
+        /// Source color when gathered, the evaluated color after EvaluateParticlePropertiesSoA
+        dmArray<float>      m_ColorR;
+        dmArray<float>      m_ColorG;
+        dmArray<float>      m_ColorB;
+        dmArray<float>      m_ColorA;
+        /// Source stretch factor when gathered, the evaluated stretch factor after EvaluateParticlePropertiesSoA
+        dmArray<float>      m_StretchFactorX;
+        dmArray<float>      m_StretchFactorY;
+        /// Evaluated scale, and the scale after stretching (see IntegrateSoA)
+        dmArray<float>      m_Scale;
+        dmArray<float>      m_ScaleX;
+        dmArray<float>      m_ScaleY;
+        uint32_t            m_Count;
+        uint32_t            m_Capacity;
+    };
+
+    /*
+     * Kernels, four particles per iteration. They give the same result as the scalar code they replace in particle.cpp,
+     * since the operations are done in the same order.
+     */
+
+    /// Samples the scale, color and stretch factor properties
+    void EvaluateParticlePropertiesSoA(ParticleSoA& soa, const Property* particle_properties);
+    /// velocity += acc_step * (magnitude + mag_spread * spread_factor)
+    void ApplyAccelerationSoA(ParticleSoA& soa, const dmVMath::Vector3& acc_step, float magnitude, float mag_spread);
+    /// Direction is only used if use_direction is set, otherwise the drag is applied along the velocity
+    void ApplyDragSoA(ParticleSoA& soa, bool use_direction, const dmVMath::Vector3& direction, float magnitude, float mag_spread, float dt);
+    /// Particles located exactly at the position are pushed along their own direction, i.e. their rotation applied to particle_local_dir
+    void ApplyRadialSoA(ParticleSoA& soa, const Particle* particles, const dmVMath::Point3& position, const dmVMath::Vector3& particle_local_dir, float magnitude, float mag_spread, float max_sq_distance, float applied_factor);
+    void ApplyVortexSoA(ParticleSoA& soa, const dmVMath::Point3& position, const dmVMath::Vector3& axis, const dmVMath::Vector3& start, float magnitude, float mag_spread, float max_sq_distance, float applied_factor);
+    /// Integrates the position and applies the stretch factors to the scale
+    void IntegrateSoA(ParticleSoA& soa, bool stretch_with_velocity, float stretch_scaling, float dt);
+}
+
+#endif // DM_PARTICLE_SOA_H
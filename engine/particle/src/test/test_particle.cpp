@@ -1518,24 +1518,25 @@ TEST_F(ParticleTest, InvalidKeys)
     ASSERT_TRUE(LoadPrototype("invalid_keys.particlefxc", &m_Prototype));
 }
 
-TEST_F(ParticleTest, StableSort)
+// Emitters with at most 256 particles use insertion sort, larger ones radix sort (see SortParticles)
+static void VerifyStableSort(dmParticle::HParticleContext context, dmParticle::HPrototype prototype, uint32_t particle_count)
 {
     float dt = 1.0f / 60.0f;
 
-    ASSERT_TRUE(LoadPrototype("sort.particlefxc", &m_Prototype));
-    dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+    dmParticle::HInstance instance = dmParticle::CreateInstance(context, prototype, 0x0);
     uint16_t index = instance & 0xffff;
 
-    dmParticle::Instance* i = m_Context->m_Instances[index];
+    dmParticle::Instance* i = context->m_Instances[index];
 
-    dmParticle::StartInstance(m_Context, instance);
+    dmParticle::StartInstance(context, instance);
 
-    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(context, dt, 0x0);
 
-    const uint32_t particle_count = 20;
     ASSERT_EQ(particle_count, i->m_Emitters[0].m_Particles.Size());
 
-    float x[particle_count];
+    dmArray<float> x;
+    x.SetCapacity(particle_count);
+    x.SetSize(particle_count);
     dmParticle::Particle* p = &i->m_Emitters[0].m_Particles[0];
     // Store x-positions
     for (uint32_t pi = 0; pi < particle_count; ++pi)
@@ -1557,16 +1558,28 @@ TEST_F(ParticleTest, StableSort)
         p[d].SetPosition(pos);
     }
     // Sort
-    dmParticle::Update(m_Context, dt, 0x0);
+    dmParticle::Update(context, dt, 0x0);
     // Sort verification
-    std::sort(x, x+particle_count);
+    std::sort(x.Begin(), x.End());
     // Verify order of undisturbed
     for (uint32_t pi = 0; pi < particle_count; ++pi)
     {
         ASSERT_EQ(x[pi], p[pi].GetPosition().getX());
     }
 
-    dmParticle::DestroyInstance(m_Context, instance);
+    dmParticle::DestroyInstance(context, instance);
+}
+
+TEST_F(ParticleTest, StableSort)
+{
+    ASSERT_TRUE(LoadPrototype("sort.particlefxc", &m_Prototype));
+    VerifyStableSort(m_Context, m_Prototype, 20);
+}
+
+TEST_F(ParticleTest, StableSortLarge)
+{
+    ASSERT_TRUE(LoadPrototype("sort_large.particlefxc", &m_Prototype));
+    VerifyStableSort(m_Context, m_Prototype, 1000);
 }
 
 TEST_F(ParticleTest, ReloadPrototype)
@@ -2202,6 +2215,242 @@ TEST_F(ParticleTest, Pivot)
     dmParticle::DestroyInstance(m_Context, instance);
 }
 
+struct StateChangeRecord
+{
+    dmhash_t                m_EmitterId;
+    dmParticle::EmitterState m_State;
+    uint32_t                m_NumAwakeEmitters;
+};
+
+// Allocated with malloc, since it is freed by the particle system
+struct StateChangeRecorder
+{
+    dmArray<StateChangeRecord>* m_Records;
+};
+
+static void RecordStateChangedCallback(uint32_t num_awake_emitters, dmhash_t emitter_id, dmParticle::EmitterState emitter_state, void* user_data)
+{
+    dmArray<StateChangeRecord>* records = ((StateChangeRecorder*) user_data)->m_Records;
+    StateChangeRecord record;
+    record.m_EmitterId = emitter_id;
+    record.m_State = emitter_state;
+    record.m_NumAwakeEmitters = num_awake_emitters;
+    if (records->Full())
+        records->OffsetCapacity(64);
+    records->Push(record);
+}
+
+static void CreateParallelTestInstances(dmParticle::HParticleContext context, dmParticle::HPrototype* prototypes, uint32_t prototype_count, dmParticle::HInstance* instances, uint32_t instance_count, dmArray<StateChangeRecord>* records)
+{
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        StateChangeRecorder* recorder = (StateChangeRecorder*) malloc(sizeof(StateChangeRecorder));
+        recorder->m_Records = records;
+        dmParticle::EmitterStateChangedData callback_data;
+        callback_data.m_StateChangedCallback = RecordStateChangedCallback;
+        callback_data.m_UserData = recorder;
+        instances[i] = dmParticle::CreateInstance(context, prototypes[i % prototype_count], &callback_data);
+        dmParticle::SetPosition(context, instances[i], Point3((float) i, 0.0f, 0.0f));
+        dmParticle::StartInstance(context, instances[i]);
+    }
+}
+
+static void ExpectEqualVectors(const Vector4& expected, const Vector4& actual)
+{
+    ASSERT_EQ(expected.getX(), actual.getX());
+    ASSERT_EQ(expected.getY(), actual.getY());
+    ASSERT_EQ(expected.getZ(), actual.getZ());
+    ASSERT_EQ(expected.getW(), actual.getW());
+}
+
+/**
+ * Verify that updating the emitters, and generating their vertex data, on the job thread gives the same result as the serial path
+ */
+TEST_F(ParticleTest, ParallelUpdate)
+{
+    const uint32_t prototype_count = 3;
+    const char* prototype_names[prototype_count] = {"perf.particlefxc", "once_three_emitters.particlefxc", "loop.particlefxc"};
+    dmParticle::HPrototype prototypes[prototype_count];
+    for (uint32_t i = 0; i < prototype_count; ++i)
+    {
+        ASSERT_TRUE(LoadPrototype(prototype_names[i], &prototypes[i]));
+    }
+
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    job_thread_params.m_ThreadNames[0] = "ParticleJob";
+    job_thread_params.m_ThreadNames[1] = "ParticleJob";
+    job_thread_params.m_ThreadCount = 2;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    dmParticle::HParticleContext parallel_context = dmParticle::CreateContext(64, 1024);
+    dmParticle::SetContextJobThread(parallel_context, job_thread);
+
+    const uint32_t instance_count = 8;
+    dmParticle::HInstance serial_instances[instance_count];
+    dmParticle::HInstance parallel_instances[instance_count];
+    dmArray<StateChangeRecord> serial_records;
+    dmArray<StateChangeRecord> parallel_records;
+    CreateParallelTestInstances(m_Context, prototypes, prototype_count, serial_instances, instance_count, &serial_records);
+    CreateParallelTestInstances(parallel_context, prototypes, prototype_count, parallel_instances, instance_count, &parallel_records);
+
+    // The emitter seeds are based on the time of creation
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        dmParticle::Instance* serial = m_Context->m_Instances[serial_instances[i] & 0xffff];
+        dmParticle::Instance* parallel = parallel_context->m_Instances[parallel_instances[i] & 0xffff];
+        for (uint32_t e = 0; e < serial->m_Emitters.Size(); ++e)
+        {
+            dmParticle::Emitter* serial_emitter = &serial->m_Emitters[e];
+            dmParticle::Emitter* parallel_emitter = &parallel->m_Emitters[e];
+            parallel_emitter->m_OriginalSeed = serial_emitter->m_OriginalSeed;
+            parallel_emitter->m_Seed = serial_emitter->m_Seed;
+            parallel_emitter->m_Duration = serial_emitter->m_Duration;
+            parallel_emitter->m_StartDelay = serial_emitter->m_StartDelay;
+            parallel_emitter->m_SpawnRateSpread = serial_emitter->m_SpawnRateSpread;
+        }
+    }
+
+    const uint32_t max_particle_count = 16 * 1024;
+    uint32_t vertex_buffer_size = dmParticle::GetVertexBufferSize(max_particle_count, sizeof(TestVertex));
+    uint8_t* serial_vertex_buffer = new uint8_t[vertex_buffer_size];
+    uint8_t* parallel_vertex_buffer = new uint8_t[vertex_buffer_size];
+
+    dmArray<dmParticle::EmitterVertexData> batch;
+    batch.SetCapacity(instance_count * 3);
+
+    for (uint32_t frame = 0; frame < 60; ++frame)
+    {
+        // Occasional long frames make the emitters go through several states in one update
+        float dt = (frame % 20) == 19 ? 0.6f : 1.0f / 60.0f;
+        dmParticle::Update(m_Context, dt, 0x0);
+        dmParticle::Update(parallel_context, dt, 0x0);
+
+        memset(serial_vertex_buffer, 0, vertex_buffer_size);
+        memset(parallel_vertex_buffer, 0, vertex_buffer_size);
+        uint32_t serial_size = 0;
+        uint32_t parallel_size = 0;
+        batch.SetSize(0);
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            dmParticle::Instance* serial = m_Context->m_Instances[serial_instances[i] & 0xffff];
+            dmParticle::Instance* parallel = parallel_context->m_Instances[parallel_instances[i] & 0xffff];
+            ASSERT_EQ(serial->m_Emitters.Size(), parallel->m_Emitters.Size());
+            for (uint32_t e = 0; e < serial->m_Emitters.Size(); ++e)
+            {
+                dmParticle::Emitter* serial_emitter = &serial->m_Emitters[e];
+                dmParticle::Emitter* parallel_emitter = &parallel->m_Emitters[e];
+                ASSERT_EQ(serial_emitter->m_State, parallel_emitter->m_State);
+                ASSERT_EQ(serial_emitter->m_Seed, parallel_emitter->m_Seed);
+                ASSERT_EQ(serial_emitter->m_Particles.Size(), parallel_emitter->m_Particles.Size());
+                for (uint32_t p = 0; p < serial_emitter->m_Particles.Size(); ++p)
+                {
+                    dmParticle::Particle* sp = &serial_emitter->m_Particles[p];
+                    dmParticle::Particle* pp = &parallel_emitter->m_Particles[p];
+                    ASSERT_EQ(sp->GetTimeLeft(), pp->GetTimeLeft());
+                    ExpectEqualVectors(Vector4(sp->GetPosition()), Vector4(pp->GetPosition()));
+                    ExpectEqualVectors(Vector4(sp->GetVelocity()), Vector4(pp->GetVelocity()));
+                    ExpectEqualVectors(Vector4(sp->GetScale()), Vector4(pp->GetScale()));
+                    ExpectEqualVectors(sp->GetColor(), pp->GetColor());
+                    ExpectEqualVectors(Vector4(sp->GetRotation()), Vector4(pp->GetRotation()));
+                }
+
+                dmParticle::GenerateVertexData(m_Context, dt, serial_instances[i], e, m_AttributeInfos, Vector4(1,1,1,1), serial_vertex_buffer, vertex_buffer_size, &serial_size);
+
+                dmParticle::EmitterVertexData data;
+                data.m_Instance = parallel_instances[i];
+                data.m_EmitterIndex = e;
+                data.m_AttributeInfos = &m_AttributeInfos;
+                data.m_Color = Vector4(1,1,1,1);
+                batch.Push(data);
+            }
+        }
+        dmParticle::GenerateVertexDataBatch(parallel_context, dt, batch.Begin(), batch.Size(), parallel_vertex_buffer, vertex_buffer_size, &parallel_size);
+        for (uint32_t i = 0; i < batch.Size(); ++i)
+        {
+            ASSERT_EQ(dmParticle::GENERATE_VERTEX_DATA_OK, batch[i].m_Result);
+        }
+        ASSERT_EQ(serial_size, parallel_size);
+        ASSERT_EQ(0, memcmp(serial_vertex_buffer, parallel_vertex_buffer, serial_size));
+
+        dmParticle::Stats serial_stats, parallel_stats;
+        dmParticle::GetStats(m_Context, &serial_stats);
+        dmParticle::GetStats(parallel_context, &parallel_stats);
+        ASSERT_EQ(serial_stats.m_Particles, parallel_stats.m_Particles);
+    }
+
+    // The state changed callbacks are called from the calling thread, in the same order
+    ASSERT_LT(0u, serial_records.Size());
+    ASSERT_EQ(serial_records.Size(), parallel_records.Size());
+    for (uint32_t i = 0; i < serial_records.Size(); ++i)
+    {
+        ASSERT_EQ(serial_records[i].m_EmitterId, parallel_records[i].m_EmitterId);
+        ASSERT_EQ(serial_records[i].m_State, parallel_records[i].m_State);
+        ASSERT_EQ(serial_records[i].m_NumAwakeEmitters, parallel_records[i].m_NumAwakeEmitters);
+    }
+
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        dmParticle::DestroyInstance(m_Context, serial_instances[i]);
+        dmParticle::DestroyInstance(parallel_context, parallel_instances[i]);
+    }
+    dmParticle::DestroyContext(parallel_context);
+    dmJobThread::Destroy(job_thread);
+    for (uint32_t i = 0; i < prototype_count; ++i)
+    {
+        dmParticle::DeletePrototype(prototypes[i]);
+    }
+    delete [] serial_vertex_buffer;
+    delete [] parallel_vertex_buffer;
+}
+
+TEST(dmParticle, SoAPadding)
+{
+    const uint32_t capacity = 8;
+    dmParticle::ParticleSoA streams;
+    streams.SetCapacity(capacity);
+
+    // The kernels process the streams four entries at a time, including the padding after the count
+    const uint32_t size = streams.m_PosX.Size();
+    ASSERT_LE(capacity + 3, size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        ASSERT_EQ(0.0f, streams.m_PosX[i]);
+        ASSERT_EQ(0.0f, streams.m_Scale[i]);
+        ASSERT_EQ(0.0f, streams.m_ScaleX[i]);
+        ASSERT_EQ(0.0f, streams.m_ScaleY[i]);
+    }
+
+    dmParticle::Particle particles[capacity];
+    memset(particles, 0, sizeof(particles));
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        particles[i].m_Position = dmVMath::Point3(1.0f, 2.0f, 3.0f);
+        particles[i].m_SourceColor = dmVMath::Vector4(1.0f);
+        particles[i].m_MaxLifeTime = 1.0f;
+        particles[i].m_ooMaxLifeTime = 1.0f;
+        particles[i].m_TimeLeft = 0.5f;
+    }
+    streams.Gather(particles, capacity);
+    // As written by the kernels
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        streams.m_Scale[i] = streams.m_ScaleX[i] = streams.m_ScaleY[i] = 1.0f;
+    }
+
+    // The padding after a smaller count is zeroed
+    const uint32_t count = 5;
+    streams.Gather(particles, count);
+    for (uint32_t i = count; i < count + 3; ++i)
+    {
+        ASSERT_EQ(0.0f, streams.m_PosX[i]);
+        ASSERT_EQ(0.0f, streams.m_ColorA[i]);
+        ASSERT_EQ(0.0f, streams.m_Life[i]);
+        ASSERT_EQ(0.0f, streams.m_Scale[i]);
+        ASSERT_EQ(0.0f, streams.m_ScaleX[i]);
+        ASSERT_EQ(0.0f, streams.m_ScaleY[i]);
+    }
+}
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);
@@ -0,0 +1,422 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include <stdio.h>
+
+#include <dlib/array.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <dlib/vmath.h>
+#include <dlib/testutil.h>
+
+#include "../particle.h"
+#include "../particle_private.h"
+#include "../particle_soa.h"
+
+using namespace dmVMath;
+
+// Compares the structure-of-arrays simulation kernels with the scalar path that was used in dmParticle::Simulate,
+// on 50 instances of perf.particlefx (one emitter with 2000 particles each).
+
+static const uint32_t INSTANCE_COUNT = 50;
+static const uint32_t PARTICLES_PER_EMITTER = 2000;
+static const uint32_t ITERATIONS = 20;
+static const float DT = 1.0f / 60.0f;
+static const float STRETCH_SCALING = (1.0f/60.0f) * 0.5f;
+static const Vector3 PARTICLE_LOCAL_BASE_DIR = Vector3::yAxis();
+
+// Modifier parameters as computed in dmParticle::Simulate
+struct SimulateParams
+{
+    Vector3 m_AccStep;
+    float   m_AccMagnitude;
+    float   m_AccSpread;
+    Vector3 m_DragDirection;
+    float   m_DragMagnitude;
+    float   m_DragSpread;
+    Point3  m_RadialPosition;
+    float   m_RadialMagnitude;
+    float   m_RadialSpread;
+    Point3  m_VortexPosition;
+    Vector3 m_VortexAxis;
+    Vector3 m_VortexStart;
+    float   m_VortexMagnitude;
+    float   m_VortexSpread;
+    float   m_MaxSqDistance;
+    float   m_AppliedFactor;
+};
+
+#define SAMPLE_PROP(segment, x, target)\
+    {\
+        const dmParticle::LinearSegment* s = &segment;\
+        target = (x - s->m_X) * s->m_K + s->m_Y;\
+    }\
+
+static Vector3 NonZeroVector3(Vector3 v, float sq_length, Vector3 fallback)
+{
+    Vector3 result;
+    float neg_sq_length = -sq_length;
+    result.setX(dmMath::Select(neg_sq_length, fallback.getX(), v.getX()));
+    result.setY(dmMath::Select(neg_sq_length, fallback.getY(), v.getY()));
+    result.setZ(dmMath::Select(neg_sq_length, fallback.getZ(), v.getZ()));
+    return result;
+}
+
+// Same as the scalar path that was used in dmParticle::Simulate (rotations excluded, they are still evaluated per particle)
+static void SimulateScalar(dmArray<dmParticle::Particle>& particles, const dmParticle::Property* particle_properties, const SimulateParams& params)
+{
+    uint32_t count = particles.Size();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* particle = &particles[i];
+        float properties[dmParticleDDF::PARTICLE_KEY_COUNT];
+        float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
+        uint32_t segment_index = dmMath::Min((uint32_t)(x * dmParticle::PROPERTY_SAMPLE_COUNT), dmParticle::PROPERTY_SAMPLE_COUNT - 1);
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_SCALE].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_SCALE])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_RED].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_RED])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_GREEN].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_GREEN])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_BLUE].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_BLUE])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_ALPHA].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_ALPHA])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_X].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_X])
+        SAMPLE_PROP(particle_properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_Y].m_Segments[segment_index], x, properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_Y])
+        Vector4 c = particle->GetSourceColor();
+        particle->SetScale(Vector3(properties[dmParticleDDF::PARTICLE_KEY_SCALE]));
+        particle->SetColor(Vector4(dmMath::Clamp(c.getX() * properties[dmParticleDDF::PARTICLE_KEY_RED], 0.0f, 1.0f),
+                dmMath::Clamp(c.getY() * properties[dmParticleDDF::PARTICLE_KEY_GREEN], 0.0f, 1.0f),
+                dmMath::Clamp(c.getZ() * properties[dmParticleDDF::PARTICLE_KEY_BLUE], 0.0f, 1.0f),
+                dmMath::Clamp(c.getW() * properties[dmParticleDDF::PARTICLE_KEY_ALPHA], 0.0f, 1.0f)));
+        particle->m_StretchFactorX = particle->m_SourceStretchFactorX + (properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_X]);
+        particle->m_StretchFactorY = particle->m_SourceStretchFactorY + (properties[dmParticleDDF::PARTICLE_KEY_STRETCH_FACTOR_Y]);
+    }
+
+    // Acceleration
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* particle = &particles[i];
+        particle->SetVelocity(particle->GetVelocity() + params.m_AccStep * (params.m_AccMagnitude + params.m_AccSpread * particle->GetSpreadFactor()));
+    }
+
+    // Drag
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* particle = &particles[i];
+        Vector3 v = projection(Point3(particle->GetVelocity()), params.m_DragDirection) * params.m_DragDirection;
+        float applied_drag = dmMath::Min((params.m_DragMagnitude + params.m_DragSpread * particle->GetSpreadFactor()) * DT, 1.0f);
+        particle->SetVelocity(particle->GetVelocity() - v * applied_drag);
+    }
+
+    // Radial
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* particle = &particles[i];
+        Vector3 delta = particle->GetPosition() - params.m_RadialPosition;
+        float delta_sq_len = lengthSqr(delta);
+        float applied_magnitude = params.m_RadialMagnitude + params.m_RadialSpread * particle->GetSpreadFactor();
+        float a = dmMath::Select(params.m_MaxSqDistance - delta_sq_len, applied_magnitude, 0.0f);
+        Vector3 dir = normalize(NonZeroVector3(delta, delta_sq_len, rotate(particle->GetRotation(), PARTICLE_LOCAL_BASE_DIR)));
+        particle->SetVelocity(particle->GetVelocity() + dir * a * params.m_AppliedFactor);
+    }
+
+    // Vortex
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* particle = &particles[i];
+        Vector3 delta = particle->GetPosition() - params.m_VortexPosition;
+        Vector3 normal = delta - projection(Point3(delta), params.m_VortexAxis) * params.m_VortexAxis;
+        Vector3 tangent = cross(params.m_VortexAxis, normal);
+        tangent = NonZeroVector3(tangent, lengthSqr(tangent), params.m_VortexStart);
+        tangent = normalize(tangent);
+        float normal_sq_len = lengthSqr(normal);
+        float acceleration = dmMath::Select(params.m_MaxSqDistance - normal_sq_len, params.m_VortexMagnitude + params.m_VortexSpread * particle->GetSpreadFactor(), 0.0f);
+        particle->SetVelocity(particle->GetVelocity() + tangent * acceleration * params.m_AppliedFactor);
+    }
+
+    // Integration
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmParticle::Particle* p = &particles[i];
+        p->SetPosition(p->GetPosition() + p->m_Velocity * DT);
+        p->m_Scale[0] += p->m_Scale[0] * p->m_StretchFactorX;
+        p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY * length(p->m_Velocity) * STRETCH_SCALING;
+    }
+}
+
+#undef SAMPLE_PROP
+
+// Same steps as dmParticle::Simulate
+static void SimulateKernels(dmParticle::ParticleSoA& streams, const dmArray<dmParticle::Particle>& particles, const dmParticle::Property* particle_properties, const SimulateParams& params)
+{
+    dmParticle::EvaluateParticlePropertiesSoA(streams, particle_properties);
+    dmParticle::ApplyAccelerationSoA(streams, params.m_AccStep, params.m_AccMagnitude, params.m_AccSpread);
+    dmParticle::ApplyDragSoA(streams, true, params.m_DragDirection, params.m_DragMagnitude, params.m_DragSpread, DT);
+    dmParticle::ApplyRadialSoA(streams, particles.Begin(), params.m_RadialPosition, PARTICLE_LOCAL_BASE_DIR, params.m_RadialMagnitude, params.m_RadialSpread, params.m_MaxSqDistance, params.m_AppliedFactor);
+    dmParticle::ApplyVortexSoA(streams, params.m_VortexPosition, params.m_VortexAxis, params.m_VortexStart, params.m_VortexMagnitude, params.m_VortexSpread, params.m_MaxSqDistance, params.m_AppliedFactor);
+    dmParticle::IntegrateSoA(streams, true, STRETCH_SCALING, DT);
+}
+
+static void AssertNearVector(const float* expected, const float* actual, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_NEAR(expected[i], actual[i], 0.0001f * dmMath::Max(1.0f, dmMath::Abs(expected[i])));
+    }
+}
+
+class ParticlePerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_Context = dmParticle::CreateContext(INSTANCE_COUNT, INSTANCE_COUNT * PARTICLES_PER_EMITTER);
+        assert(m_Context != 0);
+        m_Prototype = 0x0;
+
+        char path[128];
+        dmTestUtil::MakeHostPathf(path, sizeof(path), "build/src/test/%s", "perf.particlefxc");
+        const uint32_t MAX_FILE_SIZE = 4 * 1024;
+        unsigned char buffer[MAX_FILE_SIZE];
+        FILE* f = fopen(path, "rb");
+        ASSERT_NE((FILE*) 0, f);
+        uint32_t file_size = fread(buffer, 1, MAX_FILE_SIZE, f);
+        fclose(f);
+        m_Prototype = dmParticle::NewPrototype(buffer, file_size);
+        ASSERT_NE((dmParticle::HPrototype) 0, m_Prototype);
+
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            m_Instances[i] = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+            dmParticle::SetPosition(m_Context, m_Instances[i], Point3((float) (i % 10) * 10.0f, (float) (i / 10) * 10.0f, 0.0f));
+            dmParticle::StartInstance(m_Context, m_Instances[i]);
+        }
+
+        // Fill all emitters
+        for (uint32_t i = 0; i < 10; ++i)
+        {
+            dmParticle::Update(m_Context, DT, 0x0);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            dmParticle::DestroyInstance(m_Context, m_Instances[i]);
+        }
+        if (m_Prototype != 0x0)
+        {
+            dmParticle::Particle_DeletePrototype(m_Prototype);
+        }
+        dmParticle::DestroyContext(m_Context);
+    }
+
+    dmParticle::Emitter* GetEmitter(uint32_t instance_index)
+    {
+        return &m_Context->m_Instances[m_Instances[instance_index] & 0xffff]->m_Emitters[0];
+    }
+
+    uint32_t ParticleCount()
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+            count += GetEmitter(i)->m_Particles.Size();
+        return count;
+    }
+
+    dmParticle::HParticleContext m_Context;
+    dmParticle::HPrototype       m_Prototype;
+    dmParticle::HInstance        m_Instances[INSTANCE_COUNT];
+};
+
+TEST_F(ParticlePerfTest, Simulate100k)
+{
+    ASSERT_EQ(INSTANCE_COUNT * PARTICLES_PER_EMITTER, ParticleCount());
+
+    const dmParticle::Property* particle_properties = m_Prototype->m_Emitters[0].m_ParticleProperties;
+
+    SimulateParams params;
+    Quat rotation = Quat::rotationZ(0.785398f);
+    params.m_AccStep = rotate(rotation, Vector3::yAxis()) * DT;
+    params.m_AccMagnitude = -10.0f;
+    params.m_AccSpread = 2.0f;
+    params.m_DragDirection = rotate(rotation, Vector3::xAxis());
+    params.m_DragMagnitude = 0.5f;
+    params.m_DragSpread = 0.1f;
+    params.m_RadialPosition = Point3(1.0f, 2.0f, 0.0f);
+    params.m_RadialMagnitude = 5.0f;
+    params.m_RadialSpread = 1.0f;
+    params.m_VortexPosition = Point3(-1.0f, 0.0f, 2.0f);
+    params.m_VortexAxis = Vector3::zAxis();
+    params.m_VortexStart = Vector3::xAxis();
+    params.m_VortexMagnitude = 3.0f;
+    params.m_VortexSpread = 1.0f;
+    params.m_MaxSqDistance = 20.0f * 20.0f;
+    params.m_AppliedFactor = DT;
+
+    dmArray<dmParticle::Particle> scalar[INSTANCE_COUNT];
+    dmArray<dmParticle::Particle> soa[INSTANCE_COUNT];
+    dmParticle::ParticleSoA streams;
+    streams.SetCapacity(PARTICLES_PER_EMITTER);
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        dmArray<dmParticle::Particle>& particles = GetEmitter(i)->m_Particles;
+        ASSERT_EQ(PARTICLES_PER_EMITTER, particles.Size());
+        scalar[i].SetCapacity(particles.Size());
+        scalar[i].PushArray(particles.Begin(), particles.Size());
+        soa[i].SetCapacity(particles.Size());
+        soa[i].PushArray(particles.Begin(), particles.Size());
+    }
+
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        SimulateScalar(scalar[i], particle_properties, params);
+        streams.Gather(soa[i].Begin(), soa[i].Size());
+        SimulateKernels(streams, soa[i], particle_properties, params);
+        streams.Scatter(soa[i].Begin());
+        for (uint32_t p = 0; p < PARTICLES_PER_EMITTER; ++p)
+        {
+            const dmParticle::Particle& expected = scalar[i][p];
+            const dmParticle::Particle& actual = soa[i][p];
+            AssertNearVector((const float*) &expected.m_Position, (const float*) &actual.m_Position, 3);
+            AssertNearVector((const float*) &expected.m_Velocity, (const float*) &actual.m_Velocity, 3);
+            AssertNearVector((const float*) &expected.m_Color, (const float*) &actual.m_Color, 4);
+            AssertNearVector((const float*) &expected.m_Scale, (const float*) &actual.m_Scale, 3);
+            AssertNearVector(&expected.m_StretchFactorX, &actual.m_StretchFactorX, 2);
+        }
+    }
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+            SimulateScalar(scalar[i], particle_properties, params);
+    }
+    uint64_t scalar_time = dmTime::GetTime() - start;
+
+    uint64_t gather_time = 0;
+    uint64_t kernel_time = 0;
+    uint64_t scatter_time = 0;
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            start = dmTime::GetTime();
+            streams.Gather(soa[i].Begin(), soa[i].Size());
+            uint64_t gathered = dmTime::GetTime();
+            SimulateKernels(streams, soa[i], particle_properties, params);
+            uint64_t simulated = dmTime::GetTime();
+            streams.Scatter(soa[i].Begin());
+            gather_time += gathered - start;
+            kernel_time += simulated - gathered;
+            scatter_time += dmTime::GetTime() - simulated;
+        }
+    }
+    uint64_t soa_time = gather_time + kernel_time + scatter_time;
+
+    printf("[simulate] %u emitters, %6u particles | scalar: %7.3f ms | soa: %7.3f ms (gather %7.3f ms, kernels %7.3f ms, scatter %7.3f ms) | x%.2f\n", INSTANCE_COUNT, INSTANCE_COUNT * PARTICLES_PER_EMITTER,
+            scalar_time * 0.001f / ITERATIONS, soa_time * 0.001f / ITERATIONS, gather_time * 0.001f / ITERATIONS, kernel_time * 0.001f / ITERATIONS, scatter_time * 0.001f / ITERATIONS,
+            soa_time ? scalar_time / (float) soa_time : 0.0f);
+}
+
+TEST_F(ParticlePerfTest, Update100k)
+{
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        dmParticle::Update(m_Context, DT, 0x0);
+    }
+    uint64_t time = dmTime::GetTime() - start;
+
+    uint32_t particle_count = ParticleCount();
+    ASSERT_EQ(INSTANCE_COUNT * PARTICLES_PER_EMITTER, particle_count);
+
+    printf("[update] %u emitters, %6u particles | %7.3f ms\n", INSTANCE_COUNT, particle_count, time * 0.001f / ITERATIONS);
+}
+
+// Updates the emitters and generates their vertex data with 0 (serial), 1 and 3 job threads
+TEST_F(ParticlePerfTest, UpdateParallel100k)
+{
+    dmGraphics::VertexAttributeInfos attribute_infos;
+    attribute_infos.m_Infos[0].m_NameHash = dmHashString64("position");
+    attribute_infos.m_Infos[0].m_SemanticType = dmGraphics::VertexAttribute::SEMANTIC_TYPE_POSITION;
+    attribute_infos.m_Infos[0].m_CoordinateSpace = dmGraphics::COORDINATE_SPACE_WORLD;
+    attribute_infos.m_Infos[0].m_ValueByteSize = sizeof(float) * 3;
+    attribute_infos.m_Infos[1].m_NameHash = dmHashString64("color");
+    attribute_infos.m_Infos[1].m_SemanticType = dmGraphics::VertexAttribute::SEMANTIC_TYPE_COLOR;
+    attribute_infos.m_Infos[1].m_CoordinateSpace = dmGraphics::COORDINATE_SPACE_WORLD;
+    attribute_infos.m_Infos[1].m_ValueByteSize = sizeof(float) * 4;
+    attribute_infos.m_NumInfos = 2;
+    attribute_infos.m_VertexStride = sizeof(float) * 7;
+
+    uint32_t vertex_buffer_size = dmParticle::GetVertexBufferSize(INSTANCE_COUNT * PARTICLES_PER_EMITTER, attribute_infos.m_VertexStride);
+    uint8_t* vertex_buffer = new uint8_t[vertex_buffer_size];
+
+    dmParticle::EmitterVertexData emitters[INSTANCE_COUNT];
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        emitters[i].m_Instance = m_Instances[i];
+        emitters[i].m_EmitterIndex = 0;
+        emitters[i].m_AttributeInfos = &attribute_infos;
+        emitters[i].m_Color = Vector4(1.0f);
+    }
+
+    const uint32_t thread_counts[] = {0, 1, 3};
+    for (uint32_t t = 0; t < DM_ARRAY_SIZE(thread_counts); ++t)
+    {
+        dmJobThread::HContext job_thread = 0;
+        if (thread_counts[t] > 0)
+        {
+            dmJobThread::JobThreadCreationParams job_thread_params;
+            for (uint32_t i = 0; i < thread_counts[t]; ++i)
+                job_thread_params.m_ThreadNames[i] = "ParticleJob";
+            job_thread_params.m_ThreadCount = thread_counts[t];
+            job_thread = dmJobThread::Create(job_thread_params);
+        }
+        dmParticle::SetContextJobThread(m_Context, job_thread);
+
+        uint64_t update_time = 0;
+        uint64_t vertex_time = 0;
+        for (uint32_t i = 0; i < ITERATIONS; ++i)
+        {
+            uint64_t start = dmTime::GetTime();
+            dmParticle::Update(m_Context, DT, 0x0);
+            uint64_t mid = dmTime::GetTime();
+            uint32_t vertex_data_size = 0;
+            dmParticle::GenerateVertexDataBatch(m_Context, DT, emitters, INSTANCE_COUNT, vertex_buffer, vertex_buffer_size, &vertex_data_size);
+            uint64_t end = dmTime::GetTime();
+            update_time += mid - start;
+            vertex_time += end - mid;
+            ASSERT_EQ(ParticleCount() * 6 * attribute_infos.m_VertexStride, vertex_data_size);
+        }
+
+        printf("[update parallel] %u emitters, %6u particles, %u job threads | update: %7.3f ms | vertex data: %7.3f ms\n", INSTANCE_COUNT, ParticleCount(), thread_counts[t],
+                update_time * 0.001f / ITERATIONS, vertex_time * 0.001f / ITERATIONS);
+
+        dmParticle::SetContextJobThread(m_Context, 0);
+        if (job_thread)
+            dmJobThread::Destroy(job_thread);
+    }
+
+    delete [] vertex_buffer;
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+
+    int ret = jc_test_run_all();
+    return ret;
+}
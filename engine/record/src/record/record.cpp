@@ -21,9 +21,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "record.h"
+#include "record_private.h"
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
+#include <dlib/condition_variable.h>
 #include <dlib/log.h>
+#include <dlib/mutex.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
 
 namespace dmRecord
 {
@@ -45,6 +50,8 @@ namespace dmRecord
             {
                 fclose(m_File);
             }
+            free(m_Buffers);
+            delete[] m_BufferPts;
         }
 
         uint32_t            m_Width;
@@ -54,7 +61,23 @@ namespace dmRecord
         FILE*               m_File;
         vpx_codec_ctx_t     m_Codec;
         vpx_image_t         m_VpxImage;
-        uint32_t            m_FrameCount;
+        uint32_t            m_FrameCount;       // Number of encoded frames
+
+        // Ring of captured frames waiting for the encoder thread. The slots [m_QueueStart, m_QueueStart + m_QueueCount)
+        // are owned by the encoder thread, the rest by the thread calling RecordFrame.
+        uint8_t*                                m_Buffers;
+        uint32_t*                               m_BufferPts;
+        uint32_t                                m_BufferSize;
+        uint32_t                                m_QueueSize;
+        uint32_t                                m_QueueStart;
+        uint32_t                                m_QueueCount;
+        dmThread::Thread                        m_Thread;
+        dmMutex::HMutex                         m_Mutex;
+        dmConditionVariable::HConditionVariable m_Condition;
+        Result                                  m_EncodeResult;     // First error on the encoder thread
+        bool                                    m_Quit;
+
+        Stats                                   m_Stats;
     };
 
     static void MemPutLE16(char *mem, unsigned int val)
@@ -111,6 +134,92 @@ namespace dmRecord
         return fwrite(header, 1, sizeof(header), recorder->m_File) == sizeof(header);
     }
 
+    static Result EncodeFrame(HRecorder recorder, const uint8_t* frame_buffer, uint32_t pts)
+    {
+        vpx_codec_iter_t iter = NULL;
+        const vpx_codec_cx_pkt_t *pkt;
+        vpx_codec_err_t res;
+        int flags = 0;
+
+        vpx_image_t* image = &recorder->m_VpxImage;
+        BGRAToI420FlipY(frame_buffer, recorder->m_Width, recorder->m_Height,
+                        image->planes[VPX_PLANE_Y], image->stride[VPX_PLANE_Y],
+                        image->planes[VPX_PLANE_U], image->planes[VPX_PLANE_V], image->stride[VPX_PLANE_U]);
+
+        // The pts counts all recorded frames, so that the video keeps its timing when frames are dropped
+        res = vpx_codec_encode(&recorder->m_Codec, image, pts, 1, flags, VPX_DL_REALTIME);
+        if (res)
+        {
+            dmLogError("Failed to encode frame (%s)", vpx_codec_err_to_string(res))
+            return RESULT_UNKNOWN_ERROR;
+        }
+
+        while ((pkt = vpx_codec_get_cx_data(&recorder->m_Codec, &iter)))
+        {
+            switch (pkt->kind)
+            {
+            case VPX_CODEC_CX_FRAME_PKT:
+                if (!WriteIvfFrameHeader(recorder, pkt))
+                {
+                    return RESULT_IO_ERROR;
+                }
+
+                if (fwrite(pkt->data.frame.buf, 1, pkt->data.frame.sz,
+                        recorder->m_File) != pkt->data.frame.sz)
+                {
+                    return RESULT_IO_ERROR;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        recorder->m_FrameCount++;
+
+        return RESULT_OK;
+    }
+
+    static void EncoderThread(void* arg)
+    {
+        Recorder* recorder = (Recorder*) arg;
+
+        while (true)
+        {
+            uint32_t slot;
+            {
+                DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+                while (recorder->m_QueueCount == 0 && !recorder->m_Quit)
+                {
+                    dmConditionVariable::Wait(recorder->m_Condition, recorder->m_Mutex);
+                }
+                // The queue is drained before quitting
+                if (recorder->m_QueueCount == 0)
+                {
+                    return;
+                }
+                slot = recorder->m_QueueStart;
+            }
+
+            // The codec and the file are only used by this thread while it's running
+            uint64_t start = dmTime::GetTime();
+            Result r = EncodeFrame(recorder, recorder->m_Buffers + slot * recorder->m_BufferSize, recorder->m_BufferPts[slot]);
+            uint64_t encode_time = dmTime::GetTime() - start;
+
+            DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+            if (r == RESULT_OK)
+            {
+                recorder->m_Stats.m_FramesEncoded++;
+            }
+            else if (recorder->m_EncodeResult == RESULT_OK)
+            {
+                recorder->m_EncodeResult = r;
+            }
+            recorder->m_Stats.m_EncodeTime += encode_time;
+            recorder->m_QueueStart = (recorder->m_QueueStart + 1) % recorder->m_QueueSize;
+            recorder->m_QueueCount--;
+        }
+    }
+
     Result New(const NewParams* params, HRecorder* recorder)
     {
         *recorder = 0;
@@ -180,68 +289,39 @@ namespace dmRecord
         r->m_Codec = codec;
         r->m_VpxImage = vpx_image;
         r->m_File = f;
+        r->m_EncodeResult = RESULT_OK;
+
+        if (params->m_QueueSize > 0)
+        {
+            r->m_BufferSize = params->m_Width * params->m_Height * 4;
+            r->m_QueueSize = params->m_QueueSize;
+            r->m_Buffers = (uint8_t*) malloc(r->m_BufferSize * r->m_QueueSize);
+            r->m_BufferPts = new uint32_t[r->m_QueueSize];
+            r->m_Mutex = dmMutex::New();
+            r->m_Condition = dmConditionVariable::New();
+            r->m_Thread = dmThread::New(EncoderThread, 0x20000, r, "record");
+        }
+
         *recorder = r;
         return RESULT_OK;
     }
 
-    /*
-     * TODO: This code needs to be optimized.
-     * RGBA to YV12 with flipped y
-     * Links:
-     * http://groups.google.com/a/chromium.org/group/chromium-reviews/browse_thread/thread/720aafe35a78942a?pli=1
-     */
-    static void RGBAToYV12FlipY(const uint8_t *rgba, uint32_t width, uint32_t height, void *y_plane, void *u_plane, void *v_plane)
+    Result Delete(HRecorder recorder)
     {
-        for (uint32_t iy = 0; iy < height; ++iy)
-        {
-            char* y_plane_row = (char*) y_plane;
-            y_plane_row += (height - 1 - iy) * width;
-            for (uint32_t ix = 0; ix < width; ++ix)
-            {
-                int i = (iy * width + ix) * 4;
-                uint8_t B = rgba[i+0];
-                uint8_t G = rgba[i+1];
-                uint8_t R = rgba[i+2];
-                float y = (float)( R*66 + G*129 + B*25 + 128 ) / 256 + 16;
-                *y_plane_row = (char) y;
-                ++y_plane_row;
-            }
-        }
-
-        uint32_t half_height = height >> 1;
-        uint32_t half_width = width >> 1;
+        Result result = RESULT_OK;
 
-        for (uint32_t iy = 0; iy < half_height; iy++)
+        if (recorder->m_QueueSize > 0)
         {
-            uint32_t base_src = (iy*2) * width * 4;
-
-            uint8_t *v_plane_row = (uint8_t*)v_plane;
-            uint8_t *u_plane_row = (uint8_t*)u_plane;
-            v_plane_row += (half_height - 1 - iy) * half_width;
-            u_plane_row += (half_height - 1 - iy) * half_width;
-
-            for (uint32_t xPixel = 0; xPixel < half_width; xPixel++ )
             {
-                uint8_t B = rgba[base_src+0];
-                uint8_t G = rgba[base_src+1];
-                uint8_t R = rgba[base_src+2];
-
-                float u = (float)( R*-38 + G*-74 + B*112 + 128 ) / 256 + 128;
-                float v = (float)( R*112 + G*-94 + B*-18 + 128 ) / 256 + 128;
-
-                *v_plane_row = (uint8_t) v;
-                *u_plane_row = (uint8_t) u;
-                ++u_plane_row;
-                ++v_plane_row;
-
-                base_src += 8;
+                DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+                recorder->m_Quit = true;
+                dmConditionVariable::Signal(recorder->m_Condition);
             }
+            dmThread::Join(recorder->m_Thread);
+            dmConditionVariable::Delete(recorder->m_Condition);
+            dmMutex::Delete(recorder->m_Mutex);
+            result = recorder->m_EncodeResult;
         }
-    }
-
-    Result Delete(HRecorder recorder)
-    {
-        Result result = RESULT_OK;
 
         fseek(recorder->m_File, 0, SEEK_SET);
         if (!WriteIvfFileHeader(recorder))
@@ -259,41 +339,60 @@ namespace dmRecord
     Result RecordFrame(HRecorder recorder, const void* frame_buffer,
             uint32_t frame_buffer_size, BufferFormat format)
     {
-        vpx_codec_iter_t iter = NULL;
-        const vpx_codec_cx_pkt_t *pkt;
-        vpx_codec_err_t res;
-        int flags = 0;
-
-        RGBAToYV12FlipY((const uint8_t*) frame_buffer, recorder->m_Width, recorder->m_Height, recorder->m_VpxImage.planes[0], recorder->m_VpxImage.planes[1], recorder->m_VpxImage.planes[2]);
-        res = vpx_codec_encode(&recorder->m_Codec, &recorder->m_VpxImage, recorder->m_FrameCount, 1, flags, VPX_DL_REALTIME);
-        if (res)
+        if (recorder->m_QueueSize == 0)
         {
-            dmLogError("Failed to encode frame (%s)", vpx_codec_err_to_string(res))
-            return RESULT_UNKNOWN_ERROR;
+            uint64_t start = dmTime::GetTime();
+            Result r = EncodeFrame(recorder, (const uint8_t*) frame_buffer, recorder->m_Stats.m_FramesRecorded++);
+            if (r == RESULT_OK)
+            {
+                recorder->m_Stats.m_FramesEncoded++;
+            }
+            recorder->m_Stats.m_EncodeTime += dmTime::GetTime() - start;
+            return r;
         }
 
-        while ((pkt = vpx_codec_get_cx_data(&recorder->m_Codec, &iter)))
+        uint32_t slot, pts;
         {
-            switch (pkt->kind)
+            DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+            pts = recorder->m_Stats.m_FramesRecorded++;
+            if (recorder->m_EncodeResult != RESULT_OK)
             {
-            case VPX_CODEC_CX_FRAME_PKT:
-                if (!WriteIvfFrameHeader(recorder, pkt))
-                {
-                    return RESULT_IO_ERROR;
-                }
-
-                if (fwrite(pkt->data.frame.buf, 1, pkt->data.frame.sz,
-                        recorder->m_File) != pkt->data.frame.sz)
-                {
-                    return RESULT_IO_ERROR;
-                }
-                break;
-            default:
-                break;
+                return recorder->m_EncodeResult;
+            }
+            // Never wait for the encoder, that would affect the timing of the game being recorded
+            if (recorder->m_QueueCount == recorder->m_QueueSize)
+            {
+                recorder->m_Stats.m_FramesDropped++;
+                return RESULT_OK;
             }
+            slot = (recorder->m_QueueStart + recorder->m_QueueCount) % recorder->m_QueueSize;
         }
-        recorder->m_FrameCount++;
 
+        // The free slots are only touched by this thread
+        uint32_t size = frame_buffer_size < recorder->m_BufferSize ? frame_buffer_size : recorder->m_BufferSize;
+        memcpy(recorder->m_Buffers + slot * recorder->m_BufferSize, frame_buffer, size);
+        recorder->m_BufferPts[slot] = pts;
+
+        DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+        recorder->m_QueueCount++;
+        if (recorder->m_QueueCount > recorder->m_Stats.m_MaxQueued)
+        {
+            recorder->m_Stats.m_MaxQueued = recorder->m_QueueCount;
+        }
+        dmConditionVariable::Signal(recorder->m_Condition);
         return RESULT_OK;
     }
+
+    void GetStats(HRecorder recorder, Stats* stats)
+    {
+        if (recorder->m_QueueSize > 0)
+        {
+            DM_MUTEX_SCOPED_LOCK(recorder->m_Mutex);
+            *stats = recorder->m_Stats;
+        }
+        else
+        {
+            *stats = recorder->m_Stats;
+        }
+    }
 }
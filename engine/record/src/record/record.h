@@ -60,11 +60,31 @@ namespace dmRecord
         VideoCodec      m_VideoCodec;
         const char*     m_Filename;
         uint32_t        m_Fps;
+        /// Number of captured frames that can wait for the encoder thread. Frames recorded while
+        /// the queue is full are dropped. If 0, the frames are encoded directly in RecordFrame.
+        uint32_t        m_QueueSize;
+    };
+
+    struct Stats
+    {
+        uint32_t m_FramesRecorded;  // Number of calls to RecordFrame
+        uint32_t m_FramesEncoded;
+        uint32_t m_FramesDropped;   // Frames dropped since the encoder queue was full
+        uint32_t m_MaxQueued;       // Highest number of frames waiting for the encoder
+        uint64_t m_EncodeTime;      // Total time spent converting and encoding frames (us)
     };
 
     Result New(const NewParams* params, HRecorder* recorder);
+    /**
+     * Encodes the frames left in the queue, and closes the file
+     */
     Result Delete(HRecorder recorder);
+    /**
+     * Copies the frame into the encoder queue. The frame is encoded on the encoder thread,
+     * or dropped if the queue is full.
+     */
     Result RecordFrame(HRecorder recorder, const void* frame_buffer, uint32_t frame_buffer_size, BufferFormat format);
+    void GetStats(HRecorder recorder, Stats* stats);
 }
 
 #endif
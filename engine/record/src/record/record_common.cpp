@@ -13,9 +13,11 @@
 // specific language governing permissions and limitations under the License.
 
 #include "record.h"
+#include "record_private.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <dlib/simd.h>
 
 namespace dmRecord
 {
@@ -25,5 +27,194 @@ namespace dmRecord
         m_ContainerFormat = CONTAINER_FORMAT_IVF;
         m_VideoCodec = VIDOE_CODEC_VP8;
         m_Fps = 30;
+        m_QueueSize = 4;
+    }
+
+    // BT.601 studio range, in 8.8 fixed point. Gives the same results as the previous float implementation.
+    static inline uint8_t BGRAToY(const uint8_t* p)
+    {
+        return (uint8_t) (((p[2] * 66 + p[1] * 129 + p[0] * 25 + 128) >> 8) + 16);
+    }
+
+    static inline uint8_t BGRAToU(const uint8_t* p)
+    {
+        return (uint8_t) (((p[2] * -38 + p[1] * -74 + p[0] * 112 + 128) >> 8) + 128);
+    }
+
+    static inline uint8_t BGRAToV(const uint8_t* p)
+    {
+        return (uint8_t) (((p[2] * 112 + p[1] * -94 + p[0] * -18 + 128) >> 8) + 128);
+    }
+
+    static void ConvertRowYScalar(const uint8_t* bgra, uint8_t* y, uint32_t width)
+    {
+        for (uint32_t i = 0; i < width; ++i)
+        {
+            y[i] = BGRAToY(bgra + i * 4);
+        }
+    }
+
+    // Uses every other pixel of the row
+    static void ConvertRowUVScalar(const uint8_t* bgra, uint8_t* u, uint8_t* v, uint32_t half_width)
+    {
+        for (uint32_t i = 0; i < half_width; ++i)
+        {
+            const uint8_t* p = bgra + i * 8;
+            u[i] = BGRAToU(p);
+            v[i] = BGRAToV(p);
+        }
+    }
+
+#if defined(DM_SIMD_SSE2)
+    // Weighted sum of the B, G and R channels of four pixels, as 32 bit integers
+    static inline __m128i DotBGR(__m128i pixels, __m128i weights)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights));
+        __m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights));
+        __m128i bg = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i ra = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+        return _mm_add_epi32(bg, ra);
+    }
+
+    static inline __m128i Scale(__m128i dot, __m128i offset)
+    {
+        return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(dot, _mm_set1_epi32(128)), 8), offset);
+    }
+
+    static void ConvertRowY(const uint8_t* bgra, uint8_t* y, uint32_t width)
+    {
+        const __m128i weights = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+        const __m128i offset  = _mm_set1_epi32(16);
+
+        uint32_t i = 0;
+        for (; i + 8 <= width; i += 8)
+        {
+            __m128i p0 = _mm_loadu_si128((const __m128i*) (bgra + i * 4));
+            __m128i p1 = _mm_loadu_si128((const __m128i*) (bgra + i * 4 + 16));
+            __m128i y0 = Scale(DotBGR(p0, weights), offset);
+            __m128i y1 = Scale(DotBGR(p1, weights), offset);
+            __m128i y8 = _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_setzero_si128());
+            _mm_storel_epi64((__m128i*) (y + i), y8);
+        }
+        ConvertRowYScalar(bgra + i * 4, y + i, width - i);
+    }
+
+    static void ConvertRowUV(const uint8_t* bgra, uint8_t* u, uint8_t* v, uint32_t half_width)
+    {
+        const __m128i u_weights = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+        const __m128i v_weights = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+        const __m128i offset    = _mm_set1_epi32(128);
+
+        uint32_t i = 0;
+        for (; i + 4 <= half_width; i += 4)
+        {
+            __m128 p0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) (bgra + i * 8)));
+            __m128 p1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) (bgra + i * 8 + 16)));
+            __m128i even = _mm_castps_si128(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i u4 = Scale(DotBGR(even, u_weights), offset);
+            __m128i v4 = Scale(DotBGR(even, v_weights), offset);
+            __m128i uv = _mm_packus_epi16(_mm_packs_epi32(u4, v4), _mm_setzero_si128());
+            int32_t u_bytes = _mm_cvtsi128_si32(uv);
+            int32_t v_bytes = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+            memcpy(u + i, &u_bytes, 4);
+            memcpy(v + i, &v_bytes, 4);
+        }
+        ConvertRowUVScalar(bgra + i * 8, u + i, v + i, half_width - i);
+    }
+
+#elif defined(DM_SIMD_NEON)
+    static void ConvertRowY(const uint8_t* bgra, uint8_t* y, uint32_t width)
+    {
+        uint32_t i = 0;
+        for (; i + 8 <= width; i += 8)
+        {
+            uint8x8x4_t p = vld4_u8(bgra + i * 4);
+            // At most 220 * 255 + 128, so it fits in 16 bits
+            uint16x8_t sum = vmull_u8(p.val[2], vdup_n_u8(66));
+            sum = vmlal_u8(sum, p.val[1], vdup_n_u8(129));
+            sum = vmlal_u8(sum, p.val[0], vdup_n_u8(25));
+            sum = vaddq_u16(sum, vdupq_n_u16(128));
+            vst1_u8(y + i, vadd_u8(vshrn_n_u16(sum, 8), vdup_n_u8(16)));
+        }
+        ConvertRowYScalar(bgra + i * 4, y + i, width - i);
+    }
+
+    static inline int16x8_t EvenLanes(uint8x16_t v)
+    {
+        return vreinterpretq_s16_u16(vmovl_u8(vmovn_u16(vreinterpretq_u16_u8(v))));
+    }
+
+    static inline uint8x8_t Scale(int16x8_t sum)
+    {
+        sum = vaddq_s16(sum, vdupq_n_s16(128));
+        return vqmovun_s16(vaddq_s16(vshrq_n_s16(sum, 8), vdupq_n_s16(128)));
+    }
+
+    static void ConvertRowUV(const uint8_t* bgra, uint8_t* u, uint8_t* v, uint32_t half_width)
+    {
+        uint32_t i = 0;
+        for (; i + 8 <= half_width; i += 8)
+        {
+            uint8x16x4_t p = vld4q_u8(bgra + i * 8);
+            int16x8_t b = EvenLanes(p.val[0]);
+            int16x8_t g = EvenLanes(p.val[1]);
+            int16x8_t r = EvenLanes(p.val[2]);
+
+            int16x8_t u_sum = vmulq_n_s16(b, 112);
+            u_sum = vmlaq_n_s16(u_sum, g, -74);
+            u_sum = vmlaq_n_s16(u_sum, r, -38);
+            vst1_u8(u + i, Scale(u_sum));
+
+            int16x8_t v_sum = vmulq_n_s16(r, 112);
+            v_sum = vmlaq_n_s16(v_sum, g, -94);
+            v_sum = vmlaq_n_s16(v_sum, b, -18);
+            vst1_u8(v + i, Scale(v_sum));
+        }
+        ConvertRowUVScalar(bgra + i * 8, u + i, v + i, half_width - i);
+    }
+
+#else
+    static void ConvertRowY(const uint8_t* bgra, uint8_t* y, uint32_t width)
+    {
+        ConvertRowYScalar(bgra, y, width);
+    }
+
+    static void ConvertRowUV(const uint8_t* bgra, uint8_t* u, uint8_t* v, uint32_t half_width)
+    {
+        ConvertRowUVScalar(bgra, u, v, half_width);
+    }
+#endif
+
+    void BGRAToI420FlipY(const uint8_t* bgra, uint32_t width, uint32_t height,
+                         uint8_t* y_plane, uint32_t y_stride, uint8_t* u_plane, uint8_t* v_plane, uint32_t uv_stride)
+    {
+        for (uint32_t iy = 0; iy < height; ++iy)
+        {
+            ConvertRowY(bgra + iy * width * 4, y_plane + (height - 1 - iy) * y_stride, width);
+        }
+
+        uint32_t half_height = height >> 1;
+        for (uint32_t iy = 0; iy < half_height; ++iy)
+        {
+            uint32_t row = (half_height - 1 - iy) * uv_stride;
+            ConvertRowUV(bgra + iy * 2 * width * 4, u_plane + row, v_plane + row, width >> 1);
+        }
+    }
+
+    void BGRAToI420FlipYScalar(const uint8_t* bgra, uint32_t width, uint32_t height,
+                               uint8_t* y_plane, uint32_t y_stride, uint8_t* u_plane, uint8_t* v_plane, uint32_t uv_stride)
+    {
+        for (uint32_t iy = 0; iy < height; ++iy)
+        {
+            ConvertRowYScalar(bgra + iy * width * 4, y_plane + (height - 1 - iy) * y_stride, width);
+        }
+
+        uint32_t half_height = height >> 1;
+        for (uint32_t iy = 0; iy < half_height; ++iy)
+        {
+            uint32_t row = (half_height - 1 - iy) * uv_stride;
+            ConvertRowUVScalar(bgra + iy * 2 * width * 4, u_plane + row, v_plane + row, width >> 1);
+        }
     }
 }
@@ -36,5 +36,10 @@ namespace dmRecord
     {
         return RESULT_RECORD_NOT_SUPPORTED;
     }
+
+    void GetStats(HRecorder recorder, Stats* stats)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
 }
 
@@ -0,0 +1,34 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_RECORD_PRIVATE_H
+#define DM_RECORD_PRIVATE_H
+
+#include <stdint.h>
+
+namespace dmRecord
+{
+    /*
+     * Converts a BGRA frame to I420 planes, flipped vertically (the frame is read bottom up from the frame buffer).
+     * The chroma of each 2x2 block is taken from its top left pixel. The width and height must be multiples of two.
+     */
+    void BGRAToI420FlipY(const uint8_t* bgra, uint32_t width, uint32_t height,
+                         uint8_t* y_plane, uint32_t y_stride, uint8_t* u_plane, uint8_t* v_plane, uint32_t uv_stride);
+
+    // Plain scalar version, for the row tails and for testing
+    void BGRAToI420FlipYScalar(const uint8_t* bgra, uint32_t width, uint32_t height,
+                               uint8_t* y_plane, uint32_t y_stride, uint8_t* u_plane, uint8_t* v_plane, uint32_t uv_stride);
+}
+
+#endif // DM_RECORD_PRIVATE_H
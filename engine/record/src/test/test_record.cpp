@@ -18,6 +18,7 @@
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
 #include "../record/record.h"
+#include "../record/record_private.h"
 
 TEST(dmRecord, InvalidWidth1)
 {
@@ -101,7 +102,127 @@ TEST(dmRecord, EmptyRecording)
     ASSERT_EQ(dmRecord::RESULT_OK, r);
 }
 
+// The previous float implementation of the conversion
+static void ReferenceBGRAToI420FlipY(const uint8_t* bgra, uint32_t width, uint32_t height, uint8_t* y_plane, uint8_t* u_plane, uint8_t* v_plane)
+{
+    for (uint32_t iy = 0; iy < height; ++iy)
+    {
+        for (uint32_t ix = 0; ix < width; ++ix)
+        {
+            const uint8_t* p = bgra + (iy * width + ix) * 4;
+            float y = (float)(p[2]*66 + p[1]*129 + p[0]*25 + 128) / 256 + 16;
+            y_plane[(height - 1 - iy) * width + ix] = (uint8_t) y;
+        }
+    }
+
+    uint32_t half_width = width / 2;
+    uint32_t half_height = height / 2;
+    for (uint32_t iy = 0; iy < half_height; ++iy)
+    {
+        for (uint32_t ix = 0; ix < half_width; ++ix)
+        {
+            const uint8_t* p = bgra + (iy * 2 * width + ix * 2) * 4;
+            float u = (float)(p[2]*-38 + p[1]*-74 + p[0]*112 + 128) / 256 + 128;
+            float v = (float)(p[2]*112 + p[1]*-94 + p[0]*-18 + 128) / 256 + 128;
+            u_plane[(half_height - 1 - iy) * half_width + ix] = (uint8_t) u;
+            v_plane[(half_height - 1 - iy) * half_width + ix] = (uint8_t) v;
+        }
+    }
+}
+
+TEST(dmRecord, BGRAToI420)
+{
+    // Not a multiple of the SIMD width, to test the row tails
+    const uint32_t width = 72;
+    const uint32_t height = 10;
+    const uint32_t y_size = width * height;
+    const uint32_t uv_size = y_size / 4;
+
+    uint8_t* bgra = new uint8_t[y_size * 4];
+    uint32_t seed = 1234;
+    for (uint32_t i = 0; i < y_size * 4; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        bgra[i] = (uint8_t) (seed >> 24);
+    }
+    // Include the extremes
+    memset(bgra, 0xff, 16);
+    memset(bgra + 16, 0, 16);
+
+    uint8_t* expected = new uint8_t[y_size + uv_size * 2];
+    uint8_t* scalar = new uint8_t[y_size + uv_size * 2];
+    uint8_t* actual = new uint8_t[y_size + uv_size * 2];
+    ReferenceBGRAToI420FlipY(bgra, width, height, expected, expected + y_size, expected + y_size + uv_size);
+    dmRecord::BGRAToI420FlipYScalar(bgra, width, height, scalar, width, scalar + y_size, scalar + y_size + uv_size, width / 2);
+    dmRecord::BGRAToI420FlipY(bgra, width, height, actual, width, actual + y_size, actual + y_size + uv_size, width / 2);
+
+    for (uint32_t i = 0; i < y_size + uv_size * 2; ++i)
+    {
+        ASSERT_EQ(expected[i], scalar[i]);
+        ASSERT_EQ(expected[i], actual[i]);
+    }
+
+    delete[] bgra;
+    delete[] expected;
+    delete[] scalar;
+    delete[] actual;
+}
+
 #if !defined(DM_RECORD_NULL)
+static void RecordFrames(uint32_t queue_size, const char* filename, dmRecord::Stats* stats)
+{
+    dmRecord::NewParams params;
+    params.m_Width = 320;
+    params.m_Height = 240;
+    params.m_Filename = filename;
+    params.m_QueueSize = queue_size;
+    dmRecord::HRecorder recorder = 0;
+    dmRecord::Result r = dmRecord::New(&params, &recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+
+    uint32_t buffer_size = params.m_Width * params.m_Height * sizeof(uint32_t);
+    uint32_t* buffer = new uint32_t[params.m_Width * params.m_Height];
+    for (uint32_t i = 0; i < 32; ++i)
+    {
+        for (uint32_t p = 0; p < params.m_Width * params.m_Height; ++p)
+        {
+            buffer[p] = (p + i * 4) & 0xff;
+        }
+        r = dmRecord::RecordFrame(recorder, buffer, buffer_size, dmRecord::BUFFER_FORMAT_BGRA);
+        ASSERT_EQ(dmRecord::RESULT_OK, r);
+    }
+    delete[] buffer;
+
+    dmRecord::GetStats(recorder, stats);
+    r = dmRecord::Delete(recorder);
+    ASSERT_EQ(dmRecord::RESULT_OK, r);
+}
+
+TEST(dmRecord, Synchronous)
+{
+    dmRecord::Stats stats;
+    RecordFrames(0, "tmp/synchronous.ivf", &stats);
+    ASSERT_EQ(32u, stats.m_FramesRecorded);
+    ASSERT_EQ(32u, stats.m_FramesEncoded);
+    ASSERT_EQ(0u, stats.m_FramesDropped);
+    ASSERT_EQ(0u, stats.m_MaxQueued);
+}
+
+TEST(dmRecord, Queued)
+{
+    dmRecord::Stats stats;
+    RecordFrames(2, "tmp/queued.ivf", &stats);
+    ASSERT_EQ(32u, stats.m_FramesRecorded);
+    // Frames are only dropped if the queue was full
+    ASSERT_LE(stats.m_FramesEncoded + stats.m_FramesDropped, stats.m_FramesRecorded);
+    ASSERT_GE(stats.m_FramesRecorded, stats.m_FramesDropped + stats.m_MaxQueued);
+    ASSERT_LE(stats.m_MaxQueued, 2u);
+    if (stats.m_FramesDropped > 0)
+    {
+        ASSERT_EQ(2u, stats.m_MaxQueued);
+    }
+}
+
 TEST(dmRecord, Simple)
 {
     dmRecord::NewParams params;
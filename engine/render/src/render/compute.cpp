@@ -59,7 +59,7 @@ namespace dmRender
         return (HComputeProgram) program;
     }
 
-    void ApplyComputeProgramConstants(dmRender::HRenderContext render_context, HComputeProgram compute_program)
+    void ApplyComputeProgramConstants(dmRender::HRenderContext render_context, const ViewState& view_state, HComputeProgram compute_program)
     {
         dmGraphics::HContext graphics_context           = dmRender::GetGraphicsContext(render_context);
         const dmArray<RenderConstant>& render_constants = compute_program->m_Constants;
@@ -75,7 +75,7 @@ namespace dmRender
             const HConstant constant                     = material_constant.m_Constant;
             dmGraphics::HUniformLocation location        = GetConstantLocation(constant);
             dmRenderDDF::MaterialDesc::ConstantType type = GetConstantType(constant);
-            SetProgramConstant(render_context, graphics_context, world_matrix, texture_matrix, language, type, program, location, constant);
+            SetProgramConstant(view_state, graphics_context, world_matrix, texture_matrix, language, type, program, location, constant);
         }
     }
 
@@ -130,6 +130,31 @@ void ClearNamedConstantBuffer(HNamedConstantBuffer buffer)
     buffer->m_Values.SetSize(0);
 }
 
+void CopyNamedConstantBuffer(HNamedConstantBuffer dst, HNamedConstantBuffer src)
+{
+    ClearNamedConstantBuffer(dst);
+
+    if (dst->m_Constants.Capacity() < src->m_Constants.Size())
+    {
+        uint32_t capacity = src->m_Constants.Size() + 8;
+        dst->m_Constants.SetCapacity(capacity, capacity * 2);
+    }
+
+    // The value indices are kept as is, since the value array is copied as a whole
+    dmHashTable64<NamedConstantBuffer::Constant>::Iterator iter = src->m_Constants.GetIterator();
+    while (iter.Next())
+    {
+        dst->m_Constants.Put(iter.GetKey(), iter.GetValue());
+    }
+
+    uint32_t num_values = src->m_Values.Size();
+    if (dst->m_Values.Capacity() < num_values)
+        dst->m_Values.SetCapacity(num_values);
+    dst->m_Values.SetSize(num_values);
+    if (num_values > 0)
+        memcpy(dst->m_Values.Begin(), src->m_Values.Begin(), sizeof(dmVMath::Vector4) * num_values);
+}
+
 struct ShiftConstantsContext
 {
     uint32_t m_Index;
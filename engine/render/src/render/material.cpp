@@ -208,7 +208,15 @@ namespace dmRender
 
     void ApplyMaterialConstants(dmRender::HRenderContext render_context, HMaterial material, const RenderObject* ro)
     {
-        dmGraphics::HContext graphics_context    = dmRender::GetGraphicsContext(render_context);
+        ViewState view_state;
+        view_state.m_View       = render_context->m_View;
+        view_state.m_Projection = render_context->m_Projection;
+        view_state.m_ViewProj   = render_context->m_ViewProj;
+        ApplyMaterialConstants(dmRender::GetGraphicsContext(render_context), view_state, material, ro);
+    }
+
+    void ApplyMaterialConstants(dmGraphics::HContext graphics_context, const ViewState& view_state, HMaterial material, const RenderObject* ro)
+    {
         const dmArray<RenderConstant>& constants = material->m_Constants;
         dmGraphics::HProgram program             = material->m_Program;
 
@@ -220,7 +228,7 @@ namespace dmRender
             dmGraphics::HUniformLocation location        = GetConstantLocation(constant);
             dmRenderDDF::MaterialDesc::ConstantType type = GetConstantType(constant);
             dmGraphics::ShaderDesc::Language language    = dmGraphics::GetProgramLanguage(dmRender::GetMaterialProgram(material));
-            SetProgramConstant(render_context, graphics_context, ro->m_WorldTransform, ro->m_TextureTransform, language, type, program, location, constant);
+            SetProgramConstant(view_state, graphics_context, ro->m_WorldTransform, ro->m_TextureTransform, language, type, program, location, constant);
         }
     }
 
@@ -339,7 +339,7 @@ namespace dmRender
         delete[] default_values;
     }
 
-    void SetProgramConstant(dmRender::HRenderContext render_context, dmGraphics::HContext graphics_context, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& texture_matrix, dmGraphics::ShaderDesc::Language program_language, dmRenderDDF::MaterialDesc::ConstantType type, dmGraphics::HProgram program, dmGraphics::HUniformLocation location, HConstant constant)
+    void SetProgramConstant(const ViewState& view_state, dmGraphics::HContext graphics_context, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& texture_matrix, dmGraphics::ShaderDesc::Language program_language, dmRenderDDF::MaterialDesc::ConstantType type, dmGraphics::HProgram program, dmGraphics::HUniformLocation location, HConstant constant)
     {
         switch (type)
         {
@@ -364,12 +364,12 @@ namespace dmRender
                     Matrix4 ndc_matrix = Matrix4::identity();
                     ndc_matrix.setElem(2, 2, 0.5f );
                     ndc_matrix.setElem(3, 2, 0.5f );
-                    const Matrix4 view_projection = ndc_matrix * render_context->m_ViewProj;
+                    const Matrix4 view_projection = ndc_matrix * view_state.m_ViewProj;
                     dmGraphics::SetConstantM4(graphics_context, (Vector4*)&view_projection, 1, location);
                 }
                 else
                 {
-                    dmGraphics::SetConstantM4(graphics_context, (Vector4*)&render_context->m_ViewProj, 1, location);
+                    dmGraphics::SetConstantM4(graphics_context, (Vector4*)&view_state.m_ViewProj, 1, location);
                 }
                 break;
             }
@@ -385,7 +385,7 @@ namespace dmRender
             }
             case dmRenderDDF::MaterialDesc::CONSTANT_TYPE_VIEW:
             {
-                dmGraphics::SetConstantM4(graphics_context, (Vector4*)&render_context->m_View, 1, location);
+                dmGraphics::SetConstantM4(graphics_context, (Vector4*)&view_state.m_View, 1, location);
                 break;
             }
             case dmRenderDDF::MaterialDesc::CONSTANT_TYPE_PROJECTION:
@@ -397,12 +397,12 @@ namespace dmRender
                     Matrix4 ndc_matrix = Matrix4::identity();
                     ndc_matrix.setElem(2, 2, 0.5f );
                     ndc_matrix.setElem(3, 2, 0.5f );
-                    const Matrix4 proj = ndc_matrix * render_context->m_Projection;
+                    const Matrix4 proj = ndc_matrix * view_state.m_Projection;
                     dmGraphics::SetConstantM4(graphics_context, (Vector4*)&proj, 1, location);
                 }
                 else
                 {
-                    dmGraphics::SetConstantM4(graphics_context, (Vector4*)&render_context->m_Projection, 1, location);
+                    dmGraphics::SetConstantM4(graphics_context, (Vector4*)&view_state.m_Projection, 1, location);
                 }
                 break;
             }
@@ -410,7 +410,7 @@ namespace dmRender
             {
                 {
                     // normalT = transp(inv(view * world))
-                    Matrix4 normalT = render_context->m_View * world_matrix;
+                    Matrix4 normalT = view_state.m_View * world_matrix;
                     // The world transform might include non-uniform scaling, which breaks the orthogonality of the combined model-view transform
                     // It is always affine however
                     normalT = affineInverse(normalT);
@@ -422,7 +422,7 @@ namespace dmRender
             case dmRenderDDF::MaterialDesc::CONSTANT_TYPE_WORLDVIEW:
             {
                 {
-                    Matrix4 world_view = render_context->m_View * world_matrix;
+                    Matrix4 world_view = view_state.m_View * world_matrix;
                     dmGraphics::SetConstantM4(graphics_context, (Vector4*)&world_view, 1, location);
                 }
                 break;
@@ -434,12 +434,12 @@ namespace dmRender
                     Matrix4 ndc_matrix = Matrix4::identity();
                     ndc_matrix.setElem(2, 2, 0.5f );
                     ndc_matrix.setElem(3, 2, 0.5f );
-                    const Matrix4 world_view_projection = ndc_matrix * render_context->m_ViewProj * world_matrix;
+                    const Matrix4 world_view_projection = ndc_matrix * view_state.m_ViewProj * world_matrix;
                     dmGraphics::SetConstantM4(graphics_context, (Vector4*)&world_view_projection, 1, location);
                 }
                 else
                 {
-                    const Matrix4 world_view_projection = render_context->m_ViewProj * world_matrix;
+                    const Matrix4 world_view_projection = view_state.m_ViewProj * world_matrix;
                     dmGraphics::SetConstantM4(graphics_context, (Vector4*)&world_view_projection, 1, location);
                 }
                 break;
@@ -32,6 +32,7 @@
 #include "font_renderer.h"
 
 DM_PROPERTY_GROUP(rmtp_Render, "Renderer");
+DM_PROPERTY_U32(rmtp_RenderFrameCommands, 0, FrameReset, "# recorded commands submitted", &rmtp_Render);
 
 namespace dmRender
 {
@@ -97,6 +98,26 @@ namespace dmRender
 
     }
 
+    static void ResetRenderFrame(RenderFrame* frame)
+    {
+        frame->m_Commands.SetSize(0);
+        frame->m_RenderObjects.SetSize(0);
+        frame->m_Draws.SetSize(0);
+        frame->m_Computes.SetSize(0);
+        frame->m_TextureBindings.SetSize(0);
+        frame->m_ConstantBuffersUsed = 0;
+    }
+
+    static void DeleteRenderFrame(RenderFrame* frame)
+    {
+        for (uint32_t i = 0; i < frame->m_ConstantBuffers.Size(); ++i)
+        {
+            DeleteNamedConstantBuffer(frame->m_ConstantBuffers[i]);
+        }
+        frame->m_ConstantBuffers.SetSize(0);
+        ResetRenderFrame(frame);
+    }
+
     HRenderContext NewRenderContext(dmGraphics::HContext graphics_context, const RenderContextParams& params)
     {
         RenderContext* context = new RenderContext;
@@ -143,6 +164,11 @@ namespace dmRender
 
         context->m_RenderListDispatch.SetCapacity(255);
 
+        context->m_RecordFrame = 0;
+        context->m_SubmitFrame = 0;
+        context->m_RenderFrames[0].m_ConstantBuffersUsed = 0;
+        context->m_RenderFrames[1].m_ConstantBuffersUsed = 0;
+
         dmMessage::Result r = dmMessage::NewSocket(RENDER_SOCKET_NAME, &context->m_Socket);
         assert(r == dmMessage::RESULT_OK);
         return context;
@@ -157,6 +183,8 @@ namespace dmRender
         dmScript::DeleteScriptWorld(render_context->m_ScriptWorld);
         FinalizeDebugRenderer(render_context);
         FinalizeTextContext(render_context);
+        DeleteRenderFrame(&render_context->m_RenderFrames[0]);
+        DeleteRenderFrame(&render_context->m_RenderFrames[1]);
         dmMessage::DeleteSocket(render_context->m_Socket);
         delete render_context;
 
@@ -255,17 +283,6 @@ namespace dmRender
         render_context->m_RenderListRanges.SetSize(0);
     }
 
-    struct RenderListSorter
-    {
-        bool operator()(uint32_t a, uint32_t b) const
-        {
-            const RenderListSortValue& u = values[a];
-            const RenderListSortValue& v = values[b];
-            return u.m_SortKey < v.m_SortKey;
-        }
-        RenderListSortValue* values;
-    };
-
     void RenderListEnd(HRenderContext render_context)
     {
         // Unflushed leftovers are assumed to be the debug rendering
@@ -475,7 +492,103 @@ namespace dmRender
         return false;
     }
 
-    // Compute new sort values for everything that matches tag_mask
+    // Stable LSD radix sort of the values by key, one pass per byte.
+    // A pass is skipped when all keys have the same byte, so small keys only cost the passes they need.
+    static void RadixSort(uint64_t* keys, uint32_t* values, uint64_t* keys_scratch, uint32_t* values_scratch, uint32_t count)
+    {
+        if (count < 2)
+            return;
+
+        uint32_t offsets[8][256];
+        memset(offsets, 0, sizeof(offsets));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint64_t key = keys[i];
+            for (uint32_t pass = 0; pass < 8; ++pass)
+            {
+                ++offsets[pass][(key >> (pass * 8)) & 0xff];
+            }
+        }
+
+        uint64_t* src_keys = keys;
+        uint32_t* src_values = values;
+        uint64_t* dst_keys = keys_scratch;
+        uint32_t* dst_values = values_scratch;
+        for (uint32_t pass = 0; pass < 8; ++pass)
+        {
+            uint32_t shift = pass * 8;
+            uint32_t* pass_offsets = offsets[pass];
+            if (pass_offsets[(src_keys[0] >> shift) & 0xff] == count)
+                continue;
+
+            uint32_t sum = 0;
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                uint32_t c = pass_offsets[b];
+                pass_offsets[b] = sum;
+                sum += c;
+            }
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint64_t key = src_keys[i];
+                uint32_t j = pass_offsets[(key >> shift) & 0xff]++;
+                dst_keys[j] = key;
+                dst_values[j] = src_values[i];
+            }
+
+            uint64_t* tmp_keys = src_keys; src_keys = dst_keys; dst_keys = tmp_keys;
+            uint32_t* tmp_values = src_values; src_values = dst_values; dst_values = tmp_values;
+        }
+
+        if (src_keys != keys)
+        {
+            memcpy(keys, src_keys, sizeof(uint64_t) * count);
+            memcpy(values, src_values, sizeof(uint32_t) * count);
+        }
+    }
+
+    static void SetSortScratchCapacity(HRenderContext context, uint32_t capacity)
+    {
+        // SetCapacity does early out if they are the same, so just call anyway.
+        context->m_RenderListSortKeys.SetCapacity(capacity);
+        context->m_RenderListSortKeysScratch.SetCapacity(capacity);
+        context->m_RenderListSortIndicesScratch.SetCapacity(capacity);
+    }
+
+    // Writes z/w in clip space for each entry. Only the z and w rows of the transform are needed for that.
+    static void ComputeSortDepths(const Matrix4& transform, const RenderListEntry* entries, const uint32_t* indices, uint32_t count, float* depths, float* min_depth, float* max_depth)
+    {
+        const float zx = transform.getCol0().getZ();
+        const float zy = transform.getCol1().getZ();
+        const float zz = transform.getCol2().getZ();
+        const float zt = transform.getCol3().getZ();
+        const float wx = transform.getCol0().getW();
+        const float wy = transform.getCol1().getW();
+        const float wz = transform.getCol2().getW();
+        const float wt = transform.getCol3().getW();
+
+        float minZW = *min_depth;
+        float maxZW = *max_depth;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const RenderListEntry* entry = &entries[indices[i]];
+            if (entry->m_MajorOrder != RENDER_ORDER_WORLD)
+                continue;
+
+            const Point3& p = entry->m_WorldPosition;
+            const float z = zx * p.getX() + zy * p.getY() + zz * p.getZ() + zt;
+            const float w = wx * p.getX() + wy * p.getY() + wz * p.getZ() + wt;
+            const float zw = z / w;
+            depths[i] = zw;
+            if (zw < minZW) minZW = zw;
+            if (zw > maxZW) maxZW = zw;
+        }
+        *min_depth = minZW;
+        *max_depth = maxZW;
+    }
+
+    // Collect everything that matches tag_mask and compute the sort keys for it
     static void MakeSortBuffer(HRenderContext context, uint32_t tag_count, dmhash_t* tags)
     {
         DM_PROFILE("MakeSortBuffer");
@@ -484,17 +597,11 @@ namespace dmRender
         // SetCapacity does early out if they are the same, so just call anyway.
         context->m_RenderListSortBuffer.SetCapacity(required_capacity);
         context->m_RenderListSortBuffer.SetSize(0);
-        context->m_RenderListSortValues.SetCapacity(required_capacity);
-        context->m_RenderListSortValues.SetSize(context->m_RenderListSortIndices.Size());
+        context->m_RenderListSortDepths.SetCapacity(required_capacity);
+        SetSortScratchCapacity(context, required_capacity);
 
-        RenderListSortValue* sort_values = context->m_RenderListSortValues.Begin();
         RenderListEntry* entries = context->m_RenderList.Begin();
 
-        const Matrix4& transform = context->m_ViewProj;
-
-        float minZW = FLT_MAX;
-        float maxZW = -FLT_MAX;
-
         RenderListRange* ranges = context->m_RenderListRanges.Begin();
         uint32_t num_ranges = context->m_RenderListRanges.Size();
         for( uint32_t r = 0; r < num_ranges; ++r)
@@ -511,28 +618,16 @@ namespace dmRender
                 continue;
             }
 
-            // Write z values...
             int num_visibility_skipped = 0;
             for (uint32_t i = range.m_Start; i < range.m_Start+range.m_Count; ++i)
             {
                 uint32_t idx = context->m_RenderListSortIndices[i];
-                RenderListEntry* entry = &entries[idx];
-                if (entry->m_Visibility == dmRender::VISIBILITY_NONE)
+                if (entries[idx].m_Visibility == dmRender::VISIBILITY_NONE)
                 {
                     num_visibility_skipped++;
                     continue;
                 }
-
-                if (entry->m_MajorOrder != RENDER_ORDER_WORLD)
-                {
-                    continue; // Could perhaps break here, if we also sorted on the major order (cost more when I tested it /MAWE)
-                }
-
-                const Vector4 res = transform * entry->m_WorldPosition;
-                const float zw = res.getZ() / res.getW();
-                sort_values[idx].m_ZW = zw;
-                if (zw < minZW) minZW = zw;
-                if (zw > maxZW) maxZW = zw;
+                context->m_RenderListSortBuffer.Push(idx);
             }
 
             if (num_visibility_skipped == range.m_Count)
@@ -541,43 +636,43 @@ namespace dmRender
             }
         }
 
+        const uint32_t count = context->m_RenderListSortBuffer.Size();
+        const uint32_t* sort_buffer = context->m_RenderListSortBuffer.Begin();
+        context->m_RenderListSortDepths.SetSize(count);
+        context->m_RenderListSortKeys.SetSize(count);
+        float* depths = context->m_RenderListSortDepths.Begin();
+        uint64_t* keys = context->m_RenderListSortKeys.Begin();
+
+        // Write z values...
+        float minZW = FLT_MAX;
+        float maxZW = -FLT_MAX;
+        ComputeSortDepths(context->m_ViewProj, entries, sort_buffer, count, depths, &minZW, &maxZW);
+
         // ... and compute range
         float rc = 0;
         if (maxZW > minZW)
             rc = 1.0f / (maxZW - minZW);
 
-        for( uint32_t i = 0; i < num_ranges; ++i)
+        // The key sorts on minor order, major order, order (or depth), dispatch and batch key, from high to low bits
+        for (uint32_t i = 0; i < count; ++i)
         {
-            const RenderListRange& range = ranges[i];
-            if (range.m_Skip)
-                continue;
+            const RenderListEntry* entry = &entries[sort_buffer[i]];
 
-            for (uint32_t i = range.m_Start; i < range.m_Start+range.m_Count; ++i)
+            uint32_t order;
+            if (entry->m_MajorOrder == RENDER_ORDER_WORLD)
             {
-                uint32_t idx = context->m_RenderListSortIndices[i];
-                RenderListEntry* entry = &entries[idx];
-
-                if (entry->m_Visibility == dmRender::VISIBILITY_NONE)
-                {
-                    continue;
-                }
-
-                sort_values[idx].m_MajorOrder = entry->m_MajorOrder;
-                if (entry->m_MajorOrder == RENDER_ORDER_WORLD)
-                {
-                    const float z = sort_values[idx].m_ZW;
-                    sort_values[idx].m_Order = (uint32_t) (0xfffff8 - 0xfffff0 * rc * (z - minZW));
-                }
-                else
-                {
-                    // use the integer value provided.
-                    sort_values[idx].m_Order = entry->m_Order;
-                }
-                sort_values[idx].m_MinorOrder = entry->m_MinorOrder;
-                sort_values[idx].m_BatchKey = entry->m_BatchKey & 0x00ffffff;
-                sort_values[idx].m_Dispatch = entry->m_Dispatch;
-                context->m_RenderListSortBuffer.Push(idx);
+                order = (uint32_t) (0xfffff8 - 0xfffff0 * rc * (depths[i] - minZW));
+            }
+            else
+            {
+                // use the integer value provided.
+                order = entry->m_Order;
             }
+            keys[i] = ((uint64_t) entry->m_MinorOrder << 60)
+                    | ((uint64_t) entry->m_MajorOrder << 56)
+                    | ((uint64_t) (order & 0xffffff) << 32)
+                    | ((uint64_t) entry->m_Dispatch << 24)
+                    | (uint64_t) (entry->m_BatchKey & 0x00ffffff);
         }
     }
 
@@ -595,25 +690,17 @@ namespace dmRender
         context->m_RenderListRanges.Push(range);
     }
 
-    void FindRenderListRanges(uint32_t* first, size_t offset, size_t size, RenderListEntry* entries, FindRangeComparator& comp, void* ctx, RangeCallback callback )
+    void FindRenderListRanges(const uint64_t* sorted_keys, uint32_t count, void* ctx, RangeCallback callback)
     {
-        if (size == 0)
-            return;
-
-        size_t half = size >> 1;
-        uint32_t* low = first + offset;
-        uint32_t* high = low + size;
-        uint32_t* middle = low + half;
-        uint32_t val = entries[*middle].m_TagListKey;
-
-        low = std::lower_bound(low, middle, *middle, comp);
-        high = std::upper_bound(middle, high, *middle, comp);
-
-        callback(ctx, val, low - first, high - low);
-
-        uint32_t* rangefirst = first + offset;
-        FindRenderListRanges(first, offset, low - rangefirst, entries, comp, ctx, callback);
-        FindRenderListRanges(first, high - first, size - (high - rangefirst), entries, comp, ctx, callback);
+        uint32_t start = 0;
+        for (uint32_t i = 1; i <= count; ++i)
+        {
+            if (i == count || sorted_keys[i] != sorted_keys[start])
+            {
+                callback(ctx, (uint32_t) sorted_keys[start], start, i - start);
+                start = i;
+            }
+        }
     }
 
     static void SortRenderList(HRenderContext context)
@@ -624,18 +711,21 @@ namespace dmRender
             return;
 
         // First sort on the tag masks
+        uint32_t count = context->m_RenderListSortIndices.Size();
+        SetSortScratchCapacity(context, context->m_RenderListSortIndices.Capacity());
+        context->m_RenderListSortKeys.SetSize(count);
+
+        RenderListEntry* entries = context->m_RenderList.Begin();
+        uint32_t* indices = context->m_RenderListSortIndices.Begin();
+        uint64_t* keys = context->m_RenderListSortKeys.Begin();
+        for (uint32_t i = 0; i < count; ++i)
         {
-            RenderListEntrySorter sort;
-            sort.m_Base = context->m_RenderList.Begin();
-            std::stable_sort(context->m_RenderListSortIndices.Begin(), context->m_RenderListSortIndices.End(), sort);
+            keys[i] = entries[indices[i]].m_TagListKey;
         }
+        RadixSort(keys, indices, context->m_RenderListSortKeysScratch.Begin(), context->m_RenderListSortIndicesScratch.Begin(), count);
+
         // Now find the ranges of tag masks
-        {
-            RenderListEntry* entries = context->m_RenderList.Begin();
-            FindRangeComparator comp;
-            comp.m_Entries = entries;
-            FindRenderListRanges(context->m_RenderListSortIndices.Begin(), 0, context->m_RenderListSortIndices.Size(), entries, comp, context, CollectRenderEntryRange);
-        }
+        FindRenderListRanges(keys, count, context, CollectRenderEntryRange);
     }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -763,29 +853,28 @@ namespace dmRender
         }
     }
 
-    static void GetRenderContextTextures(HRenderContext render_context, const dmArray<Sampler>& samplers, dmGraphics::HTexture* textures)
+    static void GetRenderContextTextures(const TextureBinding* bindings, uint32_t num_bindings, const dmArray<Sampler>& samplers, dmGraphics::HTexture* textures)
     {
-        uint32_t num_bindings = render_context->m_TextureBindTable.Size();
         for (uint32_t i = 0; i < num_bindings; ++i)
         {
             uint32_t sampler_index       = i;
             dmGraphics::HTexture texture = textures[i];
 
             // If a texture has been bound by a sampler hash, the material must have a valid sampler for it
-            if (render_context->m_TextureBindTable[i].m_Samplerhash)
+            if (bindings[i].m_Samplerhash)
             {
-                int32_t hash_sampler_index = GetProgramSamplerIndex(samplers, render_context->m_TextureBindTable[i].m_Samplerhash);
+                int32_t hash_sampler_index = GetProgramSamplerIndex(samplers, bindings[i].m_Samplerhash);
                 if (hash_sampler_index >= 0)
                 {
                     sampler_index = hash_sampler_index;
-                    texture       = render_context->m_TextureBindTable[i].m_Texture;
+                    texture       = bindings[i].m_Texture;
                 }
                 // The sampler doesn't exist, so we ignore it.
                 else continue;
             }
             else if (texture == 0)
             {
-                texture = render_context->m_TextureBindTable[i].m_Texture;
+                texture = bindings[i].m_Texture;
             }
 
             if (sampler_index >= 0 && sampler_index < RenderObject::MAX_TEXTURE_COUNT)
@@ -799,6 +888,13 @@ namespace dmRender
         }
     }
 
+    static inline void GetViewState(HRenderContext render_context, ViewState* view_state)
+    {
+        view_state->m_View       = render_context->m_View;
+        view_state->m_Projection = render_context->m_Projection;
+        view_state->m_ViewProj   = render_context->m_ViewProj;
+    }
+
     Result DrawRenderList(HRenderContext context, HPredicate predicate, HNamedConstantBuffer constant_buffer, const FrustumOptions* frustum_options)
     {
         DM_PROFILE("DrawRenderList");
@@ -872,9 +968,8 @@ namespace dmRender
 
         {
             DM_PROFILE("DrawRenderList_SORT");
-            RenderListSorter sort;
-            sort.values = context->m_RenderListSortValues.Begin();
-            std::stable_sort(context->m_RenderListSortBuffer.Begin(), context->m_RenderListSortBuffer.End(), sort);
+            RadixSort(context->m_RenderListSortKeys.Begin(), context->m_RenderListSortBuffer.Begin(),
+                      context->m_RenderListSortKeysScratch.Begin(), context->m_RenderListSortIndicesScratch.Begin(), context->m_RenderListSortBuffer.Size());
         }
 
         // Construct render objects
@@ -953,20 +1048,14 @@ namespace dmRender
         return Draw(context, predicate, constant_buffer);
     }
 
-    void DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
+    static void DispatchCompute(HRenderContext render_context, const ViewState& view_state, HComputeProgram compute_program, const TextureBinding* bindings, uint32_t num_bindings,
+                                uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
     {
-        HComputeProgram compute_program = render_context->m_ComputeProgram;
-
-        if (compute_program == 0)
-        {
-            return;
-        }
-
         dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
         dmGraphics::HTexture render_context_textures[RenderObject::MAX_TEXTURE_COUNT] = {};
 
         dmGraphics::EnableProgram(context, compute_program->m_Program);
-        GetRenderContextTextures(render_context, compute_program->m_Samplers, render_context_textures);
+        GetRenderContextTextures(bindings, num_bindings, compute_program->m_Samplers, render_context_textures);
 
         uint8_t next_texture_unit = 0;
         for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
@@ -988,7 +1077,7 @@ namespace dmRender
             }
         }
 
-        ApplyComputeProgramConstants(render_context, compute_program);
+        ApplyComputeProgramConstants(render_context, view_state, compute_program);
 
         if (constant_buffer)
         {
@@ -1013,140 +1102,211 @@ namespace dmRender
         }
 
         dmGraphics::DisableProgram(context);
-        TrimTextureBindingTable(render_context);
     }
 
-    // NOTE: Currently only used externally in 1 test (fontview.cpp)
-    // TODO: Replace that occurrance with DrawRenderList
-    Result Draw(HRenderContext render_context, HPredicate predicate, HNamedConstantBuffer constant_buffer)
+    void DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
     {
-        if (render_context == 0x0)
-            return RESULT_INVALID_CONTEXT;
-
-        dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
-        dmGraphics::HTexture render_context_textures[RenderObject::MAX_TEXTURE_COUNT] = {};
+        HComputeProgram compute_program = render_context->m_ComputeProgram;
 
-        HMaterial material         = render_context->m_Material;
-        HMaterial context_material = render_context->m_Material;
+        if (compute_program == 0)
+        {
+            return;
+        }
 
-        if(context_material)
+        if (render_context->m_RecordFrame)
+        {
+            RecordDispatchCompute(render_context, group_count_x, group_count_y, group_count_z, constant_buffer);
+        }
+        else
         {
-            dmGraphics::EnableProgram(context, GetMaterialProgram(context_material));
-            GetRenderContextTextures(render_context, context_material->m_Samplers, render_context_textures);
+            ViewState view_state;
+            GetViewState(render_context, &view_state);
+            DispatchCompute(render_context, view_state, compute_program, render_context->m_TextureBindTable.Begin(), render_context->m_TextureBindTable.Size(),
+                            group_count_x, group_count_y, group_count_z, constant_buffer);
         }
+        TrimTextureBindingTable(render_context);
+    }
 
-        dmGraphics::PipelineState ps_orig = dmGraphics::GetPipelineState(context);
+    // The state of a Draw() call, either from the render context or from a recorded draw
+    struct DrawState
+    {
+        dmGraphics::HTexture    m_Textures[RenderObject::MAX_TEXTURE_COUNT];
+        const ViewState*        m_ViewState;
+        const TextureBinding*   m_TextureBindings;
+        uint32_t                m_TextureBindingCount;
+        HMaterial               m_ContextMaterial;
+        HMaterial               m_Material;
+        HNamedConstantBuffer    m_ConstantBuffer;
+    };
 
-        for (uint32_t i = 0; i < render_context->m_RenderObjects.Size(); ++i)
+    static void BeginDraw(HRenderContext render_context, DrawState& state)
+    {
+        memset(state.m_Textures, 0, sizeof(state.m_Textures));
+        state.m_Material = state.m_ContextMaterial;
+
+        if (state.m_ContextMaterial)
         {
-            RenderObject* ro = render_context->m_RenderObjects[i];
-            if (ro->m_VertexCount == 0)
-                continue;
+            dmGraphics::EnableProgram(render_context->m_GraphicsContext, GetMaterialProgram(state.m_ContextMaterial));
+            GetRenderContextTextures(state.m_TextureBindings, state.m_TextureBindingCount, state.m_ContextMaterial->m_Samplers, state.m_Textures);
+        }
+    }
 
-            MaterialTagList taglist;
-            uint32_t taglistkey = dmRender::GetMaterialTagListKey(ro->m_Material);
-            dmRender::GetMaterialTagList(render_context, taglistkey, &taglist);
+    static bool IsRenderObjectVisible(HRenderContext render_context, HPredicate predicate, const RenderObject* ro)
+    {
+        if (ro->m_VertexCount == 0)
+            return false;
 
-            if (predicate && !dmRender::MatchMaterialTags(taglist.m_Count, taglist.m_Tags, predicate->m_TagCount, predicate->m_Tags))
-            {
-                continue;
-            }
+        if (!predicate)
+            return true;
+
+        MaterialTagList taglist;
+        uint32_t taglistkey = dmRender::GetMaterialTagListKey(ro->m_Material);
+        dmRender::GetMaterialTagList(render_context, taglistkey, &taglist);
+        return dmRender::MatchMaterialTags(taglist.m_Count, taglist.m_Tags, predicate->m_TagCount, predicate->m_Tags);
+    }
 
-            if (!context_material)
+    static void DrawRenderObject(HRenderContext render_context, DrawState& state, const RenderObject* ro)
+    {
+        dmGraphics::HContext context = render_context->m_GraphicsContext;
+        dmGraphics::HTexture* render_context_textures = state.m_Textures;
+
+        if (!state.m_ContextMaterial)
+        {
+            if(state.m_Material != ro->m_Material)
             {
-                if(material != ro->m_Material)
-                {
-                    material = ro->m_Material;
-                    dmGraphics::EnableProgram(context, GetMaterialProgram(material));
+                state.m_Material = ro->m_Material;
+                dmGraphics::EnableProgram(context, GetMaterialProgram(state.m_Material));
 
-                    // Reset the override texture binding array. The new material may have a different
-                    // resource layout than the current material.
-                    memset(render_context_textures, 0, sizeof(render_context_textures));
-                    GetRenderContextTextures(render_context, material->m_Samplers, render_context_textures);
-                }
+                // Reset the override texture binding array. The new material may have a different
+                // resource layout than the current material.
+                memset(state.m_Textures, 0, sizeof(state.m_Textures));
+                GetRenderContextTextures(state.m_TextureBindings, state.m_TextureBindingCount, state.m_Material->m_Samplers, state.m_Textures);
             }
+        }
+
+        HMaterial material = state.m_Material;
 
-            ApplyMaterialConstants(render_context, material, ro);
+        ApplyMaterialConstants(context, *state.m_ViewState, material, ro);
 
-            if (ro->m_ConstantBuffer) // from components/scripts
-                ApplyNamedConstantBuffer(render_context, material, ro->m_ConstantBuffer);
+        if (ro->m_ConstantBuffer) // from components/scripts
+            ApplyNamedConstantBuffer(render_context, material, ro->m_ConstantBuffer);
 
-            if (constant_buffer) // from render script
-                ApplyNamedConstantBuffer(render_context, material, constant_buffer);
+        if (state.m_ConstantBuffer) // from render script
+            ApplyNamedConstantBuffer(render_context, material, state.m_ConstantBuffer);
 
-            ApplyRenderState(render_context, render_context->m_GraphicsContext, dmGraphics::GetPipelineState(context), ro);
+        ApplyRenderState(render_context, context, dmGraphics::GetPipelineState(context), ro);
 
-            uint8_t next_texture_unit = 0;
-            for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
+        uint8_t next_texture_unit = 0;
+        for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
+        {
+            dmGraphics::HTexture texture = ro->m_Textures[i];
+            if (render_context_textures[i])
             {
-                dmGraphics::HTexture texture = ro->m_Textures[i];
-                if (render_context_textures[i])
-                {
-                    texture = render_context_textures[i];
-                }
+                texture = render_context_textures[i];
+            }
 
-                if (texture)
+            if (texture)
+            {
+                uint32_t num_texture_handles = dmGraphics::GetNumTextureHandles(texture);
+                for (int sub_handle = 0; sub_handle < num_texture_handles; ++sub_handle)
                 {
-                    uint32_t num_texture_handles = dmGraphics::GetNumTextureHandles(texture);
-                    for (int sub_handle = 0; sub_handle < num_texture_handles; ++sub_handle)
-                    {
-                        HSampler sampler = GetProgramSampler(material->m_Samplers, next_texture_unit);
-                        dmGraphics::EnableTexture(context, next_texture_unit, sub_handle, texture);
-                        ApplyProgramSampler(render_context, sampler, next_texture_unit, texture);
-
-                        next_texture_unit++;
-                    }
+                    HSampler sampler = GetProgramSampler(material->m_Samplers, next_texture_unit);
+                    dmGraphics::EnableTexture(context, next_texture_unit, sub_handle, texture);
+                    ApplyProgramSampler(render_context, sampler, next_texture_unit, texture);
+
+                    next_texture_unit++;
                 }
             }
+        }
 
-            dmGraphics::HProgram material_program = GetMaterialProgram(material);
+        dmGraphics::HProgram material_program = GetMaterialProgram(material);
 
-            for (int i = 0; i < RenderObject::MAX_VERTEX_BUFFER_COUNT; ++i)
+        for (int i = 0; i < RenderObject::MAX_VERTEX_BUFFER_COUNT; ++i)
+        {
+            if (ro->m_VertexBuffers[i])
             {
-                if (ro->m_VertexBuffers[i])
-                {
-                    dmGraphics::EnableVertexBuffer(context, ro->m_VertexBuffers[i], i);
-                }
-                if (ro->m_VertexDeclarations[i])
-                {
-                    dmGraphics::EnableVertexDeclaration(context, ro->m_VertexDeclarations[i], i, material_program);
-                }
+                dmGraphics::EnableVertexBuffer(context, ro->m_VertexBuffers[i], i);
             }
+            if (ro->m_VertexDeclarations[i])
+            {
+                dmGraphics::EnableVertexDeclaration(context, ro->m_VertexDeclarations[i], i, material_program);
+            }
+        }
 
-            if (ro->m_IndexBuffer)
-                dmGraphics::DrawElements(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount, ro->m_IndexType, ro->m_IndexBuffer);
-            else
-                dmGraphics::Draw(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount);
+        if (ro->m_IndexBuffer)
+            dmGraphics::DrawElements(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount, ro->m_IndexType, ro->m_IndexBuffer);
+        else
+            dmGraphics::Draw(context, ro->m_PrimitiveType, ro->m_VertexStart, ro->m_VertexCount);
 
-            for (int i = 0; i < RenderObject::MAX_VERTEX_BUFFER_COUNT; ++i)
+        for (int i = 0; i < RenderObject::MAX_VERTEX_BUFFER_COUNT; ++i)
+        {
+            if (ro->m_VertexBuffers[i])
             {
-                if (ro->m_VertexBuffers[i])
-                {
-                    dmGraphics::DisableVertexBuffer(context, ro->m_VertexBuffers[i]);
-                }
+                dmGraphics::DisableVertexBuffer(context, ro->m_VertexBuffers[i]);
+            }
 
-                if (ro->m_VertexDeclarations[i])
-                {
-                    dmGraphics::DisableVertexDeclaration(context, ro->m_VertexDeclarations[i]);
-                }
+            if (ro->m_VertexDeclarations[i])
+            {
+                dmGraphics::DisableVertexDeclaration(context, ro->m_VertexDeclarations[i]);
             }
+        }
 
-            next_texture_unit = 0;
-            for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
+        next_texture_unit = 0;
+        for (uint32_t i = 0; i < RenderObject::MAX_TEXTURE_COUNT; ++i)
+        {
+            dmGraphics::HTexture texture = ro->m_Textures[i];
+            if (render_context_textures[i])
+                texture = render_context_textures[i];
+            if (texture)
             {
-                dmGraphics::HTexture texture = ro->m_Textures[i];
-                if (render_context_textures[i])
-                    texture = render_context_textures[i];
-                if (texture)
+                for (int sub_handle = 0; sub_handle < dmGraphics::GetNumTextureHandles(texture); ++sub_handle)
                 {
-                    for (int sub_handle = 0; sub_handle < dmGraphics::GetNumTextureHandles(texture); ++sub_handle)
-                    {
-                        dmGraphics::DisableTexture(context, next_texture_unit, texture);
-                        next_texture_unit++;
-                    }
+                    dmGraphics::DisableTexture(context, next_texture_unit, texture);
+                    next_texture_unit++;
                 }
             }
         }
+    }
+
+    static void RecordDraw(HRenderContext render_context, HPredicate predicate, HNamedConstantBuffer constant_buffer);
+
+    // NOTE: Currently only used externally in 1 test (fontview.cpp)
+    // TODO: Replace that occurrance with DrawRenderList
+    Result Draw(HRenderContext render_context, HPredicate predicate, HNamedConstantBuffer constant_buffer)
+    {
+        if (render_context == 0x0)
+            return RESULT_INVALID_CONTEXT;
+
+        if (render_context->m_RecordFrame)
+        {
+            RecordDraw(render_context, predicate, constant_buffer);
+            TrimTextureBindingTable(render_context);
+            return RESULT_OK;
+        }
+
+        dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
+
+        ViewState view_state;
+        GetViewState(render_context, &view_state);
+
+        DrawState state;
+        state.m_ViewState           = &view_state;
+        state.m_TextureBindings     = render_context->m_TextureBindTable.Begin();
+        state.m_TextureBindingCount = render_context->m_TextureBindTable.Size();
+        state.m_ContextMaterial     = render_context->m_Material;
+        state.m_ConstantBuffer      = constant_buffer;
+        BeginDraw(render_context, state);
+
+        dmGraphics::PipelineState ps_orig = dmGraphics::GetPipelineState(context);
+
+        for (uint32_t i = 0; i < render_context->m_RenderObjects.Size(); ++i)
+        {
+            RenderObject* ro = render_context->m_RenderObjects[i];
+            if (IsRenderObjectVisible(render_context, predicate, ro))
+            {
+                DrawRenderObject(render_context, state, ro);
+            }
+        }
 
         ResetRenderStateIfChanged(context, ps_orig, dmGraphics::GetPipelineState(context));
 
@@ -1155,6 +1315,182 @@ namespace dmRender
         return RESULT_OK;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Frame recording
+
+    static RenderFrame* GetOtherFrame(HRenderContext render_context, RenderFrame* frame)
+    {
+        return frame == &render_context->m_RenderFrames[0] ? &render_context->m_RenderFrames[1] : &render_context->m_RenderFrames[0];
+    }
+
+    template <typename T>
+    static void PushGrow(dmArray<T>& array, const T& value)
+    {
+        if (array.Full())
+        {
+            array.OffsetCapacity(dmMath::Max(array.Capacity(), 16u));
+        }
+        array.Push(value);
+    }
+
+    // Copies the buffer into the frame, as the owner may change it before the frame is submitted
+    static HNamedConstantBuffer RecordConstantBuffer(RenderFrame* frame, HNamedConstantBuffer buffer)
+    {
+        if (buffer == 0)
+            return 0;
+
+        if (frame->m_ConstantBuffersUsed == frame->m_ConstantBuffers.Size())
+        {
+            PushGrow(frame->m_ConstantBuffers, NewNamedConstantBuffer());
+        }
+
+        HNamedConstantBuffer copy = frame->m_ConstantBuffers[frame->m_ConstantBuffersUsed++];
+        CopyNamedConstantBuffer(copy, buffer);
+        return copy;
+    }
+
+    static uint32_t RecordTextureBindings(HRenderContext render_context, RenderFrame* frame)
+    {
+        uint32_t start = frame->m_TextureBindings.Size();
+        uint32_t count = render_context->m_TextureBindTable.Size();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            PushGrow(frame->m_TextureBindings, render_context->m_TextureBindTable[i]);
+        }
+        return start;
+    }
+
+    void RecordCommand(HRenderContext render_context, const Command& command)
+    {
+        PushGrow(render_context->m_RecordFrame->m_Commands, command);
+    }
+
+    static void RecordDraw(HRenderContext render_context, HPredicate predicate, HNamedConstantBuffer constant_buffer)
+    {
+        RenderFrame* frame = render_context->m_RecordFrame;
+
+        RecordedDraw draw;
+        GetViewState(render_context, &draw.m_ViewState);
+        draw.m_Material            = render_context->m_Material;
+        draw.m_ConstantBuffer      = RecordConstantBuffer(frame, constant_buffer);
+        draw.m_TextureBindingStart = RecordTextureBindings(render_context, frame);
+        draw.m_TextureBindingCount = render_context->m_TextureBindTable.Size();
+        draw.m_RenderObjectStart   = frame->m_RenderObjects.Size();
+
+        // The predicate is resolved now, the render objects are owned by the components and are
+        // only valid until ClearRenderObjects()
+        for (uint32_t i = 0; i < render_context->m_RenderObjects.Size(); ++i)
+        {
+            RenderObject* ro = render_context->m_RenderObjects[i];
+            if (IsRenderObjectVisible(render_context, predicate, ro))
+            {
+                PushGrow(frame->m_RenderObjects, *ro);
+                frame->m_RenderObjects.Back().m_ConstantBuffer = RecordConstantBuffer(frame, ro->m_ConstantBuffer);
+            }
+        }
+        draw.m_RenderObjectCount = frame->m_RenderObjects.Size() - draw.m_RenderObjectStart;
+
+        PushGrow(frame->m_Draws, draw);
+        RecordCommand(render_context, Command(COMMAND_TYPE_SUBMIT_DRAW, frame->m_Draws.Size() - 1));
+    }
+
+    void RecordDispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer)
+    {
+        RenderFrame* frame = render_context->m_RecordFrame;
+
+        RecordedCompute compute;
+        GetViewState(render_context, &compute.m_ViewState);
+        compute.m_ComputeProgram      = render_context->m_ComputeProgram;
+        compute.m_ConstantBuffer      = RecordConstantBuffer(frame, constant_buffer);
+        compute.m_GroupCount[0]       = group_count_x;
+        compute.m_GroupCount[1]       = group_count_y;
+        compute.m_GroupCount[2]       = group_count_z;
+        compute.m_TextureBindingStart = RecordTextureBindings(render_context, frame);
+        compute.m_TextureBindingCount = render_context->m_TextureBindTable.Size();
+
+        PushGrow(frame->m_Computes, compute);
+        RecordCommand(render_context, Command(COMMAND_TYPE_SUBMIT_COMPUTE, frame->m_Computes.Size() - 1));
+    }
+
+    void SubmitRecordedDraw(HRenderContext render_context, const RenderFrame* frame, const RecordedDraw& draw)
+    {
+        dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
+
+        DrawState state;
+        state.m_ViewState           = &draw.m_ViewState;
+        state.m_TextureBindings     = frame->m_TextureBindings.Begin() + draw.m_TextureBindingStart;
+        state.m_TextureBindingCount = draw.m_TextureBindingCount;
+        state.m_ContextMaterial     = draw.m_Material;
+        state.m_ConstantBuffer      = draw.m_ConstantBuffer;
+        BeginDraw(render_context, state);
+
+        dmGraphics::PipelineState ps_orig = dmGraphics::GetPipelineState(context);
+
+        const RenderObject* ros = frame->m_RenderObjects.Begin() + draw.m_RenderObjectStart;
+        for (uint32_t i = 0; i < draw.m_RenderObjectCount; ++i)
+        {
+            DrawRenderObject(render_context, state, &ros[i]);
+        }
+
+        ResetRenderStateIfChanged(context, ps_orig, dmGraphics::GetPipelineState(context));
+    }
+
+    void SubmitRecordedCompute(HRenderContext render_context, const RenderFrame* frame, const RecordedCompute& compute)
+    {
+        DispatchCompute(render_context, compute.m_ViewState, compute.m_ComputeProgram,
+                        frame->m_TextureBindings.Begin() + compute.m_TextureBindingStart, compute.m_TextureBindingCount,
+                        compute.m_GroupCount[0], compute.m_GroupCount[1], compute.m_GroupCount[2], compute.m_ConstantBuffer);
+    }
+
+    void BeginRenderFrame(HRenderContext render_context)
+    {
+        assert(render_context->m_RecordFrame == 0);
+
+        RenderFrame* frame = GetOtherFrame(render_context, render_context->m_SubmitFrame);
+        ResetRenderFrame(frame);
+        render_context->m_RecordFrame = frame;
+
+        // The dispatches of all draw calls are done before the frame is submitted, so the render buffers
+        // must not be reused between draw calls. This is the same requirement as for the deferred adapters.
+        render_context->m_MultiBufferingRequired = 1;
+    }
+
+    void EndRenderFrame(HRenderContext render_context)
+    {
+        assert(render_context->m_RecordFrame != 0);
+        render_context->m_SubmitFrame = render_context->m_RecordFrame;
+        render_context->m_RecordFrame = 0;
+    }
+
+    Result SubmitRenderFrame(HRenderContext render_context)
+    {
+        DM_PROFILE("SubmitRenderFrame");
+
+        RenderFrame* frame = render_context->m_SubmitFrame;
+        if (frame == 0)
+            return RESULT_INVALID_CONTEXT;
+
+        for (uint32_t i = 0; i < frame->m_Commands.Size(); ++i)
+        {
+            const Command& command = frame->m_Commands[i];
+            switch (command.m_Type)
+            {
+                case COMMAND_TYPE_SUBMIT_DRAW:
+                    SubmitRecordedDraw(render_context, frame, frame->m_Draws[command.m_Operands[0]]);
+                    break;
+                case COMMAND_TYPE_SUBMIT_COMPUTE:
+                    SubmitRecordedCompute(render_context, frame, frame->m_Computes[command.m_Operands[0]]);
+                    break;
+                default:
+                    ExecuteGraphicsCommand(render_context, &command);
+                    break;
+            }
+        }
+
+        DM_PROPERTY_ADD_U32(rmtp_RenderFrameCommands, frame->m_Commands.Size());
+        return RESULT_OK;
+    }
+
     Result DrawDebug3d(HRenderContext context, const FrustumOptions* frustum_options)
     {
         if (!context->m_DebugRenderer.m_RenderContext) {
@@ -180,6 +180,31 @@ namespace dmRender
     Result DrawDebug3d(HRenderContext context, const FrustumOptions* frustum_options);
     Result DrawDebug2d(HRenderContext context);
 
+    /**
+     * Starts recording the graphics commands of a frame. Until EndRenderFrame is called, the render
+     * script graphics commands and draw calls are recorded instead of being executed. The render lists
+     * are still dispatched immediately, and the render objects, constant buffers and texture bindings
+     * of each draw call are copied into the frame.
+     * @param render_context Render context handle
+     */
+    void BeginRenderFrame(HRenderContext render_context);
+
+    /**
+     * Stops recording the frame started with BeginRenderFrame, and makes it the frame executed by
+     * SubmitRenderFrame. The next frame is recorded into the other frame buffer.
+     * @param render_context Render context handle
+     */
+    void EndRenderFrame(HRenderContext render_context);
+
+    /**
+     * Executes the graphics commands of the last ended frame. This may be called from another thread,
+     * while the next frame is simulated, as long as the graphics resources used by the frame are kept
+     * alive and the render functions aren't called until it returns (see dmGraphics::SetResourceChangeCallback).
+     * @param render_context Render context handle
+     * @return RESULT_OK on success
+     */
+    Result SubmitRenderFrame(HRenderContext render_context);
+
     /**
      * Render debug square. The upper left corner of the screen is (-1,-1) and the bottom right is (1,1).
      * @param context Render context handle
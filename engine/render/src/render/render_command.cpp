@@ -55,28 +55,124 @@ namespace dmRender
         m_Operands[3] = op3;
     }
 
-    void ParseCommands(dmRender::HRenderContext render_context, Command* commands, uint32_t command_count)
+    void ExecuteGraphicsCommand(dmRender::HRenderContext render_context, const Command* c)
     {
         dmGraphics::HContext context = dmRender::GetGraphicsContext(render_context);
 
+        switch (c->m_Type)
+        {
+            case COMMAND_TYPE_ENABLE_STATE:
+            {
+                dmGraphics::EnableState(context, (dmGraphics::State)c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_DISABLE_STATE:
+            {
+                dmGraphics::DisableState(context, (dmGraphics::State)c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_SET_RENDER_TARGET:
+            {
+                dmGraphics::SetRenderTarget(context, c->m_Operands[0], c->m_Operands[1]);
+                break;
+            }
+            case COMMAND_TYPE_CLEAR:
+            {
+                uint8_t r = (c->m_Operands[1] >> 0) & 0xff;
+                uint8_t g = (c->m_Operands[1] >> 8) & 0xff;
+                uint8_t b = (c->m_Operands[1] >> 16) & 0xff;
+                uint8_t a = (c->m_Operands[1] >> 24) & 0xff;
+                union float_to_uint32_t {float f; uint32_t i;};
+                float_to_uint32_t ftoi;
+                ftoi.i = c->m_Operands[2];
+                dmGraphics::Clear(context, c->m_Operands[0], r, g, b, a, ftoi.f, c->m_Operands[3]);
+                render_context->m_StencilBufferCleared = (c->m_Operands[0] & dmGraphics::BUFFER_TYPE_STENCIL_BIT) != 0;
+                break;
+            }
+            case COMMAND_TYPE_SET_VIEWPORT:
+            {
+                dmGraphics::SetViewport(context, c->m_Operands[0], c->m_Operands[1], c->m_Operands[2], c->m_Operands[3]);
+                break;
+            }
+            case COMMAND_TYPE_SET_BLEND_FUNC:
+            {
+                dmGraphics::SetBlendFunc(context, (dmGraphics::BlendFactor)c->m_Operands[0], (dmGraphics::BlendFactor)c->m_Operands[1]);
+                break;
+            }
+            case COMMAND_TYPE_SET_COLOR_MASK:
+            {
+                dmGraphics::SetColorMask(context, c->m_Operands[0] != 0, c->m_Operands[1] != 0, c->m_Operands[2] != 0, c->m_Operands[3] != 0);
+                break;
+            }
+            case COMMAND_TYPE_SET_DEPTH_MASK:
+            {
+                dmGraphics::SetDepthMask(context, (bool) c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_SET_DEPTH_FUNC:
+            {
+                dmGraphics::SetDepthFunc(context, (dmGraphics::CompareFunc)c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_SET_STENCIL_MASK:
+            {
+                dmGraphics::SetStencilMask(context, c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_SET_STENCIL_FUNC:
+            {
+                dmGraphics::SetStencilFunc(context, (dmGraphics::CompareFunc)c->m_Operands[0], c->m_Operands[1], c->m_Operands[2]);
+                break;
+            }
+            case COMMAND_TYPE_SET_STENCIL_OP:
+            {
+                dmGraphics::SetStencilOp(context, (dmGraphics::StencilOp)c->m_Operands[0], (dmGraphics::StencilOp)c->m_Operands[1], (dmGraphics::StencilOp)c->m_Operands[2]);
+                break;
+            }
+            case COMMAND_TYPE_SET_CULL_FACE:
+            {
+                dmGraphics::SetCullFace(context, (dmGraphics::FaceType)c->m_Operands[0]);
+                break;
+            }
+            case COMMAND_TYPE_SET_POLYGON_OFFSET:
+            {
+                dmGraphics::SetPolygonOffset(context, (float)c->m_Operands[0], (float)c->m_Operands[1]);
+                break;
+            }
+            default:
+            {
+                dmLogError("No such graphics command (%d).", c->m_Type);
+            }
+        }
+    }
+
+    void ParseCommands(dmRender::HRenderContext render_context, Command* commands, uint32_t command_count)
+    {
         for (uint32_t i=0; i<command_count; i++)
         {
             Command* c = &commands[i];
             switch (c->m_Type)
             {
                 case COMMAND_TYPE_ENABLE_STATE:
-                {
-                    dmGraphics::EnableState(context, (dmGraphics::State)c->m_Operands[0]);
-                    break;
-                }
                 case COMMAND_TYPE_DISABLE_STATE:
-                {
-                    dmGraphics::DisableState(context, (dmGraphics::State)c->m_Operands[0]);
-                    break;
-                }
                 case COMMAND_TYPE_SET_RENDER_TARGET:
+                case COMMAND_TYPE_CLEAR:
+                case COMMAND_TYPE_SET_VIEWPORT:
+                case COMMAND_TYPE_SET_BLEND_FUNC:
+                case COMMAND_TYPE_SET_COLOR_MASK:
+                case COMMAND_TYPE_SET_DEPTH_MASK:
+                case COMMAND_TYPE_SET_DEPTH_FUNC:
+                case COMMAND_TYPE_SET_STENCIL_MASK:
+                case COMMAND_TYPE_SET_STENCIL_FUNC:
+                case COMMAND_TYPE_SET_STENCIL_OP:
+                case COMMAND_TYPE_SET_CULL_FACE:
+                case COMMAND_TYPE_SET_POLYGON_OFFSET:
                 {
-                    dmGraphics::SetRenderTarget(context, c->m_Operands[0], c->m_Operands[1]);
+                    // When recording a frame, the graphics state is only changed when the frame is submitted
+                    if (render_context->m_RecordFrame)
+                        dmRender::RecordCommand(render_context, *c);
+                    else
+                        ExecuteGraphicsCommand(render_context, c);
                     break;
                 }
                 case COMMAND_TYPE_ENABLE_TEXTURE:
@@ -97,24 +193,6 @@ namespace dmRender
                         dmRender::SetTextureBindingByUnit(render_context, c->m_Operands[1], 0);
                     break;
                 }
-                case COMMAND_TYPE_CLEAR:
-                {
-                    uint8_t r = (c->m_Operands[1] >> 0) & 0xff;
-                    uint8_t g = (c->m_Operands[1] >> 8) & 0xff;
-                    uint8_t b = (c->m_Operands[1] >> 16) & 0xff;
-                    uint8_t a = (c->m_Operands[1] >> 24) & 0xff;
-                    union float_to_uint32_t {float f; uint32_t i;};
-                    float_to_uint32_t ftoi;
-                    ftoi.i = c->m_Operands[2];
-                    dmGraphics::Clear(context, c->m_Operands[0], r, g, b, a, ftoi.f, c->m_Operands[3]);
-                    render_context->m_StencilBufferCleared = (c->m_Operands[0] & dmGraphics::BUFFER_TYPE_STENCIL_BIT) != 0;
-                    break;
-                }
-                case COMMAND_TYPE_SET_VIEWPORT:
-                {
-                    dmGraphics::SetViewport(context, c->m_Operands[0], c->m_Operands[1], c->m_Operands[2], c->m_Operands[3]);
-                    break;
-                }
                 case COMMAND_TYPE_SET_VIEW:
                 {
                     dmVMath::Matrix4* matrix = (dmVMath::Matrix4*)c->m_Operands[0];
@@ -129,51 +207,6 @@ namespace dmRender
                     delete matrix;
                     break;
                 }
-                case COMMAND_TYPE_SET_BLEND_FUNC:
-                {
-                    dmGraphics::SetBlendFunc(context, (dmGraphics::BlendFactor)c->m_Operands[0], (dmGraphics::BlendFactor)c->m_Operands[1]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_COLOR_MASK:
-                {
-                    dmGraphics::SetColorMask(context, c->m_Operands[0] != 0, c->m_Operands[1] != 0, c->m_Operands[2] != 0, c->m_Operands[3] != 0);
-                    break;
-                }
-                case COMMAND_TYPE_SET_DEPTH_MASK:
-                {
-                    dmGraphics::SetDepthMask(context, (bool) c->m_Operands[0]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_DEPTH_FUNC:
-                {
-                    dmGraphics::SetDepthFunc(context, (dmGraphics::CompareFunc)c->m_Operands[0]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_STENCIL_MASK:
-                {
-                    dmGraphics::SetStencilMask(context, c->m_Operands[0]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_STENCIL_FUNC:
-                {
-                    dmGraphics::SetStencilFunc(context, (dmGraphics::CompareFunc)c->m_Operands[0], c->m_Operands[1], c->m_Operands[2]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_STENCIL_OP:
-                {
-                    dmGraphics::SetStencilOp(context, (dmGraphics::StencilOp)c->m_Operands[0], (dmGraphics::StencilOp)c->m_Operands[1], (dmGraphics::StencilOp)c->m_Operands[2]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_CULL_FACE:
-                {
-                    dmGraphics::SetCullFace(context, (dmGraphics::FaceType)c->m_Operands[0]);
-                    break;
-                }
-                case COMMAND_TYPE_SET_POLYGON_OFFSET:
-                {
-                    dmGraphics::SetPolygonOffset(context, (float)c->m_Operands[0], (float)c->m_Operands[1]);
-                    break;
-                }
                 case COMMAND_TYPE_DRAW:
                 {
                     FrustumOptions* frustum_options = (FrustumOptions*)c->m_Operands[2];
@@ -49,6 +49,9 @@ namespace dmRender
         COMMAND_TYPE_SET_RENDER_CAMERA,
         COMMAND_TYPE_SET_COMPUTE,
         COMMAND_TYPE_DISPATCH_COMPUTE,
+        // Only used in recorded frames, see BeginRenderFrame
+        COMMAND_TYPE_SUBMIT_DRAW,
+        COMMAND_TYPE_SUBMIT_COMPUTE,
         COMMAND_TYPE_MAX
     };
 
@@ -25,6 +25,7 @@
 #include <dlib/hashtable.h>
 
 #include "render.h"
+#include "render_command.h"
 
 extern "C"
 {
@@ -204,25 +205,6 @@ namespace dmRender
         void*                       m_UserData;
     };
 
-    struct RenderListSortValue
-    {
-        union
-        {
-            struct
-            {
-                uint32_t m_BatchKey:24;
-                uint32_t m_Dispatch:8;
-                uint32_t m_Order:24;
-                uint32_t m_MajorOrder:4;        // currently only 2 bits used (dmRender::RenderOrder)
-                uint32_t m_MinorOrder:4;
-            };
-            // only temporarily used
-            float m_ZW;
-            // final sort value
-            uint64_t m_SortKey;
-        };
-    };
-
     struct RenderListRange
     {
         uint32_t m_TagListKey;
@@ -262,6 +244,49 @@ namespace dmRender
         uint8_t          m_Dirty : 1;
     };
 
+    // The matrices a draw call was issued with
+    struct ViewState
+    {
+        Matrix4 m_View;
+        Matrix4 m_Projection;
+        Matrix4 m_ViewProj;
+    };
+
+    // A render.draw() call recorded into a RenderFrame. The render objects, constants and
+    // texture bindings are copies, so that the frame can be submitted while the next one is simulated.
+    struct RecordedDraw
+    {
+        ViewState               m_ViewState;
+        HMaterial               m_Material;             // The render script material override, if any
+        HNamedConstantBuffer    m_ConstantBuffer;       // Copy of the render script constant buffer, or 0
+        uint32_t                m_RenderObjectStart;    // Index into RenderFrame::m_RenderObjects
+        uint32_t                m_RenderObjectCount;
+        uint32_t                m_TextureBindingStart;  // Index into RenderFrame::m_TextureBindings
+        uint32_t                m_TextureBindingCount;
+    };
+
+    struct RecordedCompute
+    {
+        ViewState               m_ViewState;
+        HComputeProgram         m_ComputeProgram;
+        HNamedConstantBuffer    m_ConstantBuffer;
+        uint32_t                m_GroupCount[3];
+        uint32_t                m_TextureBindingStart;
+        uint32_t                m_TextureBindingCount;
+    };
+
+    // The graphics commands of one frame, recorded between BeginRenderFrame and EndRenderFrame
+    struct RenderFrame
+    {
+        dmArray<Command>                m_Commands;
+        dmArray<RenderObject>           m_RenderObjects;
+        dmArray<RecordedDraw>           m_Draws;
+        dmArray<RecordedCompute>        m_Computes;
+        dmArray<TextureBinding>         m_TextureBindings;
+        dmArray<HNamedConstantBuffer>   m_ConstantBuffers;      // Pool, kept between frames
+        uint32_t                        m_ConstantBuffersUsed;
+    };
+
     struct RenderContext
     {
         DebugRenderer               m_DebugRenderer;
@@ -273,7 +298,10 @@ namespace dmRender
 
         dmArray<RenderListEntry>    m_RenderList;
         dmArray<RenderListDispatch> m_RenderListDispatch;
-        dmArray<RenderListSortValue>m_RenderListSortValues;
+        dmArray<uint64_t>           m_RenderListSortKeys;       // Sort key per element in m_RenderListSortBuffer (tag list key in SortRenderList)
+        dmArray<uint64_t>           m_RenderListSortKeysScratch;
+        dmArray<uint32_t>           m_RenderListSortIndicesScratch;
+        dmArray<float>              m_RenderListSortDepths;     // Normalized depth per element in m_RenderListSortBuffer
         dmArray<uint32_t>           m_RenderListSortBuffer;
         dmArray<uint32_t>           m_RenderListSortIndices;
         dmArray<RenderListRange>    m_RenderListRanges;         // Maps tagmask to a range in the (sorted) render list
@@ -293,10 +321,15 @@ namespace dmRender
         HMaterial                   m_Material;
         HComputeProgram             m_ComputeProgram;
         dmMessage::HSocket          m_Socket;
+        RenderFrame                 m_RenderFrames[2];
+        RenderFrame*                m_RecordFrame;      // != 0 between BeginRenderFrame and EndRenderFrame
+        RenderFrame*                m_SubmitFrame;      // The last ended frame, executed by SubmitRenderFrame
         uint32_t                    m_OutOfResources                : 1;
-        uint32_t                    m_StencilBufferCleared          : 1;
         uint32_t                    m_MultiBufferingRequired        : 1;
         uint32_t                    m_CurrentRenderCameraUseFrustum : 1;
+        // Only touched while executing graphics commands, which may happen on the render thread,
+        // so it is kept out of the bit field above
+        uint8_t                     m_StencilBufferCleared;
     };
 
     struct BufferedRenderBuffer
@@ -316,7 +349,7 @@ namespace dmRender
 
     void     GetProgramUniformCount(dmGraphics::HProgram program, uint32_t total_constants_count, uint32_t* constant_count_out, uint32_t* samplers_count_out);
     void     SetProgramConstantValues(dmGraphics::HContext graphics_context, dmGraphics::HProgram program, uint32_t total_constants_count, dmHashTable64<dmGraphics::HUniformLocation>& name_hash_to_location, dmArray<RenderConstant>& constants, dmArray<Sampler>& samplers);
-    void     SetProgramConstant(dmRender::HRenderContext render_context, dmGraphics::HContext graphics_context, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& texture_matrix, dmGraphics::ShaderDesc::Language program_language, dmRenderDDF::MaterialDesc::ConstantType type, dmGraphics::HProgram program, dmGraphics::HUniformLocation location, HConstant constant);
+    void     SetProgramConstant(const ViewState& view_state, dmGraphics::HContext graphics_context, const dmVMath::Matrix4& world_matrix, const dmVMath::Matrix4& texture_matrix, dmGraphics::ShaderDesc::Language program_language, dmRenderDDF::MaterialDesc::ConstantType type, dmGraphics::HProgram program, dmGraphics::HUniformLocation location, HConstant constant);
     void     SetProgramRenderConstant(const dmArray<RenderConstant>& constants, dmhash_t name_hash, const dmVMath::Vector4* values, uint32_t count);
     void     SetProgramConstantType(const dmArray<RenderConstant>& constants, dmhash_t name_hash, dmRenderDDF::MaterialDesc::ConstantType type);
     bool     GetProgramConstant(const dmArray<RenderConstant>& constants, dmhash_t name_hash, HConstant& out_value);
@@ -326,6 +359,16 @@ namespace dmRender
     HSampler GetProgramSampler(const dmArray<Sampler>& samplers, uint32_t unit);
     void     ApplyProgramSampler(dmRender::HRenderContext render_context, HSampler sampler, uint8_t unit, dmGraphics::HTexture texture);
 
+    void     ApplyMaterialConstants(dmGraphics::HContext graphics_context, const ViewState& view_state, HMaterial material, const RenderObject* ro);
+    void     CopyNamedConstantBuffer(HNamedConstantBuffer dst, HNamedConstantBuffer src);
+
+    // Frame recording, see BeginRenderFrame
+    void    RecordCommand(HRenderContext render_context, const Command& command);
+    void    ExecuteGraphicsCommand(HRenderContext render_context, const Command* command);
+    void    SubmitRecordedDraw(HRenderContext render_context, const RenderFrame* frame, const RecordedDraw& draw);
+    void    SubmitRecordedCompute(HRenderContext render_context, const RenderFrame* frame, const RecordedCompute& compute);
+    void    RecordDispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer);
+
     void FillElementIds(char* buffer, uint32_t buffer_size, dmhash_t element_ids[4]);
 
     // Return true if the predicate tags all exist in the material tag list
@@ -341,7 +384,7 @@ namespace dmRender
     int32_t GetMaterialSamplerIndex(HMaterial material, dmhash_t name_hash);
 
     void    DispatchCompute(HRenderContext render_context, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z, HNamedConstantBuffer constant_buffer);
-    void    ApplyComputeProgramConstants(HRenderContext render_context, HComputeProgram compute_program);
+    void    ApplyComputeProgramConstants(HRenderContext render_context, const ViewState& view_state, HComputeProgram compute_program);
     int32_t GetComputeProgramSamplerIndex(HComputeProgram program, dmhash_t name_hash);
     bool    GetComputeProgramConstant(HComputeProgram compute_program, dmhash_t name_hash, HConstant& out_value);
 
@@ -361,19 +404,10 @@ namespace dmRender
         RenderListEntry* m_Base;
     };
 
-    struct FindRangeComparator
-    {
-        RenderListEntry* m_Entries;
-        bool operator() (const uint32_t& a, const uint32_t& b) const
-        {
-            return m_Entries[a].m_TagListKey < m_Entries[b].m_TagListKey;
-        }
-    };
-
     typedef void (*RangeCallback)(void* ctx, uint32_t val, size_t start, size_t count);
 
-    // Invokes the callback for each range. Two ranges are not guaranteed to preceed/succeed one another.
-    void FindRenderListRanges(uint32_t* first, size_t offset, size_t size, RenderListEntry* entries, FindRangeComparator& comp, void* ctx, RangeCallback callback );
+    // Invokes the callback for each range of equal tag list keys, in order
+    void FindRenderListRanges(const uint64_t* sorted_keys, uint32_t count, void* ctx, RangeCallback callback);
 
     bool FindTagListRange(RenderListRange* ranges, uint32_t num_ranges, uint32_t tag_list_key, RenderListRange& range);
 
@@ -18,8 +18,11 @@
 #include <dmsdk/dlib/intersection.h>
 
 #include <testmain/testmain.h>
+#include <dlib/atomic.h>
 #include <dlib/hash.h>
 #include <dlib/math.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
 
 #include <script/script.h>
 #include <algorithm> // std::stable_sort
@@ -43,6 +46,11 @@ const static uint32_t HEIGHT = 400;
 
 using namespace dmVMath;
 
+namespace dmGraphics
+{
+    extern const Vector4& GetConstantV4Ptr(dmGraphics::HContext context, dmGraphics::HUniformLocation base_register);
+}
+
 class dmRenderTest : public jc_test_base_class
 {
 protected:
@@ -500,6 +508,137 @@ TEST_F(dmRenderTest, TestRenderListDrawState)
     dmGraphics::DeleteVertexDeclaration(vx_decl);
 }
 
+struct TestRenderFrameDispatchCtx
+{
+    dmRender::HRenderContext       m_Context;
+    dmRender::HMaterial            m_Material;
+    dmRender::HNamedConstantBuffer m_ConstantBuffer;
+    dmRender::RenderObject         m_RenderObject;
+    dmGraphics::HVertexDeclaration m_VertexDeclaration;
+    dmGraphics::HVertexBuffer      m_VertexBuffer;
+    uint32_t                       m_BatchCalls;
+};
+
+static void TestRenderFrameDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    if (params.m_Operation == dmRender::RENDER_LIST_OPERATION_BATCH)
+    {
+        TestRenderFrameDispatchCtx* user_ctx = (TestRenderFrameDispatchCtx*) params.m_UserData;
+        dmRender::RenderObject* ro           = &user_ctx->m_RenderObject;
+
+        ro->Init();
+        ro->m_Material          = user_ctx->m_Material;
+        ro->m_ConstantBuffer    = user_ctx->m_ConstantBuffer;
+        ro->m_VertexCount       = 1;
+        ro->m_VertexDeclaration = user_ctx->m_VertexDeclaration;
+        ro->m_VertexBuffer      = user_ctx->m_VertexBuffer;
+
+        AddToRender(user_ctx->m_Context, ro);
+        user_ctx->m_BatchCalls++;
+    }
+}
+
+TEST_F(dmRenderTest, TestRenderFrameRecording)
+{
+    dmGraphics::ShaderDesc::Shader vp_shader = MakeDDFShader("uniform vec4 tint;\nuniform mat4 view_proj;\n", 43);
+    dmGraphics::ShaderDesc::Shader fp_shader = MakeDDFShader("foo", 3);
+    dmGraphics::HVertexProgram vp   = dmGraphics::NewVertexProgram(m_GraphicsContext, &vp_shader, 0, 0);
+    dmGraphics::HFragmentProgram fp = dmGraphics::NewFragmentProgram(m_GraphicsContext, &fp_shader, 0, 0);
+    dmRender::HMaterial material    = dmRender::NewMaterial(m_Context, vp, fp);
+    dmRender::SetMaterialProgramConstantType(material, dmHashString64("view_proj"), dmRenderDDF::MaterialDesc::CONSTANT_TYPE_VIEWPROJ);
+
+    dmGraphics::HProgram program = dmRender::GetMaterialProgram(material);
+    dmGraphics::HUniformLocation tint_loc      = dmGraphics::GetUniformLocation(program, "tint");
+    dmGraphics::HUniformLocation view_proj_loc = dmGraphics::GetUniformLocation(program, "view_proj");
+
+    TestRenderFrameDispatchCtx user_ctx;
+    memset(&user_ctx, 0, sizeof(user_ctx));
+    user_ctx.m_Context           = m_Context;
+    user_ctx.m_Material          = material;
+    user_ctx.m_ConstantBuffer    = dmRender::NewNamedConstantBuffer();
+    user_ctx.m_VertexDeclaration = dmGraphics::NewVertexDeclaration(m_GraphicsContext, 0, 0);
+    user_ctx.m_VertexBuffer      = dmGraphics::NewVertexBuffer(m_GraphicsContext, 0, 0, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+
+    Vector4 tint(1.0f, 2.0f, 3.0f, 4.0f);
+    dmRender::SetNamedConstant(user_ctx.m_ConstantBuffer, dmHashString64("tint"), &tint, 1);
+
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, 0.1f, 1.0f);
+    dmRender::SetProjectionMatrix(m_Context, proj);
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::translation(Vector3(1.0f, 2.0f, 3.0f)));
+    dmVMath::Matrix4 recorded_view_proj = dmRender::GetViewProjectionMatrix(m_Context);
+
+    dmGraphics::PipelineState ps_before = dmGraphics::GetPipelineState(m_GraphicsContext);
+
+    dmGraphics::ResetDrawCount();
+    dmRender::BeginRenderFrame(m_Context);
+
+    // Graphics commands from the render script are recorded
+    dmRender::Command clear(dmRender::COMMAND_TYPE_CLEAR, dmGraphics::BUFFER_TYPE_STENCIL_BIT, 0, 0, 0);
+    dmRender::ParseCommands(m_Context, &clear, 1);
+    ASSERT_EQ(0u, m_Context->m_StencilBufferCleared);
+
+    // The render list is dispatched now, but nothing is drawn
+    dmRender::RenderListBegin(m_Context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, TestRenderFrameDispatch, 0, &user_ctx);
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, 1);
+    memset(out, 0, sizeof(dmRender::RenderListEntry));
+    out[0].m_Order    = 1;
+    out[0].m_Dispatch = dispatch;
+    dmRender::RenderListSubmit(m_Context, out, out + 1);
+    dmRender::RenderListEnd(m_Context);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+
+    dmRender::EndRenderFrame(m_Context);
+
+    ASSERT_EQ(1u, user_ctx.m_BatchCalls);
+    ASSERT_EQ(0u, dmGraphics::GetDrawCount());
+
+    // Simulate the next frame while this one is in flight
+    dmRender::ClearRenderObjects(m_Context);
+    Vector4 next_tint(5.0f, 6.0f, 7.0f, 8.0f);
+    dmRender::SetNamedConstant(user_ctx.m_ConstantBuffer, dmHashString64("tint"), &next_tint, 1);
+    user_ctx.m_RenderObject.m_VertexCount = 0;
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::identity());
+
+    // The frame is drawn with the state it was recorded with
+    ASSERT_EQ(dmRender::RESULT_OK, dmRender::SubmitRenderFrame(m_Context));
+    ASSERT_EQ(1u, dmGraphics::GetDrawCount());
+    ASSERT_EQ(1u, m_Context->m_StencilBufferCleared);
+
+    const Vector4& submitted_tint = dmGraphics::GetConstantV4Ptr(m_GraphicsContext, tint_loc);
+    ASSERT_VEC4(tint, submitted_tint);
+    for (int i = 0; i < 4; ++i)
+    {
+        const Vector4& column = dmGraphics::GetConstantV4Ptr(m_GraphicsContext, view_proj_loc + i);
+        ASSERT_VEC4(recorded_view_proj.getCol(i), column);
+    }
+
+    dmGraphics::PipelineState ps_after = dmGraphics::GetPipelineState(m_GraphicsContext);
+    ASSERT_EQ(0, memcmp(&ps_before, &ps_after, sizeof(dmGraphics::PipelineState)));
+
+    // Without recording, the draw is made directly
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::identity());
+    dmRender::RenderListBegin(m_Context);
+    dispatch = dmRender::RenderListMakeDispatch(m_Context, TestRenderFrameDispatch, 0, &user_ctx);
+    out = dmRender::RenderListAlloc(m_Context, 1);
+    memset(out, 0, sizeof(dmRender::RenderListEntry));
+    out[0].m_Order    = 1;
+    out[0].m_Dispatch = dispatch;
+    dmRender::RenderListSubmit(m_Context, out, out + 1);
+    dmRender::RenderListEnd(m_Context);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(2u, dmGraphics::GetDrawCount());
+    ASSERT_VEC4(next_tint, dmGraphics::GetConstantV4Ptr(m_GraphicsContext, tint_loc));
+    dmRender::ClearRenderObjects(m_Context);
+
+    dmRender::DeleteNamedConstantBuffer(user_ctx.m_ConstantBuffer);
+    dmGraphics::DeleteVertexBuffer(user_ctx.m_VertexBuffer);
+    dmGraphics::DeleteVertexDeclaration(user_ctx.m_VertexDeclaration);
+    dmGraphics::DeleteVertexProgram(vp);
+    dmGraphics::DeleteFragmentProgram(fp);
+    dmRender::DeleteMaterial(m_Context, material);
+}
+
 struct TestEnableTextureByHashDispatchCtx
 {
     dmRender::HRenderContext        m_Context;
@@ -712,6 +851,161 @@ TEST_F(dmRenderTest, TestEnableTextureByHash)
     dmGraphics::DeleteVertexDeclaration(vx_decl);
 }
 
+struct TestRenderFrameInFlight
+{
+    dmRender::HRenderContext m_Context;
+    dmThread::Thread         m_Thread;
+    int32_atomic_t           m_Kicked;
+    uint32_t                 m_DrawCount;
+    uint32_t                 m_ChangeCalls;
+};
+
+// Submits the recorded frame when it's kicked, like the engine's render thread
+static void TestRenderFrameInFlightThread(void* arg)
+{
+    TestRenderFrameInFlight* frame = (TestRenderFrameInFlight*) arg;
+    while (!dmAtomicGet32(&frame->m_Kicked))
+    {
+        dmTime::Sleep(1000);
+    }
+    dmRender::SubmitRenderFrame(frame->m_Context);
+    frame->m_DrawCount = dmGraphics::GetDrawCount();
+}
+
+// Waits for the frame in flight before a graphics object is deleted or written to
+static void TestRenderFrameInFlightChange(void* user_data)
+{
+    TestRenderFrameInFlight* frame = (TestRenderFrameInFlight*) user_data;
+    frame->m_ChangeCalls++;
+    if (frame->m_Thread)
+    {
+        dmAtomicStore32(&frame->m_Kicked, 1);
+        dmThread::Join(frame->m_Thread);
+        frame->m_Thread = 0;
+    }
+}
+
+// Records a frame drawing a textured render object, and starts a thread that submits it once kicked
+static void StartTexturedRenderFrame(dmRender::HRenderContext context, TestEnableTextureByHashDispatchCtx* user_ctx, TestRenderFrameInFlight* frame)
+{
+    dmGraphics::ResetDrawCount();
+    dmRender::BeginRenderFrame(context);
+
+    dmRender::RenderListBegin(context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(context, TestEnableTextureByHashDispatch, 0, user_ctx);
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(context, 1);
+    memset(out, 0, sizeof(dmRender::RenderListEntry));
+    out[0].m_Order    = 1;
+    out[0].m_Dispatch = dispatch;
+    dmRender::RenderListSubmit(context, out, out + 1);
+    dmRender::RenderListEnd(context);
+    dmRender::DrawRenderList(context, 0, 0, 0);
+
+    dmRender::EndRenderFrame(context);
+
+    memset(frame, 0, sizeof(*frame));
+    frame->m_Context = context;
+    frame->m_Thread  = dmThread::New(TestRenderFrameInFlightThread, 0x80000, frame, "render");
+    dmGraphics::SetResourceChangeCallback(TestRenderFrameInFlightChange, frame);
+}
+
+TEST_F(dmRenderTest, TestRenderFrameDeleteInFlight)
+{
+    const char* shader_src = "uniform lowp sampler2D texture_sampler_1;\n";
+
+    dmGraphics::ShaderDesc::Shader vs_shader = MakeDDFShader("foo", 3);
+    dmGraphics::ShaderDesc::Shader fs_shader = MakeDDFShader(shader_src, strlen(shader_src));
+
+    dmGraphics::HVertexProgram vp   = dmGraphics::NewVertexProgram(m_GraphicsContext, &vs_shader, 0, 0);
+    dmGraphics::HFragmentProgram fp = dmGraphics::NewFragmentProgram(m_GraphicsContext, &fs_shader, 0, 0);
+    dmRender::HMaterial material    = dmRender::NewMaterial(m_Context, vp, fp);
+    SetMaterialSampler(material, dmHashString64("texture_sampler_1"), 0, dmGraphics::TEXTURE_WRAP_REPEAT, dmGraphics::TEXTURE_WRAP_REPEAT, dmGraphics::TEXTURE_FILTER_LINEAR, dmGraphics::TEXTURE_FILTER_LINEAR, 1.0f);
+
+    dmGraphics::HTexture textures[dmRender::RenderObject::MAX_TEXTURE_COUNT] = {};
+    textures[0] = MakeDummyTexture(m_GraphicsContext);
+
+    TestEnableTextureByHashDispatchCtx user_ctx;
+    user_ctx.m_Context           = m_Context;
+    user_ctx.m_Material          = material;
+    user_ctx.m_VertexDeclaration = dmGraphics::NewVertexDeclaration(m_GraphicsContext, 0, 0);
+    user_ctx.m_VertexBuffer      = dmGraphics::NewVertexBuffer(m_GraphicsContext, 0, 0, dmGraphics::BUFFER_USAGE_STATIC_DRAW);
+    user_ctx.m_Textures          = textures;
+
+    TestRenderFrameInFlight frame;
+    StartTexturedRenderFrame(m_Context, &user_ctx, &frame);
+    ASSERT_EQ(0u, dmGraphics::GetDrawCount());
+
+    // The next update deletes the objects the frame in flight uses. The frame is submitted before they're freed.
+    dmRender::ClearRenderObjects(m_Context);
+    dmGraphics::DeleteTexture(textures[0]);
+    ASSERT_EQ(1u, frame.m_ChangeCalls);
+    ASSERT_EQ(1u, frame.m_DrawCount);
+
+    dmGraphics::DeleteVertexBuffer(user_ctx.m_VertexBuffer);
+    dmGraphics::DeleteVertexDeclaration(user_ctx.m_VertexDeclaration);
+    dmGraphics::DeleteVertexProgram(vp);
+    dmGraphics::DeleteFragmentProgram(fp);
+    dmRender::DeleteMaterial(m_Context, material);
+    ASSERT_EQ(7u, frame.m_ChangeCalls);
+    ASSERT_EQ(1u, dmGraphics::GetDrawCount());
+
+    dmGraphics::SetResourceChangeCallback(0, 0);
+}
+
+TEST_F(dmRenderTest, TestRenderFrameSetDataInFlight)
+{
+    const char* shader_src = "uniform lowp sampler2D texture_sampler_1;\n";
+
+    dmGraphics::ShaderDesc::Shader vs_shader = MakeDDFShader("foo", 3);
+    dmGraphics::ShaderDesc::Shader fs_shader = MakeDDFShader(shader_src, strlen(shader_src));
+
+    dmGraphics::HVertexProgram vp   = dmGraphics::NewVertexProgram(m_GraphicsContext, &vs_shader, 0, 0);
+    dmGraphics::HFragmentProgram fp = dmGraphics::NewFragmentProgram(m_GraphicsContext, &fs_shader, 0, 0);
+    dmRender::HMaterial material    = dmRender::NewMaterial(m_Context, vp, fp);
+    SetMaterialSampler(material, dmHashString64("texture_sampler_1"), 0, dmGraphics::TEXTURE_WRAP_REPEAT, dmGraphics::TEXTURE_WRAP_REPEAT, dmGraphics::TEXTURE_FILTER_LINEAR, dmGraphics::TEXTURE_FILTER_LINEAR, 1.0f);
+
+    dmGraphics::HTexture textures[dmRender::RenderObject::MAX_TEXTURE_COUNT] = {};
+    textures[0] = MakeDummyTexture(m_GraphicsContext);
+
+    const float vertex_data[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    TestEnableTextureByHashDispatchCtx user_ctx;
+    user_ctx.m_Context           = m_Context;
+    user_ctx.m_Material          = material;
+    user_ctx.m_VertexDeclaration = dmGraphics::NewVertexDeclaration(m_GraphicsContext, 0, 0);
+    user_ctx.m_VertexBuffer      = dmGraphics::NewVertexBuffer(m_GraphicsContext, sizeof(vertex_data), vertex_data, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+    user_ctx.m_Textures          = textures;
+
+    TestRenderFrameInFlight frame;
+    StartTexturedRenderFrame(m_Context, &user_ctx, &frame);
+    ASSERT_EQ(0u, dmGraphics::GetDrawCount());
+
+    // The next update replaces the texture image (e.g. resource.set_texture), which reallocates its storage
+    uint8_t tex_data[4 * 4];
+    memset(tex_data, 0, sizeof(tex_data));
+    dmGraphics::TextureParams params;
+    params.m_DataSize = sizeof(tex_data);
+    params.m_Data     = tex_data;
+    params.m_Width    = 4;
+    params.m_Height   = 4;
+    params.m_Format   = dmGraphics::TEXTURE_FORMAT_LUMINANCE;
+    dmGraphics::SetTexture(textures[0], params);
+    ASSERT_EQ(1u, frame.m_ChangeCalls);
+    ASSERT_EQ(1u, frame.m_DrawCount);
+
+    // And the vertex data (e.g. resource.set_buffer)
+    dmGraphics::SetVertexBufferData(user_ctx.m_VertexBuffer, 0, 0, dmGraphics::BUFFER_USAGE_DYNAMIC_DRAW);
+    ASSERT_EQ(2u, frame.m_ChangeCalls);
+
+    dmGraphics::SetResourceChangeCallback(0, 0);
+
+    dmGraphics::DeleteTexture(textures[0]);
+    dmGraphics::DeleteVertexBuffer(user_ctx.m_VertexBuffer);
+    dmGraphics::DeleteVertexDeclaration(user_ctx.m_VertexDeclaration);
+    dmGraphics::DeleteVertexProgram(vp);
+    dmGraphics::DeleteFragmentProgram(fp);
+    dmRender::DeleteMaterial(m_Context, material);
+}
+
 TEST_F(dmRenderTest, TestEnableDisableContextTextures)
 {
     dmGraphics::ShaderDesc::Shader vs_shader = MakeDDFShader("foo", 3);
@@ -1549,9 +1843,12 @@ TEST_F(dmRenderTest, FindRanges)
     SRangeCtx ctx;
     ctx.m_NumRanges = 0;
 
-    dmRender::FindRangeComparator comp;
-    comp.m_Entries = entries;
-    dmRender::FindRenderListRanges(indices, 0, sizeof(indices)/sizeof(indices[0]), entries, comp, &ctx, CollectRenderEntryRange);
+    uint64_t keys[count];
+    for( uint32_t i = 0; i < count; ++i)
+    {
+        keys[i] = entries[indices[i]].m_TagListKey;
+    }
+    dmRender::FindRenderListRanges(keys, count, &ctx, CollectRenderEntryRange);
 
     ASSERT_EQ(5, ctx.m_NumRanges);
 
@@ -0,0 +1,347 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+#include <jc_test/jc_test.h>
+#include <testmain/testmain.h>
+#include <dlib/array.h>
+#include <dlib/hash.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <platform/platform_window.h>
+#include <script/script.h>
+
+#include "render/render.h"
+#include "render/render_private.h"
+
+using namespace dmVMath;
+
+// Draws a render list of ENTRY_COUNT entries with the null graphics backend,
+// and compares the sorting with the std::stable_sort based sorting it replaced
+
+static const uint32_t ENTRY_COUNT = 50000;
+static const uint32_t TAG_LIST_COUNT = 4;
+static const uint32_t ITERATIONS = 20;
+
+// The sort value that was used by the previous sorting
+struct LegacySortValue
+{
+    union
+    {
+        struct
+        {
+            uint32_t m_BatchKey:24;
+            uint32_t m_Dispatch:8;
+            uint32_t m_Order:24;
+            uint32_t m_MajorOrder:4;
+            uint32_t m_MinorOrder:4;
+        };
+        float m_ZW;
+        uint64_t m_SortKey;
+    };
+};
+
+struct LegacySorter
+{
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return m_Values[a].m_SortKey < m_Values[b].m_SortKey;
+    }
+    LegacySortValue* m_Values;
+};
+
+struct LegacyRanges
+{
+    dmArray<dmRender::RenderListRange> m_Ranges;
+};
+
+static void CollectLegacyRange(void* _ctx, uint32_t tag_list_key, size_t start, size_t count)
+{
+    LegacyRanges* ctx = (LegacyRanges*) _ctx;
+    dmRender::RenderListRange range;
+    range.m_TagListKey = tag_list_key;
+    range.m_Start = start;
+    range.m_Count = count;
+    range.m_Skip = 0;
+    ctx->m_Ranges.Push(range);
+}
+
+struct LegacyFindRangeComparator
+{
+    dmRender::RenderListEntry* m_Entries;
+    bool operator() (const uint32_t& a, const uint32_t& b) const
+    {
+        return m_Entries[a].m_TagListKey < m_Entries[b].m_TagListKey;
+    }
+};
+
+// The previous range search, which finds the ranges in a binary search order
+static void LegacyFindRenderListRanges(uint32_t* first, size_t offset, size_t size, dmRender::RenderListEntry* entries, LegacyFindRangeComparator& comp, void* ctx, dmRender::RangeCallback callback)
+{
+    if (size == 0)
+        return;
+
+    size_t half = size >> 1;
+    uint32_t* low = first + offset;
+    uint32_t* high = low + size;
+    uint32_t* middle = low + half;
+    uint32_t val = entries[*middle].m_TagListKey;
+
+    low = std::lower_bound(low, middle, *middle, comp);
+    high = std::upper_bound(middle, high, *middle, comp);
+
+    callback(ctx, val, low - first, high - low);
+
+    uint32_t* rangefirst = first + offset;
+    LegacyFindRenderListRanges(first, offset, low - rangefirst, entries, comp, ctx, callback);
+    LegacyFindRenderListRanges(first, high - first, size - (high - rangefirst), entries, comp, ctx, callback);
+}
+
+// Sorts the tag lists, finds the ranges and sorts all visible entries, as DrawRenderList did without a predicate
+static void LegacySortRenderList(const Matrix4& transform, dmRender::RenderListEntry* entries, uint32_t count, dmArray<uint32_t>& indices, dmArray<LegacySortValue>& values, dmArray<uint32_t>& sort_buffer, LegacyRanges& ranges)
+{
+    indices.SetSize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        indices[i] = i;
+    }
+
+    dmRender::RenderListEntrySorter tag_sort;
+    tag_sort.m_Base = entries;
+    std::stable_sort(indices.Begin(), indices.End(), tag_sort);
+
+    ranges.m_Ranges.SetSize(0);
+    LegacyFindRangeComparator comp;
+    comp.m_Entries = entries;
+    LegacyFindRenderListRanges(indices.Begin(), 0, count, entries, comp, &ranges, CollectLegacyRange);
+
+    values.SetSize(count);
+    sort_buffer.SetSize(0);
+
+    float minZW = FLT_MAX;
+    float maxZW = -FLT_MAX;
+    for (uint32_t r = 0; r < ranges.m_Ranges.Size(); ++r)
+    {
+        const dmRender::RenderListRange& range = ranges.m_Ranges[r];
+        for (uint32_t i = range.m_Start; i < range.m_Start + range.m_Count; ++i)
+        {
+            uint32_t idx = indices[i];
+            dmRender::RenderListEntry* entry = &entries[idx];
+            if (entry->m_MajorOrder != dmRender::RENDER_ORDER_WORLD)
+                continue;
+            const Vector4 res = transform * entry->m_WorldPosition;
+            const float zw = res.getZ() / res.getW();
+            values[idx].m_ZW = zw;
+            if (zw < minZW) minZW = zw;
+            if (zw > maxZW) maxZW = zw;
+        }
+    }
+
+    float rc = 0;
+    if (maxZW > minZW)
+        rc = 1.0f / (maxZW - minZW);
+
+    for (uint32_t r = 0; r < ranges.m_Ranges.Size(); ++r)
+    {
+        const dmRender::RenderListRange& range = ranges.m_Ranges[r];
+        for (uint32_t i = range.m_Start; i < range.m_Start + range.m_Count; ++i)
+        {
+            uint32_t idx = indices[i];
+            dmRender::RenderListEntry* entry = &entries[idx];
+            values[idx].m_MajorOrder = entry->m_MajorOrder;
+            if (entry->m_MajorOrder == dmRender::RENDER_ORDER_WORLD)
+                values[idx].m_Order = (uint32_t) (0xfffff8 - 0xfffff0 * rc * (values[idx].m_ZW - minZW));
+            else
+                values[idx].m_Order = entry->m_Order;
+            values[idx].m_MinorOrder = entry->m_MinorOrder;
+            values[idx].m_BatchKey = entry->m_BatchKey & 0x00ffffff;
+            values[idx].m_Dispatch = entry->m_Dispatch;
+            sort_buffer.Push(idx);
+        }
+    }
+
+    LegacySorter sort;
+    sort.m_Values = values.Begin();
+    std::stable_sort(sort_buffer.Begin(), sort_buffer.End(), sort);
+}
+
+struct DrawOrderCtx
+{
+    dmArray<uint32_t> m_Order;
+};
+
+static void DrawOrderDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    if (params.m_Operation != dmRender::RENDER_LIST_OPERATION_BATCH)
+        return;
+    DrawOrderCtx* ctx = (DrawOrderCtx*) params.m_UserData;
+    for (uint32_t* i = params.m_Begin; i != params.m_End; ++i)
+    {
+        ctx->m_Order.Push(*i);
+    }
+}
+
+class dmRenderPerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmGraphics::InstallAdapter();
+
+        dmPlatform::WindowParams win_params = {};
+        win_params.m_Width = 20;
+        win_params.m_Height = 10;
+
+        m_Window = dmPlatform::NewWindow();
+        dmPlatform::OpenWindow(m_Window, win_params);
+
+        dmGraphics::ContextParams graphics_context_params = {};
+        graphics_context_params.m_Window = m_Window;
+        m_GraphicsContext = dmGraphics::NewContext(graphics_context_params);
+
+        m_ScriptContext = dmScript::NewContext(0, 0, true);
+        dmRender::RenderContextParams params;
+        params.m_MaxRenderTargets = 1;
+        params.m_MaxInstances = 2;
+        params.m_ScriptContext = m_ScriptContext;
+        params.m_MaxDebugVertexCount = 256;
+        params.m_MaxCharacters = 256;
+        params.m_MaxBatches = 128;
+        m_Context = dmRender::NewRenderContext(m_GraphicsContext, params);
+
+        for (uint32_t i = 0; i < TAG_LIST_COUNT; ++i)
+        {
+            dmhash_t tag = dmHashString64(i == 0 ? "tile" : i == 1 ? "model" : i == 2 ? "particle" : "gui");
+            m_TagListKeys[i] = dmRender::RegisterMaterialTagList(m_Context, 1, &tag);
+        }
+
+        Matrix4 view = Matrix4::lookAt(Point3(0, 0, 100), Point3(0, 0, 0), Vector3(0, 1, 0));
+        Matrix4 proj = Matrix4::perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+        dmRender::SetViewMatrix(m_Context, view);
+        dmRender::SetProjectionMatrix(m_Context, proj);
+
+        // Mostly world entries at random depths, with a few gui style entries on top
+        srand(42);
+        m_Entries.SetCapacity(ENTRY_COUNT);
+        m_Entries.SetSize(ENTRY_COUNT);
+        for (uint32_t i = 0; i < ENTRY_COUNT; ++i)
+        {
+            dmRender::RenderListEntry& entry = m_Entries[i];
+            memset(&entry, 0, sizeof(entry));
+            entry.m_WorldPosition = Point3(rand() % 200 - 100.0f, rand() % 200 - 100.0f, (rand() % 10000) * 0.01f - 50.0f);
+            entry.m_TagListKey = m_TagListKeys[rand() % TAG_LIST_COUNT];
+            entry.m_BatchKey = rand() % 64;
+            entry.m_MajorOrder = (i % 10) == 0 ? dmRender::RENDER_ORDER_AFTER_WORLD : dmRender::RENDER_ORDER_WORLD;
+            entry.m_Order = rand() % 1000;
+            entry.m_MinorOrder = rand() % 2;
+            entry.m_Visibility = dmRender::VISIBILITY_FULL;
+        }
+    }
+
+    virtual void TearDown()
+    {
+        dmRender::DeleteRenderContext(m_Context, 0);
+        dmGraphics::DeleteContext(m_GraphicsContext);
+        dmScript::DeleteContext(m_ScriptContext);
+        dmPlatform::CloseWindow(m_Window);
+        dmPlatform::DeleteWindow(m_Window);
+    }
+
+    void SubmitEntries(uint8_t dispatch)
+    {
+        dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, ENTRY_COUNT);
+        memcpy(out, m_Entries.Begin(), sizeof(dmRender::RenderListEntry) * ENTRY_COUNT);
+        for (uint32_t i = 0; i < ENTRY_COUNT; ++i)
+        {
+            out[i].m_Dispatch = dispatch;
+        }
+        dmRender::RenderListSubmit(m_Context, out, out + ENTRY_COUNT);
+        dmRender::RenderListEnd(m_Context);
+    }
+
+    dmPlatform::HWindow                 m_Window;
+    dmGraphics::HContext                m_GraphicsContext;
+    dmScript::HContext                  m_ScriptContext;
+    dmRender::HRenderContext            m_Context;
+    uint32_t                            m_TagListKeys[TAG_LIST_COUNT];
+    dmArray<dmRender::RenderListEntry>  m_Entries;
+};
+
+TEST_F(dmRenderPerfTest, SortRenderList)
+{
+    DrawOrderCtx ctx;
+    ctx.m_Order.SetCapacity(ENTRY_COUNT);
+
+    uint64_t draw_time = 0;
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        ctx.m_Order.SetSize(0);
+        dmRender::RenderListBegin(m_Context);
+        uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, DrawOrderDispatch, 0, &ctx);
+        SubmitEntries(dispatch);
+
+        uint64_t start = dmTime::GetTime();
+        dmRender::DrawRenderList(m_Context, 0, 0, 0);
+        draw_time += dmTime::GetTime() - start;
+    }
+    ASSERT_EQ(ENTRY_COUNT, ctx.m_Order.Size());
+
+    dmArray<dmRender::RenderListEntry> entries;
+    entries.SetCapacity(ENTRY_COUNT);
+    entries.SetSize(ENTRY_COUNT);
+    memcpy(entries.Begin(), m_Entries.Begin(), sizeof(dmRender::RenderListEntry) * ENTRY_COUNT);
+
+    dmArray<uint32_t> indices;
+    dmArray<LegacySortValue> values;
+    dmArray<uint32_t> sort_buffer;
+    LegacyRanges ranges;
+    indices.SetCapacity(ENTRY_COUNT);
+    values.SetCapacity(ENTRY_COUNT);
+    sort_buffer.SetCapacity(ENTRY_COUNT);
+    ranges.m_Ranges.SetCapacity(TAG_LIST_COUNT);
+
+    Matrix4 view_proj = dmRender::GetViewProjectionMatrix(m_Context);
+    uint64_t legacy_time = 0;
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        uint64_t start = dmTime::GetTime();
+        LegacySortRenderList(view_proj, entries.Begin(), ENTRY_COUNT, indices, values, sort_buffer, ranges);
+        legacy_time += dmTime::GetTime() - start;
+    }
+
+    // Entries with equal sort values may be drawn in any order, so compare the sort values in draw order
+    ASSERT_EQ(ENTRY_COUNT, sort_buffer.Size());
+    for (uint32_t i = 0; i < ENTRY_COUNT; ++i)
+    {
+        ASSERT_EQ(values[sort_buffer[i]].m_SortKey, values[ctx.m_Order[i]].m_SortKey);
+    }
+
+    printf("[render list] %u entries | stable_sort: %7.3f ms | radix (full draw): %7.3f ms | x%.2f\n", ENTRY_COUNT,
+            legacy_time * 0.001 / ITERATIONS, draw_time * 0.001 / ITERATIONS, legacy_time / (double) dmMath::Max(draw_time, (uint64_t) 1));
+}
+
+extern "C" void dmExportedSymbols();
+
+int main(int argc, char **argv)
+{
+    dmExportedSymbols();
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
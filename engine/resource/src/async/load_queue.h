@@ -38,6 +38,7 @@ namespace dmLoadQueue
         FResourcePreload        m_CompleteFunction;
         ResourcePreloadHintInfo m_HintInfo;
         void*                   m_Context;
+        bool                    m_BorrowBuffer; // Try to load without copying, see ResourceTypeSetBorrowBuffer
     };
 
     struct LoadResult
@@ -45,6 +46,9 @@ namespace dmLoadQueue
         dmResource::Result m_LoadResult;
         dmResource::Result m_PreloadResult;
         void* m_PreloadData;
+        // If set, the buffer is borrowed from this archive (see dmResource::BorrowResource). It stays valid after FreeLoad,
+        // and must be returned with dmResource::ReturnBorrowedResource once it isn't used any longer
+        dmResourceProvider::HArchive m_BorrowedArchive;
     };
 
     HQueue CreateQueue(dmResource::HFactory factory);
@@ -54,7 +58,7 @@ namespace dmLoadQueue
     // The name and canonical_path provided must have a lifetime that lasts until EndLoad is called
     HRequest BeginLoad(HQueue queue, const char* name, const char* canonical_path, PreloadInfo* info);
 
-    // Actual load result will be put in load_result. Ptrs can be handled until FreeLoad has been called.
+    // Actual load result will be put in load_result. Ptrs can be handled until FreeLoad has been called, unless borrowed (see LoadResult)
     Result EndLoad(HQueue queue, HRequest request, void** buf, uint32_t* size, LoadResult* load_result);
 
     // Free once completed.
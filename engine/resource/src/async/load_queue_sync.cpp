@@ -73,7 +73,16 @@ namespace dmLoadQueue
             return RESULT_INVALID_PARAM;
         }
 
-        load_result->m_LoadResult    = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
+        load_result->m_BorrowedArchive = 0;
+        if (request->m_PreloadInfo.m_BorrowBuffer &&
+            dmResource::BorrowResource(queue->m_Factory, request->m_CanonicalPath, (const void**)buf, size, &load_result->m_BorrowedArchive) == dmResource::RESULT_OK)
+        {
+            load_result->m_LoadResult = dmResource::RESULT_OK;
+        }
+        else
+        {
+            load_result->m_LoadResult = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
+        }
         load_result->m_PreloadResult = dmResource::RESULT_PENDING;
         load_result->m_PreloadData   = 0;
 
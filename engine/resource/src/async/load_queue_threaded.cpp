@@ -23,10 +23,12 @@
 #include <dlib/mutex.h>
 #include <dlib/time.h>
 #include <dlib/condition_variable.h>
+#include <dlib/math.h>
 
 namespace dmLoadQueue
 {
-    // Implementation of dmLoadQueue with a thread that loads items in the order they are supplied,
+    // Implementation of dmLoadQueue with a pool of threads that pick up items in the order they are supplied.
+    // Items may finish out of order, but are handed back (made visible to EndLoad) in the order they were supplied.
 
     // Default to small buffers since a lot of what is loaded are just small objects anyway.
     // That way we can have more in flight, but throttle when max pending data grows too large anyway
@@ -36,6 +38,7 @@ namespace dmLoadQueue
     // This sets the bandwidth of the loader.
     const uint64_t MAX_PENDING_DATA = 4 * 1024 * 1024;
     const uint32_t QUEUE_SLOTS      = 16;
+    const uint32_t MAX_LOAD_THREADS = 8;
 
     struct Request
     {
@@ -44,45 +47,98 @@ namespace dmLoadQueue
         dmResource::LoadBufferType m_Buffer;
         PreloadInfo                m_PreloadInfo;
         LoadResult                 m_Result;
+        // Result of a finished load, waiting for the previous requests to finish
+        LoadResult                 m_PendingResult;
+        // Set if the data is borrowed from an archive instead of loaded into m_Buffer
+        const void*                m_BorrowedData;
+        uint32_t                   m_BorrowedSize;
+        // Part of m_BytesWaiting reserved for the buffer before the read starts (0 until the size is looked up)
+        uint32_t                   m_Reserved;
+        bool                       m_SizePending;
+        bool                       m_Done;
     };
 
     struct Queue
     {
         Request                                 m_Request[QUEUE_SLOTS];
+        dmThread::Thread                        m_Threads[MAX_LOAD_THREADS];
         dmResource::HFactory                    m_Factory;
         dmMutex::HMutex                         m_Mutex;
         dmConditionVariable::HConditionVariable m_WakeupCond;
-        dmThread::Thread                        m_Thread;
+        uint32_t                                m_ThreadCount;
         uint32_t                                m_Front;
         uint32_t                                m_Back;
         uint32_t                                m_Loaded;
+        uint32_t                                m_Claimed;
         uint64_t                                m_BytesWaiting;
         bool                                    m_Shutdown;
 
         // Circular queue with indexing as follow (exclusive end)
         //
-        //          m_Back           m_Loaded   m_Front
-        // [N/A]   [loaded] [loaded] [to-load]  [N/A]
+        //          m_Back           m_Loaded   m_Claimed             m_Front
+        // [N/A]   [loaded] [loaded] [loading]  [to-load] [to-load]   [N/A]
         //
+        // The range [m_Loaded, m_Claimed) may contain finished requests (m_Done) that wait for an earlier one
     };
 
     static Request* GetNextRequest(Queue* queue)
     {
+        if (queue->m_Claimed == queue->m_Front)
+        {
+            return 0x0;
+        }
+
         // Since we can be loading many things at once, track the total Capacity() for buffers
-        // that are waiting to be picked up by the preloader. In the case of the queue being filled
-        // with only large requests (say only 4Mb textures), this throttles a bit so memory consumption
-        // does not run away.
-        if (queue->m_BytesWaiting >= MAX_PENDING_DATA)
+        // that are being loaded or waiting to be picked up by the preloader. The buffer is reserved before
+        // the read starts, so in the case of the queue being filled with only large requests (say only 4Mb textures),
+        // the threads can't read more than MAX_PENDING_DATA at once and memory consumption does not run away.
+        // A request is always started if nothing else is waiting, even if it's larger than MAX_PENDING_DATA
+        Request* request = &queue->m_Request[queue->m_Claimed % QUEUE_SLOTS];
+        if (request->m_Reserved == 0)
         {
             return 0x0;
         }
 
-        if (queue->m_Loaded == queue->m_Front)
+        if (queue->m_BytesWaiting != 0 && queue->m_BytesWaiting + request->m_Reserved > MAX_PENDING_DATA)
         {
             return 0x0;
         }
 
-        return &queue->m_Request[queue->m_Loaded % QUEUE_SLOTS];
+        queue->m_BytesWaiting += request->m_Reserved;
+        queue->m_Claimed++;
+        request->m_Done = false;
+        return request;
+    }
+
+    // The next request to claim, if its size isn't known yet and no other thread is looking it up
+    static Request* GetUnsizedRequest(Queue* queue)
+    {
+        if (queue->m_Claimed == queue->m_Front)
+        {
+            return 0x0;
+        }
+
+        Request* request = &queue->m_Request[queue->m_Claimed % QUEUE_SLOTS];
+        if (request->m_Reserved != 0 || request->m_SizePending)
+        {
+            return 0x0;
+        }
+        return request;
+    }
+
+    // Hands back the finished requests that are not waiting for an earlier request to finish. Mutex must be held
+    static void FinishRequests(Queue* queue)
+    {
+        while (queue->m_Loaded != queue->m_Claimed)
+        {
+            Request* request = &queue->m_Request[queue->m_Loaded % QUEUE_SLOTS];
+            if (!request->m_Done)
+            {
+                break;
+            }
+            request->m_Result = request->m_PendingResult;
+            queue->m_Loaded++;
+        }
     }
 
     static void LoadThread(void* arg)
@@ -96,11 +152,12 @@ namespace dmLoadQueue
                 dmMutex::ScopedLock lk(queue->m_Mutex);
                 if (current != 0)
                 {
-                    // Just finished one (from previous iteration)
-                    queue->m_BytesWaiting += current->m_Buffer.Capacity();
-                    queue->m_Loaded++;
-                    current->m_Result = result;
-                    current           = 0;
+                    // Just finished one (from previous iteration), replace the reservation with the actual buffer
+                    queue->m_BytesWaiting = queue->m_BytesWaiting - current->m_Reserved + current->m_Buffer.Capacity();
+                    current->m_PendingResult = result;
+                    current->m_Done          = true;
+                    current                  = 0;
+                    FinishRequests(queue);
                 }
                 if (queue->m_Shutdown)
                 {
@@ -110,11 +167,26 @@ namespace dmLoadQueue
                 current = GetNextRequest(queue);
                 if (current == 0x0)
                 {
-                    // Nothing to do, reset any buffers of inactive requests that are not at default capacity
+                    Request* next = GetUnsizedRequest(queue);
+                    if (next)
+                    {
+                        // Looked up without holding the mutex, as it may take a while (e.g. a http request). The request stays
+                        // in its slot, since it can't be handed back before it's claimed
+                        next->m_SizePending = true;
+                        dmMutex::Unlock(queue->m_Mutex);
+                        uint32_t size = 0;
+                        dmResource::GetResourceSize(queue->m_Factory, next->m_CanonicalPath, &size);
+                        dmMutex::Lock(queue->m_Mutex);
+                        next->m_Reserved    = dmMath::Max((uint32_t)DEFAULT_CAPACITY, size);
+                        next->m_SizePending = false;
+                        continue;
+                    }
+
+                    // Nothing to do, reset any buffers of free requests that are not at default capacity
                     for (uint32_t i = 0; i < QUEUE_SLOTS; ++i)
                     {
                         Request* r = &queue->m_Request[i];
-                        if (r->m_Buffer.Size() == 0)
+                        if (r->m_Name == 0x0)
                         {
                             if (r->m_Buffer.Capacity() > DEFAULT_CAPACITY)
                             {
@@ -126,6 +198,12 @@ namespace dmLoadQueue
                     dmConditionVariable::Wait(queue->m_WakeupCond, queue->m_Mutex);
                     current = GetNextRequest(queue);
                 }
+
+                if (current != 0 && queue->m_Claimed != queue->m_Front)
+                {
+                    // Let another thread pick up the next request
+                    dmConditionVariable::Signal(queue->m_WakeupCond);
+                }
             }
 
             if (current)
@@ -134,25 +212,36 @@ namespace dmLoadQueue
                 uint32_t size = 0;
 
                 assert(current->m_Buffer.Size() == 0);
-                if (current->m_Buffer.Capacity() != DEFAULT_CAPACITY)
+                result.m_BorrowedArchive = 0;
+                current->m_BorrowedData  = 0;
+                if (current->m_PreloadInfo.m_BorrowBuffer &&
+                    dmResource::BorrowResource(queue->m_Factory, current->m_CanonicalPath, &current->m_BorrowedData, &size, &result.m_BorrowedArchive) == dmResource::RESULT_OK)
                 {
-                    current->m_Buffer.SetCapacity(DEFAULT_CAPACITY);
+                    current->m_BorrowedSize = size;
+                    result.m_LoadResult     = dmResource::RESULT_OK;
+                }
+                else
+                {
+                    current->m_BorrowedData = 0;
+                    if (current->m_Buffer.Capacity() != DEFAULT_CAPACITY)
+                    {
+                        current->m_Buffer.SetCapacity(DEFAULT_CAPACITY);
+                    }
+                    result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
+                    assert(result.m_LoadResult != dmResource::RESULT_OK || current->m_Buffer.Size() == size);
                 }
-
-                result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
                 result.m_PreloadResult = dmResource::RESULT_PENDING;
                 result.m_PreloadData   = 0;
 
                 if (result.m_LoadResult == dmResource::RESULT_OK)
                 {
-                    assert(current->m_Buffer.Size() == size);
                     if (current->m_PreloadInfo.m_CompleteFunction)
                     {
                         ResourcePreloadParams params;
                         params.m_Factory       = queue->m_Factory;
                         params.m_Context       = current->m_PreloadInfo.m_Context;
-                        params.m_Buffer        = current->m_Buffer.Begin();
-                        params.m_BufferSize    = current->m_Buffer.Size();
+                        params.m_Buffer        = current->m_BorrowedData ? current->m_BorrowedData : current->m_Buffer.Begin();
+                        params.m_BufferSize    = size;
                         params.m_HintInfo      = &current->m_PreloadInfo.m_HintInfo;
                         params.m_PreloadData   = &result.m_PreloadData;
                         result.m_PreloadResult = (dmResource::Result)current->m_PreloadInfo.m_CompleteFunction(&params);
@@ -173,11 +262,28 @@ namespace dmLoadQueue
         q->m_Front        = 0;
         q->m_Back         = 0;
         q->m_Loaded       = 0;
+        q->m_Claimed      = 0;
         q->m_Shutdown     = false;
         q->m_BytesWaiting = 0;
         q->m_Mutex        = dmMutex::New();
         q->m_WakeupCond   = dmConditionVariable::New();
-        q->m_Thread       = dmThread::New(&LoadThread, 128 * 1024, q, "AsyncLoad");
+        for (uint32_t i = 0; i < QUEUE_SLOTS; ++i)
+        {
+            q->m_Request[i].m_Name         = 0x0;
+            q->m_Request[i].m_BorrowedData = 0x0;
+            q->m_Request[i].m_Reserved     = 0;
+            q->m_Request[i].m_SizePending  = false;
+            q->m_Request[i].m_Done         = false;
+        }
+
+        // More threads than slots would never have anything to do
+        q->m_ThreadCount = dmMath::Clamp(dmResource::GetLoadThreadCount(factory), 1u, dmMath::Min(MAX_LOAD_THREADS, QUEUE_SLOTS));
+        for (uint32_t i = 0; i < q->m_ThreadCount; ++i)
+        {
+            char name[32];
+            dmSnPrintf(name, sizeof(name), i == 0 ? "AsyncLoad" : "AsyncLoad%u", i);
+            q->m_Threads[i] = dmThread::New(&LoadThread, 128 * 1024, q, name);
+        }
 
         return q;
     }
@@ -187,10 +293,13 @@ namespace dmLoadQueue
         {
             dmMutex::ScopedLock lk(queue->m_Mutex);
             queue->m_Shutdown = true;
-            // Wake up the worker so it can exit and allow us to join
-            dmConditionVariable::Signal(queue->m_WakeupCond);
+            // Wake up the workers so they can exit and allow us to join
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        for (uint32_t i = 0; i < queue->m_ThreadCount; ++i)
+        {
+            dmThread::Join(queue->m_Threads[i]);
         }
-        dmThread::Join(queue->m_Thread);
         dmConditionVariable::Delete(queue->m_WakeupCond);
         dmMutex::Delete(queue->m_Mutex);
         delete queue;
@@ -209,15 +318,14 @@ namespace dmLoadQueue
         if ((queue->m_Front - queue->m_Back) == QUEUE_SLOTS)
             return 0;
 
-        if (queue->m_Loaded == queue->m_Front)
-        {
-            // The worker is sleeping waiting for request, wake it up
-            dmConditionVariable::Signal(queue->m_WakeupCond);
-        }
+        // Wake up a worker, if any is sleeping waiting for requests
+        dmConditionVariable::Signal(queue->m_WakeupCond);
 
         Request* req         = &queue->m_Request[(queue->m_Front++) % QUEUE_SLOTS];
         req->m_Name          = name;
         req->m_CanonicalPath = canonical_path;
+        req->m_Reserved      = 0;
+        req->m_SizePending   = false;
 
         req->m_PreloadInfo         = *info;
         req->m_Result.m_LoadResult = dmResource::RESULT_PENDING;
@@ -231,8 +339,16 @@ namespace dmLoadQueue
         if (request->m_Result.m_LoadResult == dmResource::RESULT_PENDING)
             return RESULT_PENDING;
 
-        *buf         = request->m_Buffer.Begin();
-        *size        = request->m_Buffer.Size();
+        if (request->m_BorrowedData)
+        {
+            *buf  = (void*)request->m_BorrowedData;
+            *size = request->m_BorrowedSize;
+        }
+        else
+        {
+            *buf  = request->m_Buffer.Begin();
+            *size = request->m_Buffer.Size();
+        }
         *load_result = request->m_Result;
 
         return RESULT_OK;
@@ -249,17 +365,23 @@ namespace dmLoadQueue
 
         uint32_t buffer_capacity = request->m_Buffer.Capacity();
         queue->m_BytesWaiting -= buffer_capacity;
-        // If we either have blocked further processing by exceeding MAX_PENDING_DATA or
-        // the buffer has a non-default capacity, we want to wake up the worker
-        if (buffer_capacity != DEFAULT_CAPACITY || (old_bytes_waiting >= MAX_PENDING_DATA && queue->m_BytesWaiting < MAX_PENDING_DATA))
+        // If the next request didn't fit in MAX_PENDING_DATA, all workers may be waiting.
+        // If the buffer has a non-default capacity, we want to wake up a worker to reset it
+        if (queue->m_Claimed != queue->m_Front && old_bytes_waiting + queue->m_Request[queue->m_Claimed % QUEUE_SLOTS].m_Reserved > MAX_PENDING_DATA)
+        {
+            // Wake up threads, we can now fit new requests
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        else if (buffer_capacity != DEFAULT_CAPACITY)
         {
-            // Wake up thread, we can now fit a new request
             dmConditionVariable::Signal(queue->m_WakeupCond);
         }
 
         // Clean up picked up requests
         request->m_Name          = 0x0;
         request->m_CanonicalPath = 0x0;
+        request->m_BorrowedData  = 0x0;
+        request->m_Done          = false;
 
         while (queue->m_Back != queue->m_Loaded && queue->m_Request[queue->m_Back % QUEUE_SLOTS].m_Name == 0x0)
         {
@@ -286,6 +286,9 @@ void ResourceTypeSetCreateFn(HResourceType type, FResourceCreate fn);
 void ResourceTypeSetPostCreateFn(HResourceType type, FResourcePostCreate fn);
 void ResourceTypeSetDestroyFn(HResourceType type, FResourceDestroy fn);
 void ResourceTypeSetRecreateFn(HResourceType type, FResourceRecreate fn);
+// If set, the buffer passed to the preload and create functions may point directly into a memory mapped archive.
+// The functions must then treat it as read only, and not keep any pointers into it after the call.
+void ResourceTypeSetBorrowBuffer(HResourceType type, bool borrow);
 
 // internal
 ResourceResult ResourceRegisterType(HResourceFactory factory,
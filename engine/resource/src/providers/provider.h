@@ -50,6 +50,7 @@ namespace dmResourceProvider
 
     typedef Result (*FGetFileSize)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     typedef Result (*FReadFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
+    typedef Result (*FGetFileData)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len);
     typedef Result (*FWriteFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
     typedef Result (*FGetManifest)(HArchiveInternal, dmResource::HManifest*); // In order for other providers to get the base manifest
     typedef Result (*FSetManifest)(HArchiveInternal, dmResource::HManifest);  // In order to set a downloaded manifest to a provider
@@ -71,6 +72,11 @@ namespace dmResourceProvider
 
     Result GetFileSize(HArchive archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     Result ReadFile(HArchive archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
+    // Gets a read only pointer to the file data, if the archive keeps it in memory as-is (e.g. memory mapped and uncompressed).
+    // The data is valid until the archive is unmounted. Returns RESULT_NOT_SUPPORTED if the file has to be read with ReadFile
+    Result GetFileData(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len);
+    // If ReadFile may be called from several threads at once
+    bool CanReadConcurrently(HArchive archive);
     Result WriteFile(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
 
 
@@ -234,6 +234,22 @@ namespace dmResourceProviderArchive
         return dmResourceProvider::RESULT_NOT_FOUND;
     }
 
+    static dmResourceProvider::Result GetFileData(dmResourceProvider::HArchiveInternal internal, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len)
+    {
+        GameArchiveFile* archive = (GameArchiveFile*)internal;
+        EntryInfo* entry = archive->m_EntryMap.Get(path_hash);
+        if (entry)
+        {
+            const void* entry_data;
+            if (dmResourceArchive::RESULT_OK != dmResourceArchive::GetEntryData(archive->m_ArchiveIndex, entry->m_ArchiveInfo, &entry_data, data_len))
+                return dmResourceProvider::RESULT_NOT_SUPPORTED;
+            *data = (const uint8_t*)entry_data;
+            return dmResourceProvider::RESULT_OK;
+        }
+
+        return dmResourceProvider::RESULT_NOT_FOUND;
+    }
+
     static dmResourceProvider::Result GetManifest(dmResourceProvider::HArchiveInternal internal, dmResource::HManifest* out_manifest)
     {
         GameArchiveFile* archive = (GameArchiveFile*)internal;
@@ -253,6 +269,8 @@ namespace dmResourceProviderArchive
         loader->m_GetManifest   = GetManifest;
         loader->m_GetFileSize   = GetFileSize;
         loader->m_ReadFile      = ReadFile;
+        loader->m_GetFileData   = GetFileData;
+        loader->m_ConcurrentReads = true;
     }
 
     DM_DECLARE_ARCHIVE_LOADER(ResourceProviderArchive, "archive", SetupArchiveLoader);
@@ -119,6 +119,7 @@ namespace dmResourceProviderFile
         loader->m_Unmount       = Unmount;
         loader->m_GetFileSize   = GetFileSize;
         loader->m_ReadFile      = ReadFile;
+        loader->m_ConcurrentReads = true;
     }
 
     DM_DECLARE_ARCHIVE_LOADER(ResourceProviderFile, "file", SetupArchiveLoader);
@@ -38,7 +38,9 @@ namespace dmResourceProvider
 
         FGetFileSize            m_GetFileSize;
         FReadFile               m_ReadFile;
+        FGetFileData            m_GetFileData;      // Optional, for archives that can hand out their data without copying
         FWriteFile              m_WriteFile;        // For writeable archives
+        bool                    m_ConcurrentReads;  // If m_ReadFile may be called from several threads at once
 
         void Verify();
 
@@ -92,6 +92,9 @@ struct ResourceFactory
     // m_BuiltinsManifest, m_Manifest
     dmMutex::HMutex                              m_LoadMutex;
 
+    // Number of threads in the async load queue of each preloader
+    uint32_t                                     m_LoadThreadCount;
+
     // dmResource::Get recursion depth
     uint32_t                                     m_RecursionDepth;
     // List of resources currently in dmResource::Get call-stack
@@ -128,6 +131,7 @@ const char* BUNDLE_PUBLIC_KEY_FILENAME          = "game.public.der";
 
 
 const char* MAX_RESOURCES_KEY = "resource.max_resources";
+const char* LOAD_THREAD_COUNT_KEY = "resource.load_thread_count";
 
 
 static inline uint16_t IncreaseVersion(HResourceFactory factory)
@@ -160,6 +164,7 @@ void SetDefaultNewFactoryParams(struct NewFactoryParams* params)
     memset(params, 0, sizeof(NewFactoryParams));
     params->m_MaxResources = 1024;
     params->m_Flags = RESOURCE_FACTORY_FLAGS_EMPTY;
+    params->m_LoadThreadCount = 1;
 
     params->m_ArchiveManifest.m_Data = 0;
     params->m_ArchiveManifest.m_Size = 0;
@@ -355,6 +360,7 @@ HFactory NewFactory(NewFactoryParams* params, const char* uri)
     }
 
     factory->m_LoadMutex = dmMutex::New();
+    factory->m_LoadThreadCount = dmMath::Max(1u, params->m_LoadThreadCount);
     return factory;
 }
 
@@ -605,8 +611,9 @@ dmResourceProvider::HArchive GetBaseArchive(HFactory factory)
     return factory->m_BaseArchiveMount;
 }
 
-// Assumes m_LoadMutex is already held
-static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
+// Doesn't need the m_LoadMutex, the mounts are guarded by their own mutex, which is only held while the resource is looked up.
+// Called from the async queue, from several threads at once
+Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
 {
     DM_PROFILE(__FUNCTION__);
 
@@ -616,33 +623,45 @@ static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, c
     // Let's find the resource in the current mounts
 
     dmhash_t normalized_path_hash = dmHashString64(normalized_path);
-    uint32_t file_size;
-    dmResource::Result r = dmResourceMounts::GetResourceSize(factory->m_Mounts, normalized_path_hash, normalized_path, &file_size);
+    dmResource::Result r = dmResourceMounts::ReadResourceConcurrent(factory->m_Mounts, normalized_path_hash, normalized_path, buffer);
     if (r == dmResource::RESULT_OK)
     {
-        if (buffer->Capacity() < file_size) {
-            buffer->SetCapacity(file_size);
-        }
-        buffer->SetSize(0);
+        *resource_size = buffer->Size();
+        return RESULT_OK;
+    }
+    buffer->SetSize(0);
+    return r;
+}
 
-        r = dmResourceMounts::ReadResource(factory->m_Mounts, normalized_path_hash, normalized_path, (uint8_t*)buffer->Begin(), file_size);
-        if (r == dmResource::RESULT_OK)
-        {
-            buffer->SetSize(file_size);
-            *resource_size = file_size;
-            return RESULT_OK;
-        }
-        return r;
+// Doesn't need the m_LoadMutex
+Result GetResourceSize(HFactory factory, const char* path, uint32_t* resource_size)
+{
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+    return dmResourceMounts::GetResourceSize(factory->m_Mounts, dmHashString64(normalized_path), normalized_path, resource_size);
+}
+
+// Doesn't need the m_LoadMutex, the mounts are guarded by their own mutex
+Result BorrowResource(HFactory factory, const char* path, const void** data, uint32_t* resource_size, dmResourceProvider::HArchive* archive)
+{
+    DM_PROFILE(__FUNCTION__);
+
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+    const uint8_t* resource_data;
+    Result r = dmResourceMounts::BorrowResourceData(factory->m_Mounts, normalized_path_hash, normalized_path, &resource_data, resource_size, archive);
+    if (r == RESULT_OK)
+    {
+        *data = resource_data;
     }
-    return RESULT_RESOURCE_NOT_FOUND;
+    return r;
 }
 
-// Takes the lock.
-Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
+void ReturnBorrowedResource(HFactory factory, dmResourceProvider::HArchive archive)
 {
-    // Called from async queue so we wrap around a lock
-    dmMutex::ScopedLock lk(factory->m_LoadMutex);
-    return LoadResourceFromBufferLocked(factory, path, original_name, resource_size, buffer);
+    dmResourceMounts::ReturnResourceData(factory->m_Mounts, archive);
 }
 
 // Assumes m_LoadMutex is already held
@@ -652,7 +671,7 @@ Result LoadResource(HFactory factory, const char* path, const char* original_nam
         factory->m_Buffer.SetCapacity(DEFAULT_BUFFER_SIZE);
     }
     factory->m_Buffer.SetSize(0);
-    Result r = LoadResourceFromBufferLocked(factory, path, original_name, resource_size, &factory->m_Buffer);
+    Result r = LoadResourceFromBuffer(factory, path, original_name, resource_size, &factory->m_Buffer);
     if (r == RESULT_OK)
     {
         *buffer = factory->m_Buffer.Begin();
@@ -831,6 +850,19 @@ static Result CreateAndLoadResource(HFactory factory, const char* name, void** r
         return RESULT_OK;
     }
 
+    if (resource_type->m_BorrowBuffer)
+    {
+        const void* data;
+        uint32_t data_size;
+        dmResourceProvider::HArchive archive;
+        if (BorrowResource(factory, canonical_path, &data, &data_size, &archive) == RESULT_OK)
+        {
+            Result result = DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, (void*)data, data_size, resource);
+            ReturnBorrowedResource(factory, archive);
+            return result;
+        }
+    }
+
     void* buffer         = 0;
     uint32_t buffer_size = 0;
     Result result = LoadResource(factory, canonical_path, name, &buffer, &buffer_size);
@@ -1463,6 +1495,11 @@ dmMutex::HMutex GetLoadMutex(const dmResource::HFactory factory)
     return factory->m_LoadMutex;
 }
 
+uint32_t GetLoadThreadCount(const dmResource::HFactory factory)
+{
+    return factory->m_LoadThreadCount;
+}
+
 dmResourceMounts::HContext GetMountsContext(const dmResource::HFactory factory)
 {
     return factory->m_Mounts;
@@ -54,6 +54,11 @@ namespace dmResource
      */
     extern const char* MAX_RESOURCES_KEY;
 
+    /**
+     * Configuration key used to set the number of threads used by the preloader to load resources.
+     */
+    extern const char* LOAD_THREAD_COUNT_KEY;
+
     extern const char* BUNDLE_INDEX_FILENAME;
     extern const char* BUNDLE_DATA_FILENAME;
 
@@ -137,7 +142,10 @@ namespace dmResource
         EmbeddedResource m_ArchiveData;
         EmbeddedResource m_ArchiveManifest;
 
-        uint32_t m_Reserved[5];
+        /// Number of threads loading resources for the preloader, on platforms with thread support. Default is 1
+        uint32_t m_LoadThreadCount;
+
+        uint32_t m_Reserved[4];
 
         NewFactoryParams()
         {
@@ -351,6 +359,13 @@ namespace dmResource
     */
     dmMutex::HMutex GetLoadMutex(const dmResource::HFactory factory);
 
+    /**
+     * Returns the number of threads used to load resources asynchronously
+     * @param factory Factory handle
+     * @return Number of load threads
+    */
+    uint32_t GetLoadThreadCount(const dmResource::HFactory factory);
+
 
     /**
      * @name
@@ -431,6 +446,12 @@ namespace dmResource
     Result LoadResource(HFactory factory, const char* path, const char* original_name, void** buffer, uint32_t* resource_size);
     // load with own buffer
     Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer);
+    // get the size of the resource, without loading it
+    Result GetResourceSize(HFactory factory, const char* path, uint32_t* resource_size);
+    // get read only data directly from the archive, e.g. a memory mapped archive, without copying it. The archive stays
+    // mounted until ReturnBorrowedResource is called. Returns RESULT_NOT_SUPPORTED if the resource must be loaded with a buffer
+    Result BorrowResource(HFactory factory, const char* path, const void** data, uint32_t* resource_size, dmResourceProvider::HArchive* archive);
+    void ReturnBorrowedResource(HFactory factory, dmResourceProvider::HArchive archive);
 }
 
 #endif // DM_RESOURCE_H
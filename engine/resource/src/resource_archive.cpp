@@ -140,7 +140,13 @@ namespace dmResourceArchive
             return RESULT_IO_ERROR;
         }
 
-        aic->m_ArchiveFileIndex->m_FileResourceData = f_data; // game.arcd file handle
+        // The bundled archive is only read from, and each read takes an idle handle (see ReadEntry)
+        ArchiveFileIndex* afi = aic->m_ArchiveFileIndex;
+        dmStrlCpy(afi->m_DataPath, data_file_path, DMPATH_MAX_PATH);
+        afi->m_ReadHandles[0] = f_data; // game.arcd file handle
+        afi->m_ReadHandleCount = 1;
+        afi->m_ReadHandleMutex = dmMutex::New();
+        CreateLookup(aic);
         *archive = aic;
 
         fclose(f_index);
@@ -166,9 +172,12 @@ namespace dmResourceArchive
         (*archive)->m_ArchiveFileIndex->m_ResourceData = (uint8_t*)resource_data;
         (*archive)->m_ArchiveFileIndex->m_ResourceSize = resource_data_size;
         (*archive)->m_ArchiveFileIndex->m_IsMemMapped = mem_mapped_data;
+        // Guards the read buffers, as the memory mapped data may be read from several threads at once
+        (*archive)->m_ArchiveFileIndex->m_ReadHandleMutex = dmMutex::New();
 
         (*archive)->m_ArchiveIndex = a;
         (*archive)->m_ArchiveIndexSize = index_buffer_size;
+        CreateLookup(*archive);
 
         return RESULT_OK;
     }
@@ -185,6 +194,24 @@ namespace dmResourceArchive
                 fclose(afi->m_FileResourceData);
                 afi->m_FileResourceData = 0;
             }
+
+            for (uint32_t i = 0; i < afi->m_ReadHandleCount; ++i)
+            {
+                fclose(afi->m_ReadHandles[i]);
+            }
+            afi->m_ReadHandleCount = 0;
+
+            for (uint32_t i = 0; i < afi->m_ReadBufferCount; ++i)
+            {
+                delete[] afi->m_ReadBuffers[i].m_Data;
+            }
+            afi->m_ReadBufferCount = 0;
+
+            if (afi->m_ReadHandleMutex)
+            {
+                dmMutex::Delete(afi->m_ReadHandleMutex);
+                afi->m_ReadHandleMutex = 0;
+            }
         }
 
         delete afi;
@@ -192,6 +219,7 @@ namespace dmResourceArchive
 
     void Delete(HArchiveIndexContainer &archive)
     {
+        DeleteLookup(archive);
         DeleteArchiveFileIndex(archive->m_ArchiveFileIndex);
 
         if (!archive->m_IsMemMapped)
@@ -211,24 +239,138 @@ namespace dmResourceArchive
         }
     }
 
-    dmResourceArchive::Result FindEntry(dmResourceArchive::HArchiveIndexContainer archive, const uint8_t* hash, uint32_t hash_len, dmResourceArchive::EntryData** entry)
-    {
-        uint32_t entry_count = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataCount);
-        uint32_t entry_offset = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataOffset);
-        uint32_t hash_offset = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_HashOffset);
-        uint8_t* hashes = 0;
-        dmResourceArchive::EntryData* entries = 0;
+    // Number of hash digest bytes stored in the lookup
+    static const uint32_t LOOKUP_PREFIX_LENGTH = 8;
 
+    static void GetHashesAndEntries(HArchiveIndexContainer archive, uint8_t** hashes, EntryData** entries)
+    {
         // If archive is loaded from file use the member arrays for hashes and entries, otherwise read with mem offsets.
         if (!archive->m_IsMemMapped)
         {
-            hashes = archive->m_ArchiveFileIndex->m_Hashes;
-            entries = archive->m_ArchiveFileIndex->m_Entries;
+            *hashes = archive->m_ArchiveFileIndex->m_Hashes;
+            *entries = archive->m_ArchiveFileIndex->m_Entries;
         }
         else
         {
-            hashes = (uint8_t*)((uintptr_t)archive->m_ArchiveIndex + hash_offset);
-            entries = (dmResourceArchive::EntryData*)((uintptr_t)archive->m_ArchiveIndex + entry_offset);
+            *hashes = (uint8_t*)((uintptr_t)archive->m_ArchiveIndex + dmEndian::ToNetwork(archive->m_ArchiveIndex->m_HashOffset));
+            *entries = (EntryData*)((uintptr_t)archive->m_ArchiveIndex + dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataOffset));
+        }
+    }
+
+    // Read as big endian, so that the prefixes compare in the same order as memcmp() on the digests
+    static inline uint64_t GetHashPrefix(const uint8_t* hash)
+    {
+        uint64_t prefix = 0;
+        for (uint32_t i = 0; i < LOOKUP_PREFIX_LENGTH; ++i)
+        {
+            prefix = (prefix << 8) | hash[i];
+        }
+        return prefix;
+    }
+
+    // Places the sorted hashes in Eytzinger order with an in-order traversal of the implicit tree (children of k are 2k and 2k+1)
+    static uint32_t BuildLookup(HArchiveIndexContainer archive, const uint8_t* hashes, uint32_t count, uint32_t i, uint32_t k)
+    {
+        if (k <= count)
+        {
+            i = BuildLookup(archive, hashes, count, i, 2 * k);
+            archive->m_LookupPrefixes[k] = GetHashPrefix(hashes + dmResourceArchive::MAX_HASH * i);
+            archive->m_LookupIndices[k] = i;
+            i = BuildLookup(archive, hashes, count, i + 1, 2 * k + 1);
+        }
+        return i;
+    }
+
+    void DeleteLookup(HArchiveIndexContainer archive)
+    {
+        delete[] archive->m_LookupPrefixes;
+        delete[] archive->m_LookupIndices;
+        archive->m_LookupPrefixes = 0;
+        archive->m_LookupIndices = 0;
+        archive->m_LookupHashes = 0;
+        archive->m_LookupCount = 0;
+    }
+
+    void CreateLookup(HArchiveIndexContainer archive)
+    {
+        DeleteLookup(archive);
+
+        uint32_t entry_count = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataCount);
+        uint32_t hash_length = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_HashLength);
+        if (entry_count == 0 || hash_length < LOOKUP_PREFIX_LENGTH)
+        {
+            return;
+        }
+
+        uint8_t* hashes = 0;
+        EntryData* entries = 0;
+        GetHashesAndEntries(archive, &hashes, &entries);
+
+        archive->m_LookupPrefixes = new uint64_t[entry_count + 1];
+        archive->m_LookupIndices = new uint32_t[entry_count + 1];
+        archive->m_LookupPrefixes[0] = 0;
+        archive->m_LookupIndices[0] = 0;
+        BuildLookup(archive, hashes, entry_count, 0, 1);
+        archive->m_LookupHashes = hashes;
+        archive->m_LookupCount = entry_count;
+    }
+
+    static inline bool IsLookupValid(HArchiveIndexContainer archive, const uint8_t* hashes, uint32_t entry_count)
+    {
+        return archive->m_LookupPrefixes != 0 && archive->m_LookupHashes == hashes && archive->m_LookupCount == entry_count;
+    }
+
+    // Returns the index of the first hash that isn't less than the prefix of 'hash', or entry_count if there is none
+    static uint32_t FindLookupLowerBound(HArchiveIndexContainer archive, const uint8_t* hash, uint32_t entry_count)
+    {
+        const uint64_t* prefixes = archive->m_LookupPrefixes;
+        const uint64_t prefix = GetHashPrefix(hash);
+
+        uint32_t k = 1;
+        while (k <= entry_count)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            // The descendants four levels down are stored next to each other. Fetch them while comparing the levels in between
+            __builtin_prefetch(prefixes + 16 * k);
+#endif
+            k = 2 * k + (prefixes[k] < prefix ? 1 : 0);
+        }
+        // Undo the right turns taken after the last left turn. The node where that left turn was made is the lower bound
+        while (k & 1)
+        {
+            k >>= 1;
+        }
+        k >>= 1;
+        return k == 0 ? entry_count : archive->m_LookupIndices[k];
+    }
+
+    dmResourceArchive::Result FindEntry(dmResourceArchive::HArchiveIndexContainer archive, const uint8_t* hash, uint32_t hash_len, dmResourceArchive::EntryData** entry)
+    {
+        uint32_t entry_count = dmEndian::ToNetwork(archive->m_ArchiveIndex->m_EntryDataCount);
+        uint8_t* hashes = 0;
+        dmResourceArchive::EntryData* entries = 0;
+        GetHashesAndEntries(archive, &hashes, &entries);
+
+        if (hash_len >= LOOKUP_PREFIX_LENGTH && IsLookupValid(archive, hashes, entry_count))
+        {
+            // The prefixes are practically unique, so this is normally a single compare
+            for (uint32_t i = FindLookupLowerBound(archive, hash, entry_count); i < entry_count; ++i)
+            {
+                int cmp = memcmp(hash, hashes + dmResourceArchive::MAX_HASH * i, hash_len);
+                if (cmp == 0)
+                {
+                    if (entry != 0)
+                    {
+                        *entry = &entries[i];
+                    }
+                    return dmResourceArchive::RESULT_OK;
+                }
+                else if (cmp < 0)
+                {
+                    break;
+                }
+            }
+            return dmResourceArchive::RESULT_NOT_FOUND;
         }
 
         // Search for hash with binary search (entries are sorted on hash)
@@ -499,6 +641,95 @@ namespace dmResourceArchive
         return RESULT_OK;
     }
 
+    // The compressed data is read and decrypted into an idle buffer of the archive, which is kept for the next read
+    static ReadBuffer AcquireReadBuffer(ArchiveFileIndex* afi, uint32_t size)
+    {
+        ReadBuffer read_buffer = {0, 0};
+        if (afi->m_ReadHandleMutex)
+        {
+            dmMutex::Lock(afi->m_ReadHandleMutex);
+        }
+        if (afi->m_ReadBufferCount > 0)
+        {
+            read_buffer = afi->m_ReadBuffers[--afi->m_ReadBufferCount];
+        }
+        if (afi->m_ReadHandleMutex)
+        {
+            dmMutex::Unlock(afi->m_ReadHandleMutex);
+        }
+
+        if (read_buffer.m_Capacity < size)
+        {
+            delete[] read_buffer.m_Data;
+            read_buffer.m_Data = new uint8_t[size];
+            read_buffer.m_Capacity = size;
+        }
+        return read_buffer;
+    }
+
+    static void ReleaseReadBuffer(ArchiveFileIndex* afi, ReadBuffer read_buffer)
+    {
+        if (!read_buffer.m_Data)
+        {
+            return;
+        }
+
+        if (afi->m_ReadHandleMutex)
+        {
+            dmMutex::Lock(afi->m_ReadHandleMutex);
+        }
+        bool kept = afi->m_ReadBufferCount < MAX_READ_HANDLES;
+        if (kept)
+        {
+            afi->m_ReadBuffers[afi->m_ReadBufferCount++] = read_buffer;
+        }
+        if (afi->m_ReadHandleMutex)
+        {
+            dmMutex::Unlock(afi->m_ReadHandleMutex);
+        }
+
+        if (!kept)
+        {
+            delete[] read_buffer.m_Data;
+        }
+    }
+
+    // Archives without a read handle mutex only have the one file handle, and the caller serializes the reads
+    static FILE* AcquireReadHandle(ArchiveFileIndex* afi)
+    {
+        if (!afi->m_ReadHandleMutex)
+        {
+            return afi->m_FileResourceData;
+        }
+
+        {
+            DM_MUTEX_SCOPED_LOCK(afi->m_ReadHandleMutex);
+            if (afi->m_ReadHandleCount > 0)
+            {
+                return afi->m_ReadHandles[--afi->m_ReadHandleCount];
+            }
+        }
+        return fopen(afi->m_DataPath, "rb");
+    }
+
+    static void ReleaseReadHandle(ArchiveFileIndex* afi, FILE* file)
+    {
+        if (!afi->m_ReadHandleMutex)
+        {
+            return;
+        }
+
+        {
+            DM_MUTEX_SCOPED_LOCK(afi->m_ReadHandleMutex);
+            if (afi->m_ReadHandleCount < MAX_READ_HANDLES)
+            {
+                afi->m_ReadHandles[afi->m_ReadHandleCount++] = file;
+                return;
+            }
+        }
+        fclose(file);
+    }
+
     Result ReadEntry(HArchiveIndexContainer archive, const EntryData* entry, void* buffer)
     {
         // We always assume it's in Host format, since it may arrive from memory mapped data
@@ -510,17 +741,21 @@ namespace dmResourceArchive
         bool encrypted = (flags & dmResourceArchive::ENTRY_FLAG_ENCRYPTED);
         bool compressed = (flags & dmResourceArchive::ENTRY_FLAG_COMPRESSED);
 
-        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
         bool resource_memmapped = afi->m_IsMemMapped;
 
-        uint8_t* temp_data = 0;
         uint8_t* source_data = 0;
         uint32_t source_data_size = 0;
+        ReadBuffer read_buffer = {0, 0};
 
         if (!resource_memmapped)
         {
             // we need to read from the file on disc
-            FILE* resource_file = afi->m_FileResourceData;
+            FILE* resource_file = AcquireReadHandle(afi);
+            if (!resource_file)
+            {
+                return dmResourceArchive::RESULT_IO_ERROR;
+            }
             fseek(resource_file, resource_offset, SEEK_SET);
 
             Result result = dmResourceArchive::RESULT_OK;
@@ -540,18 +775,19 @@ namespace dmResourceArchive
             else
             {
                 // We need a temp buffer to read to, since we can't decompress to the same buffer
-                temp_data = new uint8_t[compressed_size];
-                if (fread(temp_data, 1, compressed_size, resource_file) != compressed_size)
+                read_buffer = AcquireReadBuffer(afi, compressed_size);
+                source_data = read_buffer.m_Data;
+                if (fread(source_data, 1, compressed_size, resource_file) != compressed_size)
                 {
                     result = RESULT_IO_ERROR;
                 }
-                source_data = temp_data;
                 source_data_size = compressed_size;
             }
 
+            ReleaseReadHandle(afi, resource_file);
             if (result != dmResourceArchive::RESULT_OK)
             {
-                delete[] temp_data;
+                ReleaseReadBuffer(afi, read_buffer);
                 return result;
             }
         }
@@ -577,10 +813,9 @@ namespace dmResourceArchive
             else
             {
                 // We need a temp buffer to read to, since we can't decompress to the same buffer
-                temp_data = new uint8_t[compressed_size];
-                memcpy(temp_data, archive_data, compressed_size);
-
-                source_data = temp_data;
+                read_buffer = AcquireReadBuffer(afi, compressed_size);
+                source_data = read_buffer.m_Data;
+                memcpy(source_data, archive_data, compressed_size);
                 source_data_size = compressed_size;
             }
         }
@@ -588,30 +823,47 @@ namespace dmResourceArchive
         // At this point the source_data is the file "stored on disc"
         // and will be treated as the input
 
+        Result result = dmResourceArchive::RESULT_OK;
+
         // Encryption is done in-place
         if(encrypted)
         {
             dmResource::Result r = dmResource::DecryptBuffer((uint8_t*)source_data, source_data_size);
             if (dmResource::RESULT_OK != r)
             {
-                delete[] temp_data;
-                return dmResourceArchive::RESULT_UNKNOWN;
+                result = dmResourceArchive::RESULT_UNKNOWN;
             }
         }
 
-        if (compressed)
+        if (compressed && result == dmResourceArchive::RESULT_OK)
         {
             int decompressed_size;
             dmLZ4::Result r = dmLZ4::DecompressBuffer(source_data, source_data_size, buffer, size, &decompressed_size);
             if (dmLZ4::RESULT_OK != r)
             {
-                delete[] temp_data;
-                return dmResourceArchive::RESULT_OUTBUFFER_TOO_SMALL;
+                result = dmResourceArchive::RESULT_OUTBUFFER_TOO_SMALL;
             }
         }
 
-        delete[] temp_data;
-        return dmResourceArchive::RESULT_OK;
+        ReleaseReadBuffer(afi, read_buffer);
+        return result;
+    }
+
+    Result GetEntryData(HArchiveIndexContainer archive, const EntryData* entry, const void** data, uint32_t* size)
+    {
+        // We always assume it's in Host format, since it may arrive from memory mapped data
+        const uint32_t flags            = dmEndian::ToNetwork(entry->m_Flags);
+        const uint32_t resource_offset  = dmEndian::ToNetwork(entry->m_ResourceDataOffset);
+
+        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (!afi->m_IsMemMapped || (flags & (ENTRY_FLAG_ENCRYPTED | ENTRY_FLAG_COMPRESSED)))
+        {
+            return RESULT_NOT_FOUND;
+        }
+
+        *data = (const void*) ((uintptr_t)afi->m_ResourceData + resource_offset);
+        *size = dmEndian::ToNetwork(entry->m_ResourceSize);
+        return RESULT_OK;
     }
 
     Result WriteArchiveIndex(const char* path, ArchiveIndex* ai)
@@ -685,6 +937,7 @@ namespace dmResourceArchive
         archive_container->m_ArchiveIndex = new_index;
         // Since we store data sequentially when doing the deep-copy we want to access it in that fashion
         archive_container->m_IsMemMapped = mem_mapped;
+        CreateLookup(archive_container);
     }
 
     uint32_t GetEntryCount(HArchiveIndexContainer archive)
@@ -23,6 +23,7 @@
 #include <dlib/uri.h>
 #include <dlib/align.h>
 #include <dlib/array.h>
+#include <dlib/mutex.h>
 #include <dlib/path.h> // DMPATH_MAX_PATH
 
 
@@ -40,6 +41,9 @@ namespace dmResourceArchive
     // Equivalent to 512 bits
     const static uint32_t MAX_HASH = 64;
 
+    // Number of idle game.arcd read handles (and read buffers) kept per archive (see ReadEntry)
+    const static uint32_t MAX_READ_HANDLES = 8;
+
     enum Result
     {
         RESULT_OK = 0,
@@ -90,6 +94,13 @@ namespace dmResourceArchive
         uint8_t  m_ArchiveIndexMD5[16]; // 16 bytes is the size of md5
     };
 
+    // Scratch buffer for reading compressed entries (see ReadEntry)
+    struct ReadBuffer
+    {
+        uint8_t*    m_Data;
+        uint32_t    m_Capacity;
+    };
+
     // Used if the archive is loaded from file (i.e a bundled archive of live update archive)
     struct ArchiveFileIndex
     {
@@ -100,10 +111,20 @@ namespace dmResourceArchive
         char        m_Path[DMPATH_MAX_PATH];
         uint8_t*    m_Hashes;           // Sorted list of filenames (i.e. hashes)
         EntryData*  m_Entries;          // Indices of this list matches indices of m_Hashes
-        FILE*       m_FileResourceData; // game.arcd file handle
+        FILE*       m_FileResourceData; // liveupdate.arcd file handle (the bundled game.arcd uses m_ReadHandles)
         uint8_t*    m_ResourceData;     // mem-mapped game.arcd
         uint32_t    m_ResourceSize;     // the size of the memory mapped region
         bool        m_IsMemMapped;      // Is the data memory mapped?
+
+        // Bundled archives are read through their own file handles, so that several threads can read at once.
+        // Without a mutex (e.g. the live update archive), m_FileResourceData is used and the caller serializes the reads
+        char            m_DataPath[DMPATH_MAX_PATH];        // game.arcd path
+        FILE*           m_ReadHandles[MAX_READ_HANDLES];    // Idle read handles
+        uint32_t        m_ReadHandleCount;
+        // Idle scratch buffers for compressed entries. Also guarded by m_ReadHandleMutex, and freed with the archive
+        ReadBuffer      m_ReadBuffers[MAX_READ_HANDLES];
+        uint32_t        m_ReadBufferCount;
+        dmMutex::HMutex m_ReadHandleMutex;
     };
 
     struct ArchiveIndexContainer
@@ -121,6 +142,12 @@ namespace dmResourceArchive
         //ArchiveLoader       m_Loader;
         void*               m_UserData;         // private to the loader
 
+        // Eytzinger ordered copy of the first bytes of each hash digest, for faster lookups (see CreateLookup())
+        uint64_t*           m_LookupPrefixes;   // 1-based, m_LookupCount + 1 entries
+        uint32_t*           m_LookupIndices;    // Index of the entry, for each prefix
+        const uint8_t*      m_LookupHashes;     // The hash digests that the lookup was created from
+        uint32_t            m_LookupCount;      // The entry count that the lookup was created from
+
         uint32_t m_ArchiveIndexSize;            // kept for unmapping
         uint8_t  m_IsMemMapped:1; // if the m_ArchiveIndex is memory mapped
         uint8_t  :7;
@@ -194,6 +221,21 @@ namespace dmResourceArchive
                              const void* resource_data, uint32_t resource_data_size, bool mem_mapped_data,
                              HArchiveIndexContainer* archive);
 
+    /**
+     * Creates (or recreates) the lookup structure used by FindEntry(). The first 8 bytes of each hash digest
+     * is stored in Eytzinger (breadth first) order, which keeps the first levels of the search in a few cache lines.
+     * Called by LoadArchiveFromFile(), WrapArchiveBuffer() and SetNewArchiveIndex().
+     * If the index is modified in other ways, FindEntry() falls back to a binary search until the lookup is recreated.
+     * @param archive archive index container handle
+     */
+    void CreateLookup(HArchiveIndexContainer archive);
+
+    /**
+     * Deletes the lookup structure, after which FindEntry() uses a binary search over the hash digests
+     * @param archive archive index container handle
+     */
+    void DeleteLookup(HArchiveIndexContainer archive);
+
     /**
      * Find resource entry within the loaded archives
      * @param archive archive index handle
@@ -205,6 +247,7 @@ namespace dmResourceArchive
 
     /**
      * Read resource from the given archive
+     * @note Bundled and memory mapped archives may be read from several threads at once
      * @param archive archive index handle
      * @param entry_data entry data
      * @param buffer buffer to load to
@@ -212,6 +255,18 @@ namespace dmResourceArchive
      */
     Result ReadEntry(HArchiveIndexContainer archive, const EntryData* entry, void* buffer);
 
+    /**
+     * Get the resource data directly from the memory mapped data of the given archive, without copying it.
+     * Only possible for entries that are neither compressed nor encrypted.
+     * The data is read only, and valid until the archive is deleted
+     * @param archive archive index handle
+     * @param entry_data entry data
+     * @param data out pointer to the data
+     * @param size out size of the data
+     * @return RESULT_OK on success, RESULT_NOT_FOUND if the data must be read with ReadEntry
+     */
+    Result GetEntryData(HArchiveIndexContainer archive, const EntryData* entry, const void** data, uint32_t* size);
+
     /**
      * Delete archive index. Only required for archives created with LoadArchive function
      * @param archive archive index handle
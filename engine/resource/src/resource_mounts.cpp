@@ -24,6 +24,7 @@
 #include <dlib/log.h>
 #include <dlib/mutex.h>
 #include <dlib/sys.h>
+#include <assert.h>
 #include <algorithm> // std::sort
 
 namespace dmResourceMounts
@@ -39,6 +40,7 @@ struct ArchiveMount
     dmResourceProvider::HArchive    m_Archive;
     int                             m_Priority;
     bool                            m_Persist;
+    uint32_t                        m_BorrowCount; // Number of borrowed resource data pointers into the archive, and reads in progress
 };
 
 struct CustomFile
@@ -160,6 +162,7 @@ dmResource::Result AddMount(HContext ctx, const char* name, dmResourceProvider::
     mount.m_Priority = priority;
     mount.m_Archive = archive;
     mount.m_Persist = persist;
+    mount.m_BorrowCount = 0;
     AddMountInternal(ctx, mount);
     return dmResource::RESULT_OK;
 }
@@ -170,6 +173,12 @@ static dmResource::Result RemoveMountByIndexInternal(HContext ctx, uint32_t inde
     if (index >= ctx->m_Mounts.Size())
         return dmResource::RESULT_RESOURCE_NOT_FOUND;
 
+    if (ctx->m_Mounts[index].m_BorrowCount != 0)
+    {
+        dmLogError("Mount '%s' is in use by %u pending resource loads", ctx->m_Mounts[index].m_Name, ctx->m_Mounts[index].m_BorrowCount);
+        return dmResource::RESULT_PENDING;
+    }
+
     ctx->m_Mounts.EraseSwap(index); // TODO: We'd like an Erase() function in dmArray, to keep the internal ordering
     SortMounts(ctx->m_Mounts);
 
@@ -203,8 +212,13 @@ dmResource::Result RemoveAndUnmountByName(HContext ctx, const char* name)
         ArchiveMount& mount = ctx->m_Mounts[i];
         if (strcmp(mount.m_Name, name) == 0)
         {
-            dmResourceProvider::Unmount(mount.m_Archive);
-            return RemoveMountByIndexInternal(ctx, i);
+            dmResourceProvider::HArchive archive = mount.m_Archive;
+            dmResource::Result result = RemoveMountByIndexInternal(ctx, i);
+            if (dmResource::RESULT_OK == result)
+            {
+                dmResourceProvider::Unmount(archive);
+            }
+            return result;
         }
     }
     return dmResource::RESULT_RESOURCE_NOT_FOUND;
@@ -455,6 +469,60 @@ dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* pa
     return dmResource::RESULT_RESOURCE_NOT_FOUND;
 }
 
+dmResource::Result BorrowResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size, dmResourceProvider::HArchive* archive)
+{
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+    uint32_t size = ctx->m_Mounts.Size();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        ArchiveMount& mount = ctx->m_Mounts[i];
+        uint32_t resource_size;
+        dmResourceProvider::Result result = dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &resource_size);
+        if (dmResourceProvider::RESULT_NOT_FOUND == result)
+            continue;
+        if (dmResourceProvider::RESULT_OK != result)
+            return ProviderResultToResult(result);
+
+        // The first mount that has the resource decides if it can be borrowed
+        result = dmResourceProvider::GetFileData(mount.m_Archive, path_hash, path, data, data_size);
+        if (dmResourceProvider::RESULT_OK == result)
+        {
+            mount.m_BorrowCount++;
+            *archive = mount.m_Archive;
+            DM_RESOURCE_DBG_LOG(3, "BorrowResourceData: %s (%u bytes)\n", path, *data_size);
+            return dmResource::RESULT_OK;
+        }
+        if (dmResourceProvider::RESULT_NOT_SUPPORTED == result)
+            return dmResource::RESULT_NOT_SUPPORTED;
+        return ProviderResultToResult(result);
+    }
+
+    // The custom files are owned by the caller of AddFile, so they are read as usual
+    if (!ctx->m_CustomFiles.Empty() && ctx->m_CustomFiles.Get(path_hash))
+        return dmResource::RESULT_NOT_SUPPORTED;
+
+    return dmResource::RESULT_RESOURCE_NOT_FOUND;
+}
+
+void ReturnResourceData(HContext ctx, dmResourceProvider::HArchive archive)
+{
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+    uint32_t size = ctx->m_Mounts.Size();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        ArchiveMount& mount = ctx->m_Mounts[i];
+        if (mount.m_Archive == archive)
+        {
+            assert(mount.m_BorrowCount > 0);
+            mount.m_BorrowCount--;
+            return;
+        }
+    }
+    assert(false && "Archive of borrowed resource data is no longer mounted");
+}
+
 dmResource::Result ReadResource(HContext ctx, const char* path, dmhash_t path_hash, dmArray<char>* buffer)
 {
     DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
@@ -494,6 +562,60 @@ dmResource::Result ReadResource(HContext ctx, const char* path, dmhash_t path_ha
     return dmResource::RESULT_RESOURCE_NOT_FOUND;
 }
 
+dmResource::Result ReadResourceConcurrent(HContext ctx, dmhash_t path_hash, const char* path, dmArray<char>* buffer)
+{
+    dmResourceProvider::HArchive archive = 0;
+    uint32_t resource_size;
+    {
+        DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+        uint32_t size = ctx->m_Mounts.Size();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            ArchiveMount& mount = ctx->m_Mounts[i];
+            dmResourceProvider::Result result = dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &resource_size);
+            if (dmResourceProvider::RESULT_NOT_FOUND == result)
+                continue;
+            if (dmResourceProvider::RESULT_OK != result)
+                return ProviderResultToResult(result);
+
+            if (buffer->Capacity() < resource_size)
+                buffer->SetCapacity(resource_size);
+            buffer->SetSize(resource_size);
+
+            if (!dmResourceProvider::CanReadConcurrently(mount.m_Archive))
+            {
+                result = dmResourceProvider::ReadFile(mount.m_Archive, path_hash, path, (uint8_t*)buffer->Begin(), resource_size);
+                DM_RESOURCE_DBG_LOG(3, "ReadResourceConcurrent: %s (%u bytes) - result %d (locked)\n", path, resource_size, result);
+                return ProviderResultToResult(result);
+            }
+
+            // The mount can't be removed until the read is done (see ReturnResourceData)
+            mount.m_BorrowCount++;
+            archive = mount.m_Archive;
+            break;
+        }
+
+        if (!archive)
+        {
+            if (!ctx->m_CustomFiles.Empty() && dmResource::RESULT_OK == GetCustomResourceSize(ctx, path_hash, path, &resource_size))
+            {
+                if (buffer->Capacity() < resource_size)
+                    buffer->SetCapacity(resource_size);
+                buffer->SetSize(resource_size);
+
+                return ReadCustomResource(ctx, path_hash, (uint8_t*)buffer->Begin(), resource_size);
+            }
+            return dmResource::RESULT_RESOURCE_NOT_FOUND;
+        }
+    }
+
+    dmResourceProvider::Result result = dmResourceProvider::ReadFile(archive, path_hash, path, (uint8_t*)buffer->Begin(), resource_size);
+    DM_RESOURCE_DBG_LOG(3, "ReadResourceConcurrent: %s (%u bytes) - result %d\n", path, resource_size, result);
+    ReturnResourceData(ctx, archive);
+    return ProviderResultToResult(result);
+}
+
 // ****************************************
 // Custom files
 
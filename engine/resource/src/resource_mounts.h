@@ -51,6 +51,15 @@ namespace dmResourceMounts
     dmResource::Result GetResourceSize(HContext ctx, dmhash_t path_hash, const char* path, uint32_t* resource_size);
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size);
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, dmArray<char>* buffer);
+    // Only holds the lock while looking up the resource. If the provider supports it (see dmResourceProvider::CanReadConcurrently),
+    // the mount is pinned and the resource is read outside of the lock. Otherwise it's read with the lock held
+    dmResource::Result ReadResourceConcurrent(HContext ctx, dmhash_t path_hash, const char* path, dmArray<char>* buffer);
+
+    // Gets a read only pointer to the resource data in the archive, without copying it (see dmResourceProvider::GetFileData)
+    // The archive can't be removed until the data is returned with ReturnResourceData
+    // Returns RESULT_NOT_SUPPORTED if the resource must be read with ReadResource
+    dmResource::Result BorrowResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size, dmResourceProvider::HArchive* archive);
+    void ReturnResourceData(HContext ctx, dmResourceProvider::HArchive archive);
 
     struct SGetMountResult
     {
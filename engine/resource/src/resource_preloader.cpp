@@ -134,6 +134,8 @@ struct PreloadRequest
     // Set for items that are pending and waiting for children to complete
     void* m_Buffer;
     uint32_t m_BufferSize;
+    // Set if m_Buffer is borrowed from an archive, rather than allocated from m_BlockAllocator
+    dmResourceProvider::HArchive m_BorrowedArchive;
 
     // Set once preload function has run
     void* m_PreloadData;
@@ -546,7 +548,15 @@ namespace dmResource
             params.m_BufferSize               = req->m_BufferSize;
             req->m_LoadResult                 = (Result)resource_type->m_CreateFunction(&params);
 
-            dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            if (req->m_BorrowedArchive)
+            {
+                ReturnBorrowedResource(preloader->m_Factory, req->m_BorrowedArchive);
+                req->m_BorrowedArchive = 0;
+            }
+            else
+            {
+                dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            }
 
             req->m_Buffer = 0;
         }
@@ -734,9 +744,22 @@ namespace dmResource
             UnmarkPathInProgress(preloader, &req->m_PathDescriptor);
             dmLoadQueue::FreeLoad(preloader->m_LoadQueue, req->m_LoadRequest);
             req->m_LoadRequest = 0;
+            if (load_result.m_BorrowedArchive)
+            {
+                ReturnBorrowedResource(preloader->m_Factory, load_result.m_BorrowedArchive);
+            }
 
             PreloaderTryPruneParent(preloader, req);
         }
+        else if (load_result.m_BorrowedArchive)
+        {
+            // Keep the borrowed data until we have loaded all children, it stays valid after FreeLoad
+            req->m_Buffer          = buffer;
+            req->m_BufferSize      = buffer_size;
+            req->m_BorrowedArchive = load_result.m_BorrowedArchive;
+            dmLoadQueue::FreeLoad(preloader->m_LoadQueue, req->m_LoadRequest);
+            req->m_LoadRequest = 0;
+        }
         else
         {
             // Keep the loaded bytes until we have loaded all children
@@ -864,6 +887,7 @@ namespace dmResource
         info.m_HintInfo.m_Parent    = index;
         info.m_CompleteFunction     = req->m_PathDescriptor.m_ResourceType->m_PreloadFunction;
         info.m_Context              = req->m_PathDescriptor.m_ResourceType->m_Context;
+        info.m_BorrowBuffer         = req->m_PathDescriptor.m_ResourceType->m_BorrowBuffer;
 
         // If we can't add the request to the load queue it is because the queue is full
         // We will try again once we completed loading of an item via dmLoadQueue::EndLoad
@@ -76,6 +76,7 @@ struct ResourceType
     FResourceDestroy    m_DestroyFunction;
     FResourceRecreate   m_RecreateFunction;
     uint8_t             m_Index;
+    bool                m_BorrowBuffer; // See ResourceTypeSetBorrowBuffer
 };
 
 struct ResourceTypeContext
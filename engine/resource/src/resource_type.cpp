@@ -81,6 +81,11 @@ void ResourceTypeSetRecreateFn(HResourceType type, FResourceRecreate fn)
     type->m_RecreateFunction = fn;
 }
 
+void ResourceTypeSetBorrowBuffer(HResourceType type, bool borrow)
+{
+    type->m_BorrowBuffer = borrow;
+}
+
 
 TypeCreatorDesc* g_ResourceTypeCreatorDescFirst = 0;
 
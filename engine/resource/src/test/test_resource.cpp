@@ -793,6 +793,61 @@ TEST_P(GetResourceTest, PreloadGetList)
 }
 
 
+TEST_P(GetResourceTest, PreloadGetListLoadThreads)
+{
+    // Same as PreloadGetList, but with several threads loading at the same time
+    const char* test_dir = "build/src/test";
+    dmResource::DeleteFactory(m_Factory);
+    dmResource::NewFactoryParams params;
+    params.m_MaxResources = 16;
+    params.m_LoadThreadCount = 4;
+    m_Factory = dmResource::NewFactory(&params, test_dir);
+    ASSERT_NE((void*) 0, m_Factory);
+    ASSERT_EQ(4u, dmResource::GetLoadThreadCount(m_Factory));
+
+    dmResource::Result e;
+    e = dmResource::RegisterType(m_Factory, "cont", this, &ResourceContainerPreload, &ResourceContainerCreate, 0, &ResourceContainerDestroy, 0);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+    e = dmResource::RegisterType(m_Factory, "foo", this, 0, &FooResourceCreate, &FooResourcePostCreate, &FooResourceDestroy, 0);
+    ASSERT_EQ(dmResource::RESULT_OK, e);
+
+    const char* resource_names_list[] = { m_ResourceName, "/test_ref.cont" };
+    dmArray<const char*> resource_names(resource_names_list, 2, 3);
+    const char* subresource_name = "/test01.foo";
+
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        dmResource::HPreloader pr = dmResource::NewPreloader(m_Factory, resource_names);
+
+        dmResource::Result r;
+        for (uint32_t j = 0; j < 33; ++j)
+        {
+            r = dmResource::UpdatePreloader(pr, 0, 0, 30*1000);
+            if (r == dmResource::RESULT_PENDING)
+                dmTime::Sleep(30000);
+            else
+                break;
+        }
+        ASSERT_EQ(dmResource::RESULT_OK, r);
+
+        // The preloader holds two references to subresources referenced by two parents
+        HResourceDescriptor descriptor;
+        e = dmResource::GetDescriptor(m_Factory, m_ResourceName, &descriptor);
+        ASSERT_EQ(dmResource::RESULT_OK, e);
+        ASSERT_EQ((uint32_t) 1, descriptor->m_ReferenceCount);
+        e = dmResource::GetDescriptor(m_Factory, subresource_name, &descriptor);
+        ASSERT_EQ(dmResource::RESULT_OK, e);
+        ASSERT_EQ((uint32_t) 2, descriptor->m_ReferenceCount);
+
+        dmResource::DeletePreloader(pr);
+
+        e = dmResource::GetDescriptor(m_Factory, m_ResourceName, &descriptor);
+        ASSERT_EQ(dmResource::RESULT_NOT_LOADED, e);
+    }
+    ASSERT_EQ(m_FooResourceCreateCallCount, m_FooResourceDestroyCallCount);
+}
+
+
 TEST_P(GetResourceTest, PreloadGetParallell)
 {
     // Race preloaders against eachother with the same Factory
@@ -22,7 +22,10 @@
 #include "../providers/provider_archive_private.h"
 #include <dlib/dstrings.h>
 #include <dlib/endian.h>
+#include <dlib/atomic.h>
 #include <dlib/sys.h>
+#include <dlib/thread.h>
+#include <dlib/time.h>
 #include <dlib/testutil.h>
 #include <testmain/testmain.h>
 
@@ -678,6 +681,59 @@ TEST(dmResourceArchive, Wrap_Compressed)
     dmResourceArchive::Delete(archive);
 }
 
+TEST(dmResourceArchive, GetEntryData)
+{
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveBuffer((void*) RESOURCES_COMPRESSED_ARCI, RESOURCES_COMPRESSED_ARCI_SIZE, true, (void*) RESOURCES_COMPRESSED_ARCD, RESOURCES_COMPRESSED_ARCD_SIZE, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    dmResourceArchive::EntryData* entry;
+    for (uint32_t i = 0; i < (sizeof(path_hash) / sizeof(path_hash[0])); ++i)
+    {
+        if (IsLiveUpdateResource(path_hash[i])) continue;
+
+        result = dmResourceArchive::FindEntry(archive, compressed_content_hash[i], sizeof(compressed_content_hash[i]), &entry);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+        const void* data = 0;
+        uint32_t size = 0;
+        result = dmResourceArchive::GetEntryData(archive, entry, &data, &size);
+
+        // Only data that is stored as-is can be used without copying
+        uint32_t flags = dmEndian::ToNetwork(entry->m_Flags);
+        if (flags & (dmResourceArchive::ENTRY_FLAG_COMPRESSED | dmResourceArchive::ENTRY_FLAG_ENCRYPTED))
+        {
+            ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, result);
+            continue;
+        }
+
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        ASSERT_GE((const uint8_t*) data, (const uint8_t*) RESOURCES_COMPRESSED_ARCD);
+        ASSERT_LE((const uint8_t*) data + size, (const uint8_t*) RESOURCES_COMPRESSED_ARCD + RESOURCES_COMPRESSED_ARCD_SIZE);
+        ASSERT_EQ(strlen(content[i]), size);
+        ASSERT_EQ(0, memcmp(content[i], data, size));
+    }
+
+    dmResourceArchive::Delete(archive);
+
+    // Archives that aren't memory mapped must always be read
+    char archive_path[512];
+    char resource_path[512];
+    dmTestUtil::MakeHostPath(archive_path, sizeof(archive_path), "build/src/test/resources.arci");
+    dmTestUtil::MakeHostPath(resource_path, sizeof(resource_path), "build/src/test/resources.arcd");
+    result = dmResourceArchive::LoadArchiveFromFile(archive_path, resource_path, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    result = dmResourceArchive::FindEntry(archive, content_hash[0], sizeof(content_hash[0]), &entry);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    const void* data = 0;
+    uint32_t size = 0;
+    ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, dmResourceArchive::GetEntryData(archive, entry, &data, &size));
+
+    dmResourceArchive::Delete(archive);
+}
+
 TEST(dmResourceArchive, LoadFromDisk)
 {
     dmResourceArchive::HArchiveIndexContainer archive = 0;
@@ -758,6 +814,231 @@ TEST(dmResourceArchive, LoadFromDisk_Compressed)
     dmResourceArchive::Delete(archive);
 }
 
+struct ReadEntryThreadContext
+{
+    dmResourceArchive::HArchiveIndexContainer m_Archive;
+    int32_atomic_t                            m_Errors;
+};
+
+static void ReadEntryThread(void* _ctx)
+{
+    ReadEntryThreadContext* ctx = (ReadEntryThreadContext*) _ctx;
+    for (uint32_t n = 0; n < 200; ++n)
+    {
+        for (uint32_t i = 0; i < sizeof(path_name)/sizeof(path_name[0]); ++i)
+        {
+            if (IsLiveUpdateResource(path_hash[i])) continue;
+
+            char buffer[1024] = { 0 };
+            dmResourceArchive::EntryData* entry;
+            if (dmResourceArchive::FindEntry(ctx->m_Archive, compressed_content_hash[i], sizeof(compressed_content_hash[i]), &entry) != dmResourceArchive::RESULT_OK ||
+                dmResourceArchive::ReadEntry(ctx->m_Archive, entry, buffer) != dmResourceArchive::RESULT_OK ||
+                strcmp(content[i], buffer) != 0)
+            {
+                dmAtomicIncrement32(&ctx->m_Errors);
+            }
+        }
+    }
+}
+
+TEST(dmResourceArchive, LoadFromDisk_ReadThreads)
+{
+    // The archive is read from several threads at once, each with its own file handle and decompression buffer
+    char archive_path[512];
+    char resource_path[512];
+    dmTestUtil::MakeHostPath(archive_path, sizeof(archive_path), "build/src/test/resources_compressed.arci");
+    dmTestUtil::MakeHostPath(resource_path, sizeof(resource_path), "build/src/test/resources_compressed.arcd");
+
+    ReadEntryThreadContext ctx;
+    ctx.m_Archive = 0;
+    ctx.m_Errors = 0;
+    dmResourceArchive::Result result = dmResourceArchive::LoadArchiveFromFile(archive_path, resource_path, &ctx.m_Archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+    const uint32_t thread_count = 4;
+    dmThread::Thread threads[thread_count];
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        threads[i] = dmThread::New(ReadEntryThread, 0x80000, &ctx, "ReadEntryThread");
+    }
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        dmThread::Join(threads[i]);
+    }
+
+    ASSERT_EQ(0, dmAtomicGet32(&ctx.m_Errors));
+
+    dmResourceArchive::Delete(ctx.m_Archive);
+}
+
+static int CompareHashes(const void* a, const void* b)
+{
+    return memcmp(a, b, dmResourceArchive::MAX_HASH);
+}
+
+// Creates an archive index with 'count' random (sorted) hashes. Every fourth hash shares the first 8 bytes with the previous one.
+// The resource data offset of each entry is set to the entry index.
+static dmResourceArchive::ArchiveIndex* CreateRandomArchiveIndex(uint32_t count, uint32_t hash_length, uint32_t* index_size)
+{
+    uint32_t hashes_size = count * dmResourceArchive::MAX_HASH;
+    uint32_t size = sizeof(dmResourceArchive::ArchiveIndex) + hashes_size + count * sizeof(dmResourceArchive::EntryData);
+    uint8_t* data = new uint8_t[size];
+    memset(data, 0, size);
+
+    dmResourceArchive::ArchiveIndex* ai = (dmResourceArchive::ArchiveIndex*) data;
+    ai->m_Version = dmEndian::ToHost(dmResourceArchive::VERSION);
+    ai->m_EntryDataCount = dmEndian::ToHost(count);
+    ai->m_HashOffset = dmEndian::ToHost((uint32_t)sizeof(dmResourceArchive::ArchiveIndex));
+    ai->m_EntryDataOffset = dmEndian::ToHost((uint32_t)(sizeof(dmResourceArchive::ArchiveIndex) + hashes_size));
+    ai->m_HashLength = dmEndian::ToHost(hash_length);
+
+    uint8_t* hashes = data + sizeof(dmResourceArchive::ArchiveIndex);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint8_t* h = hashes + i * dmResourceArchive::MAX_HASH;
+        for (uint32_t j = 0; j < hash_length; ++j)
+            h[j] = (uint8_t) rand();
+        if (i > 0 && (i % 4) == 0)
+            memcpy(h, h - dmResourceArchive::MAX_HASH, 8);
+    }
+    qsort(hashes, count, dmResourceArchive::MAX_HASH, CompareHashes);
+
+    dmResourceArchive::EntryData* entries = (dmResourceArchive::EntryData*) (hashes + hashes_size);
+    for (uint32_t i = 0; i < count; ++i)
+        entries[i].m_ResourceDataOffset = dmEndian::ToHost(i);
+
+    *index_size = size;
+    return ai;
+}
+
+static void CheckFindEntry(dmResourceArchive::HArchiveIndexContainer archive, dmResourceArchive::ArchiveIndex* ai, uint32_t count, uint32_t hash_length)
+{
+    const uint8_t* hashes = (const uint8_t*) ai + sizeof(dmResourceArchive::ArchiveIndex);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint8_t* h = hashes + i * dmResourceArchive::MAX_HASH;
+        dmResourceArchive::EntryData* entry = 0;
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, dmResourceArchive::FindEntry(archive, h, hash_length, &entry));
+        ASSERT_EQ(i, dmEndian::ToNetwork(entry->m_ResourceDataOffset));
+
+        // Hashes that sort just before and after the existing one
+        uint8_t missing[dmResourceArchive::MAX_HASH];
+        memcpy(missing, h, hash_length);
+        missing[hash_length - 1] ^= 0x01;
+        dmResourceArchive::Result expected = dmResourceArchive::RESULT_NOT_FOUND;
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            if (memcmp(missing, hashes + j * dmResourceArchive::MAX_HASH, hash_length) == 0)
+                expected = dmResourceArchive::RESULT_OK;
+        }
+        ASSERT_EQ(expected, dmResourceArchive::FindEntry(archive, missing, hash_length, 0));
+    }
+
+    uint8_t first[dmResourceArchive::MAX_HASH];
+    uint8_t last[dmResourceArchive::MAX_HASH];
+    memset(first, 0x00, sizeof(first));
+    memset(last, 0xff, sizeof(last));
+    if (count == 0 || memcmp(first, hashes, hash_length) != 0)
+        ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, dmResourceArchive::FindEntry(archive, first, hash_length, 0));
+    if (count == 0 || memcmp(last, hashes + (count - 1) * dmResourceArchive::MAX_HASH, hash_length) != 0)
+        ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, dmResourceArchive::FindEntry(archive, last, hash_length, 0));
+}
+
+TEST(dmResourceArchive, FindEntryLookup)
+{
+    srand(1234);
+
+    // All tree shapes up to a few levels, with and without the lookup
+    for (uint32_t count = 0; count < 70; ++count)
+    {
+        uint32_t index_size = 0;
+        dmResourceArchive::ArchiveIndex* ai = CreateRandomArchiveIndex(count, 20, &index_size);
+
+        dmResourceArchive::HArchiveIndexContainer archive = 0;
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, dmResourceArchive::WrapArchiveBuffer(ai, index_size, true, 0, 0, true, &archive));
+        ASSERT_EQ(count, archive->m_LookupCount);
+        ASSERT_EQ(count > 0, archive->m_LookupPrefixes != 0);
+
+        CheckFindEntry(archive, ai, count, 20);
+
+        dmResourceArchive::DeleteLookup(archive);
+        CheckFindEntry(archive, ai, count, 20);
+
+        dmResourceArchive::Delete(archive);
+        delete[] (uint8_t*) ai;
+    }
+}
+
+TEST(dmResourceArchive, FindEntryLookup_ModifiedIndex)
+{
+    srand(1234);
+
+    uint32_t index_size = 0;
+    dmResourceArchive::ArchiveIndex* ai = CreateRandomArchiveIndex(16, 20, &index_size);
+
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, dmResourceArchive::WrapArchiveBuffer(ai, index_size, true, 0, 0, true, &archive));
+
+    // The lookup no longer matches the index, and should be ignored
+    ai->m_EntryDataCount = dmEndian::ToHost(15U);
+    CheckFindEntry(archive, ai, 15, 20);
+    const uint8_t* last_hash = (const uint8_t*) ai + sizeof(dmResourceArchive::ArchiveIndex) + 15 * dmResourceArchive::MAX_HASH;
+    ASSERT_EQ(dmResourceArchive::RESULT_NOT_FOUND, dmResourceArchive::FindEntry(archive, last_hash, 20, 0));
+
+    dmResourceArchive::Delete(archive);
+    delete[] (uint8_t*) ai;
+}
+
+TEST(dmResourceArchive, FindEntryPerf)
+{
+    srand(1234);
+
+    const uint32_t count = 100000;
+    uint32_t index_size = 0;
+    dmResourceArchive::ArchiveIndex* ai = CreateRandomArchiveIndex(count, 20, &index_size);
+    const uint8_t* hashes = (const uint8_t*) ai + sizeof(dmResourceArchive::ArchiveIndex);
+
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, dmResourceArchive::WrapArchiveBuffer(ai, index_size, true, 0, 0, true, &archive));
+
+    // Look up the entries in random order, as when loading a collection
+    uint32_t* order = new uint32_t[count];
+    for (uint32_t i = 0; i < count; ++i)
+        order[i] = i;
+    for (uint32_t i = count - 1; i > 0; --i)
+    {
+        uint32_t j = (uint32_t) rand() % (i + 1);
+        uint32_t tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+
+    uint64_t times[2];
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        if (pass == 1)
+            dmResourceArchive::DeleteLookup(archive);
+
+        uint32_t found = 0;
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            dmResourceArchive::EntryData* entry = 0;
+            if (dmResourceArchive::FindEntry(archive, hashes + order[i] * dmResourceArchive::MAX_HASH, 20, &entry) == dmResourceArchive::RESULT_OK &&
+                dmEndian::ToNetwork(entry->m_ResourceDataOffset) == order[i])
+            {
+                ++found;
+            }
+        }
+        times[pass] = dmTime::GetTime() - start;
+        ASSERT_EQ(count, found);
+    }
+
+    printf("FindEntry: %u lookups | lookup: %7.3f ms | binary search: %7.3f ms | x%.2f\n", count,
+            times[0] * 0.001f, times[1] * 0.001f, times[0] ? times[1] / (float) times[0] : 0.0f);
+
+    delete[] order;
+    dmResourceArchive::Delete(archive);
+    delete[] (uint8_t*) ai;
+}
 
 static dmResource::Result TestDecryption(void* buffer, uint32_t buffer_len)
 {
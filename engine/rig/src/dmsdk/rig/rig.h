@@ -133,8 +133,41 @@ namespace dmRig
         float m_Length;
     };
 
+    // Bone index of each track in each animation of an animation set, so that sampling an
+    // animation doesn't have to look up the bone of each track by its id.
+    struct TrackBoneIndices
+    {
+        TrackBoneIndices() : m_AnimationSet(0x0), m_Skeleton(0x0), m_BoneCount(0) {}
+
+        /// The animation set and the skeleton the table was created for. The table is only used
+        /// by instances with the same animation set and skeleton, so that a reloaded skeleton
+        /// doesn't use stale bone indices.
+        const dmRigDDF::AnimationSet* m_AnimationSet;
+        const dmRigDDF::Skeleton*     m_Skeleton;
+        uint32_t                      m_BoneCount;
+        /// Index of the first track of each animation in m_BoneIndices
+        dmArray<uint32_t>             m_AnimationOffsets;
+        /// Bone index per track, INVALID_BONE_INDEX if the bone isn't part of the skeleton
+        dmArray<uint32_t>             m_BoneIndices;
+    };
+
     struct NewContextParams {
         uint32_t     m_MaxRigInstanceCount;
+        /// Share the evaluated poses (and pose matrices) between instances playing the same animation
+        /// at the same sample time. The sample times are quantized to 1/POSE_CACHE_SAMPLE_STEPS of the
+        /// animation sample interval when enabled.
+        bool         m_PoseCache;
+    };
+
+    /// Number of steps each animation sample interval is quantized into when the pose cache is enabled
+    static const uint32_t POSE_CACHE_SAMPLE_STEPS = 64;
+
+    struct PoseCacheStats
+    {
+        /// Number of instances that reused a pose evaluated by another instance during the last update
+        uint32_t m_Hits;
+        /// Number of poses evaluated during the last update
+        uint32_t m_Misses;
     };
 
     typedef void (*RigEventCallback)(RigEventType, void*, void* userdata1, void* userdata2);
@@ -150,6 +183,7 @@ namespace dmRig
         const dmRigDDF::Skeleton*       m_Skeleton;
         const dmRigDDF::MeshSet*        m_MeshSet;
         const dmRigDDF::AnimationSet*   m_AnimationSet;
+        const TrackBoneIndices*         m_TrackBoneIndices; // Optional, the bone indices are looked up per track if not set
 
         RigPoseCallback               m_PoseCallback;
         void*                         m_PoseCBUserData1;
@@ -164,6 +198,7 @@ namespace dmRig
     Result NewContext(const NewContextParams& params, HRigContext* context);
     void DeleteContext(HRigContext context);
     Result Update(HRigContext context, float dt);
+    void GetPoseCacheStats(HRigContext context, PoseCacheStats* stats);
 
     Result InstanceCreate(HRigContext context, const InstanceCreateParams& params, HRigInstance* instance);
     Result InstanceDestroy(HRigContext context, HRigInstance instance);
@@ -198,6 +233,15 @@ namespace dmRig
     // Util function used to fill a bind pose array from skeleton data
     // used in rig tests and loading rig resources.
     void CopyBindPose(dmRigDDF::Skeleton& skeleton, dmArray<RigBone>& bind_pose);
+
+    // Util function used to fill the track to bone index table of an animation set
+    // used in rig tests and loading rig resources.
+    void CreateTrackBoneIndices(const dmRigDDF::Skeleton& skeleton, const dmRigDDF::AnimationSet& animation_set, const dmHashTable64<uint32_t>& bone_indices, TrackBoneIndices& track_bone_indices);
+
+    // Util function used to normalize the bone weights of the skinned meshes, so that each vertex
+    // has exactly four influences summing up to one (unused influences get bone index 0 and weight 0).
+    // Used in rig tests and loading rig resources.
+    void NormalizeBoneWeights(dmRigDDF::MeshSet& mesh_set);
 }
 
 #endif // DMSDK_RIG_H
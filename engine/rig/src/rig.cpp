@@ -15,10 +15,12 @@
 #include "rig.h"
 #include "rig_private.h"
 
+#include <dlib/hash.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/profile.h>
+#include <dlib/simd.h>
 #include <dmsdk/dlib/object_pool.h>
 #include <graphics/graphics.h>
 
@@ -28,19 +30,66 @@
 namespace dmRig
 {
     using namespace dmVMath;
+    using namespace dmSimd;
 
     static const dmhash_t NULL_ANIMATION = dmHashString64("");
     static const float CURSOR_EPSILON = 0.0001f;
 
-    static void DoAnimate(HRigContext context, RigInstance* instance, float dt);
+    DM_PROPERTY_GROUP(rmtp_Rig, "Rig");
+    DM_PROPERTY_U32(rmtp_RigPoseCacheHits, 0, FrameReset, "# poses reused from the pose cache", &rmtp_Rig);
+    DM_PROPERTY_U32(rmtp_RigPoseCacheMisses, 0, FrameReset, "# poses evaluated", &rmtp_Rig);
+
+    static const uint32_t INVALID_OFFSET = 0xFFFFFFFF;
+
+    // Everything the evaluated pose of an instance depends on
+    struct PoseCacheKey
+    {
+        const dmRigDDF::Skeleton*       m_Skeleton;
+        const dmHashTable64<uint32_t>*  m_BoneIndices;
+        const dmArray<RigBone>*         m_BindPose;
+        const dmRigDDF::RigAnimation*   m_Animations[2];
+        // Quantized sample time per player (sample * POSE_CACHE_SAMPLE_STEPS + step)
+        uint32_t                        m_SampleTimes[2];
+        // Quantized fade rate when blending, and the current player index
+        uint32_t                        m_Blend;
+        uint32_t                        m_CurrentPlayer;
+    };
+
+    struct PoseCacheEntry
+    {
+        PoseCacheKey m_Key;
+        // Offset into PoseCache::m_Poses
+        uint32_t     m_PoseOffset;
+        uint32_t     m_BoneCount;
+        // Offset into PoseCache::m_PoseMatrices, INVALID_OFFSET until the first instance is rendered
+        uint32_t     m_MatrixOffset;
+    };
+
+    // Poses evaluated during the current update, shared between the instances with the same key
+    struct PoseCache
+    {
+        dmHashTable64<uint32_t>         m_EntryIndices; // key hash -> index into m_Entries
+        dmArray<PoseCacheEntry>         m_Entries;
+        dmArray<BonePose>               m_Poses;
+        dmArray<dmVMath::Matrix4>       m_PoseMatrices;
+        uint32_t                        m_Hits;
+        uint32_t                        m_Misses;
+    };
+
+    static void DoAnimate(HRigContext context, RigInstance* instance, float dt, PoseCache* pose_cache);
     static bool DoPostUpdate(RigInstance* instance);
 
     struct RigContext
     {
         dmObjectPool<HRigInstance>      m_Instances;
+        // Shared poses, only used if enabled in NewContextParams
+        PoseCache                       m_PoseCache;
+        bool                            m_UsePoseCache;
         // Temporary scratch buffers used for store pose as transform and matrices
         // (avoids modifying the real pose transform data during rendering).
         dmArray<dmVMath::Matrix4>       m_ScratchPoseMatrixBuffer;
+        // Pose matrices premultiplied with the model or normal matrix, used when skinning the vertices
+        dmArray<dmVMath::Matrix4>       m_ScratchSkinMatrixBuffer;
         // Temporary scratch buffers used when transforming the vertex buffer,
         // used to creating primitives from indices.
         dmArray<dmVMath::Vector3>       m_ScratchPositionBuffer;
@@ -58,6 +107,9 @@ namespace dmRig
 
         context->m_Instances.SetCapacity(params.m_MaxRigInstanceCount);
         context->m_ScratchPoseMatrixBuffer.SetCapacity(0);
+        context->m_UsePoseCache = params.m_PoseCache;
+        context->m_PoseCache.m_Hits = 0;
+        context->m_PoseCache.m_Misses = 0;
         *out = context;
         return dmRig::RESULT_OK;
     }
@@ -387,29 +439,61 @@ namespace dmRig
         return t;
     }
 
-    static void ApplyAnimation(RigInstance* instance, RigPlayer* player, dmArray<BonePose>& pose, dmArray<IKAnimation>& ik_animation, float blend_weight)
+    // Returns the bone index of each track of the animation, or 0 if the instance has no table for its animation set and skeleton
+    static const uint32_t* GetTrackBoneIndices(const RigInstance* instance, const dmRigDDF::RigAnimation* animation)
+    {
+        const TrackBoneIndices* table = instance->m_TrackBoneIndices;
+        if (!table || table->m_AnimationSet != instance->m_AnimationSet)
+            return 0;
+        // The bone count also catches a reloaded skeleton that was allocated at the same address
+        if (table->m_Skeleton != instance->m_Skeleton || table->m_BoneCount != instance->m_Skeleton->m_Bones.m_Count)
+            return 0;
+
+        uint32_t animation_index = (uint32_t)(animation - instance->m_AnimationSet->m_Animations.m_Data);
+        if (animation_index >= table->m_AnimationOffsets.Size())
+            return 0;
+        return table->m_BoneIndices.Begin() + table->m_AnimationOffsets[animation_index];
+    }
+
+    // Calculates the sample at the cursor of the player, and the fraction towards the next sample
+    static void GetSampleTime(RigPlayer* player, uint32_t* sample, float* fraction)
     {
         const dmRigDDF::RigAnimation* animation = player->m_Animation;
-        if (!animation)
-            return;
         float duration = GetCursorDuration(player, animation);
         float t = CursorToTime(player->m_Cursor, duration, player->m_Backwards, player->m_Playback == dmRig::PLAYBACK_ONCE_PINGPONG);
 
-        float fraction = t * animation->m_SampleRate;
-        uint32_t sample = (uint32_t)fraction;
-        fraction -= sample;
+        float f = t * animation->m_SampleRate;
+        *sample = (uint32_t)f;
+        *fraction = f - *sample;
+    }
+
+    static void ApplyAnimation(RigInstance* instance, const dmRigDDF::RigAnimation* animation, uint32_t sample, float fraction, dmArray<BonePose>& pose, float blend_weight)
+    {
+        if (!animation)
+            return;
         // Sample animation tracks
         const dmHashTable64<uint32_t>* bone_indices = instance->m_BoneIndices;
+        const uint32_t* track_bone_indices = GetTrackBoneIndices(instance, animation);
         uint32_t track_count = animation->m_Tracks.m_Count;
         for (uint32_t ti = 0; ti < track_count; ++ti)
         {
             const dmRigDDF::AnimationTrack* track = &animation->m_Tracks[ti];
 
-            const uint32_t* bone_index = bone_indices->Get(track->m_BoneId);
-            if (!bone_index || *bone_index >= pose.Size()) {
+            uint32_t bone_index = INVALID_BONE_INDEX;
+            if (track_bone_indices)
+            {
+                bone_index = track_bone_indices[ti];
+            }
+            else
+            {
+                const uint32_t* bone_index_ptr = bone_indices->Get(track->m_BoneId);
+                if (bone_index_ptr)
+                    bone_index = *bone_index_ptr;
+            }
+            if (bone_index >= pose.Size()) {
                 continue;
             }
-            dmTransform::Transform& transform = pose[*bone_index].m_Local;
+            dmTransform::Transform& transform = pose[bone_index].m_Local;
 
             if (track->m_Positions.m_Count > 0)
             {
@@ -444,16 +528,82 @@ namespace dmRig
         }
     }
 
+    static void ClearPoseCache(PoseCache* cache)
+    {
+        cache->m_EntryIndices.Clear();
+        cache->m_Entries.SetSize(0);
+        cache->m_Poses.SetSize(0);
+        cache->m_PoseMatrices.SetSize(0);
+        cache->m_Hits = 0;
+        cache->m_Misses = 0;
+    }
+
+    // Returns the index of the entry with the key, or INVALID_OFFSET if there is none
+    static uint32_t FindCachedPose(const PoseCache* cache, const PoseCacheKey& key, uint64_t key_hash)
+    {
+        const uint32_t* index = cache->m_EntryIndices.Get(key_hash);
+        if (!index || memcmp(&cache->m_Entries[*index].m_Key, &key, sizeof(key)) != 0)
+            return INVALID_OFFSET;
+        return *index;
+    }
+
+    // Returns the index of the new entry, or INVALID_OFFSET if the key hash is already used by another key
+    static uint32_t StorePose(PoseCache* cache, const PoseCacheKey& key, uint64_t key_hash, const dmArray<BonePose>& pose)
+    {
+        if (cache->m_EntryIndices.Get(key_hash))
+            return INVALID_OFFSET;
+
+        if (cache->m_EntryIndices.Full())
+        {
+            uint32_t capacity = cache->m_EntryIndices.Capacity() + 64;
+            cache->m_EntryIndices.SetCapacity((capacity * 2) / 3, capacity);
+            cache->m_Entries.SetCapacity(capacity);
+        }
+
+        uint32_t bone_count = pose.Size();
+        if (cache->m_Poses.Remaining() < bone_count)
+        {
+            cache->m_Poses.OffsetCapacity(dmMath::Max(bone_count, cache->m_Poses.Capacity()));
+        }
+
+        PoseCacheEntry entry;
+        entry.m_Key = key;
+        entry.m_PoseOffset = cache->m_Poses.Size();
+        entry.m_BoneCount = bone_count;
+        entry.m_MatrixOffset = INVALID_OFFSET;
+
+        cache->m_Poses.SetSize(entry.m_PoseOffset + bone_count);
+        memcpy(cache->m_Poses.Begin() + entry.m_PoseOffset, pose.Begin(), sizeof(BonePose) * bone_count);
+
+        uint32_t index = cache->m_Entries.Size();
+        cache->m_Entries.Push(entry);
+        cache->m_EntryIndices.Put(key_hash, index);
+        return index;
+    }
+
     static void Animate(HRigContext context, float dt)
     {
         DM_PROFILE("RigAnimate");
 
+        PoseCache* pose_cache = 0;
+        if (context->m_UsePoseCache)
+        {
+            pose_cache = &context->m_PoseCache;
+            ClearPoseCache(pose_cache);
+        }
+
         const dmArray<RigInstance*>& instances = context->m_Instances.GetRawObjects();
         uint32_t n = instances.Size();
         for (uint32_t i = 0; i < n; ++i)
         {
             RigInstance* instance = instances[i];
-            DoAnimate(context, instance, dt);
+            DoAnimate(context, instance, dt, pose_cache);
+        }
+
+        if (pose_cache)
+        {
+            DM_PROPERTY_ADD_U32(rmtp_RigPoseCacheHits, pose_cache->m_Hits);
+            DM_PROPERTY_ADD_U32(rmtp_RigPoseCacheMisses, pose_cache->m_Misses);
         }
     }
 
@@ -491,8 +641,18 @@ namespace dmRig
         }
     }
 
-    static void DoAnimate(HRigContext context, RigInstance* instance, float dt)
+    // Quantizes the sample time so that instances at nearly the same cursor share the same key, returns the key value
+    static uint32_t QuantizeSampleTime(uint32_t sample, float* fraction)
     {
+        uint32_t step = (uint32_t)(*fraction * POSE_CACHE_SAMPLE_STEPS);
+        *fraction = step * (1.0f / POSE_CACHE_SAMPLE_STEPS);
+        return sample * POSE_CACHE_SAMPLE_STEPS + step;
+    }
+
+    static void DoAnimate(HRigContext context, RigInstance* instance, float dt, PoseCache* pose_cache)
+    {
+        instance->m_PoseCacheEntry = 0;
+
         // NOTE we previously checked for (!instance->m_Enabled || !instance->m_AddedToUpdate) here also
         RigPlayer* player = GetPlayer(instance);
 
@@ -501,9 +661,6 @@ namespace dmRig
 
         const dmRigDDF::Skeleton* skeleton = instance->m_Skeleton;
 
-        dmArray<BonePose>& pose = instance->m_Pose;
-        ResetPose(skeleton, pose);
-
         // Reset IK animation
         dmArray<IKAnimation>& ik_animation = instance->m_IKAnimation;
         uint32_t ik_animation_count = ik_animation.Size();
@@ -516,11 +673,12 @@ namespace dmRig
 
         UpdateBlend(instance, dt);
 
+        // The players that contribute to the pose, in the order they are applied
+        RigPlayer* players[2] = { player, 0x0 };
+        float fade_rate = 0.0f;
         if (instance->m_Blending)
         {
-            float fade_rate = instance->m_BlendTimer / instance->m_BlendDuration;
-            // How much to blend the pose, 1 first time to overwrite the bind pose, either fade_rate or 1 - fade_rate second depending on which one is the current player
-            float alpha = 1.0f;
+            fade_rate = instance->m_BlendTimer / instance->m_BlendDuration;
             for (uint32_t pi = 0; pi < 2; ++pi)
             {
                 RigPlayer* p = &instance->m_Players[pi];
@@ -531,26 +689,78 @@ namespace dmRig
                 }
 
                 UpdatePlayer(instance, p, dt, blend_weight);
-                ApplyAnimation(instance, p, pose, ik_animation, alpha);
-                if (player == p)
-                {
-                    alpha = 1.0f - fade_rate;
-                }
-                else
-                {
-                    alpha = fade_rate;
-                }
+                players[pi] = p;
             }
         }
         else
         {
             UpdatePlayer(instance, player, dt, 1.0f);
-            ApplyAnimation(instance, player, pose, ik_animation, 1.0f);
         }
 
-        // Normalize quaternions while we blend
+        const dmRigDDF::RigAnimation* animations[2] = { 0x0, 0x0 };
+        uint32_t samples[2] = { 0, 0 };
+        float fractions[2] = { 0.0f, 0.0f };
+        for (uint32_t pi = 0; pi < 2; ++pi)
+        {
+            if (players[pi] && players[pi]->m_Animation)
+            {
+                animations[pi] = players[pi]->m_Animation;
+                GetSampleTime(players[pi], &samples[pi], &fractions[pi]);
+            }
+        }
+
+        PoseCacheKey key;
+        uint64_t key_hash = 0;
+        if (pose_cache)
+        {
+            memset(&key, 0, sizeof(key));
+            key.m_Skeleton = skeleton;
+            key.m_BoneIndices = instance->m_BoneIndices;
+            key.m_BindPose = instance->m_BindPose;
+            for (uint32_t pi = 0; pi < 2; ++pi)
+            {
+                key.m_Animations[pi] = animations[pi];
+                key.m_SampleTimes[pi] = QuantizeSampleTime(samples[pi], &fractions[pi]);
+            }
+            if (instance->m_Blending)
+            {
+                key.m_Blend = QuantizeSampleTime(0, &fade_rate);
+                key.m_CurrentPlayer = instance->m_CurrentPlayer;
+            }
+            key_hash = dmHashBuffer64(&key, sizeof(key));
+
+            uint32_t index = FindCachedPose(pose_cache, key, key_hash);
+            if (index != INVALID_OFFSET)
+            {
+                const PoseCacheEntry& entry = pose_cache->m_Entries[index];
+                memcpy(instance->m_Pose.Begin(), pose_cache->m_Poses.Begin() + entry.m_PoseOffset, sizeof(BonePose) * entry.m_BoneCount);
+                instance->m_PoseCacheEntry = index + 1;
+                ++pose_cache->m_Hits;
+                return;
+            }
+        }
+
+        dmArray<BonePose>& pose = instance->m_Pose;
+        ResetPose(skeleton, pose);
+
         if (instance->m_Blending)
         {
+            // How much to blend the pose, 1 first time to overwrite the bind pose, either fade_rate or 1 - fade_rate second depending on which one is the current player
+            float alpha = 1.0f;
+            for (uint32_t pi = 0; pi < 2; ++pi)
+            {
+                ApplyAnimation(instance, animations[pi], samples[pi], fractions[pi], pose, alpha);
+                if (player == players[pi])
+                {
+                    alpha = 1.0f - fade_rate;
+                }
+                else
+                {
+                    alpha = fade_rate;
+                }
+            }
+
+            // Normalize quaternions while we blend
             uint32_t bone_count = pose.Size();
             for (uint32_t bi = 0; bi < bone_count; ++bi)
             {
@@ -563,8 +773,20 @@ namespace dmRig
                 }
             }
         }
+        else
+        {
+            ApplyAnimation(instance, animations[0], samples[0], fractions[0], pose, 1.0f);
+        }
 
         UpdatePoseTransforms(pose);
+
+        if (pose_cache)
+        {
+            ++pose_cache->m_Misses;
+            uint32_t index = StorePose(pose_cache, key, key_hash, pose);
+            if (index != INVALID_OFFSET)
+                instance->m_PoseCacheEntry = index + 1;
+        }
     }
 
     static Result PostUpdate(HRigContext context)
@@ -608,6 +830,12 @@ namespace dmRig
         return PostUpdate(context);
     }
 
+    void GetPoseCacheStats(HRigContext context, PoseCacheStats* stats)
+    {
+        stats->m_Hits = context->m_PoseCache.m_Hits;
+        stats->m_Misses = context->m_PoseCache.m_Misses;
+    }
+
     static dmRig::Result CreatePose(HRigContext context, HRigInstance instance)
     {
         if(!instance->m_Skeleton)
@@ -775,7 +1003,90 @@ namespace dmRig
         return vertex_count;
     }
 
-    static void GenerateNormalData(const dmRigDDF::Mesh* mesh, const Matrix4& normal_matrix, const dmArray<Matrix4>& pose_matrices, float* normals_buffer, float* tangents_buffer)
+    // Multiplies two column major matrices, out = a * b
+    static inline void MulMatrix(const float* a, const float* b, float* out)
+    {
+        Vec4f a0 = Load(a + 0);
+        Vec4f a1 = Load(a + 4);
+        Vec4f a2 = Load(a + 8);
+        Vec4f a3 = Load(a + 12);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            Vec4f bc = Load(b + c*4);
+            Vec4f v = Mul(a0, SplatX(bc));
+            v = MulAdd(a1, SplatY(bc), v);
+            v = MulAdd(a2, SplatZ(bc), v);
+            v = MulAdd(a3, SplatW(bc), v);
+            Store(out + c*4, v);
+        }
+    }
+
+    // Premultiplies the pose matrices with a model (or normal) matrix, so that the skinning
+    // kernels can transform each vertex with a single blended matrix per vertex.
+    static void CalcSkinningMatrices(const Matrix4& matrix, const dmArray<Matrix4>& pose_matrices, dmArray<Matrix4>& out_matrices)
+    {
+        uint32_t bone_count = pose_matrices.Size();
+        if (out_matrices.Capacity() < bone_count) {
+            out_matrices.OffsetCapacity(bone_count - out_matrices.Capacity());
+        }
+        out_matrices.SetSize(bone_count);
+
+        const float* m = (const float*) &matrix;
+        for (uint32_t bi = 0; bi < bone_count; ++bi)
+        {
+            MulMatrix(m, (const float*) &pose_matrices[bi], (float*) &out_matrices[bi]);
+        }
+    }
+
+    // Blends the first 'column_count' columns of the four bone matrices that influence a vertex.
+    // The skinning matrices are stored as 16 floats, column major.
+    static inline void BlendColumns(const float* skin_matrices, const uint32_t* bone_indices, Vec4f weights, Vec4f* columns, uint32_t column_count)
+    {
+        const float* m0 = skin_matrices + bone_indices[0] * 16;
+        const float* m1 = skin_matrices + bone_indices[1] * 16;
+        const float* m2 = skin_matrices + bone_indices[2] * 16;
+        const float* m3 = skin_matrices + bone_indices[3] * 16;
+        Vec4f w0 = SplatX(weights);
+        Vec4f w1 = SplatY(weights);
+        Vec4f w2 = SplatZ(weights);
+        Vec4f w3 = SplatW(weights);
+        for (uint32_t c = 0; c < column_count; ++c)
+        {
+            Vec4f v = Mul(Load(m0 + c*4), w0);
+            v = MulAdd(Load(m1 + c*4), w1, v);
+            v = MulAdd(Load(m2 + c*4), w2, v);
+            columns[c] = MulAdd(Load(m3 + c*4), w3, v);
+        }
+    }
+
+    // Transforms a direction (w = 0) with the upper 3x3 part of a blended matrix
+    static inline Vec4f TransformDirection(const Vec4f* columns, const float* v)
+    {
+        Vec4f out = Mul(columns[0], Splat(v[0]));
+        out = MulAdd(columns[1], Splat(v[1]), out);
+        return MulAdd(columns[2], Splat(v[2]), out);
+    }
+
+    // Transforms a position (w = 1) with the four bone influences of a vertex.
+    // Since the weights are normalized, the blended matrix is still an affine transform.
+    static inline Vec4f SkinPosition(const float* skin_matrices, const float* position, const uint32_t* bone_indices, Vec4f weights)
+    {
+        Vec4f columns[4];
+        BlendColumns(skin_matrices, bone_indices, weights, columns, 4);
+        return Add(TransformDirection(columns, position), columns[3]);
+    }
+
+    // Writes the xyz part of the vector as three floats
+    static inline void StoreXYZ(float* out, Vec4f v)
+    {
+        float tmp[4];
+        Store(tmp, v);
+        out[0] = tmp[0];
+        out[1] = tmp[1];
+        out[2] = tmp[2];
+    }
+
+    static void GenerateNormalData(const dmRigDDF::Mesh* mesh, const Matrix4& normal_matrix, const dmArray<Matrix4>& skin_matrices, float* normals_buffer, float* tangents_buffer)
     {
         const float* normals_in = mesh->m_Normals.m_Data;
         bool has_tangents = mesh->m_Tangents.m_Count > 0;
@@ -785,7 +1096,7 @@ namespace dmRig
         Vector4 tangent;
 
         // Non skinned data
-        if (!mesh->m_BoneIndices.m_Count || pose_matrices.Size() == 0)
+        if (!mesh->m_BoneIndices.m_Count || skin_matrices.Size() == 0)
         {
             for (uint32_t i = 0; i < vertex_count; ++i)
             {
@@ -816,73 +1127,52 @@ namespace dmRig
             return;
         }
 
-        // Skinned data
+        // Skinned data, the normal matrix is already premultiplied into the skinning matrices.
+        // Only the upper 3x3 part of the matrices is used, so the w component of the result is ignored.
+        const float* matrices = (const float*) skin_matrices.Begin();
         const uint32_t* indices = mesh->m_BoneIndices.m_Data;
         const float* weights = mesh->m_Weights.m_Data;
-        for (uint32_t i = 0; i < vertex_count; ++i)
-        {
-            const Vector3 normal_in(normals_in[i*3+0], normals_in[i*3+1], normals_in[i*3+2]);
-            Vector4 normal_out(0.0f, 0.0f, 0.0f, 0.0f);
-
-            const Vector3 tangent_in = has_tangents ? Vector3(tangents_in[i*4+0], tangents_in[i*4+1], tangents_in[i*4+2]) : Vector3(0,0,0);
-            const float tangent_handedness = has_tangents ? tangents_in[i*4+3] : 0.0f;
-            Vector4 tangent_out(0.0f, 0.0f, 0.0f, 0.0f);
-
-            const uint32_t bi_offset = i * 4;
-            const uint32_t* bone_indices = &indices[bi_offset];
-            const float* bone_weights = &weights[bi_offset];
 
-            if (bone_weights[0])
+        // Four vertices per iteration. Each normal is written as four floats where the last one is overwritten
+        // by the next normal, so the last vertex is left to the tail loop to not write past the buffer.
+        Vec4f columns[3];
+        uint32_t i = 0;
+        for (; i + 4 < vertex_count; i += 4)
+        {
+            for (uint32_t l = 0; l < 4; ++l)
             {
-                normal_out += (pose_matrices[bone_indices[0]] * normal_in) * bone_weights[0];
-                tangent_out += (pose_matrices[bone_indices[0]] * tangent_in) * bone_weights[0];
-                if (bone_weights[1])
+                const uint32_t vi = i + l;
+                BlendColumns(matrices, &indices[vi*4], Load(&weights[vi*4]), columns, 3);
+                Store(normals_buffer + vi*3, TransformDirection(columns, &normals_in[vi*3]));
+
+                if (has_tangents)
                 {
-                    normal_out += (pose_matrices[bone_indices[1]] * normal_in) * bone_weights[1];
-                    tangent_out += (pose_matrices[bone_indices[1]] * tangent_in) * bone_weights[1];
-                    if (bone_weights[2])
-                    {
-                        normal_out += (pose_matrices[bone_indices[2]] * normal_in) * bone_weights[2];
-                        tangent_out += (pose_matrices[bone_indices[2]] * tangent_in) * bone_weights[2];
-                        if (bone_weights[3])
-                        {
-                            normal_out += (pose_matrices[bone_indices[3]] * normal_in) * bone_weights[3];
-                            tangent_out += (pose_matrices[bone_indices[3]] * tangent_in) * bone_weights[3];
-                        }
-                    }
+                    Store(tangents_buffer + vi*4, TransformDirection(columns, &tangents_in[vi*4]));
+                    tangents_buffer[vi*4+3] = tangents_in[vi*4+3];
                 }
             }
-
-            normal = normal_matrix * normal_out.getXYZ();
-            if (lengthSqr(normal) > 0.0f) {
-                normalize(normal);
-            }
-            *normals_buffer++ = normal[0];
-            *normals_buffer++ = normal[1];
-            *normals_buffer++ = normal[2];
+        }
+        for (; i < vertex_count; ++i)
+        {
+            BlendColumns(matrices, &indices[i*4], Load(&weights[i*4]), columns, 3);
+            StoreXYZ(normals_buffer + i*3, TransformDirection(columns, &normals_in[i*3]));
 
             if (has_tangents)
             {
-                tangent = normal_matrix * tangent_out;
-                if (lengthSqr(tangent) > 0.0f) {
-                    normalize(tangent);
-                }
-                *tangents_buffer++ = tangent[0];
-                *tangents_buffer++ = tangent[1];
-                *tangents_buffer++ = tangent[2];
-                *tangents_buffer++ = tangent_handedness;
+                Store(tangents_buffer + i*4, TransformDirection(columns, &tangents_in[i*4]));
+                tangents_buffer[i*4+3] = tangents_in[i*4+3];
             }
         }
     }
 
-    static float* GeneratePositionData(const dmRigDDF::Mesh* mesh, const Matrix4& model_matrix, const dmArray<Matrix4>& pose_matrices, float* out_buffer)
+    static float* GeneratePositionData(const dmRigDDF::Mesh* mesh, const Matrix4& model_matrix, const dmArray<Matrix4>& skin_matrices, float* out_buffer)
     {
         const float* positions = mesh->m_Positions.m_Data;
         const uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
         Point3 in_p;
         Vector4 v;
 
-        if(!mesh->m_BoneIndices.m_Count || pose_matrices.Size() == 0)
+        if(!mesh->m_BoneIndices.m_Count || skin_matrices.Size() == 0)
         {
             for (uint32_t i = 0; i < vertex_count; ++i)
             {
@@ -897,42 +1187,26 @@ namespace dmRig
             return out_buffer;
         }
 
+        // Skinned data, the model matrix is already premultiplied into the skinning matrices
+        // and the weights are expected to be normalized (see NormalizeBoneWeights).
+        const float* matrices = (const float*) skin_matrices.Begin();
         const uint32_t* indices = mesh->m_BoneIndices.m_Data;
         const float* weights = mesh->m_Weights.m_Data;
-        for (uint32_t i = 0; i < vertex_count; ++i)
-        {
-            Vector4 in_v;
-            in_v.setX(*positions++);
-            in_v.setY(*positions++);
-            in_v.setZ(*positions++);
-            in_v.setW(1.0f);
-
-            Vector4 out_p(0.0f, 0.0f, 0.0f, 0.0f);
-            const uint32_t bi_offset = i * 4;
-            const uint32_t* bone_indices = &indices[bi_offset];
-            const float* bone_weights = &weights[bi_offset];
-
-            if(bone_weights[0])
-            {
-                out_p += pose_matrices[bone_indices[0]] * in_v * bone_weights[0];
-                if(bone_weights[1])
-                {
-                    out_p += pose_matrices[bone_indices[1]] * in_v * bone_weights[1];
-                    if(bone_weights[2])
-                    {
-                        out_p += pose_matrices[bone_indices[2]] * in_v * bone_weights[2];
-                        if(bone_weights[3])
-                        {
-                            out_p += pose_matrices[bone_indices[3]] * in_v * bone_weights[3];
-                        }
-                    }
-                }
-            }
 
-            v = model_matrix * Point3(out_p.getX(), out_p.getY(), out_p.getZ());
-            *out_buffer++ = v[0];
-            *out_buffer++ = v[1];
-            *out_buffer++ = v[2];
+        // Four vertices per iteration, see GenerateNormalData
+        uint32_t i = 0;
+        for (; i + 4 < vertex_count; i += 4)
+        {
+            Store(out_buffer + 0, SkinPosition(matrices, &positions[i*3+0], &indices[i*4+0],  Load(&weights[i*4+0])));
+            Store(out_buffer + 3, SkinPosition(matrices, &positions[i*3+3], &indices[i*4+4],  Load(&weights[i*4+4])));
+            Store(out_buffer + 6, SkinPosition(matrices, &positions[i*3+6], &indices[i*4+8],  Load(&weights[i*4+8])));
+            Store(out_buffer + 9, SkinPosition(matrices, &positions[i*3+9], &indices[i*4+12], Load(&weights[i*4+12])));
+            out_buffer += 12;
+        }
+        for (; i < vertex_count; ++i)
+        {
+            StoreXYZ(out_buffer, SkinPosition(matrices, &positions[i*3], &indices[i*4], Load(&weights[i*4])));
+            out_buffer += 3;
         }
         return out_buffer;
     }
@@ -1109,6 +1383,56 @@ namespace dmRig
         array.SetSize(size);
     }
 
+    // Calculates the local-to-model pose matrices premultiplied with the bind pose inverse,
+    // so they can be used to directly transform each vertex.
+    // Instances sharing a pose from the pose cache also share the matrices, they're calculated by the first one rendered.
+    static void CalcPoseMatrices(HRigContext context, HRigInstance instance, uint32_t bone_count, dmArray<Matrix4>& pose_matrices)
+    {
+        // Make sure pose scratch buffers have enough space
+        if (pose_matrices.Capacity() < bone_count) {
+            uint32_t size_offset = bone_count - pose_matrices.Capacity();
+            pose_matrices.OffsetCapacity(size_offset);
+        }
+        pose_matrices.SetSize(bone_count);
+
+        PoseCache* pose_cache = &context->m_PoseCache;
+        PoseCacheEntry* entry = 0;
+        if (instance->m_PoseCacheEntry != 0 && instance->m_PoseCacheEntry <= pose_cache->m_Entries.Size())
+        {
+            entry = &pose_cache->m_Entries[instance->m_PoseCacheEntry - 1];
+            if (entry->m_BoneCount != bone_count)
+            {
+                entry = 0;
+            }
+            else if (entry->m_MatrixOffset != INVALID_OFFSET)
+            {
+                memcpy(pose_matrices.Begin(), pose_cache->m_PoseMatrices.Begin() + entry->m_MatrixOffset, sizeof(Matrix4) * bone_count);
+                return;
+            }
+        }
+
+        PoseToMatrix(instance->m_Pose, pose_matrices);
+
+        const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
+        for (uint32_t bi = 0; bi < bone_count; ++bi)
+        {
+            float* pose_matrix = (float*) &pose_matrices[bi];
+            MulMatrix(pose_matrix, (const float*) &bind_pose[bi].m_ModelToLocal, pose_matrix);
+        }
+
+        if (entry)
+        {
+            dmArray<Matrix4>& cached_matrices = pose_cache->m_PoseMatrices;
+            if (cached_matrices.Remaining() < bone_count)
+            {
+                cached_matrices.OffsetCapacity(dmMath::Max(bone_count, cached_matrices.Capacity()));
+            }
+            entry->m_MatrixOffset = cached_matrices.Size();
+            cached_matrices.SetSize(entry->m_MatrixOffset + bone_count);
+            memcpy(cached_matrices.Begin() + entry->m_MatrixOffset, pose_matrices.Begin(), sizeof(Matrix4) * bone_count);
+        }
+    }
+
     uint8_t* GenerateVertexDataFromAttributes(dmRig::HRigContext context, dmRig::HRigInstance instance, dmRigDDF::Mesh* mesh, const dmVMath::Matrix4& world_matrix, const dmGraphics::VertexAttributeInfos* attribute_infos, uint32_t vertex_stride, uint8_t* vertex_data_out)
     {
         const dmRigDDF::Model* model = instance->m_Model;
@@ -1119,6 +1443,7 @@ namespace dmRig
         }
 
         dmArray<Matrix4>& pose_matrices = context->m_ScratchPoseMatrixBuffer;
+        dmArray<Matrix4>& skin_matrices = context->m_ScratchSkinMatrixBuffer;
         dmArray<Vector3>& positions     = context->m_ScratchPositionBuffer;
         dmArray<Vector3>& normals       = context->m_ScratchNormalBuffer;
         dmArray<Vector4>& tangents      = context->m_ScratchTangentBuffer;
@@ -1145,30 +1470,14 @@ namespace dmRig
         {
             if (bone_count)
             {
-                // Make sure pose scratch buffers have enough space
-                if (pose_matrices.Capacity() < bone_count)
-                {
-                    uint32_t size_offset = bone_count - pose_matrices.Capacity();
-                    pose_matrices.OffsetCapacity(size_offset);
-                }
-                pose_matrices.SetSize(bone_count);
-
-                PoseToMatrix(instance->m_Pose, pose_matrices);
-
-                // Premultiply pose matrices with the bind pose inverse so they
-                // can be directly be used to transform each vertex.
-                const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
-                for (uint32_t bi = 0; bi < pose_matrices.Size(); ++bi)
-                {
-                    Matrix4& pose_matrix = pose_matrices[bi];
-                    pose_matrix = pose_matrix * bind_pose[bi].m_ModelToLocal;
-                }
+                CalcPoseMatrices(context, instance, bone_count, pose_matrices);
             }
 
             EnsureSize(positions, vertex_count);
             positions_buffer = (float*) positions.Begin();
 
-            dmRig::GeneratePositionData(mesh, world_matrix, pose_matrices, positions_buffer);
+            CalcSkinningMatrices(world_matrix, pose_matrices, skin_matrices);
+            dmRig::GeneratePositionData(mesh, world_matrix, skin_matrices, positions_buffer);
         }
         if (stream_normal && mesh->m_Normals.m_Count)
         {
@@ -1179,7 +1488,8 @@ namespace dmRig
 
             Matrix4 normal_matrix = Vectormath::Aos::inverse(world_matrix);
             normal_matrix = Vectormath::Aos::transpose(normal_matrix);
-            dmRig::GenerateNormalData(mesh, normal_matrix, pose_matrices, normals_buffer, tangents_buffer);
+            CalcSkinningMatrices(normal_matrix, pose_matrices, skin_matrices);
+            dmRig::GenerateNormalData(mesh, normal_matrix, skin_matrices, normals_buffer, tangents_buffer);
         }
 
         return WriteVertexDataByAttributes(mesh, positions_buffer, normals_buffer, tangents_buffer, attribute_infos, vertex_stride, vertex_data_out);
@@ -1196,6 +1506,7 @@ namespace dmRig
         }
 
         dmArray<Matrix4>& pose_matrices      = context->m_ScratchPoseMatrixBuffer;
+        dmArray<Matrix4>& skin_matrices      = context->m_ScratchSkinMatrixBuffer;
         dmArray<Vector3>& positions          = context->m_ScratchPositionBuffer;
         dmArray<Vector3>& normals            = context->m_ScratchNormalBuffer;
         dmArray<Vector4>& tangents           = context->m_ScratchTangentBuffer;
@@ -1204,23 +1515,7 @@ namespace dmRig
         uint32_t bone_count = GetBoneCount(instance);
         if (bone_count)
         {
-            // Make sure pose scratch buffers have enough space
-            if (pose_matrices.Capacity() < bone_count) {
-                uint32_t size_offset = bone_count - pose_matrices.Capacity();
-                pose_matrices.OffsetCapacity(size_offset);
-            }
-            pose_matrices.SetSize(bone_count);
-
-            PoseToMatrix(instance->m_Pose, pose_matrices);
-
-            // Premultiply pose matrices with the bind pose inverse so they
-            // can be directly be used to transform each vertex.
-            const dmArray<RigBone>& bind_pose = *instance->m_BindPose;
-            for (uint32_t bi = 0; bi < pose_matrices.Size(); ++bi)
-            {
-                Matrix4& pose_matrix = pose_matrices[bi];
-                pose_matrix = pose_matrix * bind_pose[bi].m_ModelToLocal;
-            }
+            CalcPoseMatrices(context, instance, bone_count, pose_matrices);
         } else {
             pose_matrices.SetSize(0);
         }
@@ -1241,9 +1536,11 @@ namespace dmRig
         float* tangents_buffer = (float*)tangents.Begin();
 
         // Transform the mesh data into world space
-        dmRig::GeneratePositionData(mesh, world_matrix, pose_matrices, positions_buffer);
+        CalcSkinningMatrices(world_matrix, pose_matrices, skin_matrices);
+        dmRig::GeneratePositionData(mesh, world_matrix, skin_matrices, positions_buffer);
         if (mesh->m_Normals.m_Count) {
-            dmRig::GenerateNormalData(mesh, normal_matrix, pose_matrices, normals_buffer, tangents_buffer);
+            CalcSkinningMatrices(normal_matrix, pose_matrices, skin_matrices);
+            dmRig::GenerateNormalData(mesh, normal_matrix, skin_matrices, normals_buffer, tangents_buffer);
         }
 
         return WriteVertexData(mesh, positions_buffer, normals_buffer, tangents_buffer, vertex_data_out);
@@ -1384,6 +1681,7 @@ namespace dmRig
         instance->m_Skeleton           = params.m_Skeleton;
         instance->m_MeshSet            = params.m_MeshSet;
         instance->m_AnimationSet       = params.m_AnimationSet;
+        instance->m_TrackBoneIndices   = params.m_TrackBoneIndices;
 
         instance->m_Enabled = 1;
 
@@ -1408,7 +1706,7 @@ namespace dmRig
         // before that happens, for example cloning a GUI spine node happens in script update,
         // which comes after the regular dmRig::Update.
         if (params.m_ForceAnimatePose) {
-            DoAnimate(context, instance, 0.0f);
+            DoAnimate(context, instance, 0.0f, 0x0);
         }
 
         *out_instance = instance;
@@ -1441,4 +1739,78 @@ namespace dmRig
             bind_bone->m_Length = bone->m_Length;
         }
     }
+
+    void CreateTrackBoneIndices(const dmRigDDF::Skeleton& skeleton, const dmRigDDF::AnimationSet& animation_set, const dmHashTable64<uint32_t>& bone_indices, TrackBoneIndices& track_bone_indices)
+    {
+        uint32_t animation_count = animation_set.m_Animations.m_Count;
+        uint32_t track_count = 0;
+        for (uint32_t ai = 0; ai < animation_count; ++ai)
+        {
+            track_count += animation_set.m_Animations[ai].m_Tracks.m_Count;
+        }
+
+        track_bone_indices.m_AnimationSet = &animation_set;
+        track_bone_indices.m_Skeleton = &skeleton;
+        track_bone_indices.m_BoneCount = skeleton.m_Bones.m_Count;
+        track_bone_indices.m_AnimationOffsets.SetCapacity(animation_count);
+        track_bone_indices.m_AnimationOffsets.SetSize(0);
+        track_bone_indices.m_BoneIndices.SetCapacity(track_count);
+        track_bone_indices.m_BoneIndices.SetSize(0);
+
+        for (uint32_t ai = 0; ai < animation_count; ++ai)
+        {
+            const dmRigDDF::RigAnimation& animation = animation_set.m_Animations[ai];
+            track_bone_indices.m_AnimationOffsets.Push(track_bone_indices.m_BoneIndices.Size());
+            for (uint32_t ti = 0; ti < animation.m_Tracks.m_Count; ++ti)
+            {
+                const uint32_t* bone_index = bone_indices.Get(animation.m_Tracks[ti].m_BoneId);
+                track_bone_indices.m_BoneIndices.Push(bone_index ? *bone_index : INVALID_BONE_INDEX);
+            }
+        }
+    }
+
+    void NormalizeBoneWeights(dmRigDDF::MeshSet& mesh_set)
+    {
+        for (uint32_t m = 0; m < mesh_set.m_Models.m_Count; ++m)
+        {
+            dmRigDDF::Model& model = mesh_set.m_Models[m];
+            for (uint32_t i = 0; i < model.m_Meshes.m_Count; ++i)
+            {
+                dmRigDDF::Mesh& mesh = model.m_Meshes[i];
+                if (!mesh.m_BoneIndices.m_Count || mesh.m_Weights.m_Count != mesh.m_BoneIndices.m_Count)
+                    continue;
+
+                uint32_t vertex_count = mesh.m_Weights.m_Count / 4;
+                for (uint32_t v = 0; v < vertex_count; ++v)
+                {
+                    uint32_t* bone_indices = &mesh.m_BoneIndices[v*4];
+                    float* bone_weights = &mesh.m_Weights[v*4];
+
+                    float sum = 0.0f;
+                    for (uint32_t k = 0; k < 4; ++k)
+                    {
+                        if (bone_weights[k] > 0.0f)
+                            sum += bone_weights[k];
+                        else
+                            bone_weights[k] = 0.0f;
+                    }
+
+                    // A vertex without any influences follows the first bone
+                    if (sum == 0.0f)
+                    {
+                        bone_weights[0] = 1.0f;
+                        sum = 1.0f;
+                    }
+
+                    float scale = 1.0f / sum;
+                    for (uint32_t k = 0; k < 4; ++k)
+                    {
+                        bone_weights[k] *= scale;
+                        if (bone_weights[k] == 0.0f)
+                            bone_indices[k] = 0;
+                    }
+                }
+            }
+        }
+    }
 }
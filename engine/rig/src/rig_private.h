@@ -61,6 +61,9 @@ namespace dmRig
         const dmRigDDF::Skeleton*       m_Skeleton;
         const dmRigDDF::MeshSet*        m_MeshSet;
         const dmRigDDF::AnimationSet*   m_AnimationSet;
+        const TrackBoneIndices*         m_TrackBoneIndices;
+        /// Index + 1 of the shared pose in the context pose cache, 0 if the pose isn't shared
+        uint32_t                        m_PoseCacheEntry;
 
         RigPoseCallback               m_PoseCallback;
         void*                         m_PoseCBUserData1;
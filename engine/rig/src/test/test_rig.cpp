@@ -1565,6 +1565,230 @@ TEST_F(RigInstanceTest, MultipleRigInfluences)
     DeleteRigData(mesh_set, skeleton, animation_set);
 }
 
+TEST_F(RigInstanceTest, TrackBoneIndices)
+{
+    dmRig::TrackBoneIndices track_bone_indices;
+    dmRig::CreateTrackBoneIndices(*m_Skeleton, *m_AnimationSet, m_BoneIndices, track_bone_indices);
+
+    ASSERT_EQ(m_AnimationSet, track_bone_indices.m_AnimationSet);
+    ASSERT_EQ(m_Skeleton, track_bone_indices.m_Skeleton);
+    ASSERT_EQ(m_Skeleton->m_Bones.m_Count, track_bone_indices.m_BoneCount);
+    ASSERT_EQ(m_AnimationSet->m_Animations.m_Count, track_bone_indices.m_AnimationOffsets.Size());
+    uint32_t offset = 0;
+    for (uint32_t ai = 0; ai < m_AnimationSet->m_Animations.m_Count; ++ai)
+    {
+        const dmRigDDF::RigAnimation& anim = m_AnimationSet->m_Animations[ai];
+        ASSERT_EQ(offset, track_bone_indices.m_AnimationOffsets[ai]);
+        for (uint32_t ti = 0; ti < anim.m_Tracks.m_Count; ++ti)
+        {
+            const uint32_t* bone_index = m_BoneIndices.Get(anim.m_Tracks[ti].m_BoneId);
+            ASSERT_EQ(bone_index ? *bone_index : dmRig::INVALID_BONE_INDEX, track_bone_indices.m_BoneIndices[offset + ti]);
+        }
+        offset += anim.m_Tracks.m_Count;
+    }
+    ASSERT_EQ(offset, track_bone_indices.m_BoneIndices.Size());
+
+    // A second instance using the table should animate exactly like the one looking up the bones per track
+    dmRig::InstanceCreateParams create_params = {0};
+    create_params.m_BindPose         = &m_BindPose;
+    create_params.m_BoneIndices      = &m_BoneIndices;
+    create_params.m_Skeleton         = m_Skeleton;
+    create_params.m_MeshSet          = m_MeshSet;
+    create_params.m_AnimationSet     = m_AnimationSet;
+    create_params.m_TrackBoneIndices = &track_bone_indices;
+    create_params.m_ModelId          = dmHashString64((const char*)"test");
+    create_params.m_DefaultAnimation = dmHashString64((const char*)"");
+
+    dmRig::HRigInstance second_instance = 0x0;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(m_Context, create_params, &second_instance));
+
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(second_instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+
+    dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(m_Instance);
+    dmArray<dmRig::BonePose>& second_pose = *dmRig::GetPose(second_instance);
+    ASSERT_EQ(pose.Size(), second_pose.Size());
+    for (uint32_t frame = 0; frame < 8; ++frame)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 0.5f));
+        for (uint32_t bi = 0; bi < pose.Size(); ++bi)
+        {
+            ASSERT_EQ(pose[bi].m_World.GetTranslation(), second_pose[bi].m_World.GetTranslation());
+            ASSERT_EQ(pose[bi].m_World.GetRotation(), second_pose[bi].m_World.GetRotation());
+            ASSERT_EQ(pose[bi].m_World.GetScale(), second_pose[bi].m_World.GetScale());
+        }
+    }
+
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceDestroy(m_Context, second_instance));
+}
+
+TEST_F(RigInstanceTest, TrackBoneIndicesOtherSkeleton)
+{
+    // A table created for another skeleton, e.g. before the skeleton was reloaded, maps every track to an invalid bone
+    dmRigDDF::Skeleton other_skeleton;
+    memset(&other_skeleton, 0, sizeof(other_skeleton));
+    dmHashTable64<uint32_t> other_bone_indices;
+    dmRig::TrackBoneIndices stale_track_bone_indices;
+    dmRig::CreateTrackBoneIndices(other_skeleton, *m_AnimationSet, other_bone_indices, stale_track_bone_indices);
+
+    // The instance ignores the table, and looks up the bones per track
+    dmRig::InstanceCreateParams create_params = {0};
+    create_params.m_BindPose         = &m_BindPose;
+    create_params.m_BoneIndices      = &m_BoneIndices;
+    create_params.m_Skeleton         = m_Skeleton;
+    create_params.m_MeshSet          = m_MeshSet;
+    create_params.m_AnimationSet     = m_AnimationSet;
+    create_params.m_TrackBoneIndices = &stale_track_bone_indices;
+    create_params.m_ModelId          = dmHashString64((const char*)"test");
+    create_params.m_DefaultAnimation = dmHashString64((const char*)"");
+
+    dmRig::HRigInstance second_instance = 0x0;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(m_Context, create_params, &second_instance));
+
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(second_instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+
+    dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(m_Instance);
+    dmArray<dmRig::BonePose>& second_pose = *dmRig::GetPose(second_instance);
+    for (uint32_t frame = 0; frame < 4; ++frame)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 0.5f));
+        for (uint32_t bi = 0; bi < pose.Size(); ++bi)
+        {
+            ASSERT_EQ(pose[bi].m_World.GetTranslation(), second_pose[bi].m_World.GetTranslation());
+            ASSERT_EQ(pose[bi].m_World.GetRotation(), second_pose[bi].m_World.GetRotation());
+        }
+    }
+
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceDestroy(m_Context, second_instance));
+}
+
+TEST_F(RigInstanceTest, PoseCache)
+{
+    dmRig::NewContextParams params = {0};
+    params.m_MaxRigInstanceCount = 3;
+    params.m_PoseCache = true;
+    dmRig::HRigContext cache_context;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(params, &cache_context));
+
+    dmRig::InstanceCreateParams create_params = {0};
+    create_params.m_BindPose         = &m_BindPose;
+    create_params.m_BoneIndices      = &m_BoneIndices;
+    create_params.m_Skeleton         = m_Skeleton;
+    create_params.m_MeshSet          = m_MeshSet;
+    create_params.m_AnimationSet     = m_AnimationSet;
+    create_params.m_ModelId          = dmHashString64((const char*)"test");
+    create_params.m_DefaultAnimation = dmHashString64((const char*)"");
+
+    dmRig::HRigInstance instances[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(cache_context, create_params, &instances[i]));
+    }
+
+    // The first two instances share the pose of the uncached instance, the last one is half a sample ahead
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[0], dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[1], dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.0f, 1.0f));
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[2], dmHashString64("valid"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, 0.5f, 1.0f));
+
+    dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(m_Instance);
+    dmRig::RigModelVertex data[4];
+    dmRig::RigModelVertex cached_data[4];
+    dmRig::RigModelVertex* data_end = data + 4;
+    dmRig::RigModelVertex* cached_data_end = cached_data + 4;
+
+    for (uint32_t frame = 0; frame < 12; ++frame)
+    {
+        // Cross fade between the animations half way through
+        if (frame == 6)
+        {
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instance, dmHashString64("scaling"), dmRig::PLAYBACK_LOOP_FORWARD, 1.0f, 0.0f, 1.0f));
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[0], dmHashString64("scaling"), dmRig::PLAYBACK_LOOP_FORWARD, 1.0f, 0.0f, 1.0f));
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[1], dmHashString64("scaling"), dmRig::PLAYBACK_LOOP_FORWARD, 1.0f, 0.0f, 1.0f));
+        }
+
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(m_Context, 0.25f));
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::Update(cache_context, 0.25f));
+
+        dmRig::PoseCacheStats stats;
+        dmRig::GetPoseCacheStats(cache_context, &stats);
+        ASSERT_EQ(1u, stats.m_Hits);
+        ASSERT_EQ(2u, stats.m_Misses);
+
+        ASSERT_EQ(data_end, dmRig::GenerateVertexData(m_Context, m_Instance, m_FirstMesh, Matrix4::identity(), data));
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            dmArray<dmRig::BonePose>& cached_pose = *dmRig::GetPose(instances[i]);
+            ASSERT_EQ(pose.Size(), cached_pose.Size());
+            for (uint32_t bi = 0; bi < pose.Size(); ++bi)
+            {
+                ASSERT_EQ(pose[bi].m_World.GetTranslation(), cached_pose[bi].m_World.GetTranslation());
+                ASSERT_EQ(pose[bi].m_World.GetRotation(), cached_pose[bi].m_World.GetRotation());
+                ASSERT_EQ(pose[bi].m_World.GetScale(), cached_pose[bi].m_World.GetScale());
+            }
+
+            // The second instance uses the pose matrices calculated for the first one
+            ASSERT_EQ(cached_data_end, dmRig::GenerateVertexData(cache_context, instances[i], m_FirstMesh, Matrix4::identity(), cached_data));
+            for (uint32_t vi = 0; vi < 4; ++vi)
+            {
+                ASSERT_VERT_POS(Vector3(data[vi].pos[0], data[vi].pos[1], data[vi].pos[2]), cached_data[vi]);
+                ASSERT_VERT_NORM(Vector3(data[vi].normal[0], data[vi].normal[1], data[vi].normal[2]), cached_data[vi]);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceDestroy(cache_context, instances[i]));
+    }
+    dmRig::DeleteContext(cache_context);
+}
+
+TEST(Rig, NormalizeBoneWeights)
+{
+    const uint32_t vert_count = 3;
+    uint32_t bone_indices[vert_count*4] = { 1, 2, 7, 9,
+                                            3, 4, 5, 6,
+                                            5, 6, 7, 8 };
+    float weights[vert_count*4] = { 0.25f, 0.25f, 0.0f, 0.0f,
+                                    2.0f, 1.0f, 1.0f, -1.0f,
+                                    0.0f, 0.0f, 0.0f, 0.0f };
+
+    dmRigDDF::Mesh mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.m_BoneIndices.m_Data  = bone_indices;
+    mesh.m_BoneIndices.m_Count = vert_count*4;
+    mesh.m_Weights.m_Data      = weights;
+    mesh.m_Weights.m_Count     = vert_count*4;
+
+    dmRigDDF::Model model;
+    memset(&model, 0, sizeof(model));
+    model.m_Meshes.m_Data  = &mesh;
+    model.m_Meshes.m_Count = 1;
+
+    dmRigDDF::MeshSet mesh_set;
+    memset(&mesh_set, 0, sizeof(mesh_set));
+    mesh_set.m_Models.m_Data  = &model;
+    mesh_set.m_Models.m_Count = 1;
+
+    dmRig::NormalizeBoneWeights(mesh_set);
+
+    // Unused influences point to bone 0
+    const uint32_t expected_indices[vert_count*4] = { 1, 2, 0, 0,
+                                                      3, 4, 5, 0,
+                                                      5, 0, 0, 0 };
+    // Weights sum up to one, a vertex without influences follows the first bone
+    const float expected_weights[vert_count*4] = { 0.5f, 0.5f, 0.0f, 0.0f,
+                                                   0.5f, 0.25f, 0.25f, 0.0f,
+                                                   1.0f, 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < vert_count*4; ++i)
+    {
+        ASSERT_EQ(expected_indices[i], bone_indices[i]);
+        ASSERT_NEAR(expected_weights[i], weights[i], RIG_EPSILON_FLOAT);
+    }
+}
+
 TEST_F(RigInstanceTest, CursorNoAnim)
 {
 
@@ -0,0 +1,578 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+#include <stdio.h>
+
+#include <dlib/array.h>
+#include <dlib/dstrings.h>
+#include <dlib/hash.h>
+#include <dlib/hashtable.h>
+#include <dlib/log.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+#include <dmsdk/dlib/vmath.h>
+
+#include <../rig.h>
+
+using namespace dmVMath;
+
+// Benchmarks dmRig on 100 instances of a 5000 vertex mesh skinned to a 60 bone skeleton.
+// The skinning is compared with the scalar path that was used in dmRig::GenerateVertexData, and the
+// animation sampling with and without the precomputed track to bone index table.
+// The pose cache is measured on a crowd of 300 instances, playing the animation in 4 groups.
+
+static const uint32_t INSTANCE_COUNT = 100;
+static const uint32_t CROWD_COUNT = 300;
+static const uint32_t CROWD_GROUP_COUNT = 4;
+static const uint32_t VERTEX_COUNT = 5000;
+static const uint32_t BONE_COUNT = 60;
+static const uint32_t SAMPLE_COUNT = 32;
+static const float SAMPLE_RATE = 30.0f;
+static const uint32_t ITERATIONS = 10;
+static const float DT = 1.0f / 60.0f;
+
+static uint32_t g_Seed = 1;
+
+static float RandomFloat(float min, float max)
+{
+    g_Seed = g_Seed * 1664525 + 1013904223;
+    return min + (max - min) * ((g_Seed >> 8) / (float) (1 << 24));
+}
+
+static Vector3 RandomDirection()
+{
+    Vector3 v(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f));
+    return lengthSqr(v) > 0.0001f ? normalize(v) : Vector3(0.0f, 1.0f, 0.0f);
+}
+
+// The scalar skinning path that was used in dmRig::GenerateVertexData (non indexed meshes)
+static void ScalarGeneratePositionData(const dmRigDDF::Mesh* mesh, const Matrix4& model_matrix, const dmArray<Matrix4>& pose_matrices, float* out_buffer)
+{
+    const float* positions = mesh->m_Positions.m_Data;
+    const uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
+    const uint32_t* indices = mesh->m_BoneIndices.m_Data;
+    const float* weights = mesh->m_Weights.m_Data;
+    Vector4 v;
+    for (uint32_t i = 0; i < vertex_count; ++i)
+    {
+        Vector4 in_v;
+        in_v.setX(*positions++);
+        in_v.setY(*positions++);
+        in_v.setZ(*positions++);
+        in_v.setW(1.0f);
+
+        Vector4 out_p(0.0f, 0.0f, 0.0f, 0.0f);
+        const uint32_t bi_offset = i * 4;
+        const uint32_t* bone_indices = &indices[bi_offset];
+        const float* bone_weights = &weights[bi_offset];
+
+        if(bone_weights[0])
+        {
+            out_p += pose_matrices[bone_indices[0]] * in_v * bone_weights[0];
+            if(bone_weights[1])
+            {
+                out_p += pose_matrices[bone_indices[1]] * in_v * bone_weights[1];
+                if(bone_weights[2])
+                {
+                    out_p += pose_matrices[bone_indices[2]] * in_v * bone_weights[2];
+                    if(bone_weights[3])
+                    {
+                        out_p += pose_matrices[bone_indices[3]] * in_v * bone_weights[3];
+                    }
+                }
+            }
+        }
+
+        v = model_matrix * Point3(out_p.getX(), out_p.getY(), out_p.getZ());
+        *out_buffer++ = v[0];
+        *out_buffer++ = v[1];
+        *out_buffer++ = v[2];
+    }
+}
+
+static void ScalarGenerateNormalData(const dmRigDDF::Mesh* mesh, const Matrix4& normal_matrix, const dmArray<Matrix4>& pose_matrices, float* normals_buffer, float* tangents_buffer)
+{
+    const float* normals_in = mesh->m_Normals.m_Data;
+    const float* tangents_in = mesh->m_Tangents.m_Data;
+    const uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
+    const uint32_t* indices = mesh->m_BoneIndices.m_Data;
+    const float* weights = mesh->m_Weights.m_Data;
+    Vector4 normal;
+    Vector4 tangent;
+    for (uint32_t i = 0; i < vertex_count; ++i)
+    {
+        const Vector3 normal_in(normals_in[i*3+0], normals_in[i*3+1], normals_in[i*3+2]);
+        Vector4 normal_out(0.0f, 0.0f, 0.0f, 0.0f);
+
+        const Vector3 tangent_in(tangents_in[i*4+0], tangents_in[i*4+1], tangents_in[i*4+2]);
+        const float tangent_handedness = tangents_in[i*4+3];
+        Vector4 tangent_out(0.0f, 0.0f, 0.0f, 0.0f);
+
+        const uint32_t bi_offset = i * 4;
+        const uint32_t* bone_indices = &indices[bi_offset];
+        const float* bone_weights = &weights[bi_offset];
+
+        if (bone_weights[0])
+        {
+            normal_out += (pose_matrices[bone_indices[0]] * normal_in) * bone_weights[0];
+            tangent_out += (pose_matrices[bone_indices[0]] * tangent_in) * bone_weights[0];
+            if (bone_weights[1])
+            {
+                normal_out += (pose_matrices[bone_indices[1]] * normal_in) * bone_weights[1];
+                tangent_out += (pose_matrices[bone_indices[1]] * tangent_in) * bone_weights[1];
+                if (bone_weights[2])
+                {
+                    normal_out += (pose_matrices[bone_indices[2]] * normal_in) * bone_weights[2];
+                    tangent_out += (pose_matrices[bone_indices[2]] * tangent_in) * bone_weights[2];
+                    if (bone_weights[3])
+                    {
+                        normal_out += (pose_matrices[bone_indices[3]] * normal_in) * bone_weights[3];
+                        tangent_out += (pose_matrices[bone_indices[3]] * tangent_in) * bone_weights[3];
+                    }
+                }
+            }
+        }
+
+        normal = normal_matrix * normal_out.getXYZ();
+        *normals_buffer++ = normal[0];
+        *normals_buffer++ = normal[1];
+        *normals_buffer++ = normal[2];
+
+        tangent = normal_matrix * tangent_out;
+        *tangents_buffer++ = tangent[0];
+        *tangents_buffer++ = tangent[1];
+        *tangents_buffer++ = tangent[2];
+        *tangents_buffer++ = tangent_handedness;
+    }
+}
+
+static dmRig::RigModelVertex* ScalarGenerateVertexData(dmRig::HRigInstance instance, const dmArray<dmRig::RigBone>& bind_pose, const dmRigDDF::Mesh* mesh, const Matrix4& world_matrix,
+                                                       dmArray<Matrix4>& pose_matrices, float* positions, float* normals, float* tangents, dmRig::RigModelVertex* out_write_ptr)
+{
+    const dmArray<dmRig::BonePose>& pose = *dmRig::GetPose(instance);
+    for (uint32_t bi = 0; bi < pose.Size(); ++bi)
+    {
+        pose_matrices[bi] = dmTransform::ToMatrix4(pose[bi].m_World) * bind_pose[bi].m_ModelToLocal;
+    }
+
+    Matrix4 normal_matrix = dmVMath::Inverse(world_matrix);
+    normal_matrix = dmVMath::Transpose(normal_matrix);
+
+    ScalarGeneratePositionData(mesh, world_matrix, pose_matrices, positions);
+    ScalarGenerateNormalData(mesh, normal_matrix, pose_matrices, normals, tangents);
+
+    uint32_t vertex_count = mesh->m_Positions.m_Count / 3;
+    for (uint32_t i = 0; i < vertex_count; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            out_write_ptr->pos[c] = *positions++;
+            out_write_ptr->normal[c] = *normals++;
+        }
+
+        for (int c = 0; c < 4; ++c)
+        {
+            out_write_ptr->color[c] = 1.0f;
+            out_write_ptr->tangent[c] = *tangents++;
+        }
+
+        for (int c = 0; c < 2; ++c)
+        {
+            out_write_ptr->uv0[c] = 0.0f;
+            out_write_ptr->uv1[c] = 0.0f;
+        }
+
+        out_write_ptr++;
+    }
+    return out_write_ptr;
+}
+
+static void AssertNearVector(const float* expected, const float* actual, uint32_t count, float epsilon)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_NEAR(expected[i], actual[i], epsilon * dmMath::Max(1.0f, dmMath::Abs(expected[i])));
+    }
+}
+
+class RigPerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        g_Seed = 1;
+        CreateSkeleton();
+        CreateAnimationSet();
+        CreateMeshSet();
+
+        dmRig::CopyBindPose(m_Skeleton, m_BindPose);
+        dmRig::CreateTrackBoneIndices(m_Skeleton, m_AnimationSet, m_BoneIndices, m_TrackBoneIndices);
+        dmRig::NormalizeBoneWeights(m_MeshSet);
+
+        dmRig::NewContextParams params = {0};
+        params.m_MaxRigInstanceCount = INSTANCE_COUNT;
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(params, &m_Context));
+        ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(params, &m_LookupContext));
+
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            dmRig::InstanceCreateParams create_params = {0};
+            create_params.m_BindPose         = &m_BindPose;
+            create_params.m_BoneIndices      = &m_BoneIndices;
+            create_params.m_Skeleton         = &m_Skeleton;
+            create_params.m_MeshSet          = &m_MeshSet;
+            create_params.m_AnimationSet     = &m_AnimationSet;
+            create_params.m_ModelId          = 0;
+            create_params.m_DefaultAnimation = 0x0;
+
+            // The lookup instances look up the bone of each track in the bone index hash table
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(m_LookupContext, create_params, &m_LookupInstances[i]));
+            create_params.m_TrackBoneIndices = &m_TrackBoneIndices;
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(m_Context, create_params, &m_Instances[i]));
+
+            float offset = i / (float) INSTANCE_COUNT;
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_Instances[i], dmHashString64("anim"), dmRig::PLAYBACK_LOOP_PINGPONG, 0.0f, offset, 1.0f));
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(m_LookupInstances[i], dmHashString64("anim"), dmRig::PLAYBACK_LOOP_PINGPONG, 0.0f, offset, 1.0f));
+        }
+    }
+
+    virtual void TearDown()
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            dmRig::InstanceDestroy(m_Context, m_Instances[i]);
+            dmRig::InstanceDestroy(m_LookupContext, m_LookupInstances[i]);
+        }
+        dmRig::DeleteContext(m_Context);
+        dmRig::DeleteContext(m_LookupContext);
+
+        delete [] m_Skeleton.m_Bones.m_Data;
+        for (uint32_t i = 0; i < BONE_COUNT; ++i)
+        {
+            delete [] m_Tracks[i].m_Positions.m_Data;
+            delete [] m_Tracks[i].m_Rotations.m_Data;
+        }
+        delete [] m_Mesh.m_Positions.m_Data;
+        delete [] m_Mesh.m_Normals.m_Data;
+        delete [] m_Mesh.m_Tangents.m_Data;
+        delete [] m_Mesh.m_Weights.m_Data;
+        delete [] m_Mesh.m_BoneIndices.m_Data;
+    }
+
+    // A binary tree of bones, where each parent comes before its children
+    void CreateSkeleton()
+    {
+        memset(&m_Skeleton, 0, sizeof(m_Skeleton));
+        m_Skeleton.m_Bones.m_Data = new dmRigDDF::Bone[BONE_COUNT];
+        m_Skeleton.m_Bones.m_Count = BONE_COUNT;
+        m_BoneIndices.SetCapacity(BONE_COUNT, BONE_COUNT);
+
+        char name[32];
+        for (uint32_t i = 0; i < BONE_COUNT; ++i)
+        {
+            dmRigDDF::Bone& bone = m_Skeleton.m_Bones[i];
+            dmSnPrintf(name, sizeof(name), "bone%u", i);
+            bone.m_Id = dmHashString64(name);
+            bone.m_Name = "";
+            bone.m_Parent = i == 0 ? dmRig::INVALID_BONE_INDEX : (i - 1) / 2;
+            bone.m_Length = 1.0f;
+            bone.m_Local = dmTransform::Transform(Vector3(RandomFloat(-0.5f, 0.5f), 1.0f, 0.0f), Quat::rotationZ(RandomFloat(-0.5f, 0.5f)), Vector3(1.0f));
+            bone.m_World = i == 0 ? bone.m_Local : dmTransform::Mul(m_Skeleton.m_Bones[bone.m_Parent].m_World, bone.m_Local);
+            bone.m_InverseBindPose = dmTransform::Inv(bone.m_World);
+            m_BoneIndices.Put(bone.m_Id, i);
+        }
+    }
+
+    // One animation with a translation and rotation track per bone
+    void CreateAnimationSet()
+    {
+        for (uint32_t i = 0; i < BONE_COUNT; ++i)
+        {
+            const dmRigDDF::Bone& bone = m_Skeleton.m_Bones[i];
+            dmRigDDF::AnimationTrack& track = m_Tracks[i];
+            memset(&track, 0, sizeof(track));
+            track.m_BoneId = bone.m_Id;
+            track.m_Positions.m_Data = new float[SAMPLE_COUNT * 3];
+            track.m_Positions.m_Count = SAMPLE_COUNT * 3;
+            track.m_Rotations.m_Data = new float[SAMPLE_COUNT * 4];
+            track.m_Rotations.m_Count = SAMPLE_COUNT * 4;
+
+            float phase = RandomFloat(0.0f, 6.28f);
+            for (uint32_t s = 0; s < SAMPLE_COUNT; ++s)
+            {
+                float t = s / (float) (SAMPLE_COUNT - 1);
+                Vector3 position = bone.m_Local.GetTranslation() + Vector3(0.0f, 0.0f, 0.1f * sinf(phase + t * 6.28f));
+                Quat rotation = bone.m_Local.GetRotation() * Quat::rotationX(0.3f * sinf(phase + t * 6.28f));
+                memcpy(&track.m_Positions.m_Data[s * 3], &position, sizeof(float) * 3);
+                track.m_Rotations.m_Data[s * 4 + 0] = rotation.getX();
+                track.m_Rotations.m_Data[s * 4 + 1] = rotation.getY();
+                track.m_Rotations.m_Data[s * 4 + 2] = rotation.getZ();
+                track.m_Rotations.m_Data[s * 4 + 3] = rotation.getW();
+            }
+        }
+
+        memset(&m_Animation, 0, sizeof(m_Animation));
+        m_Animation.m_Id = dmHashString64("anim");
+        m_Animation.m_SampleRate = SAMPLE_RATE;
+        // The last sample is only used for interpolation
+        m_Animation.m_Duration = (SAMPLE_COUNT - 2) / SAMPLE_RATE;
+        m_Animation.m_Tracks.m_Data = m_Tracks;
+        m_Animation.m_Tracks.m_Count = BONE_COUNT;
+
+        memset(&m_AnimationSet, 0, sizeof(m_AnimationSet));
+        m_AnimationSet.m_Animations.m_Data = &m_Animation;
+        m_AnimationSet.m_Animations.m_Count = 1;
+    }
+
+    // A mesh where each vertex is influenced by one to four random bones
+    void CreateMeshSet()
+    {
+        memset(&m_Mesh, 0, sizeof(m_Mesh));
+        m_Mesh.m_Positions.m_Data = new float[VERTEX_COUNT * 3];
+        m_Mesh.m_Positions.m_Count = VERTEX_COUNT * 3;
+        m_Mesh.m_Normals.m_Data = new float[VERTEX_COUNT * 3];
+        m_Mesh.m_Normals.m_Count = VERTEX_COUNT * 3;
+        m_Mesh.m_Tangents.m_Data = new float[VERTEX_COUNT * 4];
+        m_Mesh.m_Tangents.m_Count = VERTEX_COUNT * 4;
+        m_Mesh.m_Weights.m_Data = new float[VERTEX_COUNT * 4];
+        m_Mesh.m_Weights.m_Count = VERTEX_COUNT * 4;
+        m_Mesh.m_BoneIndices.m_Data = new uint32_t[VERTEX_COUNT * 4];
+        m_Mesh.m_BoneIndices.m_Count = VERTEX_COUNT * 4;
+
+        for (uint32_t i = 0; i < VERTEX_COUNT; ++i)
+        {
+            Vector3 normal = RandomDirection();
+            Vector3 tangent = RandomDirection();
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                m_Mesh.m_Positions[i * 3 + c] = RandomFloat(-5.0f, 5.0f);
+                m_Mesh.m_Normals[i * 3 + c] = normal[c];
+                m_Mesh.m_Tangents[i * 4 + c] = tangent[c];
+            }
+            m_Mesh.m_Tangents[i * 4 + 3] = (i & 1) ? 1.0f : -1.0f;
+
+            uint32_t influences = 1 + i % 4;
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                float weight = k < influences ? RandomFloat(0.1f, 1.0f) : 0.0f;
+                m_Mesh.m_Weights[i * 4 + k] = weight;
+                m_Mesh.m_BoneIndices[i * 4 + k] = k < influences ? (uint32_t) RandomFloat(0.0f, (float) BONE_COUNT - 0.01f) : 0;
+                sum += weight;
+            }
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                m_Mesh.m_Weights[i * 4 + k] /= sum;
+            }
+        }
+
+        memset(&m_Model, 0, sizeof(m_Model));
+        m_Model.m_Local = dmTransform::Transform(Vector3(0.0f), Quat::identity(), Vector3(1.0f));
+        m_Model.m_Meshes.m_Data = &m_Mesh;
+        m_Model.m_Meshes.m_Count = 1;
+
+        memset(&m_MeshSet, 0, sizeof(m_MeshSet));
+        m_MeshSet.m_Models.m_Data = &m_Model;
+        m_MeshSet.m_Models.m_Count = 1;
+        m_MeshSet.m_MaxBoneCount = BONE_COUNT;
+    }
+
+    static Matrix4 GetWorldMatrix(uint32_t i)
+    {
+        return Matrix4(Quat::rotationY(i * 0.1f), Vector3((float) (i % 10) * 10.0f, (float) (i / 10) * 10.0f, 0.0f)) * Matrix4::scale(Vector3(1.0f + (i % 3) * 0.5f));
+    }
+
+    dmRig::HRigContext      m_Context;
+    dmRig::HRigContext      m_LookupContext;
+    dmRig::HRigInstance     m_Instances[INSTANCE_COUNT];
+    dmRig::HRigInstance     m_LookupInstances[INSTANCE_COUNT];
+
+    dmRigDDF::Skeleton      m_Skeleton;
+    dmArray<dmRig::RigBone> m_BindPose;
+    dmHashTable64<uint32_t> m_BoneIndices;
+    dmRigDDF::AnimationTrack m_Tracks[BONE_COUNT];
+    dmRigDDF::RigAnimation  m_Animation;
+    dmRigDDF::AnimationSet  m_AnimationSet;
+    dmRig::TrackBoneIndices m_TrackBoneIndices;
+    dmRigDDF::Mesh          m_Mesh;
+    dmRigDDF::Model         m_Model;
+    dmRigDDF::MeshSet       m_MeshSet;
+};
+
+TEST_F(RigPerfTest, Animate)
+{
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        dmRig::Update(m_LookupContext, DT);
+    }
+    uint64_t lookup_time = dmTime::GetTime() - start;
+
+    start = dmTime::GetTime();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        dmRig::Update(m_Context, DT);
+    }
+    uint64_t table_time = dmTime::GetTime() - start;
+
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        const dmArray<dmRig::BonePose>& expected = *dmRig::GetPose(m_LookupInstances[i]);
+        const dmArray<dmRig::BonePose>& actual = *dmRig::GetPose(m_Instances[i]);
+        ASSERT_EQ(0, memcmp(expected.Begin(), actual.Begin(), expected.Size() * sizeof(dmRig::BonePose)));
+    }
+
+    printf("[animate] %u instances, %u tracks | lookup: %7.3f ms | table: %7.3f ms | x%.2f\n", INSTANCE_COUNT, BONE_COUNT,
+            lookup_time * 0.001f / ITERATIONS, table_time * 0.001f / ITERATIONS, table_time ? lookup_time / (float) table_time : 0.0f);
+}
+
+TEST_F(RigPerfTest, Skinning)
+{
+    dmRig::Update(m_Context, 0.3f);
+
+    dmArray<Matrix4> pose_matrices;
+    pose_matrices.SetCapacity(BONE_COUNT);
+    pose_matrices.SetSize(BONE_COUNT);
+    float* positions = new float[VERTEX_COUNT * 3];
+    float* normals = new float[VERTEX_COUNT * 3];
+    float* tangents = new float[VERTEX_COUNT * 4];
+    dmRig::RigModelVertex* expected = new dmRig::RigModelVertex[VERTEX_COUNT];
+    dmRig::RigModelVertex* actual = new dmRig::RigModelVertex[VERTEX_COUNT];
+
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        Matrix4 world = GetWorldMatrix(i);
+        ASSERT_EQ(expected + VERTEX_COUNT, ScalarGenerateVertexData(m_Instances[i], m_BindPose, &m_Mesh, world, pose_matrices, positions, normals, tangents, expected));
+        ASSERT_EQ(actual + VERTEX_COUNT, dmRig::GenerateVertexData(m_Context, m_Instances[i], &m_Mesh, world, actual));
+        for (uint32_t v = 0; v < VERTEX_COUNT; ++v)
+        {
+            // The positions are transformed in a different order (the model matrix is premultiplied into the bone matrices)
+            AssertNearVector(expected[v].pos, actual[v].pos, 3, 0.0005f);
+            AssertNearVector(expected[v].normal, actual[v].normal, 3, 0.0005f);
+            AssertNearVector(expected[v].tangent, actual[v].tangent, 4, 0.0005f);
+        }
+    }
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+            ScalarGenerateVertexData(m_Instances[i], m_BindPose, &m_Mesh, GetWorldMatrix(i), pose_matrices, positions, normals, tangents, expected);
+    }
+    uint64_t scalar_time = dmTime::GetTime() - start;
+
+    start = dmTime::GetTime();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+            dmRig::GenerateVertexData(m_Context, m_Instances[i], &m_Mesh, GetWorldMatrix(i), actual);
+    }
+    uint64_t simd_time = dmTime::GetTime() - start;
+
+    printf("[skinning] %u instances, %u vertices, %u bones | scalar: %7.3f ms | simd: %7.3f ms | x%.2f\n", INSTANCE_COUNT, VERTEX_COUNT, BONE_COUNT,
+            scalar_time * 0.001f / ITERATIONS, simd_time * 0.001f / ITERATIONS, simd_time ? scalar_time / (float) simd_time : 0.0f);
+
+    delete [] positions;
+    delete [] normals;
+    delete [] tangents;
+    delete [] expected;
+    delete [] actual;
+}
+
+TEST_F(RigPerfTest, PoseCache)
+{
+    dmRig::NewContextParams params = {0};
+    params.m_MaxRigInstanceCount = CROWD_COUNT;
+    dmRig::HRigContext contexts[2];
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(params, &contexts[0]));
+    params.m_PoseCache = true;
+    ASSERT_EQ(dmRig::RESULT_OK, dmRig::NewContext(params, &contexts[1]));
+
+    dmRig::HRigInstance* instances[2];
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        instances[c] = new dmRig::HRigInstance[CROWD_COUNT];
+        for (uint32_t i = 0; i < CROWD_COUNT; ++i)
+        {
+            dmRig::InstanceCreateParams create_params = {0};
+            create_params.m_BindPose         = &m_BindPose;
+            create_params.m_BoneIndices      = &m_BoneIndices;
+            create_params.m_Skeleton         = &m_Skeleton;
+            create_params.m_MeshSet          = &m_MeshSet;
+            create_params.m_AnimationSet     = &m_AnimationSet;
+            create_params.m_TrackBoneIndices = &m_TrackBoneIndices;
+            create_params.m_ModelId          = 0;
+            create_params.m_DefaultAnimation = 0x0;
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::InstanceCreate(contexts[c], create_params, &instances[c][i]));
+
+            float offset = (i % CROWD_GROUP_COUNT) / (float) CROWD_GROUP_COUNT;
+            ASSERT_EQ(dmRig::RESULT_OK, dmRig::PlayAnimation(instances[c][i], dmHashString64("anim"), dmRig::PLAYBACK_LOOP_FORWARD, 0.0f, offset, 1.0f));
+        }
+    }
+
+    uint64_t times[2];
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            dmRig::Update(contexts[c], DT);
+        }
+        times[c] = dmTime::GetTime() - start;
+    }
+
+    dmRig::PoseCacheStats stats;
+    dmRig::GetPoseCacheStats(contexts[1], &stats);
+    ASSERT_EQ(CROWD_GROUP_COUNT, stats.m_Misses);
+    ASSERT_EQ(CROWD_COUNT - CROWD_GROUP_COUNT, stats.m_Hits);
+
+    // The cached poses are sampled at the quantized cursor
+    for (uint32_t i = 0; i < CROWD_COUNT; ++i)
+    {
+        const dmArray<dmRig::BonePose>& expected = *dmRig::GetPose(instances[0][i]);
+        const dmArray<dmRig::BonePose>& actual = *dmRig::GetPose(instances[1][i]);
+        for (uint32_t bi = 0; bi < BONE_COUNT; ++bi)
+        {
+            Vector3 expected_translation = expected[bi].m_World.GetTranslation();
+            Vector3 actual_translation = actual[bi].m_World.GetTranslation();
+            Quat expected_rotation = expected[bi].m_World.GetRotation();
+            Quat actual_rotation = actual[bi].m_World.GetRotation();
+            AssertNearVector((const float*) &expected_translation, (const float*) &actual_translation, 3, 0.05f);
+            AssertNearVector((const float*) &expected_rotation, (const float*) &actual_rotation, 4, 0.05f);
+        }
+    }
+
+    printf("[pose cache] %u instances, %u groups, %u bones | uncached: %7.3f ms | cached: %7.3f ms | x%.2f | hits: %u misses: %u\n", CROWD_COUNT, CROWD_GROUP_COUNT, BONE_COUNT,
+            times[0] * 0.001f / ITERATIONS, times[1] * 0.001f / ITERATIONS, times[1] ? times[0] / (float) times[1] : 0.0f, stats.m_Hits, stats.m_Misses);
+
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        for (uint32_t i = 0; i < CROWD_COUNT; ++i)
+        {
+            dmRig::InstanceDestroy(contexts[c], instances[c][i]);
+        }
+        delete [] instances[c];
+        dmRig::DeleteContext(contexts[c]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+
+    int ret = jc_test_run_all();
+    return ret;
+}
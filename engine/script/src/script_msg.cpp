@@ -445,6 +445,54 @@ namespace dmScript
         return 1;
     }
 
+    // Checks the message id at index, and converts the message table that follows it (if any) to the message data.
+    // The data is converted to the DDF message of the id if there is one, or else serialized as a table.
+    static uint32_t CheckMessage(lua_State* L, int index, dmhash_t* out_message_id, const dmDDF::Descriptor** out_desc, char* data)
+    {
+        int top = lua_gettop(L);
+        dmhash_t message_id;
+        if (lua_isstring(L, index))
+        {
+            message_id = dmHashString64(lua_tostring(L, index));
+        }
+        else
+        {
+            message_id = CheckHash(L, index);
+        }
+
+        uint32_t data_size = 0;
+        const dmDDF::Descriptor* desc = dmDDF::GetDescriptorFromHash(message_id);
+        if (desc != 0)
+        {
+            if (desc->m_Size > MAX_MESSAGE_DATA_SIZE)
+            {
+                return luaL_error(L, "The message is too large to be sent (%d bytes, max is %d).", desc->m_Size, MAX_MESSAGE_DATA_SIZE);
+            }
+            if (top > index)
+            {
+                luaL_checktype(L, index + 1, LUA_TTABLE);
+                lua_pushvalue(L, index + 1);
+            }
+            else
+            {
+                lua_newtable(L);
+            }
+            data_size = dmScript::CheckDDF(L, desc, data, MAX_MESSAGE_DATA_SIZE, -1);
+            lua_pop(L, 1);
+        }
+        else if (top > index)
+        {
+            if (!lua_isnil(L, index + 1))
+            {
+                data_size = dmScript::CheckTable(L, data, MAX_MESSAGE_DATA_SIZE, index + 1);
+            }
+        }
+
+        *out_message_id = message_id;
+        *out_desc = desc;
+        return data_size;
+    }
+
     /*# posts a message to a receiving URL
      *
      * Post a message to a receiving URL. The most common case is to send messages
@@ -490,45 +538,9 @@ namespace dmScript
         ResolveURL(L, 1, &receiver, &sender);
 
         dmhash_t message_id;
-        if (lua_isstring(L, 2))
-        {
-            message_id = dmHashString64(lua_tostring(L, 2));
-        }
-        else
-        {
-            message_id = CheckHash(L, 2);
-        }
-
+        const dmDDF::Descriptor* desc;
         char DM_ALIGNED(16) data[MAX_MESSAGE_DATA_SIZE];
-        uint32_t data_size = 0;
-
-
-        const dmDDF::Descriptor* desc = dmDDF::GetDescriptorFromHash(message_id);
-        if (desc != 0)
-        {
-            if (desc->m_Size > MAX_MESSAGE_DATA_SIZE)
-            {
-                return luaL_error(L, "The message is too large to be sent (%d bytes, max is %d).", desc->m_Size, MAX_MESSAGE_DATA_SIZE);
-            }
-            if (top > 2)
-            {
-                luaL_checktype(L, 3, LUA_TTABLE);
-                lua_pushvalue(L, 3);
-            }
-            else
-            {
-                lua_newtable(L);
-            }
-            data_size = dmScript::CheckDDF(L, desc, data, MAX_MESSAGE_DATA_SIZE, -1);
-            lua_pop(L, 1);
-        }
-        else if (top > 2)
-        {
-            if (!lua_isnil(L, 3))
-            {
-                data_size = dmScript::CheckTable(L, data, MAX_MESSAGE_DATA_SIZE, 3);
-            }
-        }
+        uint32_t data_size = CheckMessage(L, 2, &message_id, &desc, data);
 
         assert(top == lua_gettop(L));
 
@@ -549,10 +561,89 @@ namespace dmScript
         return 0;
     }
 
+    // Number of receivers that are resolved before they are posted to
+    static const uint32_t POST_BATCH_SIZE = 64;
+
+    /*# posts a message to several receiving URLs
+     *
+     * Post the same message to several receiving URLs. This is equivalent to calling
+     * [ref:msg.post] for each of the receivers, but the message parameters are only
+     * converted once, and the receivers that share a world are posted to at once.
+     *
+     * The receivers are specified the same way as for [ref:msg.post].
+     *
+     * [icon:attention] There is a 2 kilobyte limit to the message parameter table size.
+     *
+     * @name msg.post_batch
+     * @param receivers [type:table] An array of receivers, where each receiver must be a string in URL-format, a URL object or a hashed string.
+     * @param message_id [type:string|hash] The id must be a string or a hashed string.
+     * @param [message] [type:table|nil] a lua table with message parameters to send.
+     * @examples
+     *
+     * Play the same animation on a list of sprites:
+     *
+     * ```lua
+     * local sprites = { "enemy1#sprite", "enemy2#sprite", "enemy3#sprite" }
+     * msg.post_batch(sprites, "play_animation", { id = hash("run") })
+     * ```
+     */
+    int Msg_PostBatch(lua_State* L)
+    {
+        int top = lua_gettop(L);
+        luaL_checktype(L, 1, LUA_TTABLE);
+
+        dmhash_t message_id;
+        const dmDDF::Descriptor* desc;
+        char DM_ALIGNED(16) data[MAX_MESSAGE_DATA_SIZE];
+        uint32_t data_size = CheckMessage(L, 2, &message_id, &desc, data);
+
+        assert(top == lua_gettop(L));
+
+        dmMessage::URL sender;
+        dmMessage::URL receivers[POST_BATCH_SIZE];
+        uint32_t receiver_count = (uint32_t) lua_objlen(L, 1);
+        for (uint32_t batch_start = 0; batch_start < receiver_count; batch_start += POST_BATCH_SIZE)
+        {
+            uint32_t batch_count = dmMath::Min(POST_BATCH_SIZE, receiver_count - batch_start);
+            for (uint32_t i = 0; i < batch_count; ++i)
+            {
+                lua_rawgeti(L, 1, (int) (batch_start + i + 1));
+                if (lua_isnil(L, -1))
+                {
+                    return luaL_error(L, "The receiver at index %d shouldn't be `nil`", batch_start + i + 1);
+                }
+                ResolveURL(L, lua_gettop(L), &receivers[i], &sender);
+                lua_pop(L, 1);
+            }
+
+            dmMessage::Result result = dmMessage::PostBatch(&sender, receivers, batch_count, message_id, 0, 0, (uintptr_t) desc, data, data_size, 0);
+            if (result != dmMessage::RESULT_OK)
+            {
+                // Find the receiver to report
+                for (uint32_t i = 0; i < batch_count; ++i)
+                {
+                    if (!dmMessage::IsSocketValid(receivers[i].m_Socket))
+                    {
+                        char receiver_buffer[512];
+                        UrlToString(&receivers[i], receiver_buffer, sizeof(receiver_buffer));
+                        char sender_buffer[512];
+                        UrlToString(&sender, sender_buffer, sizeof(sender_buffer));
+                        return luaL_error(L, "Could not send message '%s' from '%s' to '%s'.", dmHashReverseSafe64(message_id), sender_buffer, receiver_buffer);
+                    }
+                }
+                return luaL_error(L, "Could not send message '%s'.", dmHashReverseSafe64(message_id));
+            }
+        }
+
+        assert(top == lua_gettop(L));
+        return 0;
+    }
+
     static const luaL_reg ScriptMsg_methods[] =
     {
         {SCRIPT_TYPE_NAME_URL, URL_new},
         {"post", Msg_Post},
+        {"post_batch", Msg_PostBatch},
         {0, 0}
     };
 
@@ -16,6 +16,7 @@
 #include "script_timer_private.h"
 
 #include <string.h>
+#include <algorithm>
 #include <dlib/index_pool.h>
 #include <dlib/hashtable.h>
 #include <dlib/profile.h>
@@ -42,14 +43,15 @@ namespace dmScript
      */
 
     /*
-        The timers are stored in a flat array with no holes which we scan sequenctially on each update.
+        The timers are stored in a flat array with no holes.
 
         When a timer is removed the last timer in the list may change location (EraseSwap).
 
-        This is to keep the array sweep fast and handle cases where multiple short lived timers are
-        created followed by one long-lived timer. If we did not re-shuffle and keep holes we would keep
-        scanning the array to the end where the only live timer exists skipping all the holes.
-        How much of an issue this is guesswork at this point.
+        The timers are also scheduled in a binary min-heap keyed on their absolute expiry time in the
+        timer world clock, so an update only visits the timers that fire. Timers that fire in the same
+        update are triggered in the order they have in the array, and the timers that died are removed
+        with the same EraseSwap sequence as a full sweep of the array would, so the trigger order does
+        not depend on the heap.
 
         The timer identity is an index into an indirection layer combined with a generation counter,
         this makes it possible to reuse the index for the indirection layer without risk of using
@@ -72,12 +74,15 @@ namespace dmScript
         // Store complete timer handle with generation here to identify stale timer handles
         HTimer          m_Handle;
 
-        // How much time remaining until the timer fires
-        float           m_Remaining;
+        // When the timer fires, in the timer world clock
+        double          m_Expiry;
 
         // The timer delay, we need to keep this for repeating timers
         float           m_Delay;
 
+        // Position in TimerWorld::m_Heap, INVALID_TIMER_HEAP_INDEX when not scheduled
+        uint16_t        m_HeapIndex;
+
         // Flag if the timer should repeat
         uint32_t        m_Repeat : 1;
         // Flag if the timer is alive
@@ -85,15 +90,26 @@ namespace dmScript
     };
 
     #define INVALID_TIMER_LOOKUP_INDEX  0xffffu
+    #define INVALID_TIMER_HEAP_INDEX    0xffffu
     #define INITIAL_TIMER_CAPACITY      8u
     #define MAX_TIMER_CAPACITY          65000u  // Needs to be less that 65535 since 65535 is reserved for invalid index
     #define TIMER_CAPACITY_GROWTH       16u
 
+    struct TimerHeapEntry
+    {
+        double      m_Expiry;
+        uint16_t    m_LookupIndex;
+    };
+
     struct TimerWorld
     {
         dmArray<Timer>                      m_Timers;
         dmArray<uint16_t>                   m_IndexLookup;
         dmIndexPool<uint16_t>               m_IndexPool;
+        dmArray<TimerHeapEntry>             m_Heap;      // Scheduled timers, ordered by expiry
+        dmArray<uint32_t>                   m_Due;       // Timer indices that fire in the current update
+        dmArray<uint32_t>                   m_Dead;      // Timer indices that died in the current update
+        double                              m_Time;
         uint16_t                            m_Version;   // Incremented to avoid collisions each time we push timer indexes back to the m_IndexPool
         uint16_t                            m_InUpdate : 1;
     };
@@ -108,6 +124,106 @@ namespace dmScript
         return (((uint32_t)generation) << 16) | (lookup_index);
     }
 
+    static Timer& GetTimerByLookupIndex(HTimerWorld timer_world, uint16_t lookup_index)
+    {
+        return timer_world->m_Timers[timer_world->m_IndexLookup[lookup_index]];
+    }
+
+    static float GetRemaining(HTimerWorld timer_world, const Timer& timer)
+    {
+        return (float)(timer.m_Expiry - timer_world->m_Time);
+    }
+
+    static void SetHeapEntry(HTimerWorld timer_world, uint32_t heap_index, const TimerHeapEntry& entry)
+    {
+        timer_world->m_Heap[heap_index] = entry;
+        GetTimerByLookupIndex(timer_world, entry.m_LookupIndex).m_HeapIndex = (uint16_t)heap_index;
+    }
+
+    static void SiftUp(HTimerWorld timer_world, uint32_t heap_index)
+    {
+        TimerHeapEntry entry = timer_world->m_Heap[heap_index];
+        while (heap_index > 0)
+        {
+            uint32_t parent = (heap_index - 1) / 2;
+            if (timer_world->m_Heap[parent].m_Expiry <= entry.m_Expiry)
+            {
+                break;
+            }
+            SetHeapEntry(timer_world, heap_index, timer_world->m_Heap[parent]);
+            heap_index = parent;
+        }
+        SetHeapEntry(timer_world, heap_index, entry);
+    }
+
+    static void SiftDown(HTimerWorld timer_world, uint32_t heap_index)
+    {
+        uint32_t size = timer_world->m_Heap.Size();
+        TimerHeapEntry entry = timer_world->m_Heap[heap_index];
+        while (true)
+        {
+            uint32_t child = heap_index * 2 + 1;
+            if (child >= size)
+            {
+                break;
+            }
+            if (child + 1 < size && timer_world->m_Heap[child + 1].m_Expiry < timer_world->m_Heap[child].m_Expiry)
+            {
+                ++child;
+            }
+            if (entry.m_Expiry <= timer_world->m_Heap[child].m_Expiry)
+            {
+                break;
+            }
+            SetHeapEntry(timer_world, heap_index, timer_world->m_Heap[child]);
+            heap_index = child;
+        }
+        SetHeapEntry(timer_world, heap_index, entry);
+    }
+
+    static void ScheduleTimer(HTimerWorld timer_world, Timer& timer)
+    {
+        assert(timer.m_HeapIndex == INVALID_TIMER_HEAP_INDEX);
+        if (timer_world->m_Heap.Full())
+        {
+            uint32_t capacity = dmMath::Min(timer_world->m_Heap.Capacity() + TIMER_CAPACITY_GROWTH, MAX_TIMER_CAPACITY);
+            timer_world->m_Heap.SetCapacity(capacity);
+        }
+        TimerHeapEntry entry;
+        entry.m_Expiry = timer.m_Expiry;
+        entry.m_LookupIndex = GetLookupIndex(timer.m_Handle);
+        timer_world->m_Heap.Push(entry);
+        SiftUp(timer_world, timer_world->m_Heap.Size() - 1);
+    }
+
+    static void UnscheduleTimer(HTimerWorld timer_world, Timer& timer)
+    {
+        uint32_t heap_index = timer.m_HeapIndex;
+        if (heap_index == INVALID_TIMER_HEAP_INDEX)
+        {
+            return;
+        }
+        timer.m_HeapIndex = INVALID_TIMER_HEAP_INDEX;
+
+        TimerHeapEntry last = timer_world->m_Heap.Back();
+        timer_world->m_Heap.Pop();
+        if (heap_index < timer_world->m_Heap.Size())
+        {
+            timer_world->m_Heap[heap_index] = last;
+            SiftDown(timer_world, heap_index);
+            SiftUp(timer_world, GetTimerByLookupIndex(timer_world, last.m_LookupIndex).m_HeapIndex);
+        }
+    }
+
+    static void PushIndex(dmArray<uint32_t>& array, uint32_t index)
+    {
+        if (array.Full())
+        {
+            array.OffsetCapacity(dmMath::Max(array.Capacity(), TIMER_CAPACITY_GROWTH));
+        }
+        array.Push(index);
+    }
+
     static Timer* AllocateTimer(HTimerWorld timer_world, uintptr_t owner)
     {
         assert(timer_world != 0x0);
@@ -141,6 +257,7 @@ namespace dmScript
         Timer& timer = timer_world->m_Timers[timer_count];
         timer.m_Handle = handle;
         timer.m_Owner = owner;
+        timer.m_HeapIndex = INVALID_TIMER_HEAP_INDEX;
 
         uint16_t lookup_index = GetLookupIndex(handle);
 
@@ -181,6 +298,8 @@ namespace dmScript
         timer_world->m_IndexLookup.SetSize(INITIAL_TIMER_CAPACITY);
         memset(&timer_world->m_IndexLookup[0], 0u, INITIAL_TIMER_CAPACITY * sizeof(uint16_t));
         timer_world->m_IndexPool.SetCapacity(INITIAL_TIMER_CAPACITY);
+        timer_world->m_Heap.SetCapacity(INITIAL_TIMER_CAPACITY);
+        timer_world->m_Time = 0.0;
         timer_world->m_Version = 0;
         timer_world->m_InUpdate = 0;
         return timer_world;
@@ -199,26 +318,37 @@ namespace dmScript
 
         timer_world->m_InUpdate = 1;
 
-        // We only scan timers for trigger if the timer *existed at entry to UpdateTimers*, any timers added
-        // in a trigger callback will always be added at the end of m_Timers and not triggered in this scope.
         uint32_t size = timer_world->m_Timers.Size();
         DM_PROPERTY_ADD_U32(rmtp_TimerCount, size);
 
-        for (uint32_t i = 0; i < size; ++i)
+        timer_world->m_Time += dt;
+
+        // We only trigger the timers that are due *at entry to UpdateTimers*, any timers added
+        // in a trigger callback will not be triggered in this scope.
+        dmArray<TimerHeapEntry>& heap = timer_world->m_Heap;
+        timer_world->m_Due.SetSize(0);
+        while (!heap.Empty() && (float)(heap[0].m_Expiry - timer_world->m_Time) <= 0.0f)
         {
+            Timer& timer = GetTimerByLookupIndex(timer_world, heap[0].m_LookupIndex);
+            UnscheduleTimer(timer_world, timer);
+            PushIndex(timer_world->m_Due, timer_world->m_IndexLookup[GetLookupIndex(timer.m_Handle)]);
+        }
+
+        // Trigger in array order. The timers don't move during the update, new timers are added at the end.
+        std::sort(timer_world->m_Due.Begin(), timer_world->m_Due.End());
+
+        uint32_t due_count = timer_world->m_Due.Size();
+        for (uint32_t d = 0; d < due_count; ++d)
+        {
+            uint32_t i = timer_world->m_Due[d];
             Timer* timer = &timer_world->m_Timers[i];
             if (timer->m_IsAlive == 0)
             {
                 continue;
             }
 
-            timer->m_Remaining -= dt;
-            if (timer->m_Remaining > 0.0f)
-            {
-                continue;
-            }
-
-            float elapsed_time = timer->m_Delay - timer->m_Remaining;
+            float remaining = GetRemaining(timer_world, *timer);
+            float elapsed_time = timer->m_Delay - remaining;
 
             TimerEventType eventType = timer->m_Repeat == 0 ? TIMER_EVENT_TRIGGER_WILL_DIE : TIMER_EVENT_TRIGGER_WILL_REPEAT;
 
@@ -235,45 +365,49 @@ namespace dmScript
             if (timer->m_Repeat == 0)
             {
                 timer->m_IsAlive = 0;
+                PushIndex(timer_world->m_Dead, i);
                 continue;
             }
 
             if (timer->m_Delay == 0.0f)
             {
-                timer->m_Remaining = 0.0f;
+                timer->m_Expiry = timer_world->m_Time;
+                ScheduleTimer(timer_world, *timer);
                 continue;
             }
 
-            float wrapped_count = ((-timer->m_Remaining) / timer->m_Delay) + 1.f;
+            float wrapped_count = ((-remaining) / timer->m_Delay) + 1.f;
             float offset_to_next_trigger  = floor(wrapped_count) * timer->m_Delay;
-            timer->m_Remaining += offset_to_next_trigger;
-            if (timer->m_Remaining < 0) // If the delay is very small, the floating point precision might produce issues
-                timer->m_Remaining = timer->m_Delay; // reset the timer
+            remaining += offset_to_next_trigger;
+            if (remaining < 0) // If the delay is very small, the floating point precision might produce issues
+                remaining = timer->m_Delay; // reset the timer
+            timer->m_Expiry = timer_world->m_Time + remaining;
+            ScheduleTimer(timer_world, *timer);
         }
 
         timer_world->m_InUpdate = 0;
 
-        size = timer_world->m_Timers.Size();
-        uint32_t original_size = size;
-        uint32_t i = 0;
-        while (i < size)
+        if (timer_world->m_Dead.Empty())
         {
-            Timer& timer = timer_world->m_Timers[i];
-            if (timer.m_IsAlive == 0)
-            {
-                FreeTimer(timer_world, timer);
-                --size;
-            }
-            else
-            {
-                ++i;
-            }
+            return;
         }
 
-        if (size != original_size)
+        // Free the dead timers the way a sweep of the whole array would: at each dead index, keep
+        // erasing while the timer swapped in from the end is dead as well. Everything before the
+        // first dead index is untouched by the sweep, and the timers swapped in are always dead
+        // or alive, so only the dead indices need to be visited.
+        std::sort(timer_world->m_Dead.Begin(), timer_world->m_Dead.End());
+        uint32_t dead_count = timer_world->m_Dead.Size();
+        for (uint32_t d = 0; d < dead_count; ++d)
         {
-            ++timer_world->m_Version;
+            uint32_t i = timer_world->m_Dead[d];
+            while (i < timer_world->m_Timers.Size() && timer_world->m_Timers[i].m_IsAlive == 0)
+            {
+                FreeTimer(timer_world, timer_world->m_Timers[i]);
+            }
         }
+        timer_world->m_Dead.SetSize(0);
+        ++timer_world->m_Version;
     }
 
     HTimer AddTimer(HTimerWorld timer_world,
@@ -293,11 +427,12 @@ namespace dmScript
         }
 
         timer->m_Delay = delay;
-        timer->m_Remaining = delay;
+        timer->m_Expiry = timer_world->m_Time + delay;
         timer->m_UserData = userdata;
         timer->m_Callback = timer_callback;
         timer->m_Repeat = repeat;
         timer->m_IsAlive = 1;
+        ScheduleTimer(timer_world, *timer);
 
         return timer->m_Handle;
     }
@@ -329,11 +464,17 @@ namespace dmScript
         }
 
         timer.m_IsAlive = 0;
+        UnscheduleTimer(timer_world, timer);
+        if (timer_world->m_InUpdate == 1)
+        {
+            PushIndex(timer_world->m_Dead, timer_index);
+        }
         timer.m_Callback(timer_world, TIMER_EVENT_CANCELLED, timer.m_Handle, 0.f, timer.m_Owner, timer.m_UserData);
 
         if (timer_world->m_InUpdate == 0)
         {
-            FreeTimer(timer_world, timer);
+            // The callback may have added timers, so look the timer up again
+            FreeTimer(timer_world, GetTimerByLookupIndex(timer_world, lookup_index));
             ++timer_world->m_Version;
         }
         return true;
@@ -358,6 +499,11 @@ namespace dmScript
             if (timer.m_IsAlive == 1)
             {
                 timer.m_IsAlive = 0;
+                UnscheduleTimer(timer_world, timer);
+                if (timer_world->m_InUpdate == 1)
+                {
+                    PushIndex(timer_world->m_Dead, timer_index);
+                }
                 ++cancelled_count;
             }
 
@@ -711,7 +857,7 @@ namespace dmScript
             return 1;
         }
 
-        LuaTimerCallbackArgs args = { timer.m_Handle, timer.m_Delay - timer.m_Remaining };
+        LuaTimerCallbackArgs args = { timer.m_Handle, timer.m_Delay - GetRemaining(timer_world, timer) };
         InvokeCallback(callback, LuaTimerCallbackArgsCB, &args);
 
         lua_pushboolean(L, 1);
@@ -786,7 +932,7 @@ namespace dmScript
         }
 
         lua_newtable(L);
-        lua_pushnumber(L,timer.m_Remaining);
+        lua_pushnumber(L,GetRemaining(timer_world, timer));
         lua_setfield(L, -2, "time_remaining");
         lua_pushnumber(L,timer.m_Delay);
         lua_setfield(L, -2, "delay");
@@ -2299,6 +2299,222 @@ namespace dmScript
         return 1;
     }
 
+    // The in-place functions below write their result into an existing value (the first argument),
+    // instead of allocating a new userdata per operation. The output value itself is not NaN-checked,
+    // since it is about to be overwritten.
+    static void* CheckOutValue(lua_State* L, const char* function_name, ScriptUserType* out_type)
+    {
+        ScriptUserType type = GetType(L, 1);
+        if (type == SCRIPT_TYPE_UNKNOWN || type == SCRIPT_TYPE_VECTOR)
+        {
+            luaL_error(L, "%s.%s expects a (%s|%s|%s|%s) as the first argument.", SCRIPT_LIB_NAME, function_name,
+                SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4, SCRIPT_TYPE_NAME_QUAT, SCRIPT_TYPE_NAME_MATRIX4);
+        }
+        *out_type = type;
+        return lua_touserdata(L, 1);
+    }
+
+    /*# sets the value of an existing vector, quaternion or matrix
+     *
+     * Copies the components of `v` into `out`, or sets the components of `out` from
+     * numbers. No new value is created, which makes this function suitable for
+     * reusing temporaries in code that runs every frame.
+     *
+     * @name vmath.set
+     * @param out [type:vector3|vector4|quat|matrix4] value to modify
+     * @param v [type:vector3|vector4|quat|matrix4|number] value to copy, of the same type as `out`, or the first of the components to set
+     * @return out [type:vector3|vector4|quat|matrix4] the modified value
+     * @examples
+     *
+     * ```lua
+     * function init(self)
+     *     self.pos = vmath.vector3()
+     * end
+     *
+     * function update(self, dt)
+     *     vmath.set(self.pos, go.get_position())
+     *     vmath.set(self.pos, 1, 2, 3)
+     * end
+     * ```
+     */
+    static int Set(lua_State* L)
+    {
+        ScriptUserType type;
+        void* out = CheckOutValue(L, "set", &type);
+
+        if (lua_isnumber(L, 2))
+        {
+            float x = (float) luaL_checknumber(L, 2);
+            float y = (float) luaL_checknumber(L, 3);
+            if (type == SCRIPT_TYPE_VECTOR3)
+            {
+                *(Vector3*)out = Vector3(x, y, (float) luaL_checknumber(L, 4));
+            }
+            else if (type == SCRIPT_TYPE_VECTOR4)
+            {
+                *(Vector4*)out = Vector4(x, y, (float) luaL_checknumber(L, 4), (float) luaL_checknumber(L, 5));
+            }
+            else if (type == SCRIPT_TYPE_QUAT)
+            {
+                *(Quat*)out = Quat(x, y, (float) luaL_checknumber(L, 4), (float) luaL_checknumber(L, 5));
+            }
+            else
+            {
+                return luaL_error(L, "%s.%s can not set a %s from numbers.", SCRIPT_LIB_NAME, "set", SCRIPT_TYPE_NAME_MATRIX4);
+            }
+        }
+        else
+        {
+            if (GetType(L, 2) != type)
+            {
+                return luaL_error(L, "%s.%s Arguments needs to be of same type!", SCRIPT_LIB_NAME, "set");
+            }
+            switch (type)
+            {
+                case SCRIPT_TYPE_VECTOR3: *(Vector3*)out = *CheckVector3(L, 2); break;
+                case SCRIPT_TYPE_VECTOR4: *(Vector4*)out = *CheckVector4(L, 2); break;
+                case SCRIPT_TYPE_QUAT:    *(Quat*)out = *CheckQuat(L, 2); break;
+                default:                  *(Matrix4*)out = *CheckMatrix4(L, 2); break;
+            }
+        }
+        lua_pushvalue(L, 1);
+        return 1;
+    }
+
+    /*# adds two vectors in place
+     *
+     * Stores `v1 + v2` in `out`, without creating a new vector.
+     * `out` may be the same value as `v1` or `v2`.
+     *
+     * @name vmath.add
+     * @param out [type:vector3|vector4] vector to store the result in
+     * @param v1 [type:vector3|vector4] first vector
+     * @param v2 [type:vector3|vector4] second vector
+     * @return out [type:vector3|vector4] the modified vector
+     * @examples
+     *
+     * ```lua
+     * -- same as self.pos = self.pos + self.velocity, but without allocating
+     * vmath.add(self.pos, self.pos, self.velocity)
+     * ```
+     */
+    static int Add(lua_State* L)
+    {
+        ScriptUserType type;
+        void* out = CheckOutValue(L, "add", &type);
+        if (type == SCRIPT_TYPE_VECTOR3)
+        {
+            *(Vector3*)out = *CheckVector3(L, 2) + *CheckVector3(L, 3);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4)
+        {
+            *(Vector4*)out = *CheckVector4(L, 2) + *CheckVector4(L, 3);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s) as arguments.", SCRIPT_LIB_NAME, "add", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4);
+        }
+        lua_pushvalue(L, 1);
+        return 1;
+    }
+
+    /*# subtracts two vectors in place
+     *
+     * Stores `v1 - v2` in `out`, without creating a new vector.
+     * `out` may be the same value as `v1` or `v2`.
+     *
+     * @name vmath.sub
+     * @param out [type:vector3|vector4] vector to store the result in
+     * @param v1 [type:vector3|vector4] first vector
+     * @param v2 [type:vector3|vector4] second vector
+     * @return out [type:vector3|vector4] the modified vector
+     * @examples
+     *
+     * ```lua
+     * vmath.sub(self.dir, target_pos, self.pos)
+     * ```
+     */
+    static int Sub(lua_State* L)
+    {
+        ScriptUserType type;
+        void* out = CheckOutValue(L, "sub", &type);
+        if (type == SCRIPT_TYPE_VECTOR3)
+        {
+            *(Vector3*)out = *CheckVector3(L, 2) - *CheckVector3(L, 3);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4)
+        {
+            *(Vector4*)out = *CheckVector4(L, 2) - *CheckVector4(L, 3);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s) as arguments.", SCRIPT_LIB_NAME, "sub", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4);
+        }
+        lua_pushvalue(L, 1);
+        return 1;
+    }
+
+    /*# multiplies values in place
+     *
+     * Stores `a * b` in `out`, without creating a new value. The supported combinations
+     * are the same as for the `*` operator:
+     *
+     * - `vector3`/`vector4` and a number, in either order
+     * - `quat` and `quat`
+     * - `matrix4` and `matrix4`, or `matrix4` and a number
+     * - `matrix4` and `vector4`, stored in a `vector4`
+     *
+     * `out` may be the same value as `a` or `b`.
+     *
+     * @name vmath.mul
+     * @param out [type:vector3|vector4|quat|matrix4] value to store the result in
+     * @param a [type:vector3|vector4|quat|matrix4|number] first operand
+     * @param b [type:vector3|vector4|quat|matrix4|number] second operand
+     * @return out [type:vector3|vector4|quat|matrix4] the modified value
+     * @examples
+     *
+     * ```lua
+     * -- same as self.pos = self.pos + self.velocity * dt, but without allocating
+     * vmath.mul(self.step, self.velocity, dt)
+     * vmath.add(self.pos, self.pos, self.step)
+     * ```
+     */
+    static int Mul(lua_State* L)
+    {
+        ScriptUserType type;
+        void* out = CheckOutValue(L, "mul", &type);
+        // The number operand may be on either side for scalar multiplication
+        int value_index = lua_isnumber(L, 2) ? 3 : 2;
+        int number_index = value_index == 2 ? 3 : 2;
+
+        if (type == SCRIPT_TYPE_VECTOR3)
+        {
+            *(Vector3*)out = *CheckVector3(L, value_index) * (float) luaL_checknumber(L, number_index);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4 && GetType(L, 2) == SCRIPT_TYPE_MATRIX4)
+        {
+            *(Vector4*)out = *CheckMatrix4(L, 2) * *CheckVector4(L, 3);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4)
+        {
+            *(Vector4*)out = *CheckVector4(L, value_index) * (float) luaL_checknumber(L, number_index);
+        }
+        else if (type == SCRIPT_TYPE_QUAT)
+        {
+            *(Quat*)out = *CheckQuat(L, 2) * *CheckQuat(L, 3);
+        }
+        else if (lua_isnumber(L, number_index))
+        {
+            *(Matrix4*)out = *CheckMatrix4(L, value_index) * (float) lua_tonumber(L, number_index);
+        }
+        else
+        {
+            *(Matrix4*)out = *CheckMatrix4(L, 2) * *CheckMatrix4(L, 3);
+        }
+        lua_pushvalue(L, 1);
+        return 1;
+    }
+
     static const luaL_reg methods[] =
     {
         {SCRIPT_TYPE_NAME_VECTOR, Vector_new},
@@ -2335,6 +2551,10 @@ namespace dmScript
         {"inv", Inverse},
         {"ortho_inv", OrthoInverse},
         {"mul_per_elem", MulPerElem},
+        {"set", Set},
+        {"add", Add},
+        {"sub", Sub},
+        {"mul", Mul},
         {0, 0}
     };
 
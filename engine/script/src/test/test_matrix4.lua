@@ -159,6 +159,18 @@ assert(m.c3.x == 8, "translation .x")
 assert(m.c3.y == 7, "translation .y")
 assert(m.c3.z == 6, "translation .z")
 
+-- in place
+local out = vmath.matrix4()
+local ma = vmath.matrix4_translation(vmath.vector3(1, 2, 3))
+local mb = vmath.matrix4_rotation_z(0.5)
+local r = vmath.mul(out, ma, mb)
+assert(r == out, "mul does not return out")
+assert(tostring(out) == tostring(ma * mb), "mul")
+vmath.mul(out, out, 2)
+assert(tostring(out) == tostring(ma * mb * 2), "mul number")
+vmath.set(out, ma)
+assert(tostring(out) == tostring(ma), "set")
+
 -- tostring and concat
 m = vmath.matrix4_translation(vmath.vector4(8,7,6,-1))
 assert(("foo " .. tostring(m)) == "foo vmath.matrix4(1, 0, 0, 8, 0, 1, 0, 7, 0, 0, 1, 6, 0, 0, 0, 1)")
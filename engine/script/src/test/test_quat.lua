@@ -108,6 +108,18 @@ assert(math.abs(vmath.length_sqr(q) - 1) < 0.0000001, "normalized not unit lengt
 local t = 1 / vmath.length(vmath.quat(1, 2, 3, 4))
 assert(math.abs(q.x - t) < 0.000001 and math.abs(q.y - 2*t) < 0.000001 and math.abs(q.z - 3*t) < 0.000001 and math.abs(q.w - 4*t) < 0.000001, "normalize")
 
+-- in place
+local out = vmath.quat()
+local qa = vmath.quat_rotation_z(0.5)
+local qb = vmath.quat_rotation_x(0.25)
+local r = vmath.mul(out, qa, qb)
+assert(r == out, "mul does not return out")
+assert(out == qa * qb, "mul")
+vmath.set(out, 1, 2, 3, 4)
+assert(out == vmath.quat(1, 2, 3, 4), "set")
+vmath.set(out, qa)
+assert(out == qa, "set")
+
 -- tostring and concat
 q = vmath.quat(1, 2, 3, 4)
 assert(("foo " .. tostring(q)) == "foo vmath.quat(1, 2, 3, 4)")
@@ -19,6 +19,7 @@
 #include "test_script.h"
 
 #include <testmain/testmain.h>
+#include <dlib/array.h>
 #include <dlib/dstrings.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
@@ -710,6 +711,80 @@ TEST_F(ScriptMsgTest, TestFailPost)
 }
 
 
+static void DispatchCallbackPostBatch(dmMessage::Message *message, void* user_ptr)
+{
+    // Stores the receiver paths in dispatch order
+    dmArray<dmhash_t>* paths = (dmArray<dmhash_t>*) user_ptr;
+    assert(message->m_Id == dmHashString64("table"));
+    paths->OffsetCapacity(1);
+    paths->Push(message->m_Receiver.m_Path);
+}
+
+TEST_F(ScriptMsgTest, TestPostBatch)
+{
+    int top = lua_gettop(L);
+
+    dmMessage::HSocket socket;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("socket", &socket));
+
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "msg.post_batch({\"socket:path1\", \"path2\", msg.url(\"socket:path3\"), hash(\"path4\")}, \"table\", {uint_value = 1})\n"
+        ));
+
+    dmArray<dmhash_t> paths;
+    ASSERT_EQ(2u, dmMessage::Dispatch(socket, DispatchCallbackPostBatch, &paths));
+    ASSERT_EQ(2u, dmMessage::Dispatch(m_DefaultURL.m_Socket, DispatchCallbackPostBatch, &paths));
+    ASSERT_EQ(4u, paths.Size());
+    ASSERT_EQ(dmHashString64("path1"), paths[0]);
+    ASSERT_EQ(dmHashString64("path3"), paths[1]);
+    ASSERT_EQ(dmHashString64("path2"), paths[2]);
+    ASSERT_EQ(dmHashString64("path4"), paths[3]);
+
+    // More receivers than are posted at once
+    ASSERT_TRUE(dmScriptTest::RunString(L,
+        "local receivers = {}\n"
+        "for i = 1,150 do receivers[i] = \"socket:path\" end\n"
+        "msg.post_batch(receivers, \"table\")\n"
+        "msg.post_batch({}, \"table\")\n"
+        ));
+    paths.SetSize(0);
+    ASSERT_EQ(150u, dmMessage::Dispatch(socket, DispatchCallbackPostBatch, &paths));
+
+    ASSERT_FALSE(dmScriptTest::RunString(L,
+        "msg.post_batch({\"socket:\", \"socket2:\"}, \"table\")\n"
+        ));
+    ASSERT_FALSE(dmScriptTest::RunString(L,
+        "msg.post_batch(\"socket:\", \"table\")\n"
+        ));
+    dmMessage::Consume(socket);
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(socket));
+
+    ASSERT_EQ(top+2, lua_gettop(L));
+    lua_pop(L, lua_gettop(L)-top);
+}
+
+TEST_F(ScriptMsgTest, TestPostBatchPerf)
+{
+    const uint32_t count = 10000;
+    char program[512];
+
+    // Same receivers and message as TestPerf, but posted in batches of 100
+    dmSnPrintf(program, sizeof(program),
+        "local receivers = {}\n"
+        "for i = 1,100 do receivers[i] = \"test_path\" end\n"
+        "for i = 1,%u do\n"
+        "    msg.post_batch(receivers, \"table\", {uint_value = 1})\n"
+        "end\n",
+        count / 100);
+    uint64_t time = dmTime::GetTime();
+    ASSERT_TRUE(dmScriptTest::RunString(L, program));
+    time = dmTime::GetTime() - time;
+    printf("Time per batched post: %.4f\n", time / (double)count);
+
+    ASSERT_EQ(count, dmMessage::Consume(m_DefaultURL.m_Socket));
+}
+
 TEST_F(ScriptMsgTest, TestURLCreateBeforeSocket)
 {
     int top = lua_gettop(L);
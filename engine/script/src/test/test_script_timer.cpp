@@ -665,6 +665,97 @@ TEST_F(ScriptTimerTest, TestShortRepeatTimerCallback)
     dmScript::DeleteTimerWorld(timer_world);
 }
 
+struct TriggerOrder
+{
+    static dmScript::HTimer order[8];
+    static uint32_t count;
+};
+
+dmScript::HTimer TriggerOrder::order[8];
+uint32_t TriggerOrder::count = 0;
+
+static void TriggerOrderCallback(dmScript::HTimerWorld timer_world, dmScript::TimerEventType event_type, dmScript::HTimer timer_handle, float time_elapsed, uintptr_t owner, uintptr_t userdata)
+{
+    if (event_type != dmScript::TIMER_EVENT_CANCELLED && TriggerOrder::count < 8)
+    {
+        TriggerOrder::order[TriggerOrder::count++] = timer_handle;
+    }
+}
+
+TEST_F(ScriptTimerTest, TestTriggerOrder)
+{
+    dmScript::HTimerWorld timer_world = dmScript::NewTimerWorld();
+    TriggerOrder::count = 0;
+
+    // Timers that fire in the same update are triggered in creation order, not in expiry order
+    dmScript::HTimer handles[5] = {
+        dmScript::AddTimer(timer_world, 1.5f, false, TriggerOrderCallback, 0x10, 0x0),
+        dmScript::AddTimer(timer_world, 0.5f, false, TriggerOrderCallback, 0x10, 0x0),
+        dmScript::AddTimer(timer_world, 1.0f, false, TriggerOrderCallback, 0x10, 0x0),
+        dmScript::AddTimer(timer_world, 1.5f, false, TriggerOrderCallback, 0x10, 0x0),
+        dmScript::AddTimer(timer_world, 1.25f, false, TriggerOrderCallback, 0x10, 0x0)
+    };
+
+    dmScript::UpdateTimers(timer_world, 0.5f);
+    ASSERT_EQ(1u, TriggerOrder::count);
+    ASSERT_EQ(handles[1], TriggerOrder::order[0]);
+
+    // The last timer has taken the place of the dead one
+    TriggerOrder::count = 0;
+    dmScript::UpdateTimers(timer_world, 1.0f);
+    ASSERT_EQ(4u, TriggerOrder::count);
+    ASSERT_EQ(handles[0], TriggerOrder::order[0]);
+    ASSERT_EQ(handles[4], TriggerOrder::order[1]);
+    ASSERT_EQ(handles[2], TriggerOrder::order[2]);
+    ASSERT_EQ(handles[3], TriggerOrder::order[3]);
+
+    ASSERT_EQ(0u, GetAliveTimers(timer_world));
+
+    dmScript::DeleteTimerWorld(timer_world);
+}
+
+TEST_F(ScriptTimerTest, TestManyLongTimers)
+{
+    dmScript::HTimerWorld timer_world = dmScript::NewTimerWorld();
+
+    // Many timers that don't fire, and a few that do
+    const uint32_t timer_count = 10000;
+    dmArray<dmScript::HTimer> handles;
+    handles.SetCapacity(timer_count);
+    for (uint32_t i = 0; i < timer_count; ++i)
+    {
+        float delay = (i % 1000) == 0 ? 0.5f : 100.0f + i;
+        handles.Push(dmScript::AddTimer(timer_world, delay, (i % 2000) == 0, TestCallback, 0x10, 0x0));
+        ASSERT_NE(dmScript::INVALID_TIMER_HANDLE, handles[i]);
+    }
+
+    dmScript::UpdateTimers(timer_world, 0.25f);
+    ASSERT_EQ(0u, TimerTestCallback::callback_count);
+    dmScript::UpdateTimers(timer_world, 0.25f);
+    ASSERT_EQ(10u, TimerTestCallback::callback_count);
+    ASSERT_EQ(timer_count - 5, GetAliveTimers(timer_world));
+
+    // Cancelling a long timer removes it from the schedule
+    ASSERT_TRUE(dmScript::CancelTimer(timer_world, handles[1]));
+    ASSERT_FALSE(dmScript::CancelTimer(timer_world, handles[1000]));
+    ASSERT_EQ(timer_count - 6, GetAliveTimers(timer_world));
+
+    dmScript::UpdateTimers(timer_world, 0.5f);
+    ASSERT_EQ(15u, TimerTestCallback::callback_count);
+
+    // The first long timer fires after 102 seconds
+    dmScript::UpdateTimers(timer_world, 100.0f);
+    ASSERT_EQ(20u, TimerTestCallback::callback_count);
+    dmScript::UpdateTimers(timer_world, 1.0f);
+    ASSERT_EQ(26u, TimerTestCallback::callback_count);
+    ASSERT_EQ(timer_count - 7, GetAliveTimers(timer_world));
+
+    ASSERT_EQ(timer_count - 7, dmScript::KillTimers(timer_world, 0x10));
+    ASSERT_EQ(0u, GetAliveTimers(timer_world));
+
+    dmScript::DeleteTimerWorld(timer_world);
+}
+
 TEST_F(ScriptTimerTest, TestKillTimers)
 {
     dmScript::HTimerWorld timer_world = dmScript::NewTimerWorld();
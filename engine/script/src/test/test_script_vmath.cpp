@@ -106,6 +106,14 @@ TEST_F(ScriptVmathTest, TestVector3Fail)
     ASSERT_FALSE(RunString(L, "local s = vmath.mul_per_elem(vmath.vector3(1,2,3))"));
     ASSERT_FALSE(RunString(L, "local s = vmath.mul_per_elem(vmath.vector3(1,2,3), 1)"));
     ASSERT_FALSE(RunString(L, "local s = vmath.mul_per_elem(1, 1)"));
+    // In place
+    ASSERT_FALSE(RunString(L, "vmath.add(1, vmath.vector3(), vmath.vector3())"));
+    ASSERT_FALSE(RunString(L, "vmath.add(vmath.vector3(), vmath.vector3(), vmath.vector4())"));
+    ASSERT_FALSE(RunString(L, "vmath.sub(vmath.vector3(), vmath.vector3(), 1)"));
+    ASSERT_FALSE(RunString(L, "vmath.mul(vmath.vector3(), vmath.vector3(), vmath.vector3())"));
+    ASSERT_FALSE(RunString(L, "vmath.set(vmath.vector3(), vmath.vector4())"));
+    ASSERT_FALSE(RunString(L, "vmath.set(vmath.vector3(), 1, 2)"));
+    ASSERT_FALSE(RunString(L, "vmath.set(vmath.matrix4(), 1, 2, 3, 4)"));
 }
 
 TEST_F(ScriptVmathTest, TestVector4)
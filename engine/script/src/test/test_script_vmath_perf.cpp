@@ -0,0 +1,139 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <jc_test/jc_test.h>
+#include <testmain/testmain.h>
+#include <dlib/math.h>
+#include <dlib/time.h>
+
+#include "script.h"
+
+extern "C"
+{
+#include <lua/lua.h>
+#include <lua/lauxlib.h>
+}
+
+// Compares the vmath operators, which allocate a new userdata per operation,
+// with the in-place vmath.add/vmath.mul functions
+
+static const uint32_t OPS_PER_FRAME = 1000000;
+
+// Each iteration is two vector operations: a mul and an add
+static const char* OPERATOR_SCRIPT =
+    "return function(n, dt)\n"
+    "    local pos = vmath.vector3(0, 0, 0)\n"
+    "    local vel = vmath.vector3(1, 2, 3)\n"
+    "    for i = 1, n do\n"
+    "        pos = pos + vel * dt\n"
+    "    end\n"
+    "    return pos\n"
+    "end\n";
+
+static const char* IN_PLACE_SCRIPT =
+    "return function(n, dt)\n"
+    "    local pos = vmath.vector3(0, 0, 0)\n"
+    "    local vel = vmath.vector3(1, 2, 3)\n"
+    "    local step = vmath.vector3()\n"
+    "    local add, mul = vmath.add, vmath.mul\n"
+    "    for i = 1, n do\n"
+    "        add(pos, pos, mul(step, vel, dt))\n"
+    "    end\n"
+    "    return pos\n"
+    "end\n";
+
+class ScriptVmathPerfTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        m_Context = dmScript::NewContext(0, 0, true);
+        dmScript::Initialize(m_Context);
+        L = dmScript::GetLuaState(m_Context);
+    }
+
+    virtual void TearDown()
+    {
+        dmScript::Finalize(m_Context);
+        dmScript::DeleteContext(m_Context);
+    }
+
+    // Runs one frame of the script, returns the time in microseconds and the number of bytes allocated
+    void RunFrame(const char* script, dmVMath::Vector3* result, uint64_t* time, uint32_t* allocated_kb)
+    {
+        int top = lua_gettop(L);
+        ASSERT_EQ(0, luaL_loadstring(L, script));
+        ASSERT_EQ(0, lua_pcall(L, 0, 1, 0));
+
+        // Timing with the collector running, as in a game
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        lua_pushvalue(L, -1);
+        lua_pushinteger(L, OPS_PER_FRAME / 2);
+        lua_pushnumber(L, 1.0 / 60.0);
+        uint64_t start = dmTime::GetTime();
+        ASSERT_EQ(0, lua_pcall(L, 2, 1, 0));
+        *time = dmTime::GetTime() - start;
+        *result = *dmScript::CheckVector3(L, -1);
+        lua_pop(L, 1);
+
+        // Allocations with the collector stopped, so that the heap growth is everything that was allocated
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        lua_gc(L, LUA_GCSTOP, 0);
+        int before = lua_gc(L, LUA_GCCOUNT, 0);
+        lua_pushvalue(L, -1);
+        lua_pushinteger(L, OPS_PER_FRAME / 2);
+        lua_pushnumber(L, 1.0 / 60.0);
+        ASSERT_EQ(0, lua_pcall(L, 2, 1, 0));
+        *allocated_kb = (uint32_t) (lua_gc(L, LUA_GCCOUNT, 0) - before);
+        lua_pop(L, 2);
+        lua_gc(L, LUA_GCRESTART, 0);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+
+        ASSERT_EQ(top, lua_gettop(L));
+    }
+
+    dmScript::HContext m_Context;
+    lua_State* L;
+};
+
+TEST_F(ScriptVmathPerfTest, VectorOps)
+{
+    dmVMath::Vector3 operator_result, in_place_result;
+    uint64_t operator_time, in_place_time;
+    uint32_t operator_kb, in_place_kb;
+    RunFrame(OPERATOR_SCRIPT, &operator_result, &operator_time, &operator_kb);
+    RunFrame(IN_PLACE_SCRIPT, &in_place_result, &in_place_time, &in_place_kb);
+
+    // Both forms do the same float operations in the same order
+    ASSERT_EQ(operator_result.getX(), in_place_result.getX());
+    ASSERT_EQ(operator_result.getY(), in_place_result.getY());
+    ASSERT_EQ(operator_result.getZ(), in_place_result.getZ());
+
+    // The in-place form only allocates its three vectors
+    ASSERT_GT(operator_kb, 1000u);
+    ASSERT_LT(in_place_kb, 8u);
+
+    printf("[vmath] %u ops/frame | operators: %7.3f ms %6u kb | in place: %7.3f ms %6u kb | x%.2f\n", OPS_PER_FRAME,
+            operator_time / 1000.0, operator_kb, in_place_time / 1000.0, in_place_kb,
+            operator_time / (double) dmMath::Max(in_place_time, (uint64_t) 1));
+}
+
+int main(int argc, char **argv)
+{
+    TestMainPlatformInit();
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
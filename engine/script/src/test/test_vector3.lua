@@ -124,6 +124,22 @@ assert(v.x == 5, "v.x is not 5")
 assert(v.y ==12, "v.y is not 12")
 assert(v.z ==21, "v.z is not 21")
 
+-- in place
+local out = vmath.vector3()
+local r = vmath.add(out, vmath.vector3(1, 2, 3), vmath.vector3(2, 3, 4))
+assert(r == out, "add does not return out")
+assert(out == vmath.vector3(3, 5, 7), "add")
+vmath.sub(out, out, vmath.vector3(1, 1, 1))
+assert(out == vmath.vector3(2, 4, 6), "sub")
+vmath.mul(out, out, 2)
+assert(out == vmath.vector3(4, 8, 12), "mul")
+vmath.mul(out, 0.5, out)
+assert(out == vmath.vector3(2, 4, 6), "mul")
+vmath.set(out, 7, 8, 9)
+assert(out == vmath.vector3(7, 8, 9), "set")
+vmath.set(out, vmath.vector3(1, 2, 3))
+assert(out == vmath.vector3(1, 2, 3), "set")
+
 -- tostring and concat
 v = vmath.vector3(1, 2, 3)
 assert(("foo " .. tostring(v)) == "foo vmath.vector3(1, 2, 3)")
@@ -134,6 +134,20 @@ assert(v.y ==12, "v.y is not 12")
 assert(v.z ==21, "v.z is not 21")
 assert(v.w ==32, "v.w is not 32")
 
+-- in place
+local out = vmath.vector4()
+local r = vmath.add(out, vmath.vector4(1, 2, 3, 4), vmath.vector4(2, 3, 4, 5))
+assert(r == out, "add does not return out")
+assert(out == vmath.vector4(3, 5, 7, 9), "add")
+vmath.sub(out, out, vmath.vector4(1, 1, 1, 1))
+assert(out == vmath.vector4(2, 4, 6, 8), "sub")
+vmath.mul(out, out, 2)
+assert(out == vmath.vector4(4, 8, 12, 16), "mul")
+vmath.mul(out, vmath.matrix4_translation(vmath.vector3(1, 2, 3)), vmath.vector4(1, 1, 1, 1))
+assert(out == vmath.vector4(2, 3, 4, 1), "mul matrix4")
+vmath.set(out, 7, 8, 9, 10)
+assert(out == vmath.vector4(7, 8, 9, 10), "set")
+
 -- tostring and concat
 v = vmath.vector4(1, 2, 3, 4)
 assert(("foo " .. tostring(v)) == "foo vmath.vector4(1, 2, 3, 4)")
@@ -15,6 +15,8 @@
 #include <stdint.h>
 #include <dlib/array.h>
 #include <dlib/atomic.h>
+#include <dlib/condition_variable.h>
+#include <dlib/dstrings.h>
 #include <dlib/hashtable.h>
 #include <dlib/index_pool.h>
 #include <dlib/log.h>
@@ -51,8 +53,10 @@ namespace dmSound
 
     const dmhash_t MASTER_GROUP_HASH = dmHashString64("master");
     const uint32_t GROUP_MEMORY_BUFFER_COUNT = 64;
+    const uint32_t MAX_MIX_THREADS = 8;
 
     static void SoundThread(void* ctx);
+    static void MixThreadFunc(void* ctx);
 
     /**
      * Value with memory for "ramping" of values. See also struct Ramp below.
@@ -191,6 +195,26 @@ namespace dmSound
         int      m_NextMemorySlot;
     };
 
+    /**
+     * An instance mixed in parallel, see MixInstancesParallel.
+     * The instance is mixed into the zeroed m_Scratch, which is later added to m_GroupMixBuffer.
+     */
+    struct MixVoice
+    {
+        SoundInstance*  m_Instance;
+        float*          m_GroupMixBuffer;
+        float*          m_Scratch;
+        uint32_t        m_MixCount;
+    };
+
+    struct MixThread
+    {
+        struct SoundSystem* m_SoundSystem;
+        dmThread::Thread    m_Thread;
+        // Worker index. Index 0 is the thread calling UpdateInternal
+        uint32_t            m_Index;
+    };
+
     struct SoundSystem
     {
         dmSoundCodec::HCodecContext   m_CodecContext;
@@ -219,9 +243,21 @@ namespace dmSound
         int16_t*                m_OutBuffers[SOUND_OUTBUFFER_COUNT];
         uint16_t                m_NextOutBuffer;
 
+        // Optional threads mixing instances together with the sound thread
+        dmArray<MixThread>      m_MixThreads;
+        dmArray<MixVoice>       m_MixVoices;
+        dmArray<float>          m_MixScratch;
+        dmMutex::HMutex         m_MixMutex;
+        dmConditionVariable::HConditionVariable m_MixStartCond;
+        dmConditionVariable::HConditionVariable m_MixDoneCond;
+        const MixContext*       m_MixJobContext;
+        uint32_t                m_MixJobGeneration;
+        uint32_t                m_MixJobPending;
+
         bool                    m_IsDeviceStarted;
         bool                    m_IsAudioInterrupted;
         bool                    m_HasWindowFocus;
+        bool                    m_MixThreadsRunning;
     };
 
     // Since using threads is optional, we want to make it easy to switch on/off the mutex behavior
@@ -256,6 +292,7 @@ namespace dmSound
         params->m_FrameCount = 768;
         params->m_MaxInstances = 256;
         params->m_UseThread = true;
+        params->m_MixThreadCount = 0;
     }
 
     Result RegisterDevice(struct DeviceType* device)
@@ -345,6 +382,7 @@ namespace dmSound
         uint32_t max_buffers = params->m_MaxBuffers;
         uint32_t max_sources = params->m_MaxSources;
         uint32_t max_instances = params->m_MaxInstances;
+        uint32_t mix_thread_count = params->m_MixThreadCount;
 
         if (config)
         {
@@ -353,6 +391,7 @@ namespace dmSound
             max_buffers = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_buffers", (int32_t) max_buffers);
             max_sources = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_sources", (int32_t) max_sources);
             max_instances = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_instances", (int32_t) max_instances);
+            mix_thread_count = (uint32_t) dmMath::Max(0, dmConfigFile::GetInt(config, "sound.mix_thread_count", (int32_t) mix_thread_count));
         }
 
         sound->m_Instances.SetCapacity(max_instances);
@@ -399,6 +438,39 @@ namespace dmSound
         dmAtomicStore32(&sound->m_IsPaused, 0);
         dmAtomicStore32(&sound->m_Status, (int)RESULT_NOTHING_TO_PLAY);
 
+        sound->m_MixVoices.SetCapacity(max_instances);
+        sound->m_MixMutex = 0;
+        sound->m_MixStartCond = 0;
+        sound->m_MixDoneCond = 0;
+        sound->m_MixJobContext = 0;
+        sound->m_MixJobGeneration = 0;
+        sound->m_MixJobPending = 0;
+        sound->m_MixThreadsRunning = false;
+        if (!dmThread::PlatformHasThreadSupport())
+        {
+            mix_thread_count = 0;
+        }
+        mix_thread_count = dmMath::Min(mix_thread_count, MAX_MIX_THREADS);
+        if (mix_thread_count > 0)
+        {
+            sound->m_MixMutex = dmMutex::New();
+            sound->m_MixStartCond = dmConditionVariable::New();
+            sound->m_MixDoneCond = dmConditionVariable::New();
+            sound->m_MixThreadsRunning = true;
+            // The threads keep pointers into the array, so it must not grow after this point
+            sound->m_MixThreads.SetCapacity(mix_thread_count);
+            sound->m_MixThreads.SetSize(mix_thread_count);
+            for (uint32_t i = 0; i < mix_thread_count; ++i)
+            {
+                char name[32];
+                dmSnPrintf(name, sizeof(name), "sound_mix%u", i);
+                MixThread* thread = &sound->m_MixThreads[i];
+                thread->m_SoundSystem = sound;
+                thread->m_Index = i + 1;
+                thread->m_Thread = dmThread::New((dmThread::ThreadStart)MixThreadFunc, 0x80000, thread, name);
+            }
+        }
+
         sound->m_Thread = 0;
         sound->m_Mutex = 0;
         if (params->m_UseThread)
@@ -423,6 +495,22 @@ namespace dmSound
             dmMutex::Delete(sound->m_Mutex);
         }
 
+        if (sound->m_MixThreads.Size() > 0)
+        {
+            dmMutex::Lock(sound->m_MixMutex);
+            sound->m_MixThreadsRunning = false;
+            dmConditionVariable::Broadcast(sound->m_MixStartCond);
+            dmMutex::Unlock(sound->m_MixMutex);
+
+            for (uint32_t i = 0; i < sound->m_MixThreads.Size(); ++i)
+            {
+                dmThread::Join(sound->m_MixThreads[i].m_Thread);
+            }
+            dmConditionVariable::Delete(sound->m_MixStartCond);
+            dmConditionVariable::Delete(sound->m_MixDoneCond);
+            dmMutex::Delete(sound->m_MixMutex);
+        }
+
         PlatformFinalize();
 
         Result result = RESULT_OK;
@@ -1098,7 +1186,13 @@ namespace dmSound
         mixer(mix_context, instance, rate, mix_rate, mix_buffer, mix_buffer_count);
     }
 
-    static void Mix(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info)
+    static float* GetGroupMixBuffer(SoundSystem* sound, SoundInstance* instance)
+    {
+        int* index = sound->m_GroupMap.Get(instance->m_Group);
+        return index ? sound->m_Groups[*index].m_MixBuffer : 0;
+    }
+
+    static uint32_t Mix(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info, float* mix_buffer)
     {
         DM_PROFILE(__FUNCTION__);
 
@@ -1108,12 +1202,12 @@ namespace dmSound
         mix_count = dmMath::Min(mix_count, sound->m_FrameCount);
         assert(mix_count <= sound->m_FrameCount);
 
-        int* index = sound->m_GroupMap.Get(instance->m_Group);
-        if (index) {
-            SoundGroup* group = &sound->m_Groups[*index];
-            MixResample(mix_context, instance, info, sound->m_MixRate, group->m_MixBuffer, mix_count);
+        if (mix_buffer) {
+            MixResample(mix_context, instance, info, sound->m_MixRate, mix_buffer, mix_count);
+            return mix_count;
         } else {
             dmLogError("Sound group not found");
+            return 0;
         }
     }
 
@@ -1147,7 +1241,8 @@ namespace dmSound
         return false;
     }
 
-    static void MixInstance(const MixContext* mix_context, SoundInstance* instance) {
+    // Decodes and mixes the instance into mix_buffer. Returns the number of mixed frames
+    static uint32_t MixInstance(const MixContext* mix_context, SoundInstance* instance, float* mix_buffer) {
         SoundSystem* sound = g_SoundSystem;
         uint32_t decoded = 0;
 
@@ -1158,13 +1253,13 @@ namespace dmSound
         if (!correct_bit_depth || !correct_num_channels) {
             dmLogError("Only mono/stereo with 8/16 bits per sample is supported (%s): %u bpp %u ch", GetSoundName(sound, instance), (uint32_t)info.m_BitsPerSample, (uint32_t)info.m_Channels);
             instance->m_Playing = 0;
-            return;
+            return 0;
         }
 
         if (info.m_Rate > sound->m_MixRate) {
             dmLogError("Sounds with rate higher than sample-rate not supported (%d hz > %d hz) (%s)", info.m_Rate, sound->m_MixRate, GetSoundName(sound, instance));
             instance->m_Playing = 0;
-            return;
+            return 0;
         }
 
         bool is_muted = dmSound::IsMuted(instance);
@@ -1235,11 +1330,12 @@ namespace dmSound
         if (r != dmSoundCodec::RESULT_OK) {
             dmLogWarning("Unable to decode file '%s'. Result %d", GetSoundName(sound, instance), r);
             instance->m_Playing = 0;
-            return;
+            return 0;
         }
 
+        uint32_t mix_count = 0;
         if (instance->m_FrameCount > 0)
-            Mix(mix_context, instance, &info);
+            mix_count = Mix(mix_context, instance, &info, mix_buffer);
 
         if (instance->m_FrameCount <= 1 && instance->m_EndOfStream) {
             // NOTE: Due to round-off errors, e.g 32000 -> 44100,
@@ -1247,6 +1343,131 @@ namespace dmSound
             // used in the *next* buffer. We truncate such scenarios to 0
             instance->m_FrameCount = 0;
         }
+        return mix_count;
+    }
+
+    // Mixes the part of sound->m_MixVoices belonging to the worker
+    static void MixVoices(SoundSystem* sound, const MixContext* mix_context, uint32_t worker, uint32_t worker_count)
+    {
+        DM_PROFILE(__FUNCTION__);
+        uint32_t voice_count = sound->m_MixVoices.Size();
+        uint32_t begin = (voice_count * worker) / worker_count;
+        uint32_t end = (voice_count * (worker + 1)) / worker_count;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            MixVoice* voice = &sound->m_MixVoices[i];
+            memset(voice->m_Scratch, 0, sound->m_FrameCount * sizeof(float) * SOUND_MAX_MIX_CHANNELS);
+            voice->m_MixCount = MixInstance(mix_context, voice->m_Instance, voice->m_GroupMixBuffer ? voice->m_Scratch : 0);
+        }
+    }
+
+    static void MixThreadFunc(void* ctx)
+    {
+        MixThread* thread = (MixThread*) ctx;
+        SoundSystem* sound = thread->m_SoundSystem;
+        uint32_t generation = 0;
+
+        dmMutex::Lock(sound->m_MixMutex);
+        while (true)
+        {
+            while (sound->m_MixThreadsRunning && sound->m_MixJobGeneration == generation)
+                dmConditionVariable::Wait(sound->m_MixStartCond, sound->m_MixMutex);
+            if (!sound->m_MixThreadsRunning)
+                break;
+
+            generation = sound->m_MixJobGeneration;
+            const MixContext* mix_context = sound->m_MixJobContext;
+            dmMutex::Unlock(sound->m_MixMutex);
+
+            MixVoices(sound, mix_context, thread->m_Index, sound->m_MixThreads.Size() + 1);
+
+            dmMutex::Lock(sound->m_MixMutex);
+            if (--sound->m_MixJobPending == 0)
+                dmConditionVariable::Signal(sound->m_MixDoneCond);
+        }
+        dmMutex::Unlock(sound->m_MixMutex);
+    }
+
+    /*
+     * Decodes and resamples the playing instances on the mix threads and the calling thread.
+     * Each instance is mixed into its own scratch buffer, and the scratch buffers are then
+     * added to the group mix buffers in instance order. The additions to the group buffers
+     * are made in the same order as in the serial mix, and the output doesn't depend on the
+     * number of threads.
+     */
+    static void MixInstancesParallel(const MixContext* mix_context)
+    {
+        DM_PROFILE(__FUNCTION__);
+        SoundSystem* sound = g_SoundSystem;
+
+        sound->m_MixVoices.SetSize(0);
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i) {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (instance->m_Playing || instance->m_FrameCount > 0)
+            {
+                MixVoice voice;
+                voice.m_Instance = instance;
+                voice.m_GroupMixBuffer = GetGroupMixBuffer(sound, instance);
+                voice.m_Scratch = 0;
+                voice.m_MixCount = 0;
+                sound->m_MixVoices.Push(voice);
+            }
+        }
+
+        uint32_t voice_count = sound->m_MixVoices.Size();
+        uint32_t scratch_size = sound->m_FrameCount * SOUND_MAX_MIX_CHANNELS;
+        if (sound->m_MixScratch.Capacity() < voice_count * scratch_size)
+        {
+            sound->m_MixScratch.SetCapacity(voice_count * scratch_size);
+        }
+        sound->m_MixScratch.SetSize(voice_count * scratch_size);
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            sound->m_MixVoices[i].m_Scratch = sound->m_MixScratch.Begin() + i * scratch_size;
+        }
+
+        // Not worth waking the threads for a single instance
+        bool use_threads = voice_count > 1;
+        if (use_threads)
+        {
+            dmMutex::Lock(sound->m_MixMutex);
+            sound->m_MixJobContext = mix_context;
+            sound->m_MixJobPending = sound->m_MixThreads.Size();
+            sound->m_MixJobGeneration++;
+            dmConditionVariable::Broadcast(sound->m_MixStartCond);
+            dmMutex::Unlock(sound->m_MixMutex);
+        }
+
+        MixVoices(sound, mix_context, 0, use_threads ? sound->m_MixThreads.Size() + 1 : 1);
+
+        if (use_threads)
+        {
+            dmMutex::Lock(sound->m_MixMutex);
+            while (sound->m_MixJobPending > 0)
+                dmConditionVariable::Wait(sound->m_MixDoneCond, sound->m_MixMutex);
+            dmMutex::Unlock(sound->m_MixMutex);
+        }
+
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            MixVoice* voice = &sound->m_MixVoices[i];
+            if (voice->m_GroupMixBuffer)
+            {
+                float* out = voice->m_GroupMixBuffer;
+                const float* in = voice->m_Scratch;
+                uint32_t n = voice->m_MixCount * SOUND_MAX_MIX_CHANNELS;
+                for (uint32_t j = 0; j < n; ++j)
+                {
+                    out[j] += in[j];
+                }
+            }
+
+            SoundInstance* instance = voice->m_Instance;
+            if (instance->m_EndOfStream && instance->m_FrameCount == 0) {
+                instance->m_Playing = 0;
+            }
+        }
     }
 
     static void MixInstances(const MixContext* mix_context)
@@ -1286,12 +1507,18 @@ namespace dmSound
             }
         }
 
+        if (sound->m_MixThreads.Size() > 0)
+        {
+            MixInstancesParallel(mix_context);
+            return;
+        }
+
         uint32_t instances = sound->m_Instances.Size();
         for (uint32_t i = 0; i < instances; ++i) {
             SoundInstance* instance = &sound->m_Instances[i];
             if (instance->m_Playing || instance->m_FrameCount > 0)
             {
-                MixInstance(mix_context, instance);
+                MixInstance(mix_context, instance, GetGroupMixBuffer(sound, instance));
             }
 
             if (instance->m_EndOfStream && instance->m_FrameCount == 0) {
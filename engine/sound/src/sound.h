@@ -84,6 +84,8 @@ namespace dmSound
         uint32_t m_FrameCount;
         uint32_t m_MaxInstances;
         bool     m_UseThread;
+        // Number of extra threads decoding and mixing sound instances in parallel (0 = mix on the sound thread only)
+        uint32_t m_MixThreadCount;
 
         InitializeParams()
         {
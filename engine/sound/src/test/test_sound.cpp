@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdlib.h>
+#include <string.h>
 #include <map>
 #include <set>
 #include <vector>
@@ -1610,6 +1611,112 @@ const TestParams2 params_mixer_test[] = {
 INSTANTIATE_TEST_CASE_P(dmSoundMixerTest, dmSoundMixerTest, jc_test_values_in(params_mixer_test));
 #endif
 
+struct MixThreadsSound
+{
+    void*                   m_Sound;
+    uint32_t                m_SoundSize;
+    dmSound::SoundDataType  m_Type;
+    const char*             m_Group;
+    float                   m_Gain;
+    float                   m_Pan;
+    float                   m_Speed;
+    int8_t                  m_Loopcount;
+};
+
+// Plays a fixed set of sounds until they're done, and returns the output of the loopback device
+static void MixThreadsPlay(uint32_t mix_thread_count, dmArray<int16_t>& output)
+{
+    const MixThreadsSound sounds[] = {
+        {DRUMLOOP_WAV, DRUMLOOP_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, "g1", 0.5f, 0.2f, 1.0f, 0},
+        {CLICK_TRACK_OGG, CLICK_TRACK_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, "g1", 0.8f, 0.5f, 1.0f, 0},
+        {ONEFOOTSTEP_WAV, ONEFOOTSTEP_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, "g2", 1.0f, 0.7f, 1.5f, 2},
+        {MONO_TONE_440_32000_64000_WAV, MONO_TONE_440_32000_64000_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, "master", 0.3f, 0.5f, 0.8f, 0},
+        {TONE_MONO_22050_OGG, TONE_MONO_22050_OGG_SIZE, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, "g2", 0.6f, 0.1f, 1.0f, 0},
+        {STEREO_TONE_2000_44100_88200_WAV, STEREO_TONE_2000_44100_88200_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, "g1", 0.2f, 0.9f, 1.0f, 0},
+        {BOOSTER_ON_SFX_WAV, BOOSTER_ON_SFX_WAV_SIZE, dmSound::SOUND_DATA_TYPE_WAV, "master", 0.7f, 0.5f, 2.0f, 1},
+    };
+    const uint32_t sound_count = sizeof(sounds) / sizeof(sounds[0]);
+
+    dmSound::InitializeParams params;
+    params.m_MaxBuffers = MAX_BUFFERS;
+    params.m_MaxSources = MAX_SOURCES;
+    params.m_OutputDevice = "loopback";
+    params.m_FrameCount = 2048;
+    params.m_UseThread = false;
+    params.m_MixThreadCount = mix_thread_count;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Initialize(0, &params));
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::AddGroup("g1"));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::AddGroup("g2"));
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetGroupGain(dmHashString64("g2"), 0.6f));
+
+    dmSound::HSoundData sound_data[sound_count];
+    dmSound::HSoundInstance instances[sound_count];
+    for (uint32_t i = 0; i < sound_count; ++i)
+    {
+        const MixThreadsSound& s = sounds[i];
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(s.m_Sound, s.m_SoundSize, s.m_Type, &sound_data[i], i));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sound_data[i], &instances[i]));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetInstanceGroup(instances[i], s.m_Group));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetParameter(instances[i], dmSound::PARAMETER_GAIN, dmVMath::Vector4(s.m_Gain, 0, 0, 0)));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetParameter(instances[i], dmSound::PARAMETER_PAN, dmVMath::Vector4(s.m_Pan, 0, 0, 0)));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetParameter(instances[i], dmSound::PARAMETER_SPEED, dmVMath::Vector4(s.m_Speed, 0, 0, 0)));
+        if (s.m_Loopcount)
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::SetLooping(instances[i], 1, s.m_Loopcount));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instances[i]));
+    }
+
+    bool playing = true;
+    while (playing)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+        playing = false;
+        for (uint32_t i = 0; i < sound_count; ++i)
+            playing |= dmSound::IsPlaying(instances[i]);
+    }
+
+    output.SetCapacity(g_LoopbackDevice->m_AllOutput.Size());
+    output.SetSize(0);
+    output.PushArray(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.Size());
+
+    for (uint32_t i = 0; i < sound_count; ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instances[i]));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sound_data[i]));
+    }
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+}
+
+TEST(dmSoundMixThreads, Deterministic)
+{
+    dmArray<int16_t> serial;
+    MixThreadsPlay(0, serial);
+    ASSERT_LT(0u, serial.Size());
+
+    const uint32_t thread_counts[] = {1, 3};
+    dmArray<int16_t> parallel;
+    dmArray<int16_t> reference;
+    for (uint32_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        MixThreadsPlay(thread_counts[t], parallel);
+        ASSERT_EQ(serial.Size(), parallel.Size());
+        for (uint32_t i = 0; i < serial.Size(); ++i)
+        {
+            // Allow for rounding differences if the serial mix contracts the multiply-adds
+            ASSERT_NEAR(serial[i], parallel[i], 1);
+        }
+
+        // The output must not depend on the number of threads
+        if (t == 0)
+        {
+            reference.SetCapacity(parallel.Size());
+            reference.PushArray(parallel.Begin(), parallel.Size());
+            continue;
+        }
+        ASSERT_EQ(0, memcmp(reference.Begin(), parallel.Begin(), reference.Size() * sizeof(int16_t)));
+    }
+}
+
 DM_DECLARE_SOUND_DEVICE(LoopBackDevice, "loopback", DeviceLoopbackOpen, DeviceLoopbackClose, DeviceLoopbackQueue, DeviceLoopbackFreeBufferSlots, DeviceLoopbackDeviceInfo, DeviceLoopbackRestart, DeviceLoopbackStop);
 
 extern "C" void dmExportedSymbols();
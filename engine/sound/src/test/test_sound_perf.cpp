@@ -17,6 +17,7 @@
 #include <vector>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
+#include <dlib/array.h>
 #include <dlib/hash.h>
 #include <dlib/message.h>
 #include <dlib/log.h>
@@ -157,11 +158,140 @@ TEST_F(dmSoundTest, MeasureTremoloSkip)
 }
 #endif
 
+// Like the "null" device, it discards all output. But it always has a free slot, so that every dmSound::Update() mixes one buffer
+static dmSound::Result DeviceBenchOpen(const dmSound::OpenDeviceParams* params, dmSound::HDevice* device)
+{
+    *device = (dmSound::HDevice) 1;
+    return dmSound::RESULT_OK;
+}
+
+static void DeviceBenchClose(dmSound::HDevice device)
+{
+}
+
+static dmSound::Result DeviceBenchQueue(dmSound::HDevice device, const int16_t* samples, uint32_t sample_count)
+{
+    return dmSound::RESULT_OK;
+}
+
+static uint32_t DeviceBenchFreeBufferSlots(dmSound::HDevice device)
+{
+    return 1;
+}
+
+static void DeviceBenchDeviceInfo(dmSound::HDevice device, dmSound::DeviceInfo* info)
+{
+    info->m_MixRate = 44100;
+}
+
+static void DeviceBenchRestart(dmSound::HDevice device)
+{
+}
+
+static void DeviceBenchStop(dmSound::HDevice device)
+{
+}
+
+DM_DECLARE_SOUND_DEVICE(BenchNullDevice, "benchnull", DeviceBenchOpen, DeviceBenchClose, DeviceBenchQueue, DeviceBenchFreeBufferSlots, DeviceBenchDeviceInfo, DeviceBenchRestart, DeviceBenchStop);
+
+class dmSoundMixTest : public jc_test_base_class
+{
+public:
+    static const uint32_t BUFFER_COUNT = 200;
+    static const uint32_t FRAME_COUNT = 768;
+
+    // Returns the average time (in microseconds) to mix one buffer
+    uint64_t MixAndTime(uint32_t voice_count, uint32_t mix_thread_count)
+    {
+        struct Sound
+        {
+            unsigned char* m_Data;
+            uint32_t       m_Size;
+        };
+        const Sound sounds[] = {
+            {AMBIENCE_OGG, AMBIENCE_OGG_SIZE},
+            {GLOCKENSPIEL_OGG, GLOCKENSPIEL_OGG_SIZE},
+            {EXPLOSION_OGG, EXPLOSION_OGG_SIZE},
+            {EXPLOSION_LOW_MONO_OGG, EXPLOSION_LOW_MONO_OGG_SIZE},
+            {MUSIC_OGG, MUSIC_OGG_SIZE},
+            {CYMBAL_OGG, CYMBAL_OGG_SIZE},
+            {MUSIC_LOW_OGG, MUSIC_LOW_OGG_SIZE},
+        };
+        const uint32_t sound_count = sizeof(sounds) / sizeof(sounds[0]);
+
+        dmSound::InitializeParams params;
+        params.m_OutputDevice = "benchnull";
+        params.m_FrameCount = FRAME_COUNT;
+        params.m_UseThread = false;
+        params.m_MixThreadCount = mix_thread_count;
+        if (dmSound::Initialize(0, &params) != dmSound::RESULT_OK)
+            return 0;
+
+        dmSound::HSoundData sound_data[sound_count];
+        for (uint32_t i = 0; i < sound_count; ++i)
+        {
+            dmSound::NewSoundData(sounds[i].m_Data, sounds[i].m_Size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &sound_data[i], i);
+        }
+
+        dmArray<dmSound::HSoundInstance> instances;
+        instances.SetCapacity(voice_count);
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            dmSound::HSoundInstance instance = 0;
+            dmSound::NewSoundInstance(sound_data[i % sound_count], &instance);
+            dmSound::SetLooping(instance, 1, -1);
+            dmSound::Play(instance);
+            instances.Push(instance);
+        }
+
+        // Warm up
+        dmSound::Update();
+
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t i = 0; i < BUFFER_COUNT; ++i)
+        {
+            dmSound::Update();
+        }
+        uint64_t time = (dmTime::GetTime() - start) / BUFFER_COUNT;
+
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            dmSound::DeleteSoundInstance(instances[i]);
+        }
+        for (uint32_t i = 0; i < sound_count; ++i)
+        {
+            dmSound::DeleteSoundData(sound_data[i]);
+        }
+        dmSound::Finalize();
+        return time;
+    }
+};
+
+TEST_F(dmSoundMixTest, MixPerBuffer)
+{
+    const uint32_t voice_counts[] = {1, 8, 16, 32, 64};
+    const uint32_t thread_counts[] = {0, 1, 3};
+    const float buffer_time = FRAME_COUNT * 1000.0f / 44100.0f;
+
+    printf("Mix time per buffer (%u frames, %.2f ms of audio)\n", FRAME_COUNT, buffer_time);
+    for (uint32_t v = 0; v < sizeof(voice_counts) / sizeof(voice_counts[0]); ++v)
+    {
+        printf("  %3u voices |", voice_counts[v]);
+        for (uint32_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+        {
+            uint64_t time = MixAndTime(voice_counts[v], thread_counts[t]);
+            printf(" %u mix threads: %7.3f ms |", thread_counts[t], time * 0.001f);
+        }
+        printf("\n");
+    }
+}
+
 extern "C" void dmExportedSymbols();
 
 int main(int argc, char **argv)
 {
     dmExportedSymbols();
+    BenchNullDevice();
     jc_test_init(&argc, argv);
     return jc_test_run_all();
 }